@@ -6,6 +6,7 @@
 #include <iostream>
 #include <vector>
 #include <assert.h>
+#include <climits>
 
 #include "clear_cache.hpp"
 
@@ -720,11 +721,54 @@ int main(int argc, char *argv[])
         for (int i = 0; i < Al->comm->recv_data->size_msgs; i++)
             recv_indices[i] = Al->off_proc_column_map[i];
 
-        if (rank == 0) printf("Level %d\n", level);
+        if (rank == 0) printf("Level %d, Num Procs %d\n", level, num_procs);
 
         // Print communication data (for model)
         print_comm_data(Al, proc_dist);
 
+        // Test ParComm construction (nonblocking consensus)
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        for (int test = 0; test < n_tests; test++)
+        {
+            ParComm* comm = new ParComm(Al->partition, Al->off_proc_column_map);
+            delete comm;
+        }
+        tfinal = (MPI_Wtime() - t0) / n_tests;
+        MPI_Reduce(&tfinal, &t0, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        if (rank == 0) printf("ParComm Setup: %e\n", t0);
+
+        // Test TAPComm construction
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        for (int test = 0; test < n_tests; test++)
+        {
+            TAPComm* tap_comm = new TAPComm(Al->partition, Al->off_proc_column_map);
+            delete tap_comm;
+        }
+        tfinal = (MPI_Wtime() - t0) / n_tests;
+        MPI_Reduce(&tfinal, &t0, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        if (rank == 0) printf("TAPComm Setup: %e\n", t0);
+
+        // Test halo exchange with packed sends, sends from the vector
+        // with indexed datatypes, and selection by message size
+        int min_bytes[3] = {INT_MAX, 0, TYPED_SEND_MIN_BYTES};
+        const char* exchange_names[3] = {"Packed", "Typed", "Auto"};
+        for (int t = 0; t < 3; t++)
+        {
+            Al->comm->send_data->typed_min_bytes = min_bytes[t];
+            Al->comm->communicate(xl);
+            MPI_Barrier(MPI_COMM_WORLD);
+            t0 = MPI_Wtime();
+            for (int test = 0; test < n_tests; test++)
+            {
+                Al->comm->communicate(xl);
+            }
+            tfinal = (MPI_Wtime() - t0) / n_tests;
+            MPI_Reduce(&tfinal, &t0, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            if (rank == 0) printf("%s Halo Exchange: %e\n", exchange_names[t], t0);
+        }
+
         // Test fully dynamic
         setup_comm_dynamic(recv_procs, recv_indptr, recv_indices, recv_requests,
                 send_procs, send_indptr, send_indices, send_requests);
@@ -14,6 +14,7 @@
 #include "gallery/laplacian27pt.hpp"
 #include "gallery/diffusion.hpp"
 #include "gallery/matrix_IO.hpp"
+#include "util/linalg/spmv_simd.hpp"
 
 //using namespace raptor;
 
@@ -146,6 +147,36 @@ int main(int argc, char *argv[])
         printf("Pointer SpMV Time: %e\n", tfinal);
     }
 
+    // Compare CSR kernels for each supported instruction set
+    // Traffic assumes vals, idx2, idx1, b, and x are each read once
+    double flops = 2.0 * A->nnz;
+    double bytes = A->nnz * (sizeof(double) + sizeof(int))
+        + (A->n_rows + 1) * sizeof(int)
+        + (A->n_rows + A->n_cols) * sizeof(double);
+    simd_t default_isa = get_simd();
+    for (int isa = NoSIMD; isa <= AVX512; isa++)
+    {
+        if (!simd_supported((simd_t) isa)) continue;
+        set_simd((simd_t) isa);
+
+        A->spmv(x_data, b_data);
+        t0 = wtime();
+        for (int j = 0; j < n_spmvs; j++)
+        {
+            A->spmv(x_data, b_data);
+        }
+        tfinal = (wtime() - t0) / n_spmvs;
+        printf("%s SpMV Time: %e, GFLOP/s: %.3f, GB/s: %.3f\n",
+                simd_name((simd_t) isa), tfinal, 
+                flops / tfinal * 1e-9, bytes / tfinal * 1e-9);
+    }
+    set_simd(default_isa);
+
+    delete[] idx1;
+    delete[] idx2;
+    delete[] vals;
+    delete[] b_ptr;
+    delete[] x_ptr;
     delete A;
 
     return 0;
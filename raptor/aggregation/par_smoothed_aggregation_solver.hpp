@@ -99,8 +99,7 @@ namespace raptor
             ParCSRMatrix* A = levels[level_ctr]->A;
             ParCSRMatrix* S;
             ParCSRMatrix* T;
-            ParCSRMatrix* P;
-            ParCSRMatrix* AP;
+            ParCSRMatrix* P = NULL;
 
             aligned_vector<int> states;
             aligned_vector<int> off_proc_states;
@@ -149,13 +148,27 @@ namespace raptor
             // Form coarse grid operator
             levels.emplace_back(new ParLevel());
 
-            if (setup_times) setup_times[5][level_ctr] -= MPI_Wtime();
-            AP = A->mult(levels[level_ctr]->P, tap_level, AP_mat_time);
-            if (setup_times) setup_times[5][level_ctr] += MPI_Wtime();
-
-            if (setup_times) setup_times[6][level_ctr] -= MPI_Wtime();
-            A = AP->mult_T(P, tap_level, PTAP_mat_time);
-            if (setup_times) setup_times[6][level_ctr] += MPI_Wtime();
+            // Fused P^T*A*P : time forming rows of A*P (and receiving
+            // rows of P for them) is recorded as A*P, and the remainder
+            // as P.T*AP
+            data_t rap_t = 0.0;
+            data_t AP_row_t = 0.0;
+            data_t rap_comm_t = 0.0;
+            data_t AP_comm_t = 0.0;
+            if (setup_times) rap_t -= MPI_Wtime();
+            if (spgemm_max_bytes)
+                A = A->rap_chunked(P, spgemm_max_bytes, tap_level, &rap_comm_t,
+                        &AP_row_t, &AP_comm_t);
+            else
+                A = A->rap(P, tap_level, &rap_comm_t, &AP_row_t, &AP_comm_t);
+            if (setup_times)
+            {
+                rap_t += MPI_Wtime();
+                setup_times[5][level_ctr] += AP_row_t + AP_comm_t;
+                setup_times[6][level_ctr] += rap_t - AP_row_t - AP_comm_t;
+                *AP_mat_time += AP_comm_t;
+                *PTAP_mat_time += rap_comm_t - AP_comm_t;
+            }
 
             level_ctr++;
             levels[level_ctr]->A = A;
@@ -183,7 +196,6 @@ namespace raptor
 
             std::copy(R.begin(), R.end(), B.begin());
 
-            delete AP;
             delete T;
             delete S;
 
@@ -3,6 +3,8 @@
 
 #include "core/comm_data.hpp"
 
+#include <cstring>
+
 namespace raptor 
 {
 template<>
@@ -83,6 +85,353 @@ void CommData::recv<double>(int key, MPI_Comm mpi_comm,
             s_recv_ptr, n_recv_ptr, block_size);
 }
 
+void CommData::start_persistent(const void* buf, MPI_Datatype datatype, int key,
+        MPI_Comm mpi_comm, const int block_size, const bool is_send,
+        const void* typed_buf, const MPI_Datatype* msg_types)
+{
+    if (num_msgs == 0) return;
+
+    int type_idx = (datatype == MPI_INT);
+    PersistentRequests& persistent = is_send ? persistent_send[type_idx]
+        : persistent_recv[type_idx];
+
+    if (persistent.buf != buf || persistent.typed_buf != typed_buf
+            || persistent.block_size != block_size
+            || persistent.mpi_comm != mpi_comm
+            || (int) persistent.requests.size() != num_msgs)
+    {
+        int start, end;
+        int type_size;
+        const char* msg_buf = (const char*) buf;
+        MPI_Type_size(datatype, &type_size);
+
+        // Keep the tag of the first requests
+        int tag = persistent.key;
+        if (tag < 0 || persistent.mpi_comm != mpi_comm)
+            tag = key;
+        free_persistent(persistent);
+
+        persistent.requests.resize(num_msgs);
+        for (int i = 0; i < num_msgs; i++)
+        {
+            start = indptr[i];
+            end = indptr[i+1];
+            if (msg_types && msg_types[i] != MPI_DATATYPE_NULL)
+            {
+                MPI_Send_init(typed_buf, 1, msg_types[i], procs[i], tag,
+                        mpi_comm, &(persistent.requests[i]));
+            }
+            else if (is_send)
+            {
+                MPI_Send_init(msg_buf + start * block_size * type_size,
+                        (end - start) * block_size, datatype, procs[i], tag,
+                        mpi_comm, &(persistent.requests[i]));
+            }
+            else
+            {
+                MPI_Recv_init((char*) msg_buf + start * block_size * type_size,
+                        (end - start) * block_size, datatype, procs[i], tag,
+                        mpi_comm, &(persistent.requests[i]));
+            }
+        }
+        persistent.buf = buf;
+        persistent.typed_buf = typed_buf;
+        persistent.block_size = block_size;
+        persistent.key = tag;
+        persistent.mpi_comm = mpi_comm;
+    }
+
+    MPI_Startall(num_msgs, persistent.requests.data());
+    active_persistent = &persistent;
+}
+
+void CommData::free_persistent(PersistentRequests& persistent)
+{
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized)
+    {
+        for (int i = 0; i < (int) persistent.requests.size(); i++)
+        {
+            if (persistent.requests[i] != MPI_REQUEST_NULL)
+                MPI_Request_free(&(persistent.requests[i]));
+        }
+    }
+    persistent.requests.clear();
+}
+
+// Converts n values to reduced precision (as described in
+// CommData::send_reduced), returning the bytes written
+int encode_reduced(const double* values, int n, halo_t precision, char* buf)
+{
+    if (precision == HaloFloat)
+    {
+        float* float_buf = (float*) buf;
+        for (int i = 0; i < n; i++)
+        {
+            float_buf[i] = (float) values[i];
+        }
+        return n * sizeof(float);
+    }
+
+    // Scale so the largest magnitude is below 2^15
+    int exponent = 0;
+    double max_val = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        max_val = std::max(max_val, fabs(values[i]));
+    }
+    if (max_val > 0.0)
+    {
+        frexp(max_val, &exponent);
+    }
+    memcpy(buf, &exponent, sizeof(int));
+
+    long q;
+    double scale = ldexp(1.0, 15 - exponent);
+    int16_t* int16_buf = (int16_t*) (buf + sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        q = lround(values[i] * scale);
+        int16_buf[i] = (int16_t) std::max(-32767L, std::min(32767L, q));
+    }
+    return sizeof(int) + n * sizeof(int16_t);
+}
+
+// Converts n values from reduced precision to double
+void decode_reduced(const char* buf, int n, halo_t precision, double* values)
+{
+    if (precision == HaloFloat)
+    {
+        const float* float_buf = (const float*) buf;
+        for (int i = 0; i < n; i++)
+        {
+            values[i] = float_buf[i];
+        }
+        return;
+    }
+
+    int exponent;
+    memcpy(&exponent, buf, sizeof(int));
+    double scale = ldexp(1.0, exponent - 15);
+    const int16_t* int16_buf = (const int16_t*) (buf + sizeof(int));
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = int16_buf[i] * scale;
+    }
+}
+
+void CommData::send_reduced(const double* values, int key, MPI_Comm mpi_comm,
+        halo_t precision, const int block_size,
+        std::function<double(double, double)> init_result_func,
+        double init_result_func_val)
+{
+    if (num_msgs == 0) return;
+
+    int start, end, pos, bytes;
+    const double* msg_values = gather_values(values, block_size, 
+            init_result_func, init_result_func_val);
+
+    reduced_buffer.resize(reduced_offset(num_msgs, precision, block_size));
+    for (int i = 0; i < num_msgs; i++)
+    {
+        start = indptr[i] * block_size;
+        end = indptr[i+1] * block_size;
+        pos = reduced_offset(i, precision, block_size);
+        bytes = encode_reduced(&(msg_values[start]), end - start, precision,
+                &(reduced_buffer[pos]));
+        MPI_Isend(&(reduced_buffer[pos]), bytes, MPI_BYTE, procs[i], key, 
+                mpi_comm, &(requests[i]));
+    }
+}
+
+void CommData::recv_reduced(int key, MPI_Comm mpi_comm, halo_t precision,
+        const int block_size)
+{
+    if (num_msgs == 0) return;
+
+    int pos, bytes;
+
+    reduced_buffer.resize(reduced_offset(num_msgs, precision, block_size));
+    for (int i = 0; i < num_msgs; i++)
+    {
+        pos = reduced_offset(i, precision, block_size);
+        bytes = reduced_offset(i+1, precision, block_size) - pos;
+        MPI_Irecv(&(reduced_buffer[pos]), bytes, MPI_BYTE, procs[i], key,
+                mpi_comm, &(requests[i]));
+    }
+}
+
+aligned_vector<double>& CommData::expand_reduced(halo_t precision, const int block_size)
+{
+    int start, end;
+    int size = size_msgs * block_size;
+    if ((int) buffer.size() < size) buffer.resize(size);
+
+    for (int i = 0; i < num_msgs; i++)
+    {
+        start = indptr[i] * block_size;
+        end = indptr[i+1] * block_size;
+        decode_reduced(&(reduced_buffer[reduced_offset(i, precision, block_size)]),
+                end - start, precision, &(buffer[start]));
+    }
+    return buffer;
+}
+
+aligned_vector<MPI_Datatype>& NonContigData::get_send_types(MPI_Datatype datatype,
+        const int block_size)
+{
+    int type_idx = (datatype == MPI_INT);
+    aligned_vector<MPI_Datatype>& types = send_types[type_idx];
+    if ((int) types.size() == num_msgs 
+            && send_types_block_size[type_idx] == block_size
+            && send_types_min_bytes[type_idx] == typed_min_bytes)
+    {
+        return types;
+    }
+
+    // Persistent sends may hold the old datatypes
+    free_persistent(persistent_send[type_idx]);
+    free_send_types(types);
+
+    int start, end, size;
+    int type_size;
+    aligned_vector<int> displs;
+    MPI_Type_size(datatype, &type_size);
+
+    types.resize(num_msgs, MPI_DATATYPE_NULL);
+    for (int i = 0; i < num_msgs; i++)
+    {
+        start = indptr[i];
+        end = indptr[i+1];
+        size = end - start;
+        if ((long) size * block_size * type_size < typed_min_bytes)
+        {
+            continue;
+        }
+
+        displs.resize(size);
+        for (int j = 0; j < size; j++)
+        {
+            displs[j] = indices[start + j] * block_size;
+        }
+        MPI_Type_create_indexed_block(size, block_size, displs.data(), datatype,
+                &(types[i]));
+        MPI_Type_commit(&(types[i]));
+    }
+    send_types_block_size[type_idx] = block_size;
+    send_types_min_bytes[type_idx] = typed_min_bytes;
+
+    return types;
+}
+
+void NonContigData::free_send_types(aligned_vector<MPI_Datatype>& types)
+{
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized)
+    {
+        for (int i = 0; i < (int) types.size(); i++)
+        {
+            if (types[i] != MPI_DATATYPE_NULL)
+                MPI_Type_free(&(types[i]));
+        }
+    }
+    types.clear();
+}
+
+int nbx_tag_delete(MPI_Comm /*mpi_comm*/, int /*keyval*/, void* attr, 
+        void* /*extra*/)
+{
+    delete (int*) attr;
+    return MPI_SUCCESS;
+}
+
+// Tag for the next nonblocking consensus on mpi_comm, alternating 
+// between key and key+1.  A process may start the next exchange on 
+// mpi_comm before another has seen the barrier of the last complete,
+// so consecutive exchanges must not match each other's messages.
+int nbx_tag(int key, MPI_Comm mpi_comm)
+{
+    static int keyval = MPI_KEYVAL_INVALID;
+    int* parity;
+    int flag;
+
+    if (keyval == MPI_KEYVAL_INVALID)
+    {
+        MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, nbx_tag_delete,
+                &keyval, NULL);
+    }
+
+    MPI_Comm_get_attr(mpi_comm, keyval, &parity, &flag);
+    if (!flag)
+    {
+        parity = new int(0);
+        MPI_Comm_set_attr(mpi_comm, keyval, parity);
+    }
+    *parity = !(*parity);
 
+    return key + *parity;
+}
+
+void NonContigData::probe_nbx(const CommData* recv_data, const int* values,
+        int key, MPI_Comm mpi_comm)
+{
+    int proc, start, end, count;
+    int msg_avail, sends_done, finished;
+    int tag = nbx_tag(key, mpi_comm);
+    bool barrier_active = false;
+    MPI_Request barrier_request;
+    MPI_Status recv_status;
+    aligned_vector<MPI_Request> send_requests(recv_data->num_msgs);
+
+    // Synchronous sends complete only once matched by a recv
+    for (int i = 0; i < recv_data->num_msgs; i++)
+    {
+        proc = recv_data->procs[i];
+        start = recv_data->indptr[i];
+        end = recv_data->indptr[i+1];
+        MPI_Issend(&(values[start]), end - start, MPI_INT, proc, tag,
+                mpi_comm, &(send_requests[i]));
+    }
+
+    size_msgs = 0;
+    indptr[0] = 0;
+    finished = false;
+    while (!finished)
+    {
+        MPI_Iprobe(MPI_ANY_SOURCE, tag, mpi_comm, &msg_avail, &recv_status);
+        if (msg_avail)
+        {
+            proc = recv_status.MPI_SOURCE;
+            MPI_Get_count(&recv_status, MPI_INT, &count);
+            indices.resize(size_msgs + count);
+            MPI_Recv(&(indices[size_msgs]), count, MPI_INT, proc, tag, 
+                    mpi_comm, &recv_status);
+            size_msgs += count;
+            procs.emplace_back(proc);
+            indptr.emplace_back(size_msgs);
+        }
+
+        // Once all of my messages are received, enter the barrier.
+        // It completes when every process' messages are received.
+        if (barrier_active)
+        {
+            MPI_Test(&barrier_request, &finished, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            MPI_Testall(recv_data->num_msgs, send_requests.data(), &sends_done, 
+                    MPI_STATUSES_IGNORE);
+            if (sends_done)
+            {
+                MPI_Ibarrier(mpi_comm, &barrier_request);
+                barrier_active = true;
+            }
+        }
+    }
+    num_msgs = procs.size();
+    finalize();
+}
 
 }
@@ -5,6 +5,11 @@
 
 #define WITH_MPI 1
 
+// Messages of NonContigData of at least this many bytes are sent 
+// directly from the values with an indexed datatype, rather than 
+// packed into a contiguous buffer
+#define TYPED_SEND_MIN_BYTES 8192
+
 #include <mpi.h>
 #include "types.hpp"
 #include "vector.hpp"
@@ -17,6 +22,32 @@
  **************************************************************/
 namespace raptor
 {
+/**************************************************************
+ *****   PersistentRequests Struct
+ **************************************************************
+ ***** Persistent requests for the messages of a halo send or
+ ***** recv, along with the buffer, block size and communicator
+ ***** they were formed for, and the (fixed) tag of the messages
+ **************************************************************/
+struct PersistentRequests
+{
+    PersistentRequests()
+    {
+        buf = NULL;
+        typed_buf = NULL;
+        block_size = 0;
+        key = -1;
+        mpi_comm = MPI_COMM_NULL;
+    }
+
+    aligned_vector<MPI_Request> requests;
+    const void* buf;
+    const void* typed_buf;
+    int block_size;
+    int key;
+    MPI_Comm mpi_comm;
+};
+
     // Forward Declaration
 class CommData
 {
@@ -33,10 +64,14 @@ public:
         num_msgs = 0;
         size_msgs = 0;
         indptr.emplace_back(0);
+        active_persistent = NULL;
+        n_mat_requests = 0;
     }
 
     CommData(CommData* data)
     {
+        active_persistent = NULL;
+        n_mat_requests = 0;
         num_msgs = data->num_msgs;
         size_msgs = data->size_msgs;
         std::copy(data->procs.begin(), data->procs.end(),
@@ -63,6 +98,11 @@ public:
     **************************************************************/
     virtual ~CommData()
     {
+        for (int i = 0; i < 2; i++)
+        {
+            free_persistent(persistent_send[i]);
+            free_persistent(persistent_recv[i]);
+        }
     };
 
     virtual void add_msg(int proc, int msg_size, int* msg_indices = NULL) = 0;
@@ -121,12 +161,6 @@ public:
             const double* values, 
             int key, MPI_Comm mpi_comm, 
             const int block_size = 1) = 0;
-    virtual void send(char* send_buffer,
-            const int* rowptr, 
-            const int* col_indices,
-            double const* const* values, 
-            int key, MPI_Comm mpi_comm, 
-            const int block_size = 1) = 0;
     virtual int get_msg_size(const int* rowptr, 
             const bool has_vals, MPI_Comm mpi_comm, 
             const int block_size = 1) = 0;
@@ -137,20 +171,12 @@ public:
     {
         if (num_msgs == 0) return;
 
-        int proc, start, end;
         int size = size_msgs * block_size;
         MPI_Datatype datatype = get_type<T>();
         aligned_vector<T>& buf = get_buffer<T>();
         if (buf.size() < size) buf.resize(size);
 
-        for (int i = 0; i < num_msgs; i++)
-        {
-            proc = procs[i];
-            start = indptr[i];
-            end = indptr[i+1];
-            MPI_Irecv(&(buf[start*block_size]), (end - start) * block_size, datatype,
-                    proc, key, mpi_comm, &(requests[i]));
-        }
+        start_persistent(buf.data(), datatype, key, mpi_comm, block_size, false);
     }   
 
     template <typename T>
@@ -167,106 +193,263 @@ public:
             std::function<bool(int)> compare_func,
             int* s_recv_ptr, int* n_recv_ptr, const int block_size = 1) = 0;
 
+    /**************************************************************
+    *****   CommData Recv (Matrix)
+    **************************************************************
+    ***** Receives the rows of a matrix communication.  The size of
+    ***** each row is received first (directly into the row pointer
+    ***** of recv_mat), after which the column indices and values of 
+    ***** each message are received directly into recv_mat
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** recv_mat : CSRMatrix*
+    *****    Matrix with a row for each index recvd (size_msgs rows)
+    ***** key : int
+    *****    Tag of the communication
+    ***** mpi_comm : MPI_Comm
+    *****    Communicator of the messages
+    ***** block_size : int
+    *****    Number of values per nonzero (recv_mat is a BSRMatrix
+    *****    if greater than 1)
+    ***** vals : bool
+    *****    Whether values are communicated
+    **************************************************************/
     void recv(CSRMatrix* recv_mat, int key, MPI_Comm mpi_comm, const int block_size = 1,
             const bool vals = true)
     {
         if (num_msgs == 0) return;
 
-        int proc, start, end, size;
-        int ctr, row_size, row_count;
-        int count, recv_size;
-        MPI_Status recv_status;
-        aligned_vector<char> recv_buffer;
+        int start, end, nnz;
+        double* recv_vals = NULL;
+        aligned_vector<int>& idx1 = recv_mat->idx1;
 
-        recv_size = 0;
-        row_count = 0;
+        init_mat_requests(2 * num_msgs);
         for (int i = 0; i < num_msgs; i++)
         {
-            proc = procs[i];
             start = indptr[i];
             end = indptr[i+1];
-            size = end - start;
-            
-            // Recv message of any size from proc
-            MPI_Probe(proc, key, mpi_comm, &recv_status);
-            MPI_Get_count(&recv_status, MPI_PACKED, &count);
-
-            // Resize recv_buffer as needed
-            if (count > recv_buffer.size())
+            MPI_Irecv(&(idx1[start + 1]), end - start, MPI_INT, procs[i], key,
+                    mpi_comm, &(mat_requests[i]));
+        }
+        MPI_Waitall(num_msgs, mat_requests.data(), MPI_STATUSES_IGNORE);
+
+        idx1[0] = 0;
+        for (int i = 0; i < size_msgs; i++)
+        {
+            idx1[i+1] += idx1[i];
+        }
+        nnz = idx1[size_msgs];
+
+        recv_mat->idx2.resize(nnz);
+        if (vals)
+        {
+            if (block_size > 1)
             {
-                recv_buffer.resize(count);
+                BSRMatrix* recv_mat_bsr = (BSRMatrix*) recv_mat;
+                recv_mat_bsr->block_vals.resize(nnz);
+                recv_vals = recv_mat_bsr->block_vals.data();
             }
-            MPI_Recv(&(recv_buffer[0]), count, MPI_PACKED, proc, key,
-                    mpi_comm, &recv_status);
-
-            // Go through recv, adding indices to matrix recv_mat
-            ctr = 0;
-            for (int j = 0; j < size; j++)
+            else
             {
-                MPI_Unpack(recv_buffer.data(), count, &ctr, &row_size, 1, MPI_INT,
-                        mpi_comm);
-                recv_mat->idx1[row_count + 1] = recv_size + row_size;
-                row_count++;
-                recv_mat->idx2.resize(recv_size + row_size);
-                MPI_Unpack(recv_buffer.data(), count, &ctr, &recv_mat->idx2[recv_size],
-                        row_size, MPI_INT, mpi_comm);
-                
-                if (vals)
-                {
-                    if (block_size > 1)
-                    {
-                        BSRMatrix* recv_mat_bsr = (BSRMatrix*) recv_mat;
-                        recv_mat_bsr->block_vals.resize(recv_size + row_size);
-                        for (int i = 0; i < row_size; i++)
-                        {
-                            recv_mat_bsr->block_vals[recv_size + i] = new double[block_size];
-                            MPI_Unpack(recv_buffer.data(), count, &ctr, 
-                                    recv_mat_bsr->block_vals[recv_size + i],
-                                    block_size, MPI_DOUBLE, mpi_comm);
-                        }
-                    }
-                    else
-                    {
-                        recv_mat->vals.resize(recv_size + row_size);
-                        MPI_Unpack(recv_buffer.data(), count, &ctr, &recv_mat->vals[recv_size],
-                                row_size, MPI_DOUBLE, mpi_comm);
-                    }
-                }
-                recv_size += row_size;
+                recv_mat->vals.resize(nnz);
+                recv_vals = recv_mat->vals.data();
             }
         }
-        recv_mat->nnz = recv_mat->idx2.size();
+
+        for (int i = 0; i < num_msgs; i++)
+        {
+            recv_mat_rows(i, idx1.data(), recv_mat->idx2.data(), recv_vals,
+                    key, mpi_comm, block_size);
+        }
+        mat_waitall();
+        recv_mat->nnz = nnz;
     }
 
  
-    void waitall()
+    /**************************************************************
+    *****   CommData Recv Next
+    **************************************************************
+    ***** Receives whichever message of a matrix communication 
+    ***** arrives next (rather than waiting on messages in order), 
+    ***** so that it can be used while others are in flight.  The 
+    ***** row sizes of all messages are received on the first call, 
+    ***** and the columns and values of the message whose row sizes
+    ***** arrive first are then received directly into recv_mat
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** recv_mat : CSRMatrix*
+    *****    Returns the rows of the message, with the global 
+    *****    columns sent
+    ***** pending : aligned_vector<int>&
+    *****    Indices of messages not yet received (the received
+    *****    message is removed).  Holds every message on the first
+    *****    call of a communication
+    ***** key : int
+    *****    Tag of the communication
+    ***** mpi_comm : MPI_Comm
+    *****    Communicator of the messages
+    *****
+    ***** Returns
+    ***** -------------
+    ***** int : index of the message received, whose rows are 
+    *****    indptr[idx] through indptr[idx+1]
+    **************************************************************/
+    int recv_next(CSRMatrix* recv_mat, aligned_vector<int>& pending, int key, 
+            MPI_Comm mpi_comm, const int block_size = 1, const bool vals = true)
     {
-        if (num_msgs)
+        int idx, start, end, size;
+        double* recv_vals = NULL;
+
+        // Recv row sizes of all messages into mat_sizes
+        if ((int) pending.size() == num_msgs)
         {
-            MPI_Waitall(num_msgs, requests.data(), MPI_STATUSES_IGNORE);
+            mat_sizes.resize(size_msgs);
+            init_mat_requests(num_msgs);
+            for (int i = 0; i < num_msgs; i++)
+            {
+                start = indptr[i];
+                end = indptr[i+1];
+                MPI_Irecv(&(mat_sizes[start]), end - start, MPI_INT, procs[i], 
+                        key, mpi_comm, &(mat_requests[i]));
+            }
         }
+
+        // Completed requests are null, so only pending messages match
+        MPI_Waitany(num_msgs, mat_requests.data(), &idx, MPI_STATUS_IGNORE);
+        pending.erase(std::find(pending.begin(), pending.end(), idx));
+
+        start = indptr[idx];
+        end = indptr[idx+1];
+        size = end - start;
+        recv_mat->n_rows = size;
+        recv_mat->idx1.resize(size + 1);
+        recv_mat->idx1[0] = 0;
+        for (int i = 0; i < size; i++)
+        {
+            recv_mat->idx1[i+1] = recv_mat->idx1[i] + mat_sizes[start + i];
+        }
+        recv_mat->nnz = recv_mat->idx1[size];
+        recv_mat->idx2.resize(recv_mat->nnz);
+        if (vals)
+        {
+            recv_mat->vals.resize(recv_mat->nnz * block_size);
+            recv_vals = recv_mat->vals.data();
+        }
+
+        // Recv columns and values of the message
+        MPI_Request row_requests[2];
+        int n_recvs = recv_mat_rows(recv_mat->nnz, procs[idx], recv_mat->idx2.data(), 
+                recv_vals, key, mpi_comm, block_size, row_requests);
+        MPI_Waitall(n_recvs, row_requests, MPI_STATUSES_IGNORE);
+
+        return idx;
     }
-    void waitall(int n_msgs)
+
+    // Bytes of a matrix send buffer holding the values (block_size
+    // per nonzero, if any), row sizes, and column indices of n_rows 
+    // rows with nnz nonzeros, rounded so values following in the 
+    // same buffer remain aligned
+    static int mat_buffer_bytes(int n_rows, int nnz, const bool has_vals,
+            const int block_size)
     {
-        if (n_msgs)
+        int bytes = (n_rows + nnz) * sizeof(int);
+        if (has_vals)
         {
-            MPI_Waitall(n_msgs, requests.data(), MPI_STATUSES_IGNORE);
+            bytes += nnz * block_size * sizeof(double);
         }
+        return ((bytes + sizeof(double) - 1) / sizeof(double)) * sizeof(double);
     }
 
-    void pack_values(const double* values, int row_start, int size, char* send_buffer,
-           int bytes, int* ctr, MPI_Comm mpi_comm, int block_size)
+    // Prepares mat_requests for up to n requests of a matrix 
+    // communication
+    void init_mat_requests(int n)
     {
-        MPI_Pack(&(values[row_start]), size, MPI_DOUBLE, send_buffer, 
-                bytes, ctr, mpi_comm);
+        if ((int) mat_requests.size() < n)
+        {
+            mat_requests.resize(n);
+        }
+        n_mat_requests = 0;
     }
-    void pack_values(double const* const* values, int row_start, int size, 
-            char* send_buffer, int bytes, int* ctr, MPI_Comm mpi_comm, int block_size)
+
+    // Sends message i of a matrix communication as its row sizes,
+    // followed by the column indices and values of its nnz nonzeros
+    // (unless empty).  Values are not sent if vals is NULL.
+    void send_mat_msg(int i, const int* sizes, const int* cols, const double* vals,
+            int nnz, int key, MPI_Comm mpi_comm, const int block_size)
     {
-        for (int i = 0; i < size; i++)
+        int proc = procs[i];
+        MPI_Isend(sizes, indptr[i+1] - indptr[i], MPI_INT, proc, key, mpi_comm, 
+                &(mat_requests[n_mat_requests++]));
+        if (nnz)
+        {
+            MPI_Isend(cols, nnz, MPI_INT, proc, key, mpi_comm, 
+                    &(mat_requests[n_mat_requests++]));
+            if (vals)
+            {
+                MPI_Isend(vals, nnz * block_size, MPI_DOUBLE, proc, key, mpi_comm,
+                        &(mat_requests[n_mat_requests++]));
+            }
+        }
+    }
+
+    // Receives the column indices and values (unless vals is NULL)
+    // of the nnz nonzeros of a message from proc, returning the 
+    // number of requests started
+    int recv_mat_rows(int nnz, int proc, int* cols, double* vals, int key, 
+            MPI_Comm mpi_comm, const int block_size, MPI_Request* row_requests)
+    {
+        if (nnz == 0) return 0;
+
+        MPI_Irecv(cols, nnz, MPI_INT, proc, key, mpi_comm, &(row_requests[0]));
+        if (vals == NULL) return 1;
+
+        MPI_Irecv(vals, nnz * block_size, MPI_DOUBLE, proc, key, mpi_comm, 
+                &(row_requests[1]));
+        return 2;
+    }
+
+    // Receives message i into rows indptr[i] through indptr[i+1] of
+    // a matrix with row pointer rowptr
+    void recv_mat_rows(int i, const int* rowptr, int* cols, double* vals, int key,
+            MPI_Comm mpi_comm, const int block_size)
+    {
+        int row_start = rowptr[indptr[i]];
+        int row_end = rowptr[indptr[i+1]];
+        n_mat_requests += recv_mat_rows(row_end - row_start, procs[i], 
+                &(cols[row_start]), vals ? &(vals[row_start * block_size]) : NULL,
+                key, mpi_comm, block_size, &(mat_requests[n_mat_requests]));
+    }
+
+    // Waits for the requests of a matrix communication
+    void mat_waitall()
+    {
+        if (n_mat_requests)
+        {
+            MPI_Waitall(n_mat_requests, mat_requests.data(), MPI_STATUSES_IGNORE);
+        }
+        n_mat_requests = 0;
+    }
+
+    void waitall()
+    {
+        if (active_persistent)
+        {
+            MPI_Waitall(num_msgs, active_persistent->requests.data(), 
+                    MPI_STATUSES_IGNORE);
+            active_persistent = NULL;
+        }
+        else if (num_msgs)
+        {
+            MPI_Waitall(num_msgs, requests.data(), MPI_STATUSES_IGNORE);
+        }
+    }
+    void waitall(int n_msgs)
+    {
+        if (n_msgs)
         {
-            MPI_Pack(values[row_start + i], block_size, MPI_DOUBLE, send_buffer,
-                    bytes, ctr, mpi_comm);
+            MPI_Waitall(n_msgs, requests.data(), MPI_STATUSES_IGNORE);
         }
     }
 
@@ -288,6 +471,95 @@ public:
         pack_buffer.resize(size_msgs);
     }
 
+    /**************************************************************
+    *****   CommData Send Reduced
+    **************************************************************
+    ***** Sends double values in reduced precision, completed by 
+    ***** waitall().  Each message holds block_size values per index
+    ***** as floats (HaloFloat), or as 16-bit integers (HaloScaled16)
+    ***** scaled by a power of two, stored as an int at the start of
+    ***** the message, chosen so its largest magnitude fits.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** values : const double*
+    *****    Values to be sent (gathered as in send)
+    ***** key : int
+    *****    Tag of the messages
+    ***** mpi_comm : MPI_Comm
+    *****    Communicator of the messages
+    ***** precision : halo_t
+    *****    HaloFloat or HaloScaled16
+    ***** block_size : int
+    *****    Number of values per index
+    **************************************************************/
+    void send_reduced(const double* values, int key, MPI_Comm mpi_comm,
+            halo_t precision, const int block_size = 1,
+            std::function<double(double, double)> init_result_func = 
+                &sum_func<double, double>,
+            double init_result_func_val = 0);
+
+    // Recvs values sent by send_reduced, which expand_reduced converts
+    // to double (in buffer) once completed by waitall()
+    void recv_reduced(int key, MPI_Comm mpi_comm, halo_t precision,
+            const int block_size = 1);
+    aligned_vector<double>& expand_reduced(halo_t precision, const int block_size = 1);
+
+    // Start of message i in reduced_buffer
+    int reduced_offset(int i, halo_t precision, const int block_size)
+    {
+        int bytes = indptr[i] * block_size;
+        if (precision == HaloFloat)
+        {
+            return bytes * sizeof(float);
+        }
+        return i * sizeof(int) + bytes * sizeof(int16_t);
+    }
+
+    // Returns the double values sent by each message, contiguous by
+    // message (block_size per index), gathering them as in send
+    virtual const double* gather_values(const double* values, const int block_size,
+            std::function<double(double, double)> init_result_func,
+            double init_result_func_val) = 0;
+
+    /**************************************************************
+    *****   CommData Start Persistent
+    **************************************************************
+    ***** Starts the messages of a halo send or recv of block_size
+    ***** values per index, reusing persistent requests.  Requests 
+    ***** are formed on first use, and are formed again whenever the
+    ***** buffer, block size, or communicator changes.  Completed 
+    ***** by waitall().
+    *****
+    ***** The tag is the key of the first exchange, and is kept when 
+    ***** requests are formed again, as a buffer may be reallocated
+    ***** on only some processes
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** buf : const void*
+    *****    Start of the values of the first message
+    ***** datatype : MPI_Datatype
+    *****    MPI_DOUBLE or MPI_INT
+    ***** key : int
+    *****    Tag of the messages, if the requests are new
+    ***** mpi_comm : MPI_Comm
+    *****    Communicator of the messages
+    ***** block_size : int
+    *****    Number of values per index
+    ***** is_send : bool
+    *****    Whether the messages are sent (or received)
+    ***** typed_buf : const void* (optional)
+    *****    Buffer of messages with a derived datatype
+    ***** msg_types : const MPI_Datatype* (optional)
+    *****    Derived datatype of each message (a single element from 
+    *****    typed_buf), or MPI_DATATYPE_NULL for messages in buf
+    **************************************************************/
+    void start_persistent(const void* buf, MPI_Datatype datatype, int key, 
+            MPI_Comm mpi_comm, const int block_size, const bool is_send,
+            const void* typed_buf = NULL, const MPI_Datatype* msg_types = NULL);
+    void free_persistent(PersistentRequests& persistent);
+
     int num_msgs;
     int size_msgs;
     aligned_vector<int> procs;
@@ -296,7 +568,19 @@ public:
     aligned_vector<double> buffer;
     aligned_vector<int> int_buffer;
     aligned_vector<char> pack_buffer;
-
+    aligned_vector<char> reduced_buffer;
+
+    // Requests of a matrix communication (n_mat_requests started),
+    // and row sizes recvd by recv_next
+    aligned_vector<MPI_Request> mat_requests;
+    int n_mat_requests;
+    aligned_vector<int> mat_sizes;
+
+    // Persistent requests of halo sends and recvs, for double
+    // values [0] and int values [1], and the set last started
+    PersistentRequests persistent_send[2];
+    PersistentRequests persistent_recv[2];
+    PersistentRequests* active_persistent;
 };
 
 class ContigData : public CommData
@@ -413,6 +697,13 @@ public:
         send(values, key, mpi_comm, states, compare_func, n_send_ptr, block_size);
     }        
 
+    const double* gather_values(const double* values, const int /*block_size*/,
+            std::function<double(double, double)> /*init_result_func*/,
+            double /*init_result_func_val*/)
+    {
+        return values;
+    }
+
     template <typename T>
     void send(const T* values, int key, MPI_Comm mpi_comm, const int block_size = 1,
             std::function<T(T, T)> init_result_func = &sum_func<T, T>,
@@ -420,20 +711,9 @@ public:
     {
         if (num_msgs == 0) return;
 
-        int start, end;
-        int proc, idx;
-        int size = size_msgs * block_size;
-
-        MPI_Datatype datatype = get_type<T>();
-
-        for (int i = 0; i < num_msgs; i++)
-        {
-            proc = procs[i];
-            start = indptr[i];
-            end = indptr[i+1];
-            MPI_Isend(&(values[start*block_size]), (end - start) * block_size,
-                    datatype, proc, key, mpi_comm, &(requests[i]));
-        }
+        // Values are sent in place (requests are formed again if
+        // values moves)
+        start_persistent(values, get_type<T>(), key, mpi_comm, block_size, true);
     }
 
 
@@ -508,44 +788,18 @@ public:
                 mpi_comm, block_size);
     }
 
-    void send(char* send_buffer,
-        const int* rowptr,
-        const int* col_indices,
-        double const* const* values,
-        int key, MPI_Comm mpi_comm,
-        const int block_size = 1)     
-    {
-        send_helper(send_buffer, rowptr, col_indices, values, key,
-                mpi_comm, block_size);
-    }
 
-    int get_msg_size(const int* rowptr, const bool has_vals, MPI_Comm mpi_comm, 
+    int get_msg_size(const int* rowptr, const bool has_vals, MPI_Comm /*mpi_comm*/, 
             const int block_size = 1)
     {
-        int start, end;
-        int row_start, row_end;
-        int num_ints, num_doubles;
-        int double_bytes, bytes;
-
-        // Calculate total msg size
-        start = indptr[0];
-        end = indptr[num_msgs];
-        row_start = rowptr[start];
-        row_end = rowptr[end];
-        num_ints = (row_end - row_start) + (end - start);
-        num_doubles = (row_end - row_start) * block_size;
-        MPI_Pack_size(num_ints, MPI_INT, mpi_comm, &bytes);
-
-        if (has_vals)
-        {
-            MPI_Pack_size(num_doubles, MPI_DOUBLE, mpi_comm, &double_bytes);
-            bytes += double_bytes;
-        }
-
-        return bytes;
+        int start = indptr[0];
+        int end = indptr[num_msgs];
+        return mat_buffer_bytes(end - start, rowptr[end] - rowptr[start], 
+                has_vals, block_size);
     }
 
-    // values can be double* (CSRMatrix) or double** (BSRMatrix)
+    // The values, row sizes, and columns of the (contiguous) rows sent
+    // are copied into the send buffer (laid out as in mat_buffer_bytes)
     template <typename T>
     void send_helper(char* send_buffer,
         const int* rowptr,
@@ -556,38 +810,37 @@ public:
     {   
         if (num_msgs == 0) return;
 
-        int start, end, proc;
-        int ctr, prev_ctr, size;
+        int start, end;
         int row_start, row_end;
-        int bytes;
-
-        bytes = get_msg_size(rowptr, values, mpi_comm, block_size);
+        int first_row = indptr[0];
+        int first_nnz = rowptr[first_row];
+        int n_rows = indptr[num_msgs] - first_row;
+        int nnz = rowptr[indptr[num_msgs]] - first_nnz;
+
+        double* send_vals = (double*) send_buffer;
+        int* send_sizes = (int*) (values ? &(send_vals[nnz * block_size]) : send_vals);
+        int* send_cols = &(send_sizes[n_rows]);
+        for (int j = 0; j < n_rows; j++)
+        {
+            send_sizes[j] = rowptr[first_row + j + 1] - rowptr[first_row + j];
+        }
+        std::copy(&(col_indices[first_nnz]), &(col_indices[first_nnz + nnz]), send_cols);
+        if (values)
+        {
+            std::copy(&(values[first_nnz * block_size]), 
+                    &(values[(first_nnz + nnz) * block_size]), send_vals);
+        }
 
-        ctr = 0;
-        prev_ctr = 0;
+        init_mat_requests(3 * num_msgs);
         for (int i = 0; i < num_msgs; i++)
         {
-            proc = procs[i];
             start = indptr[i];
             end = indptr[i+1];
-            for (int j = start; j < end; j++)
-            {
-                row_start = rowptr[j];
-                row_end = rowptr[j+1];
-                size = row_end - row_start;
-                MPI_Pack(&size, 1, MPI_INT, send_buffer, bytes, 
-                        &ctr, mpi_comm);
-                MPI_Pack(&(col_indices[row_start]), size, MPI_INT,
-                        send_buffer, bytes, &ctr, mpi_comm);
-                if (values)
-                {
-                    pack_values(values, row_start, size, send_buffer, bytes, 
-                            &ctr, mpi_comm, block_size);
-                }
-            }
-            MPI_Isend(&(send_buffer[prev_ctr]), ctr - prev_ctr, MPI_PACKED, proc, 
-                    key, mpi_comm, &(requests[i]));
-            prev_ctr = ctr;
+            row_start = rowptr[start] - first_nnz;
+            row_end = rowptr[end] - first_nnz;
+            send_mat_msg(i, &(send_sizes[start - first_row]), &(send_cols[row_start]),
+                    values ? &(send_vals[row_start * block_size]) : NULL,
+                    row_end - row_start, key, mpi_comm, block_size);
         }
     } 
 
@@ -668,16 +921,32 @@ class NonContigData : public CommData
 public:
     NonContigData() : CommData()
     {
+        typed_min_bytes = TYPED_SEND_MIN_BYTES;
+        for (int i = 0; i < 2; i++)
+        {
+            send_types_block_size[i] = 0;
+            send_types_min_bytes[i] = 0;
+        }
     }
 
     NonContigData(NonContigData* data) : CommData(data)
     {
         std::copy(data->indices.begin(), data->indices.end(),
                 std::back_inserter(indices));
+        typed_min_bytes = data->typed_min_bytes;
+        for (int i = 0; i < 2; i++)
+        {
+            send_types_block_size[i] = 0;
+            send_types_min_bytes[i] = 0;
+        }
     }
 
     ~NonContigData()
     {
+        for (int i = 0; i < 2; i++)
+        {
+            free_send_types(send_types[i]);
+        }
     }
 
     NonContigData* copy()
@@ -767,6 +1036,30 @@ public:
         finalize();
     }
 
+    /**************************************************************
+    *****   NonContigData Probe NBX
+    **************************************************************
+    ***** Forms the messages of this send data when the number of
+    ***** processes sending to it is not known, with a nonblocking
+    ***** consensus (synchronous sends and a nonblocking barrier).
+    ***** Cost scales with the number of neighbors rather than the
+    ***** number of processes in mpi_comm.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** recv_data : const CommData*
+    *****    Messages this process receives (procs and indptr)
+    ***** values : const int*
+    *****    Indices requested from each process in recv_data, 
+    *****    contiguous by message
+    ***** key : int
+    *****    Tag of the exchange
+    ***** mpi_comm : MPI_Comm
+    *****    Communicator (all processes must call probe_nbx)
+    **************************************************************/
+    void probe_nbx(const CommData* recv_data, const int* values, int key, 
+            MPI_Comm mpi_comm);
+
     void int_send(const int* values, int key, MPI_Comm mpi_comm, const int block_size,
             std::function<int(int, int)> init_result_func,
             int init_result_func_val)
@@ -794,25 +1087,30 @@ public:
         send(values, key, mpi_comm, states, compare_func, n_send_ptr, block_size);
     }     
 
-    template <typename T>
-    void send(const T* values, int key, MPI_Comm mpi_comm, const int block_size = 1,
-            std::function<T(T, T)> init_result_func = &sum_func<T, T>,
-            T init_result_func_val = 0)
+    const double* gather_values(const double* values, const int block_size,
+            std::function<double(double, double)> /*init_result_func*/,
+            double /*init_result_func_val*/)
     {
-	if (num_msgs == 0) return;
-
+        pack_values(values, buffer, block_size);
+        return buffer.data();
+    }
 
+    // Gathers the block_size values per index of each message into
+    // buf, skipping messages sent from values with a datatype
+    // (types[i] not MPI_DATATYPE_NULL, if types is given)
+    template <typename T>
+    void pack_values(const T* values, aligned_vector<T>& buf, const int block_size,
+            const MPI_Datatype* types = NULL)
+    {
         int start, end;
-        int proc, idx, pos;
+        int idx, pos;
         int size = size_msgs * block_size;
-
-        MPI_Datatype datatype = get_type<T>();
-        aligned_vector<T>& buf = get_buffer<T>();
-        if (buf.size() < size) buf.resize(size);
+        if ((int) buf.size() < size) buf.resize(size);
 
         for (int i = 0; i < num_msgs; i++)
         {
-            proc = procs[i];
+            if (types && types[i] != MPI_DATATYPE_NULL) continue;
+
             start = indptr[i];
             end = indptr[i+1];
             for (int j = start; j < end; j++)
@@ -824,11 +1122,37 @@ public:
                     buf[pos + k] = values[idx + k];
                 }
             }
-            MPI_Isend(&(buf[start*block_size]), (end - start) * block_size,
-                    datatype, proc, key, mpi_comm, &(requests[i]));
         }
     }
 
+    template <typename T>
+    void send(const T* values, int key, MPI_Comm mpi_comm, const int block_size = 1,
+            std::function<T(T, T)> /*init_result_func*/ = &sum_func<T, T>,
+            T /*init_result_func_val*/ = 0)
+    {
+	if (num_msgs == 0) return;
+
+        MPI_Datatype datatype = get_type<T>();
+        aligned_vector<T>& buf = get_buffer<T>();
+        aligned_vector<MPI_Datatype>& types = get_send_types(datatype, block_size);
+
+        // Large messages are sent from values with their datatype.
+        // Only these read from values, so if all messages are packed,
+        // requests are kept when values change.
+        pack_values(values, buf, block_size, types.data());
+        const T* typed_buf = NULL;
+        for (int i = 0; i < num_msgs; i++)
+        {
+            if (types[i] != MPI_DATATYPE_NULL)
+            {
+                typed_buf = values;
+                break;
+            }
+        }
+        start_persistent(buf.data(), datatype, key, mpi_comm, block_size, true,
+                typed_buf, types.data());
+    }
+
     template <typename T>
     void send(const T* values, int key, MPI_Comm mpi_comm,
             const aligned_vector<int>& states, std::function<bool(int)> compare_func,
@@ -903,45 +1227,28 @@ public:
                 mpi_comm, block_size);
     }
 
-    void send(char* send_buffer,
-        const int* rowptr,
-        const int* col_indices,
-        double const* const* values,
-        int key, MPI_Comm mpi_comm,
-        const int block_size = 1)     
-    {
-        send_helper(send_buffer, rowptr, col_indices, values, key,
-                mpi_comm, block_size);
-    }
 
-    int get_msg_size(const int* rowptr, const bool has_vals, MPI_Comm mpi_comm,
-            const int block_size = 1)
+    // Number of nonzeros in the rows sent
+    int get_send_nnz(const int* rowptr)
     {
-        int start, end;
-        int row_start, row_end;
-        int num_ints, num_doubles;
-        int double_bytes, bytes;
-
-        // Calculate message size
-        num_ints = indptr[num_msgs] - indptr[0];
-        num_doubles = 0;
+        int nnz = 0;
         for (aligned_vector<int>::iterator it = indices.begin();
                 it != indices.end(); ++it)
         {
-            num_doubles += (rowptr[*it+1] - rowptr[*it]);
-        }
-        num_ints += num_doubles;
-        MPI_Pack_size(num_ints, MPI_INT, mpi_comm, &bytes);
-
-        if (has_vals)
-        {
-            MPI_Pack_size(num_doubles * block_size, MPI_DOUBLE, mpi_comm, &double_bytes);
-            bytes += double_bytes;
+            nnz += (rowptr[*it+1] - rowptr[*it]);
         }
+        return nnz;
+    }
 
-        return bytes;
+    int get_msg_size(const int* rowptr, const bool has_vals, MPI_Comm /*mpi_comm*/,
+            const int block_size = 1)
+    {
+        return mat_buffer_bytes(indptr[num_msgs] - indptr[0], get_send_nnz(rowptr),
+                has_vals, block_size);
     }
 
+    // The values, row sizes, and columns of the rows sent are copied
+    // into the send buffer (laid out as in mat_buffer_bytes)
     template <typename T>
     void send_helper(char* send_buffer,
         const int* rowptr,
@@ -952,41 +1259,42 @@ public:
     {
         if (num_msgs == 0) return;
 
-        int start, end, proc;
-        int ctr, prev_ctr, size;
+        int start, end;
         int row, row_start, row_end;
-        int num_ints, num_doubles;
-        int double_bytes, bytes;
+        int size, nnz, msg_start;
 
-        // Resize send buffer
-        bytes = get_msg_size(rowptr, values, mpi_comm, block_size);
+        nnz = get_send_nnz(rowptr);
+        double* send_vals = (double*) send_buffer;
+        int* send_sizes = (int*) (values ? &(send_vals[nnz * block_size]) : send_vals);
+        int* send_cols = &(send_sizes[indptr[num_msgs]]);
 
-        ctr = 0;
-        prev_ctr = 0;
+        init_mat_requests(3 * num_msgs);
+        nnz = 0;
         for (int i = 0; i < num_msgs; i++)
         {
-            proc = procs[i];
             start = indptr[i];
             end = indptr[i+1];
+            msg_start = nnz;
             for (int j = start; j < end; j++)
             {
                 row = indices[j];
                 row_start = rowptr[row];
                 row_end = rowptr[row+1];
-                size = (row_end - row_start);
-                MPI_Pack(&size, 1, MPI_INT, send_buffer, bytes, 
-                        &ctr, mpi_comm);
-                MPI_Pack(&(col_indices[row_start]), size, MPI_INT, 
-                        send_buffer, bytes, &ctr, mpi_comm);
+                size = row_end - row_start;
+                send_sizes[j] = size;
+                std::copy(&(col_indices[row_start]), &(col_indices[row_end]),
+                        &(send_cols[nnz]));
                 if (values)
-                {                    
-                    pack_values(values, row_start, size, send_buffer, bytes, &ctr, 
-                            mpi_comm, block_size);
+                {
+                    std::copy(&(values[row_start * block_size]), 
+                            &(values[row_end * block_size]),
+                            &(send_vals[nnz * block_size]));
                 }
+                nnz += size;
             }
-            MPI_Isend(&(send_buffer[prev_ctr]), ctr - prev_ctr, MPI_PACKED, proc, 
-                    key, mpi_comm, &(requests[i]));
-            prev_ctr = ctr;
+            send_mat_msg(i, &(send_sizes[start]), &(send_cols[msg_start]),
+                    values ? &(send_vals[msg_start * block_size]) : NULL,
+                    nnz - msg_start, key, mpi_comm, block_size);
         }
     }
 
@@ -1061,8 +1369,33 @@ public:
         *s_recv_ptr = ctr;    
    }
 
+    /**************************************************************
+    *****   NonContigData Get Send Types
+    **************************************************************
+    ***** Returns the datatype of each message of block_size values
+    ***** per index, an MPI_Type_create_indexed_block over its 
+    ***** indices for messages of at least typed_min_bytes bytes, or
+    ***** MPI_DATATYPE_NULL for messages to be packed.  Types are 
+    ***** committed when first requested (for single doubles, when a
+    ***** ParComm is formed from a partition), and again if the block
+    ***** size or typed_min_bytes change.
+    **************************************************************/
+    aligned_vector<MPI_Datatype>& get_send_types(MPI_Datatype datatype,
+            const int block_size);
+    void free_send_types(aligned_vector<MPI_Datatype>& types);
+
     aligned_vector<int> indices;
 
+    // Minimum size (in bytes) of messages sent without packing
+    // (0 sends all messages with datatypes, INT_MAX packs all)
+    int typed_min_bytes;
+
+    // Datatypes of messages of double [0] and int [1] values, and
+    // the block size and typed_min_bytes they were formed for
+    aligned_vector<MPI_Datatype> send_types[2];
+    int send_types_block_size[2];
+    int send_types_min_bytes[2];
+
 }; 
 
 class DuplicateData : public NonContigData
@@ -1163,55 +1496,61 @@ public:
         send(values, key, mpi_comm, states, compare_func, n_send_ptr, block_size);
     }     
 
-    template <typename T>
-    void send(const T* values, int key, MPI_Comm mpi_comm, const int block_size = 1,
-            std::function<T(T, T)> init_result_func = &sum_func<T, T>,
-            T init_result_func_val = 0)
+    const double* gather_values(const double* values, const int block_size,
+            std::function<double(double, double)> init_result_func,
+            double init_result_func_val)
     {
-        if (num_msgs == 0) return;
-
+        pack_values(values, buffer, block_size, init_result_func,
+                init_result_func_val);
+        return buffer.data();
+    }
 
-        int start, end;
-        int proc, idx;
+    // Combines the block_size values of the indices of each sent
+    // position (from indptr_T) into buf
+    template <typename T>
+    void pack_values(const T* values, aligned_vector<T>& buf, const int block_size,
+            std::function<T(T, T)> init_result_func, T init_result_func_val)
+    {
+        int idx, pos;
         int idx_start, idx_end;
         int size = size_msgs * block_size;
-        int pos;
-
-        MPI_Datatype datatype = get_type<T>();
-        aligned_vector<T>& buf = get_buffer<T>();
-        if (buf.size() < size) buf.resize(size);
+        if ((int) buf.size() < size) buf.resize(size);
 
         aligned_vector<T> tmp(block_size);
-
-        for (int i = 0; i < num_msgs; i++)
+        for (int j = 0; j < size_msgs; j++)
         {
-            proc = procs[i];
-            start = indptr[i];
-            end = indptr[i+1];
-            for (int j = start; j < end; j++)
+            idx_start = indptr_T[j];
+            idx_end = indptr_T[j+1];
+            std::fill(tmp.begin(), tmp.end(), init_result_func_val);
+            for (int k = idx_start; k < idx_end; k++)
             {
-                idx_start = indptr_T[j];
-                idx_end = indptr_T[j+1];
-                std::fill(tmp.begin(), tmp.end(), init_result_func_val);
-                for (int k = idx_start; k < idx_end; k++)
-                {
-                    idx = indices[k] * block_size;
-                    for (int l = 0; l < block_size; l++)
-                    {
-                        tmp[l] = init_result_func(tmp[l], values[idx+l]);
-                    }
-                }
-                pos  = j * block_size;
-                for (int k = 0; k < block_size; k++)
+                idx = indices[k] * block_size;
+                for (int l = 0; l < block_size; l++)
                 {
-                    buf[pos + k] = tmp[k];
+                    tmp[l] = init_result_func(tmp[l], values[idx+l]);
                 }
             }
-            MPI_Isend(&(buf[start * block_size]), (end - start) * block_size,
-                   datatype, proc, key, mpi_comm, &(requests[i]));
+            pos  = j * block_size;
+            for (int k = 0; k < block_size; k++)
+            {
+                buf[pos + k] = tmp[k];
+            }
         }
     }
 
+    template <typename T>
+    void send(const T* values, int key, MPI_Comm mpi_comm, const int block_size = 1,
+            std::function<T(T, T)> init_result_func = &sum_func<T, T>,
+            T init_result_func_val = 0)
+    {
+        if (num_msgs == 0) return;
+
+        MPI_Datatype datatype = get_type<T>();
+        aligned_vector<T>& buf = get_buffer<T>();
+        pack_values(values, buf, block_size, init_result_func, init_result_func_val);
+        start_persistent(buf.data(), datatype, key, mpi_comm, block_size, true);
+    }
+
     template <typename T>
     void send(const T* values, int key, MPI_Comm mpi_comm,
             const aligned_vector<int>& states, std::function<bool(int)> compare_func,
@@ -1333,43 +1672,9 @@ public:
     {
         send_helper(send_buffer, rowptr, col_indices, values, key, mpi_comm, block_size);
     }
-    void send(char* send_buffer,
-            const int* rowptr, 
-            const int* col_indices,
-            double const* const* values, 
-            int key, MPI_Comm mpi_comm, 
-            const int block_size = 1)
-    {
-        send_helper(send_buffer, rowptr, col_indices, values, key, mpi_comm, block_size);
-    }
-
-    int get_msg_size(const int* rowptr, const bool has_vals, MPI_Comm mpi_comm, 
-            const int block_size = 1)
-    {
-        int start, end;
-        int row_start, row_end;
-        int num_ints, num_doubles;
-        int double_bytes, bytes;
-
-        // Calculate message size (upper bound)
-        num_ints = indptr[num_msgs] - indptr[0];
-        num_doubles = 0;
-        for (aligned_vector<int>::iterator it = indices.begin();
-                it != indices.end(); ++it)
-        {
-            num_doubles += (rowptr[*it+1] - rowptr[*it]);
-        }
-        num_ints += num_doubles;
-        MPI_Pack_size(num_ints, MPI_INT, mpi_comm, &bytes);
-        if (has_vals)
-        {
-            MPI_Pack_size(num_doubles * block_size, MPI_DOUBLE, mpi_comm, &double_bytes);
-            bytes += double_bytes;
-        }
-
-        return bytes;
-    }
 
+    // Rows sent to a process are combined before being copied into
+    // the send buffer (sized by get_msg_size for the uncombined rows)
     template <typename T>
     void send_helper(char* send_buffer,
             const int* rowptr, 
@@ -1380,49 +1685,46 @@ public:
     {
         if (num_msgs == 0) return;
 
-        int start, end, proc;
-        int ctr, prev_ctr, size;
-        int row, row_start, row_end;
-        int idx_start, idx_end;
-        int bytes;
+        int start, end;
+        int size, nnz, msg_start;
+        aligned_vector<int> send_indices;
+        aligned_vector<double> send_values;
 
-        // Resize send buffer
-        bytes = get_msg_size(rowptr, values, mpi_comm, block_size);
+        nnz = get_send_nnz(rowptr);
+        double* send_vals = (double*) send_buffer;
+        int* send_sizes = (int*) (values ? &(send_vals[nnz * block_size]) : send_vals);
+        int* send_cols = &(send_sizes[indptr[num_msgs]]);
 
-        ctr = 0;
-        prev_ctr = 0;
+        init_mat_requests(3 * num_msgs);
+        nnz = 0;
         for (int i = 0; i < num_msgs; i++)
         {
-            proc = procs[i];
             start = indptr[i];
             end = indptr[i+1];
+            msg_start = nnz;
             for (int j = start; j < end; j++)
             {
-                aligned_vector<int> send_indices;
-                aligned_vector<double> send_values;
-                
+                send_indices.clear();
+                send_values.clear();
                 if (values)
                 {
                     combine_entries(j, rowptr, col_indices, values, block_size,
                             send_indices, send_values, &size);
+                    std::copy(send_values.begin(), send_values.begin() + size * block_size,
+                            &(send_vals[nnz * block_size]));
                 }
                 else
                 {
                     combine_entries(j, rowptr, col_indices, send_indices, &size);
                 }
-                MPI_Pack(&size, 1, MPI_INT, send_buffer, bytes, &ctr, mpi_comm);
-                MPI_Pack(send_indices.data(), size, MPI_INT, send_buffer,
-                    bytes, &ctr, mpi_comm);
-
-                if (values)
-                {
-                    pack_values(send_values.data(), row_start, size, send_buffer, bytes, &ctr, 
-                            mpi_comm, block_size);
-                }
+                send_sizes[j] = size;
+                std::copy(send_indices.begin(), send_indices.begin() + size,
+                        &(send_cols[nnz]));
+                nnz += size;
             }
-            MPI_Isend(&(send_buffer[prev_ctr]), ctr - prev_ctr, MPI_PACKED, proc, 
-                    key, mpi_comm, &(requests[i]));
-            prev_ctr = ctr;
+            send_mat_msg(i, &(send_sizes[start]), &(send_cols[msg_start]),
+                    values ? &(send_vals[msg_start * block_size]) : NULL,
+                    nnz - msg_start, key, mpi_comm, block_size);
         }
     }
 
@@ -9,7 +9,7 @@ using namespace raptor;
 // Forward Declarations
 
 // Helper Methods
-template <typename T> aligned_vector<T>& create_mat(int n, int m, int b_n, int b_m,
+template <typename T> T& create_mat(int n, int m, int b_n, int b_m,
         CSRMatrix** mat_ptr);
 template <typename T> CSRMatrix* communication_helper(const int* rowptr,
         const int* col_indices, const T& values,
@@ -24,14 +24,14 @@ CSRMatrix* complete_comm_helper(CommData* send_comm,
         const int b_cols, const bool has_vals = true);
 
 template <typename T> CSRMatrix* transpose_recv(CSRMatrix* recv_mat_T, 
-        aligned_vector<T>& T_vals, NonContigData* send_data, int n);
+        T& T_vals, NonContigData* send_data, int n);
 template <typename T> CSRMatrix* combine_recvs(CSRMatrix* L_mat, CSRMatrix* R_mat, 
-        aligned_vector<T>& L_vals, aligned_vector<T>& R_vals, const int b_rows, 
+        T& L_vals, T& R_vals, const int b_rows, 
         const int b_cols, NonContigData* local_L_recv, NonContigData* local_R_recv, 
         aligned_vector<int>& row_sizes);
 template <typename T> CSRMatrix* combine_recvs_T(CSRMatrix* L_mat, 
         CSRMatrix* final_mat, NonContigData* local_L_send, NonContigData* final_send, 
-        aligned_vector<T>& L_vals, aligned_vector<T>& final_vals, int n, 
+        T& L_vals, T& final_vals, int n, 
         int b_rows, int b_cols);
 
 
@@ -104,7 +104,7 @@ void CommPkg::init_par_mat_comm(ParBSRMatrix* A, aligned_vector<char>& send_buff
     int nnz = A->on_proc->nnz + A->off_proc->nnz;
     aligned_vector<int> rowptr(A->local_num_rows + 1);
     aligned_vector<int> col_indices;
-    aligned_vector<double*> values;
+    BlockArray values(A->on_proc->b_size);
     if (nnz)
     {
         col_indices.resize(nnz);
@@ -124,7 +124,7 @@ void CommPkg::init_par_mat_comm(ParBSRMatrix* A, aligned_vector<char>& send_buff
         for (int j = start; j < end; j++)
         {
             global_col = A->on_proc_column_map[A->on_proc->idx2[j]];
-            if (has_vals) values[ctr] = A->on_proc->copy_val(A_on->block_vals[j]);
+            if (has_vals) A->on_proc->copy_val(A_on->block_vals[j], values[ctr]);
             col_indices[ctr++] = global_col;
         }
 
@@ -133,7 +133,7 @@ void CommPkg::init_par_mat_comm(ParBSRMatrix* A, aligned_vector<char>& send_buff
         for (int j = start; j < end; j++)
         {
             global_col = A->off_proc_column_map[A->off_proc->idx2[j]];
-            if (has_vals) values[ctr] = A->off_proc->copy_val(A_off->block_vals[j]);
+            if (has_vals) A->off_proc->copy_val(A_off->block_vals[j], values[ctr]);
             col_indices[ctr++] = global_col;
         }
         rowptr[i+1] = ctr;
@@ -151,7 +151,7 @@ CSRMatrix* ParComm::communicate(const aligned_vector<int>& rowptr,
     return complete_mat_comm(b_rows, b_cols, has_vals);
 }
 CSRMatrix* ParComm::communicate(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values, 
+        const aligned_vector<int>& col_indices, const BlockArray& values, 
         const int b_rows, const int b_cols, const bool has_vals)
 {
     aligned_vector<char> send_buffer;
@@ -171,7 +171,7 @@ void ParComm::init_mat_comm(aligned_vector<char>& send_buffer,
 }
 void ParComm::init_mat_comm(aligned_vector<char>& send_buffer,
         const aligned_vector<int>& rowptr, const aligned_vector<int>& col_indices, 
-        const aligned_vector<double*>& values, const int b_rows, const int b_cols,
+        const BlockArray& values, const int b_rows, const int b_cols,
         const bool has_vals)
 {
     int s = send_data->get_msg_size(rowptr.data(), values.data(), mpi_comm, b_rows * b_cols);
@@ -199,7 +199,7 @@ CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr,
     return complete_mat_comm_T(n_result_rows, b_rows, b_cols, has_vals);
 }
 CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+        const aligned_vector<int>& col_indices, const BlockArray& values,
         const int n_result_rows, const int b_rows, const int b_cols, const bool has_vals)
 {
     aligned_vector<char> send_buffer;
@@ -216,7 +216,7 @@ void ParComm::init_mat_comm_T(aligned_vector<char>& send_buffer, const aligned_v
             recv_data, key, mpi_comm, b_rows, b_cols);
 }
 void ParComm::init_mat_comm_T(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+        const aligned_vector<int>& col_indices, const BlockArray& values,
         const int b_rows, const int b_cols, const bool has_vals)
 {
     int s = recv_data->get_msg_size(rowptr.data(), values.data(), mpi_comm, b_rows * b_cols);
@@ -261,7 +261,7 @@ CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr,
 }
 
 CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+        const aligned_vector<int>& col_indices, const BlockArray& values,
         const int b_rows, const int b_cols, const bool has_vals)
 {   
     aligned_vector<char> send_buffer;  
@@ -307,7 +307,7 @@ void TAPComm::init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vec
 
 
 void TAPComm::init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+        const aligned_vector<int>& col_indices, const BlockArray& values,
         const int b_rows, const int b_cols, const bool has_vals)
 {  
     int block_size = b_rows * b_cols;
@@ -324,7 +324,7 @@ void TAPComm::init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vec
         send_buffer.resize(l_bytes + g_bytes);
 
         init_comm_helper(&(send_buffer[0]), S_mat->idx1.data(),
-                S_mat->idx2.data(), S_mat->vals.data(), global_par_comm->send_data, 
+                S_mat->idx2.data(), S_mat->block_vals.data(), global_par_comm->send_data, 
                 global_par_comm->key, global_par_comm->mpi_comm, b_rows, b_cols);
         delete S_mat;
     }
@@ -398,7 +398,7 @@ CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr,
 }
 
 CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+        const aligned_vector<int>& col_indices, const BlockArray& values,
         const int n_result_rows, const int b_rows, const int b_cols, const bool has_vals)
 {  
     aligned_vector<char> send_buffer;
@@ -438,7 +438,7 @@ void TAPComm::init_mat_comm_T(aligned_vector<char>& send_buffer, const aligned_v
             b_rows, b_cols);
 }
 void TAPComm::init_mat_comm_T(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+        const aligned_vector<int>& col_indices, const BlockArray& values,
         const int b_rows, const int b_cols, const bool has_vals)
 {
     int block_size = b_rows * b_cols;
@@ -510,7 +510,8 @@ CSRMatrix* TAPComm::complete_mat_comm_T(const int n_result_rows, const int b_row
 
         recv_mat = combine_recvs_T(L_mat_bsr, final_mat_bsr,
                 local_L_par_comm->send_data, final_comm->send_data,
-                L_mat_bsr->vals, final_mat_bsr->vals, n_result_rows, b_rows, b_cols);
+                L_mat_bsr->block_vals, final_mat_bsr->block_vals, n_result_rows, 
+                b_rows, b_cols);
     }
     else
     {
@@ -550,14 +551,14 @@ CSRMatrix* TAPComm::complete_mat_comm_T(const int n_result_rows, const int b_row
 
 // Helper Methods
 // Create matrix (either CSR or BSR)
-template<> aligned_vector<double>& create_mat<double>(int n, int m, int b_n, int b_m, 
-        CSRMatrix** mat_ptr)
+template<> aligned_vector<double>& create_mat<aligned_vector<double>>(int n, int m, 
+        int /*b_n*/, int /*b_m*/, CSRMatrix** mat_ptr)
 {  
     CSRMatrix* recv_mat = new CSRMatrix(n, m);
     *mat_ptr = recv_mat;
     return recv_mat->vals;
 }
-template<> aligned_vector<double*>& create_mat<double*>(int n, int m, int b_n, int b_m, 
+template<> BlockArray& create_mat<BlockArray>(int n, int m, int b_n, int b_m,
         CSRMatrix** mat_ptr)
 {  
     BSRMatrix* recv_mat = new BSRMatrix(n, m, b_n, b_m);
@@ -565,7 +566,7 @@ template<> aligned_vector<double*>& create_mat<double*>(int n, int m, int b_n, i
     return recv_mat->block_vals;
 }
 
-template <typename T> // double* or double**
+template <typename T>
 CSRMatrix* communication_helper(const int* rowptr,
         const int* col_indices, const T& values,
         CommData* send_comm, CommData* recv_comm, int key, MPI_Comm mpi_comm, 
@@ -579,7 +580,7 @@ CSRMatrix* communication_helper(const int* rowptr,
     return complete_comm_helper(send_comm, recv_comm, key, mpi_comm, 
             b_rows, b_cols, has_vals);
 }    
-template <typename T> // double* or double**
+template <typename T>
 void init_comm_helper(char* send_buffer, const int* rowptr,
         const int* col_indices, const T& values,
         CommData* send_comm, int key, MPI_Comm mpi_comm, 
@@ -603,23 +604,21 @@ CSRMatrix* complete_comm_helper(CommData* send_comm, CommData* recv_comm, int ke
 
     // Recv contents of recv_mat
     recv_comm->recv(recv_mat, key, mpi_comm, block_size, has_vals);
-    if (send_comm->num_msgs)
-        MPI_Waitall(send_comm->num_msgs, send_comm->requests.data(),
-                MPI_STATUSES_IGNORE);
+    send_comm->mat_waitall();
     return recv_mat;
 }    
 
 
 
 template <typename T>
-CSRMatrix* transpose_recv(CSRMatrix* recv_mat_T, aligned_vector<T>& T_vals,
+CSRMatrix* transpose_recv(CSRMatrix* recv_mat_T, T& T_vals,
         NonContigData* send_data, int n)
 {
     int idx, ptr;
     int start, end;
 
     CSRMatrix* recv_mat;
-    aligned_vector<T>& vals = create_mat<T>(n, -1, recv_mat_T->b_rows, 
+    T& vals = create_mat<T>(n, -1, recv_mat_T->b_rows, 
             recv_mat_T->b_cols, &recv_mat);
 
     if (n == 0) return recv_mat;
@@ -654,8 +653,8 @@ CSRMatrix* transpose_recv(CSRMatrix* recv_mat_T, aligned_vector<T>& T_vals,
         {
             ptr = recv_mat->idx1[idx] + row_sizes[idx]++;
             recv_mat->idx2[ptr] = recv_mat_T->idx2[j];
-            if (recv_mat_T->vals.size())
-                vals[ptr] = T_vals[j];
+            if (T_vals.size())
+                recv_mat->copy_val(T_vals[j], val_ptr(vals, ptr));
         }
     }
     return recv_mat;
@@ -663,7 +662,7 @@ CSRMatrix* transpose_recv(CSRMatrix* recv_mat_T, aligned_vector<T>& T_vals,
 
 template <typename T>
 CSRMatrix* combine_recvs(CSRMatrix* L_mat, CSRMatrix* R_mat, 
-        aligned_vector<T>& L_vals, aligned_vector<T>& R_vals,
+        T& L_vals, T& R_vals,
         const int b_rows, const int b_cols,
         NonContigData* local_L_recv, NonContigData* local_R_recv,
         aligned_vector<int>& row_sizes)
@@ -672,7 +671,7 @@ CSRMatrix* combine_recvs(CSRMatrix* L_mat, CSRMatrix* R_mat,
     int start, end;
 
     CSRMatrix* recv_mat;
-    aligned_vector<T>& vals = create_mat<T>(L_mat->n_rows + R_mat->n_rows, -1, b_rows, b_cols,
+    T& vals = create_mat<T>(L_mat->n_rows + R_mat->n_rows, -1, b_rows, b_cols,
             &recv_mat);
     recv_mat->nnz = L_mat->nnz + R_mat->nnz;
     int ptr;
@@ -713,7 +712,7 @@ CSRMatrix* combine_recvs(CSRMatrix* L_mat, CSRMatrix* R_mat,
             ptr = recv_mat->idx1[row] + row_sizes[row]++;
             recv_mat->idx2[ptr] = R_mat->idx2[j];
             if (vals.size()) 
-                vals[ptr] = R_mat->copy_val(R_vals[j]);
+                recv_mat->copy_val(R_vals[j], val_ptr(vals, ptr));
         }
     }
     for (int i = 0; i < L_mat->n_rows; i++)
@@ -726,7 +725,7 @@ CSRMatrix* combine_recvs(CSRMatrix* L_mat, CSRMatrix* R_mat,
             ptr = recv_mat->idx1[row] + row_sizes[row]++;
             recv_mat->idx2[ptr] = L_mat->idx2[j];
             if (vals.size())
-                vals[ptr] = L_mat->copy_val(L_vals[j]);
+                recv_mat->copy_val(L_vals[j], val_ptr(vals, ptr));
         }
     }
 
@@ -736,14 +735,14 @@ CSRMatrix* combine_recvs(CSRMatrix* L_mat, CSRMatrix* R_mat,
 template <typename T>
 CSRMatrix* combine_recvs_T(CSRMatrix* L_mat, CSRMatrix* final_mat,
         NonContigData* local_L_send, NonContigData* final_send,
-        aligned_vector<T>& L_vals, aligned_vector<T>& final_vals,
+        T& L_vals, T& final_vals,
         int n, int b_rows, int b_cols)
 {
     int row_start, row_end, row_size;
     int row, idx;
 
     CSRMatrix* recv_mat;
-    aligned_vector<T>& vals = create_mat<T>(n, -1, b_rows, b_cols,
+    T& vals = create_mat<T>(n, -1, b_rows, b_cols,
             &recv_mat);
 
     aligned_vector<int> row_sizes(n, 0);
@@ -782,7 +781,7 @@ CSRMatrix* combine_recvs_T(CSRMatrix* L_mat, CSRMatrix* final_mat,
             idx = recv_mat->idx1[row] + row_sizes[row]++;
             recv_mat->idx2[idx] = final_mat->idx2[j];
             if (final_vals.size())
-                vals[idx] = final_vals[j];
+                recv_mat->copy_val(final_vals[j], val_ptr(vals, idx));
         }
     }
     for (int i = 0; i < local_L_send->size_msgs; i++)
@@ -795,7 +794,7 @@ CSRMatrix* combine_recvs_T(CSRMatrix* L_mat, CSRMatrix* final_mat,
             idx = recv_mat->idx1[row] + row_sizes[row]++;
             recv_mat->idx2[idx] = L_mat->idx2[j];
             if (L_vals.size())
-                vals[idx] = L_vals[j];
+                recv_mat->copy_val(L_vals[j], val_ptr(vals, idx));
         }
     }
     recv_mat->nnz = recv_mat->idx2.size();
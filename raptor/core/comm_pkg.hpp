@@ -4,6 +4,7 @@
 #define RAPTOR_CORE_PARCOMM_HPP
 
 #include <mpi.h>
+#include <type_traits>
 #include "comm_data.hpp"
 #include "matrix.hpp"
 #include "partition.hpp"
@@ -39,12 +40,14 @@ namespace raptor
         {
             topology = partition->topology;
             topology->num_shared++;
+            halo_precision = HaloDouble;
         }
         
         CommPkg(Topology* _topology)
         {
             topology = _topology;
             topology->num_shared++;
+            halo_precision = HaloDouble;
         }
 
         virtual ~CommPkg()
@@ -69,13 +72,13 @@ namespace raptor
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true) = 0;
         virtual CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+                const aligned_vector<int>& col_indices, const BlockArray& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true) = 0;
         virtual void init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true) = 0;
         virtual void init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+                const aligned_vector<int>& col_indices, const BlockArray& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true) = 0;
         virtual CSRMatrix* complete_mat_comm(const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true) = 0;
@@ -85,7 +88,7 @@ namespace raptor
                 const int n_result_rows, const int b_rows = 1, const int b_cols = 1,
                 const bool has_vals = true) = 0;
         virtual CSRMatrix* communicate_T(const aligned_vector<int>& rowptr,
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values, 
+                const aligned_vector<int>& col_indices, const BlockArray& values, 
                 const int n_result_rows, const int b_rows = 1, const int b_cols = 1,
                 const bool has_vals = true) = 0;
         virtual void init_mat_comm_T(aligned_vector<char>& send_buffer, 
@@ -94,7 +97,7 @@ namespace raptor
                 const int b_cols = 1, const bool has_vals = true) = 0;
         virtual void init_mat_comm_T(aligned_vector<char>& send_buffer,
                 const aligned_vector<int>& rowptr, const aligned_vector<int>& col_indices, 
-                const aligned_vector<double*>& values, const int b_rows = 1, 
+                const BlockArray& values, const int b_rows = 1, 
                 const int b_cols = 1, const bool has_vals = true) = 0;
         virtual CSRMatrix* complete_mat_comm_T(const int n_result_rows, 
                 const int b_rows = 1, const int b_cols = 1,
@@ -104,7 +107,7 @@ namespace raptor
         {
             return A->vals;
         }
-        aligned_vector<double*> get_vals(BSRMatrix* A)
+        BlockArray& get_vals(BSRMatrix* A)
         {
             return A->block_vals;
         }
@@ -135,6 +138,11 @@ namespace raptor
         aligned_vector<double>& communicate(ParVector& v, const int block_size = 1);
         void init_comm(ParVector& v, const int block_size = 1);
 
+        // Multi-Vector Communication : the n_vecs values of each 
+        // column are sent together, one message per neighbor
+        aligned_vector<double>& communicate(ParMultiVector& v);
+        void init_comm(ParMultiVector& v);
+
         // Standard Communication
         template<typename T>
         aligned_vector<T>& communicate(const aligned_vector<T>& values, const int block_size = 1)
@@ -245,10 +253,20 @@ namespace raptor
         virtual aligned_vector<double>& get_double_buffer() = 0;
         virtual aligned_vector<int>& get_int_buffer() = 0;
 
+        // Precision of double values in vector communication (and its
+        // transpose).  HaloFloat and HaloScaled16 round the values sent
+        // (see CommData::send_reduced), to a relative error of about 
+        // 6e-8, or 3e-5 of the largest magnitude in each message.
+        virtual void set_halo_precision(halo_t precision)
+        {
+            halo_precision = precision;
+        }
+
         // Class Variables
         Topology* topology;
         aligned_vector<double> buffer;
         aligned_vector<int> int_buffer;
+        halo_t halo_precision;
     };
 
 
@@ -350,6 +368,10 @@ namespace raptor
         {
             mpi_comm = comm;
             init_par_comm(partition, off_proc_column_map, _key, comm, comm_t, r_data);
+
+            // Datatypes of large double messages are formed here, rather
+            // than on the first exchange
+            send_data->get_send_types(MPI_DOUBLE, 1);
         }
 
         ParComm(Partition* partition,
@@ -383,7 +405,9 @@ namespace raptor
                 send_data->indices[i] = part_col_to_new[idx];
                 assert(part_col_to_new[idx] >= 0);
             }
-	    
+
+            // As above, form datatypes before the first exchange
+            send_data->get_send_types(MPI_DOUBLE, 1);
         }
 
         void init_par_comm(Partition* partition,
@@ -442,17 +466,11 @@ namespace raptor
             }
 
             // For each process I recv from, send the global column indices
+            // for which I must recv corresponding rows.  Processes sending
+            // to me are found with a nonblocking consensus, so no global
+            // (num_procs sized) communication is needed
             if (comm_t) *comm_t -= MPI_Wtime();
-            // for which I must recv corresponding rows 
-            aligned_vector<int> recv_sizes(num_procs, 0);
-            for (int i = 0; i < recv_data->num_msgs; i++)
-                recv_sizes[recv_data->procs[i]] = 
-                    recv_data->indptr[i+1] - recv_data->indptr[i];
-            MPI_Allreduce(MPI_IN_PLACE, recv_sizes.data(), num_procs, MPI_INT,
-                    MPI_SUM, MPI_COMM_WORLD);
-            recv_data->send(off_proc_column_map.data(), tag, comm);
-            send_data->probe(recv_sizes[rank], tag, comm);
-            recv_data->waitall();
+            send_data->probe_nbx(recv_data, off_proc_column_map.data(), tag, comm);
             for (int i = 0; i < send_data->size_msgs; i++)
             {
                 send_data->indices[i] -= partition->first_local_col;
@@ -610,6 +628,8 @@ namespace raptor
             int start, end;
             int proc, pos, idx;
 
+            if (init_reduced(values, block_size)) return;
+
             send_data->send(values, key, mpi_comm, block_size);
             recv_data->recv<T>(key, mpi_comm, block_size);
         }
@@ -621,12 +641,57 @@ namespace raptor
             recv_data->waitall();
             key++;
 
+            if (reduced_halo<T>())
+            {
+                recv_data->expand_reduced(halo_precision, block_size);
+            }
+
             // Extract packed data to appropriate buffer
             aligned_vector<T>& buf = recv_data->get_buffer<T>();
 
             return buf;
         }
 
+        // Whether values of type T are sent in reduced precision
+        template<typename T>
+        bool reduced_halo()
+        {
+            return halo_precision != HaloDouble && std::is_same<T, double>::value;
+        }
+
+        // Start an exchange (or its transpose) of double values in
+        // halo_precision, returning false if they are sent exactly
+        // (int values always are)
+        bool init_reduced(const double* values, const int block_size)
+        {
+            if (!reduced_halo<double>()) return false;
+
+            send_data->send_reduced(values, key, mpi_comm, halo_precision, block_size);
+            recv_data->recv_reduced(key, mpi_comm, halo_precision, block_size);
+            return true;
+        }
+        bool init_reduced(const int* /*values*/, const int /*block_size*/)
+        {
+            return false;
+        }
+        bool init_reduced_T(const double* values, const int block_size,
+                std::function<double(double, double)> init_result_func,
+                double init_result_func_val)
+        {
+            if (!reduced_halo<double>()) return false;
+
+            recv_data->send_reduced(values, key, mpi_comm, halo_precision, block_size,
+                    init_result_func, init_result_func_val);
+            send_data->recv_reduced(key, mpi_comm, halo_precision, block_size);
+            return true;
+        }
+        bool init_reduced_T(const int* /*values*/, const int /*block_size*/,
+                std::function<int(int, int)> /*init_result_func*/,
+                int /*init_result_func_val*/)
+        {
+            return false;
+        }
+
         // Transpose Communication
         void init_double_comm_T(const double* values,
                 const int block_size = 1,
@@ -736,6 +801,9 @@ namespace raptor
             int start, end;
             int proc, idx, pos;
 
+            if (init_reduced_T(values, block_size, init_result_func, 
+                        init_result_func_val)) return;
+
             recv_data->send(values, key, mpi_comm, block_size, init_result_func, init_result_func_val);
             send_data->recv<T>(key, mpi_comm, block_size);
         }
@@ -772,6 +840,11 @@ namespace raptor
             send_data->waitall();
             recv_data->waitall();
             key++;
+
+            if (reduced_halo<T>())
+            {
+                send_data->expand_reduced(halo_precision, block_size);
+            }
             
             aligned_vector<T>& buf = send_data->get_buffer<T>();
         }
@@ -882,23 +955,38 @@ namespace raptor
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+                const aligned_vector<int>& col_indices, const BlockArray& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         void init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         void init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+                const aligned_vector<int>& col_indices, const BlockArray& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         CSRMatrix* complete_mat_comm(const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true);
 
+        // Completes a matrix communication one message at a time: after
+        // init_mat_comm, call recv_mat_msg while messages of recv_data
+        // are pending (returned in order of arrival), then finalize_mat_comm
+        int recv_mat_msg(CSRMatrix* msg_mat, aligned_vector<int>& pending, 
+                const bool has_vals = true)
+        {
+            return recv_data->recv_next(msg_mat, pending, key, mpi_comm, 1, 
+                    has_vals);
+        }
+        void finalize_mat_comm()
+        {
+            send_data->mat_waitall();
+            key++;
+        }
+
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values, 
                 const int n_result_rows, const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true);
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values, 
+                const aligned_vector<int>& col_indices, const BlockArray& values, 
                 const int n_result_rows, const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true);
         void init_mat_comm_T(aligned_vector<char>& send_buffer, 
@@ -907,7 +995,7 @@ namespace raptor
                 const int b_cols = 1, const bool has_vals = true) ;
         void init_mat_comm_T(aligned_vector<char>& send_buffer,
                 const aligned_vector<int>& rowptr, const aligned_vector<int>& col_indices, 
-                const aligned_vector<double*>& values, const int b_rows = 1, 
+                const BlockArray& values, const int b_rows = 1, 
                 const int b_cols = 1, const bool has_vals = true) ;
         CSRMatrix* complete_mat_comm_T(const int n_result_rows, 
                 const int b_rows = 1, const int b_cols = 1,
@@ -941,6 +1029,14 @@ namespace raptor
         {
             CommPkg::init_comm(v, block_size);
         }
+        aligned_vector<double>& communicate(ParMultiVector& v)
+        {
+            return CommPkg::communicate(v);
+        }
+        void init_comm(ParMultiVector& v)
+        {
+            CommPkg::init_comm(v);
+        }
 
         // Helper Methods
         aligned_vector<double>& get_double_buffer()
@@ -959,6 +1055,458 @@ namespace raptor
     };
 
 
+    /**************************************************************
+    *****   NeighborComm Class
+    **************************************************************
+    ***** A ParComm exchanging vector values with MPI-3 neighborhood
+    ***** collectives.  A distributed graph communicator, with the 
+    ***** processes of recv_data as sources and those of send_data as
+    ***** destinations, is formed once, and each init_comm posts a 
+    ***** single MPI_Ineighbor_alltoallv.  Transpose and matrix 
+    ***** communication use the point-to-point messages of ParComm.
+    *****
+    ***** As a collective, every process of the communicator must
+    ***** take part in each exchange (as they do in mult and 
+    ***** residual).  Values are received in the order of recv_data
+    ***** (ContigData, as for matrix communicators).
+    *****
+    ***** Attributes
+    ***** -------------
+    ***** neighbor_comm : MPI_Comm
+    *****    Distributed graph communicator, with edges weighted by 
+    *****    message size
+    ***** send_counts, send_displs : aligned_vector<int>
+    *****    Size and start of each message in the send buffer
+    ***** recv_counts, recv_displs : aligned_vector<int>
+    *****    Size and start of each message in the recv buffer
+    ***** request : MPI_Request
+    *****    Request of the exchange in progress
+    **************************************************************/
+    class NeighborComm : public ParComm
+    {
+      public:
+        /**************************************************************
+        *****   NeighborComm Class Constructor
+        **************************************************************
+        ***** Copies the messages of comm and forms the graph 
+        ***** communicator (collective over comm->mpi_comm)
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** comm : ParComm*
+        *****    Communication package to be copied
+        ***** reorder : bool (optional)
+        *****    Allow MPI to renumber the ranks of neighbor_comm to fit
+        *****    the graph to the machine (default false).  If any 
+        *****    rank changes, the graph is formed again without 
+        *****    reordering, as messages are addressed by rank.
+        **************************************************************/
+        NeighborComm(ParComm* comm, bool reorder = false) : ParComm(comm)
+        {
+            int n_sources = recv_data->num_msgs;
+            int n_dests = send_data->num_msgs;
+
+            recv_counts.resize(n_sources);
+            recv_displs.resize(n_sources);
+            for (int i = 0; i < n_sources; i++)
+            {
+                recv_displs[i] = recv_data->indptr[i];
+                recv_counts[i] = recv_data->indptr[i+1] - recv_data->indptr[i];
+            }
+            send_counts.resize(n_dests);
+            send_displs.resize(n_dests);
+            for (int i = 0; i < n_dests; i++)
+            {
+                send_displs[i] = send_data->indptr[i];
+                send_counts[i] = send_data->indptr[i+1] - send_data->indptr[i];
+            }
+
+            create_graph(reorder);
+
+            // The procs of send_data and recv_data are ranks of mpi_comm,
+            // so if MPI renumbered any process, form the graph without
+            // reordering
+            if (reorder)
+            {
+                int rank, graph_rank, renumbered;
+                MPI_Comm_rank(mpi_comm, &rank);
+                MPI_Comm_rank(neighbor_comm, &graph_rank);
+                int moved = rank != graph_rank;
+                MPI_Allreduce(&moved, &renumbered, 1, MPI_INT, MPI_MAX, mpi_comm);
+                if (renumbered)
+                {
+                    MPI_Comm_free(&neighbor_comm);
+                    create_graph(false);
+                }
+            }
+
+            block_size_counts = 1;
+            request = MPI_REQUEST_NULL;
+        }
+
+        ~NeighborComm()
+        {
+            MPI_Comm_free(&neighbor_comm);
+        }
+
+        // Standard Communication
+        void init_double_comm(const double* values, const int block_size = 1)
+        {
+            initialize(values, block_size);
+        }
+        void init_int_comm(const int* values, const int block_size = 1)
+        {
+            initialize(values, block_size);
+        }
+        aligned_vector<double>& complete_double_comm(const int block_size = 1)
+        {
+            return complete<double>(block_size);
+        }
+        aligned_vector<int>& complete_int_comm(const int block_size = 1)
+        {
+            return complete<int>(block_size);
+        }
+
+        template<typename T>
+        void initialize(const T* values, const int block_size = 1)
+        {
+            int idx, pos;
+
+            aligned_vector<T>& sendbuf = send_data->get_buffer<T>();
+            aligned_vector<T>& recvbuf = recv_data->get_buffer<T>();
+            if ((int) sendbuf.size() < send_data->size_msgs * block_size)
+                sendbuf.resize(send_data->size_msgs * block_size);
+            if ((int) recvbuf.size() < recv_data->size_msgs * block_size)
+                recvbuf.resize(recv_data->size_msgs * block_size);
+            set_block_size(block_size);
+
+            for (int i = 0; i < send_data->size_msgs; i++)
+            {
+                idx = send_data->indices[i] * block_size;
+                pos = i * block_size;
+                for (int j = 0; j < block_size; j++)
+                {
+                    sendbuf[pos + j] = values[idx + j];
+                }
+            }
+
+            MPI_Datatype datatype = CommData::get_type<T>();
+            MPI_Ineighbor_alltoallv(sendbuf.data(), send_counts.data(),
+                    send_displs.data(), datatype, recvbuf.data(), 
+                    recv_counts.data(), recv_displs.data(), datatype,
+                    neighbor_comm, &request);
+        }
+
+        template<typename T>
+        aligned_vector<T>& complete(const int /*block_size*/ = 1)
+        {
+            MPI_Wait(&request, MPI_STATUS_IGNORE);
+            return recv_data->get_buffer<T>();
+        }
+
+        MPI_Comm neighbor_comm;
+        aligned_vector<int> send_counts;
+        aligned_vector<int> send_displs;
+        aligned_vector<int> recv_counts;
+        aligned_vector<int> recv_displs;
+        MPI_Request request;
+
+      private:
+        // Forms neighbor_comm from the messages of send_data and recv_data
+        void create_graph(bool reorder)
+        {
+            int n_sources = recv_data->num_msgs;
+            int n_dests = send_data->num_msgs;
+            MPI_Dist_graph_create_adjacent(mpi_comm, 
+                    n_sources, recv_data->procs.data(),
+                    n_sources ? recv_counts.data() : MPI_WEIGHTS_EMPTY,
+                    n_dests, send_data->procs.data(),
+                    n_dests ? send_counts.data() : MPI_WEIGHTS_EMPTY,
+                    MPI_INFO_NULL, reorder, &neighbor_comm);
+        }
+
+        // Scales counts and displacements from block_size_counts
+        // values per index to block_size
+        void set_block_size(const int block_size)
+        {
+            if (block_size == block_size_counts) return;
+
+            for (int i = 0; i < (int) send_counts.size(); i++)
+            {
+                send_counts[i] = (send_counts[i] / block_size_counts) * block_size;
+                send_displs[i] = (send_displs[i] / block_size_counts) * block_size;
+            }
+            for (int i = 0; i < (int) recv_counts.size(); i++)
+            {
+                recv_counts[i] = (recv_counts[i] / block_size_counts) * block_size;
+                recv_displs[i] = (recv_displs[i] / block_size_counts) * block_size;
+            }
+            block_size_counts = block_size;
+        }
+
+        int block_size_counts;
+    };
+
+
+    /**************************************************************
+    *****   SharedComm Class
+    **************************************************************
+    ***** A ParComm exchanging vector values among processes of a
+    ***** single shared-memory node through a window allocated with
+    ***** MPI_Win_allocate_shared.  Each process packs the values it
+    ***** sends into its region of the window, and receiving processes
+    ***** copy their values directly from the sender's region, with no
+    ***** messages.  Transpose and matrix communication use the
+    ***** point-to-point messages of ParComm.
+    *****
+    ***** Exchanges are synchronized with flags in the header of each
+    ***** region: ready (the last exchange packed by the owner) and one
+    ***** done flag per send message (the last exchange read by its
+    ***** receiver), each written by a single process.  Every process
+    ***** of the communicator must take part in each exchange.
+    *****
+    ***** Attributes
+    ***** -------------
+    ***** win : MPI_Win
+    *****    Shared window, holding one region per process
+    ***** local_region : char*
+    *****    Start of this process's region (header, then send values)
+    ***** recv_regions : aligned_vector<char*>
+    *****    Start of the region of each process in recv_data
+    ***** recv_headers : aligned_vector<int>
+    *****    Header size (in bytes) of each of these regions
+    ***** recv_starts : aligned_vector<int>
+    *****    Index of each recv message in the sender's send values
+    ***** recv_slots : aligned_vector<int>
+    *****    Done flag of each recv message in the sender's header
+    ***** epoch : int
+    *****    Number of exchanges started
+    **************************************************************/
+    class SharedComm : public ParComm
+    {
+      public:
+        /**************************************************************
+        *****   SharedComm Class Constructor
+        **************************************************************
+        ***** Copies the messages of comm and allocates the shared
+        ***** window (collective over comm->mpi_comm, all processes of
+        ***** which must share memory, see shared_memory())
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** comm : ParComm*
+        *****    Communication package to be copied
+        **************************************************************/
+        SharedComm(ParComm* comm) : ParComm(comm)
+        {
+            int n_sends = send_data->num_msgs;
+            int n_recvs = recv_data->num_msgs;
+
+            header_size = (((1 + n_sends) * sizeof(int) + 63) / 64) * 64;
+
+            // Tell each receiving process where its values start in the
+            // send region, and which done flag it sets
+            aligned_vector<int> send_info(3 * n_sends);
+            aligned_vector<int> recv_info(3 * n_recvs);
+            aligned_vector<MPI_Request> requests(n_sends + n_recvs);
+            for (int i = 0; i < n_recvs; i++)
+            {
+                MPI_Irecv(&(recv_info[3*i]), 3, MPI_INT, recv_data->procs[i],
+                        key, mpi_comm, &(requests[i]));
+            }
+            for (int i = 0; i < n_sends; i++)
+            {
+                send_info[3*i] = send_data->indptr[i];
+                send_info[3*i+1] = i;
+                send_info[3*i+2] = header_size;
+                MPI_Isend(&(send_info[3*i]), 3, MPI_INT, send_data->procs[i],
+                        key, mpi_comm, &(requests[n_recvs + i]));
+            }
+            if (n_sends + n_recvs)
+            {
+                MPI_Waitall(n_sends + n_recvs, requests.data(), MPI_STATUSES_IGNORE);
+            }
+            key++;
+
+            recv_starts.resize(n_recvs);
+            recv_slots.resize(n_recvs);
+            recv_headers.resize(n_recvs);
+            for (int i = 0; i < n_recvs; i++)
+            {
+                recv_starts[i] = recv_info[3*i];
+                recv_slots[i] = recv_info[3*i+1];
+                recv_headers[i] = recv_info[3*i+2];
+            }
+
+            epoch = 0;
+            win_block_size = 0;
+            win = MPI_WIN_NULL;
+            allocate(1);
+        }
+
+        ~SharedComm()
+        {
+            free_window();
+        }
+
+        // Returns whether all processes of mpi_comm share memory
+        // (collective)
+        static bool shared_memory(MPI_Comm mpi_comm)
+        {
+            int comm_size, shared_size;
+            MPI_Comm shared_comm;
+            MPI_Comm_size(mpi_comm, &comm_size);
+            MPI_Comm_split_type(mpi_comm, MPI_COMM_TYPE_SHARED, 0,
+                    MPI_INFO_NULL, &shared_comm);
+            MPI_Comm_size(shared_comm, &shared_size);
+            MPI_Comm_free(&shared_comm);
+            return shared_size == comm_size;
+        }
+
+        // Standard Communication
+        void init_double_comm(const double* values, const int block_size = 1)
+        {
+            initialize(values, block_size);
+        }
+        void init_int_comm(const int* values, const int block_size = 1)
+        {
+            initialize(values, block_size);
+        }
+        aligned_vector<double>& complete_double_comm(const int block_size = 1)
+        {
+            return complete<double>(block_size);
+        }
+        aligned_vector<int>& complete_int_comm(const int block_size = 1)
+        {
+            return complete<int>(block_size);
+        }
+
+        template<typename T>
+        void initialize(const T* values, const int block_size = 1)
+        {
+            int idx, pos;
+
+            // Same block size on all processes, so the window is
+            // reallocated collectively
+            if (block_size > win_block_size)
+                allocate(block_size);
+
+            epoch++;
+            volatile int* flags = (volatile int*) local_region;
+
+            // Wait until the last values sent have been read
+            for (int i = 0; i < send_data->num_msgs; i++)
+            {
+                while (flags[1 + i] < epoch - 1) MPI_Win_sync(win);
+            }
+
+            T* sendbuf = (T*) (local_region + header_size);
+            for (int i = 0; i < send_data->size_msgs; i++)
+            {
+                idx = send_data->indices[i] * block_size;
+                pos = i * block_size;
+                for (int j = 0; j < block_size; j++)
+                {
+                    sendbuf[pos + j] = values[idx + j];
+                }
+            }
+
+            MPI_Win_sync(win);
+            flags[0] = epoch;
+            MPI_Win_sync(win);
+        }
+
+        template<typename T>
+        aligned_vector<T>& complete(const int block_size = 1)
+        {
+            int start, end;
+            aligned_vector<T>& recvbuf = recv_data->get_buffer<T>();
+            if ((int) recvbuf.size() < recv_data->size_msgs * block_size)
+                recvbuf.resize(recv_data->size_msgs * block_size);
+
+            for (int i = 0; i < recv_data->num_msgs; i++)
+            {
+                start = recv_data->indptr[i];
+                end = recv_data->indptr[i+1];
+                volatile int* flags = (volatile int*) recv_regions[i];
+                while (flags[0] < epoch) MPI_Win_sync(win);
+
+                const T* values = (const T*) (recv_regions[i] + recv_headers[i])
+                    + recv_starts[i] * block_size;
+                std::copy(values, values + (end - start) * block_size,
+                        &(recvbuf[start * block_size]));
+
+                MPI_Win_sync(win);
+                flags[1 + recv_slots[i]] = epoch;
+            }
+            MPI_Win_sync(win);
+
+            return recvbuf;
+        }
+
+        MPI_Win win;
+        char* local_region;
+        aligned_vector<char*> recv_regions;
+        aligned_vector<int> recv_headers;
+        aligned_vector<int> recv_starts;
+        aligned_vector<int> recv_slots;
+        int epoch;
+
+      private:
+        // Allocates the window with room for block_size values per
+        // send index, setting all flags to the current epoch
+        // (collective)
+        void allocate(const int block_size)
+        {
+            MPI_Aint size;
+            int disp_unit;
+
+            free_window();
+
+            MPI_Aint bytes = header_size + (MPI_Aint) send_data->size_msgs
+                * block_size * sizeof(double);
+            MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, mpi_comm,
+                    &local_region, &win);
+            MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+            int* flags = (int*) local_region;
+            for (int i = 0; i <= send_data->num_msgs; i++)
+            {
+                flags[i] = epoch;
+            }
+
+            recv_regions.resize(recv_data->num_msgs);
+            for (int i = 0; i < recv_data->num_msgs; i++)
+            {
+                MPI_Win_shared_query(win, recv_data->procs[i], &size, &disp_unit,
+                        &(recv_regions[i]));
+            }
+
+            // Flags must be set before they are read by other processes
+            MPI_Win_sync(win);
+            MPI_Barrier(mpi_comm);
+            MPI_Win_sync(win);
+
+            win_block_size = block_size;
+        }
+
+        void free_window()
+        {
+            int finalized;
+            MPI_Finalized(&finalized);
+            if (win != MPI_WIN_NULL && !finalized)
+            {
+                MPI_Win_unlock_all(win);
+                MPI_Win_free(&win);
+            }
+            win = MPI_WIN_NULL;
+        }
+
+        int header_size;
+        int win_block_size;
+    };
+
+
 
     /**************************************************************
     *****   TAPComm Class
@@ -1456,6 +2004,49 @@ namespace raptor
         void update_recv(const aligned_vector<int>& on_node_to_off_proc,
                 const aligned_vector<int>& off_node_to_off_proc, bool update_L = true);
 
+        /**************************************************************
+        *****   TAPComm Init Shared Comm
+        **************************************************************
+        ***** Replaces the intra-node communicators (local_S, local_R,
+        ***** and local_L, unless shared with another TAPComm) with
+        ***** SharedComms, if the processes of each node share memory
+        ***** (collective).  Returns whether they were replaced.
+        **************************************************************/
+        bool init_shared_comm()
+        {
+            if (!SharedComm::shared_memory(local_R_par_comm->mpi_comm))
+                return false;
+
+            ParComm* comm;
+            if (local_S_par_comm)
+            {
+                comm = new SharedComm(local_S_par_comm);
+                delete local_S_par_comm;
+                local_S_par_comm = comm;
+            }
+
+            comm = new SharedComm(local_R_par_comm);
+            delete local_R_par_comm;
+            local_R_par_comm = comm;
+
+            if (!shared_L)
+            {
+                comm = new SharedComm(local_L_par_comm);
+                delete local_L_par_comm;
+                local_L_par_comm = comm;
+            }
+
+            return true;
+        }
+
+        // Only inter-node (global) messages are sent in reduced
+        // precision, as intra-node steps are comparatively cheap
+        void set_halo_precision(halo_t precision)
+        {
+            halo_precision = precision;
+            global_par_comm->set_halo_precision(precision);
+        }
+
         // Class Methods
         void init_double_comm(const double* values, const int block_size)
         {
@@ -1744,13 +2335,13 @@ namespace raptor
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+                const aligned_vector<int>& col_indices, const BlockArray& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         void init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
                 const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         void init_mat_comm(aligned_vector<char>& send_buffer, const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values,
+                const aligned_vector<int>& col_indices, const BlockArray& values,
                 const int b_rows = 1, const int b_cols = 1, const bool has_vals = true);
         CSRMatrix* complete_mat_comm(const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true);
@@ -1760,7 +2351,7 @@ namespace raptor
                 const int n_result_rows, const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true);
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double*>& values, 
+                const aligned_vector<int>& col_indices, const BlockArray& values, 
                 const int n_result_rows, const int b_rows = 1, const int b_cols = 1, 
                 const bool has_vals = true);
         void init_mat_comm_T(aligned_vector<char>& send_buffer, 
@@ -1769,7 +2360,7 @@ namespace raptor
                 const int b_cols = 1, const bool has_vals = true) ;
         void init_mat_comm_T(aligned_vector<char>& send_buffer,
                 const aligned_vector<int>& rowptr, const aligned_vector<int>& col_indices, 
-                const aligned_vector<double*>& values, const int b_rows = 1, 
+                const BlockArray& values, const int b_rows = 1, 
                 const int b_cols = 1, const bool has_vals = true) ;
         CSRMatrix* complete_mat_comm_T(const int n_result_rows, 
                 const int b_rows = 1, const int b_cols = 1,
@@ -1803,6 +2394,14 @@ namespace raptor
         {
             CommPkg::init_comm(v, block_size);
         }
+        aligned_vector<double>& communicate(ParMultiVector& v)
+        {
+            return CommPkg::communicate(v);
+        }
+        void init_comm(ParMultiVector& v)
+        {
+            CommPkg::init_comm(v);
+        }
 
         // Helper Methods
         aligned_vector<double>& get_double_buffer()
@@ -0,0 +1,242 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_CORE_CSR_BUILDER_HPP_
+#define RAPTOR_CORE_CSR_BUILDER_HPP_
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+
+/**************************************************************
+ *****   CSRBuilder Class
+ **************************************************************
+ ***** Two-pass (count, then fill) construction of a CSR matrix.
+ ***** The number of entries in each row is first counted with
+ ***** count(), after which allocate() sizes idx2 and the values
+ ***** exactly, and entries are placed directly into their rows
+ ***** with insert() or add().  Rows may be filled in any order.
+ *****
+ ***** Counts may be upper bounds (e.g. when entries are later
+ ***** dropped as zeros).  In that case, finalize() compacts the
+ ***** partially filled rows and trims the storage, so that no
+ ***** over-allocated memory persists with the matrix.
+ *****
+ ***** Usage
+ ***** -------------
+ ***** CSRBuilder builder(A);
+ ***** for each entry (row, col) : builder.count(row);
+ ***** builder.allocate();
+ ***** for each entry (row, col, val) : builder.add(row, col, val);
+ ***** builder.finalize();
+ **************************************************************/
+namespace raptor
+{
+    class CSRBuilder
+    {
+      public:
+        /**************************************************************
+        *****   CSRBuilder Class Constructor
+        **************************************************************
+        ***** Prepares matrix mat (with n_rows already set) to be built,
+        ***** zeroing its row pointer.  Values are stored in mat->vals,
+        ***** or in the block values for block matrices.
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** _mat : Matrix*
+        *****    CSR matrix to be built (any existing entries are removed)
+        ***** _vals : aligned_vector<double>& or BlockArray& (optional)
+        *****    Values to build for mat (mat->vals by default, or
+        *****    block_vals of a BSR matrix), so templated kernels can
+        *****    pass either
+        **************************************************************/
+        CSRBuilder(Matrix* _mat)
+        {
+            init(_mat, &_mat->vals, NULL);
+        }
+
+        CSRBuilder(Matrix* _mat, aligned_vector<double>& _vals)
+        {
+            init(_mat, &_vals, NULL);
+        }
+
+        CSRBuilder(Matrix* _mat, BlockArray& _block_vals)
+        {
+            init(_mat, NULL, &_block_vals);
+        }
+
+        // Count n entries in row (first pass)
+        void count(int row, int n = 1)
+        {
+            mat->idx1[row+1] += n;
+        }
+
+        /**************************************************************
+        *****   CSRBuilder Allocate
+        **************************************************************
+        ***** Forms the row pointer from the counts and allocates
+        ***** exactly the counted number of column indices and values,
+        ***** placing the pages of each row with the thread that owns
+        ***** it in threaded kernels
+        **************************************************************/
+        void allocate()
+        {
+            int n_rows = mat->n_rows;
+            aligned_vector<int>& idx1 = mat->idx1;
+            for (int i = 0; i < n_rows; i++)
+            {
+                idx1[i+1] += idx1[i];
+            }
+            int nnz = idx1[n_rows];
+            pos.assign(idx1.begin(), idx1.begin() + n_rows);
+
+            // Swap with new vectors so capacity is exactly nnz, first
+            // touching each thread's rows before they are zeroed
+            aligned_vector<int> new_idx2;
+            new_idx2.reserve(nnz);
+            first_touch_rows(idx1.data(), n_rows, new_idx2.data(), sizeof(int));
+            new_idx2.resize(nnz);
+            new_idx2.swap(mat->idx2);
+            if (block_vals)
+            {
+                block_vals->clear();
+                block_vals->shrink_to_fit();
+                block_vals->resize(nnz);
+            }
+            else
+            {
+                aligned_vector<double> new_vals;
+                new_vals.reserve(nnz);
+                first_touch_rows(idx1.data(), n_rows, new_vals.data(), 
+                        sizeof(double));
+                new_vals.resize(nnz);
+                new_vals.swap(*vals);
+            }
+            mat->nnz = nnz;
+        }
+
+        // Add column col to row (second pass), returning its position
+        // in idx2 and vals so the value can be set or accumulated
+        int insert(int row, int col)
+        {
+            int j = pos[row]++;
+            mat->idx2[j] = col;
+            return j;
+        }
+
+        void add(int row, int col, double val)
+        {
+            (*vals)[insert(row, col)] = val;
+        }
+
+        void add(int row, int col, const double* block)
+        {
+            int j = insert(row, col);
+            std::copy(block, block + block_vals->block_size(), (*block_vals)[j]);
+        }
+
+        // Remove entries of a filled row with magnitude at most tol
+        // (scalar values), leaving the space for finalize() to trim
+        void drop_zeros(int row, double tol = zero_tol)
+        {
+            int ctr = mat->idx1[row];
+            for (int j = mat->idx1[row]; j < pos[row]; j++)
+            {
+                if (fabs((*vals)[j]) > tol)
+                {
+                    mat->idx2[ctr] = mat->idx2[j];
+                    (*vals)[ctr++] = (*vals)[j];
+                }
+            }
+            pos[row] = ctr;
+        }
+
+        // Position of first entry in row (after allocate)
+        int row_start(int row) const
+        {
+            return mat->idx1[row];
+        }
+
+        // Position one past the last entry inserted into row
+        int row_end(int row) const
+        {
+            return pos[row];
+        }
+
+        /**************************************************************
+        *****   CSRBuilder Finalize
+        **************************************************************
+        ***** Removes any counted but unfilled space from the rows,
+        ***** trimming idx2 and the values to the final number of
+        ***** nonzeros, and sets mat->nnz
+        **************************************************************/
+        void finalize()
+        {
+            int n_rows = mat->n_rows;
+            aligned_vector<int>& idx1 = mat->idx1;
+            aligned_vector<int>& idx2 = mat->idx2;
+            int b_size = block_vals ? block_vals->block_size() : 1;
+            double* data = block_vals ? block_vals->data() : vals->data();
+
+            int nnz = 0;
+            int start = idx1[0];
+            for (int i = 0; i < n_rows; i++)
+            {
+                int end = pos[i];
+                int next = idx1[i+1];
+                if (start != nnz)
+                {
+                    std::copy(idx2.begin() + start, idx2.begin() + end,
+                            idx2.begin() + nnz);
+                    std::copy(data + (size_t) start * b_size,
+                            data + (size_t) end * b_size,
+                            data + (size_t) nnz * b_size);
+                }
+                nnz += (end - start);
+                idx1[i+1] = nnz;
+                start = next;
+            }
+
+            if (nnz < (int) idx2.size())
+            {
+                idx2.resize(nnz);
+                idx2.shrink_to_fit();
+                if (block_vals)
+                {
+                    block_vals->resize(nnz);
+                    block_vals->shrink_to_fit();
+                }
+                else
+                {
+                    vals->resize(nnz);
+                    vals->shrink_to_fit();
+                }
+            }
+            mat->nnz = nnz;
+
+            aligned_vector<int>().swap(pos);
+        }
+
+      private:
+        void init(Matrix* _mat, aligned_vector<double>* _vals,
+                BlockArray* _block_vals)
+        {
+            mat = _mat;
+            vals = _vals;
+            block_vals = _block_vals;
+            mat->sorted = false;
+            mat->diag_first = false;
+            mat->idx1.resize(mat->n_rows + 1);
+            std::fill(mat->idx1.begin(), mat->idx1.end(), 0);
+        }
+
+        Matrix* mat;
+        aligned_vector<double>* vals;
+        BlockArray* block_vals;
+        aligned_vector<int> pos;
+    };
+}
+
+#endif
@@ -13,7 +13,7 @@ using namespace raptor;
 ***** and column according to each nonzero
 **************************************************************/
 template <typename T>
-void print_helper(const COOMatrix* A, const aligned_vector<T>& vals)
+void print_helper(const COOMatrix* A, const T& vals)
 {
     int row, col;
     double val;
@@ -26,7 +26,7 @@ void print_helper(const COOMatrix* A, const aligned_vector<T>& vals)
     }
 }
 template <typename T>
-void print_helper(const CSRMatrix* A, const aligned_vector<T>& vals)
+void print_helper(const CSRMatrix* A, const T& vals)
 {
     int col, start, end;
 
@@ -42,7 +42,7 @@ void print_helper(const CSRMatrix* A, const aligned_vector<T>& vals)
     }
 }
 template <typename T>
-void print_helper(const CSCMatrix* A, const aligned_vector<T>& vals)
+void print_helper(const CSCMatrix* A, const T& vals)
 {
     int row, start, end;
 
@@ -81,6 +81,50 @@ void BSCMatrix::print()
 {
     print_helper(this, vals);
 }
+void SELLMatrix::print()
+{
+    int C = chunk_height;
+    for (int slot = 0; slot < n_rows; slot++)
+    {
+        int row = row_order[slot];
+        int pos = idx1[slot / C] + (slot % C);
+        for (int k = 0; k < row_sizes[slot]; k++)
+        {
+            val_print(row, idx2[pos], vals[pos]);
+            pos += C;
+        }
+    }
+}
+void FloatCSRMatrix::print()
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            val_print(i, idx2[j], (double) float_vals[j]);
+        }
+    }
+}
+void CompressedCSRMatrix::print()
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            val_print(i, col(i, j), vals[j]);
+        }
+    }
+}
+void SymCSRMatrix::print()
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            val_print(i, idx2[j], vals[j]);
+        }
+    }
+}
 
 /**************************************************************
 *****  Matrix Transpose
@@ -88,6 +132,19 @@ void BSCMatrix::print()
 ***** Transpose the matrix, reversing rows and columns
 ***** Retain matrix type, and block structure if applicable
 **************************************************************/
+// Write the b_cols x b_rows transpose of a row-major
+// b_rows x b_cols block
+void transpose_block(const double* block, double* block_T, int b_rows, int b_cols)
+{
+    for (int i = 0; i < b_rows; i++)
+    {
+        for (int j = 0; j < b_cols; j++)
+        {
+            block_T[j*b_rows + i] = block[i*b_cols + j];
+        }
+    }
+}
+
 COOMatrix* COOMatrix::transpose()
 {
     COOMatrix* T = new COOMatrix(n_rows, n_cols, idx2, idx1, vals);
@@ -96,13 +153,21 @@ COOMatrix* COOMatrix::transpose()
 
 BCOOMatrix* BCOOMatrix::transpose()
 {
-    BCOOMatrix* T = new BCOOMatrix(b_rows, b_cols, n_rows, n_cols, idx2, idx1, block_vals);
+    BCOOMatrix* T = new BCOOMatrix(n_cols, n_rows, b_cols, b_rows);
+    T->idx1 = idx2;
+    T->idx2 = idx1;
+    T->nnz = nnz;
+    T->block_vals.resize(nnz);
+    for (int i = 0; i < nnz; i++)
+    {
+        transpose_block(block_vals[i], T->block_vals[i], b_rows, b_cols);
+    }
     return T;
 }
 
 CSRMatrix* CSRMatrix::transpose()
 {
-    CSCMatrix* T_csc = new CSCMatrix(n_rows, n_cols, idx1, idx2, vals); 
+    CSCMatrix* T_csc = new CSCMatrix(n_cols, n_rows, idx1, idx2, vals); 
     CSRMatrix* T = T_csc->to_CSR();
     delete T_csc;
     return T;
@@ -110,7 +175,16 @@ CSRMatrix* CSRMatrix::transpose()
 
 BSRMatrix* BSRMatrix::transpose()
 {
-    BSCMatrix* T_bsc = new BSCMatrix(b_rows, b_cols, n_rows, n_cols, idx1, idx2, block_vals);
+    // Columns of A^T (stored as BSC) are the rows of A
+    BSCMatrix* T_bsc = new BSCMatrix(n_cols, n_rows, b_cols, b_rows);
+    T_bsc->idx1 = idx1;
+    T_bsc->idx2 = idx2;
+    T_bsc->nnz = nnz;
+    T_bsc->block_vals.resize(nnz);
+    for (int i = 0; i < nnz; i++)
+    {
+        transpose_block(block_vals[i], T_bsc->block_vals[i], b_rows, b_cols);
+    }
     BSRMatrix* T = (BSRMatrix*) T_bsc->to_CSR();
     delete T_bsc;
     return T;
@@ -118,18 +192,57 @@ BSRMatrix* BSRMatrix::transpose()
 
 CSCMatrix* CSCMatrix::transpose()
 {
-    CSRMatrix* T_csr = new CSRMatrix(n_rows, n_cols, idx1, idx2, vals); 
+    CSRMatrix* T_csr = new CSRMatrix(n_cols, n_rows, idx1, idx2, vals); 
     CSCMatrix* T = T_csr->to_CSC();
     delete T_csr;
     return T;
 }
 BSCMatrix* BSCMatrix::transpose()
 {
-    BSRMatrix* T_bsr = new BSRMatrix(b_rows, b_cols, n_rows, n_cols, idx1, idx2, block_vals); 
+    BSRMatrix* T_bsr = new BSRMatrix(n_cols, n_rows, b_cols, b_rows);
+    T_bsr->idx1 = idx1;
+    T_bsr->idx2 = idx2;
+    T_bsr->nnz = nnz;
+    T_bsr->block_vals.resize(nnz);
+    for (int i = 0; i < nnz; i++)
+    {
+        transpose_block(block_vals[i], T_bsr->block_vals[i], b_rows, b_cols);
+    }
     BSCMatrix* T = (BSCMatrix*) T_bsr->to_CSC();
     delete T_bsr;
     return T;
 }
+SELLMatrix* SELLMatrix::transpose()
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSRMatrix* T_csr = A_csr->transpose();
+    SELLMatrix* T = new SELLMatrix(T_csr, chunk_height, sort_window);
+    delete A_csr;
+    delete T_csr;
+    return T;
+}
+FloatCSRMatrix* FloatCSRMatrix::transpose()
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSRMatrix* T_csr = A_csr->transpose();
+    FloatCSRMatrix* T = new FloatCSRMatrix(T_csr);
+    delete A_csr;
+    delete T_csr;
+    return T;
+}
+CompressedCSRMatrix* CompressedCSRMatrix::transpose()
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSRMatrix* T_csr = A_csr->transpose();
+    CompressedCSRMatrix* T = new CompressedCSRMatrix(T_csr);
+    delete A_csr;
+    delete T_csr;
+    return T;
+}
+SymCSRMatrix* SymCSRMatrix::transpose()
+{
+    return copy();
+}
 
 
 /**************************************************************
@@ -160,8 +273,8 @@ void Matrix::resize(int _n_rows, int _n_cols)
 ***** Matrix* A : original matrix to copy (of some type)
 **************************************************************/
 template <typename T>
-void COO_to_COO(const COOMatrix* A, COOMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void COO_to_COO(const COOMatrix* A, COOMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -178,12 +291,12 @@ void COO_to_COO(const COOMatrix* A, COOMatrix* B, aligned_vector<T>& A_vals,
     {
         B->idx1.emplace_back(A->idx1[i]);
         B->idx2.emplace_back(A->idx2[i]);
-        B_vals.emplace_back(B->copy_val(A_vals[i]));
+        B_vals.emplace_back(A_vals[i]);
     }
 }
 template <typename T>
-void CSR_to_COO(const CSRMatrix* A, COOMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void CSR_to_COO(const CSRMatrix* A, COOMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -204,13 +317,13 @@ void CSR_to_COO(const CSRMatrix* A, COOMatrix* B, aligned_vector<T>& A_vals,
         {
             B->idx1.emplace_back(i);
             B->idx2.emplace_back(A->idx2[j]);
-            B_vals.emplace_back(B->copy_val(A_vals[j]));
+            B_vals.emplace_back(A_vals[j]);
         }
     }
 }
 template <typename T>
-void CSC_to_COO(const CSCMatrix* A, COOMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void CSC_to_COO(const CSCMatrix* A, COOMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -231,14 +344,14 @@ void CSC_to_COO(const CSCMatrix* A, COOMatrix* B, aligned_vector<T>& A_vals,
         {
             B->idx1.emplace_back(A->idx2[j]);
             B->idx2.emplace_back(i);
-            B_vals.emplace_back(B->copy_val(A_vals[j]));
+            B_vals.emplace_back(A_vals[j]);
         }
     }
 
 }
 template <typename T>
-void COO_to_CSR(const COOMatrix* A, CSRMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void COO_to_CSR(const COOMatrix* A, CSRMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -278,14 +391,14 @@ void COO_to_CSR(const COOMatrix* A, CSRMatrix* B, aligned_vector<T>& A_vals,
         B->idx2[index] = col;
         if (A->data_size()) // Checking that matrix has values (not S)
         {
-            B_vals[index] = B->copy_val(A_vals[i]);
+            B->copy_val(A_vals[i], val_ptr(B_vals, index));
         }
     }
 
 }
 template <typename T>
-void CSR_to_CSR(const CSRMatrix* A, CSRMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void CSR_to_CSR(const CSRMatrix* A, CSRMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -304,14 +417,14 @@ void CSR_to_CSR(const CSRMatrix* A, CSRMatrix* B, aligned_vector<T>& A_vals,
         for (int j = row_start; j < row_end; j++)
         {
             B->idx2[j] = A->idx2[j];
-            B_vals[j] = B->copy_val(A_vals[j]);
+            B->copy_val(A_vals[j], val_ptr(B_vals, j));
         }
     }
 
 }
 template <typename T>
-void CSC_to_CSR(const CSCMatrix* A, CSRMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void CSC_to_CSR(const CSCMatrix* A, CSRMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -351,15 +464,15 @@ void CSC_to_CSR(const CSCMatrix* A, CSRMatrix* B, aligned_vector<T>& A_vals,
             B->idx2[idx] = i;
             if (A->data_size())
             {
-                B_vals[idx] = B->copy_val(A_vals[j]);
+                B->copy_val(A_vals[j], val_ptr(B_vals, idx));
             }
         }
     }
 
 }
 template <typename T>
-void COO_to_CSC(const COOMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void COO_to_CSC(const COOMatrix* A, CSCMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -399,14 +512,14 @@ void COO_to_CSC(const COOMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
         B->idx2[index] = row;
         if (A->data_size()) // Checking that matrix has values (not S)
         {
-            B_vals[index] = B->copy_val(A_vals[i]);
+            B->copy_val(A_vals[i], val_ptr(B_vals, index));
         }
     }
 
 }
 template <typename T>
-void CSR_to_CSC(const CSRMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void CSR_to_CSC(const CSRMatrix* A, CSCMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -446,15 +559,15 @@ void CSR_to_CSC(const CSRMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
             B->idx2[idx] = i;
             if (A->data_size())
             {
-                B_vals[idx] = B->copy_val(A_vals[j]);
+                B->copy_val(A_vals[j], val_ptr(B_vals, idx));
             }
         }
     }
 
 }
 template <typename T>
-void CSC_to_CSC(const CSCMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
-        aligned_vector<T>& B_vals)
+void CSC_to_CSC(const CSCMatrix* A, CSCMatrix* B, T& A_vals,
+        T& B_vals)
 {
     B->n_rows = A->n_rows;
     B->n_cols = A->n_cols;
@@ -462,7 +575,7 @@ void CSC_to_CSC(const CSCMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
 
     B->idx1.resize(A->n_cols + 1);
     B->idx2.resize(A->nnz);
-    B->vals.resize(A->nnz);
+    B_vals.resize(A->nnz);
 
     B->idx1[0] = 0;
     for (int i = 0; i < A->n_cols; i++)
@@ -473,7 +586,7 @@ void CSC_to_CSC(const CSCMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
         for (int j = col_start; j < col_end; j++)
         {
             B->idx2[j] = A->idx2[j];
-            B_vals[j] = B->copy_val(A_vals[j]);
+            B->copy_val(A_vals[j], val_ptr(B_vals, j));
         }
     }
 }
@@ -485,7 +598,7 @@ void CSC_to_CSC(const CSCMatrix* A, CSCMatrix* B, aligned_vector<T>& A_vals,
 ***** Sorts the sparse matrix by row and column
 **************************************************************/
 template <typename T>
-void sort_helper(COOMatrix* A, aligned_vector<T>& vals)
+void sort_helper(COOMatrix* A, T& vals)
 {
     if (A->sorted || A->nnz == 0)
     {
@@ -501,7 +614,7 @@ void sort_helper(COOMatrix* A, aligned_vector<T>& vals)
 }
 
 template <typename T>
-void sort_helper(CSRMatrix* A, aligned_vector<T>& vals)
+void sort_helper(CSRMatrix* A, T& vals)
 {
     int start, end, row_size;
 
@@ -534,7 +647,7 @@ void sort_helper(CSRMatrix* A, aligned_vector<T>& vals)
 }
 
 template <typename T>
-void sort_helper(CSCMatrix* A, aligned_vector<T>& vals)
+void sort_helper(CSCMatrix* A, T& vals)
 {
     int start, end, col_size;
 
@@ -591,6 +704,18 @@ void BSCMatrix::sort()
     sort_helper(this, block_vals);
 }
 
+// Solve phase matrices reorder rows through a CSR copy, as sort, 
+// move_diag, and remove_duplicates are only needed before the solve
+// phase
+void SolveMatrix::sort()
+{
+    if (sorted) return;
+    CSRMatrix* A = to_CSR();
+    A->sort();
+    init_from_CSR(A);
+    delete A;
+}
+
 
 /**************************************************************
 *****   Matrix Move Diagonal
@@ -599,7 +724,7 @@ void BSCMatrix::sort()
 ***** If matrix is not sorted, sorts before moving
 **************************************************************/
 template <typename T>
-void move_diag_helper(COOMatrix* A, aligned_vector<T>& vals)
+void move_diag_helper(COOMatrix* A, T& vals)
 {
     if (A->diag_first || A->nnz == 0)
     {
@@ -628,14 +753,12 @@ void move_diag_helper(COOMatrix* A, aligned_vector<T>& vals)
         }
         else if (row == col)
         {
-            auto tmp = vals[i];
             for (int j = i; j > row_start; j--)
             {
                 A->idx2[j] = A->idx2[j-1];
-                vals[j] = vals[j-1];
             }
             A->idx2[row_start] = row;
-            vals[row_start] = tmp;
+            vec_move_to_front(vals, row_start, i);
         }
     }
 
@@ -643,7 +766,7 @@ void move_diag_helper(COOMatrix* A, aligned_vector<T>& vals)
 }
 
 template <typename T>
-void move_diag_helper(CSRMatrix* A, aligned_vector<T>& vals)
+void move_diag_helper(CSRMatrix* A, T& vals)
 {
     int start, end;
     int col;
@@ -665,14 +788,12 @@ void move_diag_helper(CSRMatrix* A, aligned_vector<T>& vals)
                 col = A->idx2[j];
                 if (col == i)
                 {
-                    auto tmp = vals[j];
                     for (int k = j; k > start; k--)
                     {
                         A->idx2[k] = A->idx2[k-1];
-                        vals[k] = vals[k-1];
                     }
                     A->idx2[start] = i;
-                    vals[start] = tmp;
+                    vec_move_to_front(vals, start, j);
                     break;
                 }
             }
@@ -703,7 +824,7 @@ void move_diag_helper(CSRMatrix* A, aligned_vector<T>& vals)
 }
 
 template <typename T>
-void move_diag_helper(CSCMatrix* A, aligned_vector<T>& vals)
+void move_diag_helper(CSCMatrix* A, T& vals)
 {
     int start, end;
     int row;
@@ -725,14 +846,12 @@ void move_diag_helper(CSCMatrix* A, aligned_vector<T>& vals)
                 row = A->idx2[j];
                 if (row == i)
                 {
-                    auto tmp = vals[j];
                     for (int k = j; k > start; k--)
                     {
                         A->idx2[k] = A->idx2[k-1];
-                        vals[k] = vals[k-1];
                     }
                     A->idx2[start] = i;
-                    vals[start] = tmp;
+                    vec_move_to_front(vals, start, j);
                     break;
                 }
             }
@@ -786,6 +905,14 @@ void BSCMatrix::move_diag()
 {
     move_diag_helper(this, block_vals);
 }
+void SolveMatrix::move_diag()
+{
+    if (diag_first) return;
+    CSRMatrix* A = to_CSR();
+    A->move_diag();
+    init_from_CSR(A);
+    delete A;
+}
 
 /**************************************************************
 *****   Matrix Removes Duplicates
@@ -794,7 +921,7 @@ void BSCMatrix::move_diag()
 ***** entries, summing associated values
 **************************************************************/
 template <typename T>
-void remove_duplicates_helper(COOMatrix* A, aligned_vector<T>& vals)
+void remove_duplicates_helper(COOMatrix* A, T& vals)
 {
     if (!A->sorted)
     {
@@ -815,7 +942,7 @@ void remove_duplicates_helper(COOMatrix* A, aligned_vector<T>& vals)
         col = A->idx2[i];
         if (row == prev_row && col == prev_col)
         {
-            A->append_vals(&vals[ctr - 1], &vals[i]);
+            A->append_vals(val_ptr(vals, ctr - 1), vals[i]);
         }
         else
         { 
@@ -823,7 +950,7 @@ void remove_duplicates_helper(COOMatrix* A, aligned_vector<T>& vals)
             {
                 A->idx1[ctr] = row;
                 A->idx2[ctr] = col;
-                vals[ctr] = vals[i];
+                A->copy_val(vals[i], val_ptr(vals, ctr));
             }
             ctr++;
 
@@ -836,7 +963,7 @@ void remove_duplicates_helper(COOMatrix* A, aligned_vector<T>& vals)
 }
 
 template <typename T>
-void remove_duplicates_helper(CSRMatrix* A, aligned_vector<T>& vals)
+void remove_duplicates_helper(CSRMatrix* A, T& vals)
 {
     int orig_start, orig_end;
     int new_start;
@@ -865,7 +992,7 @@ void remove_duplicates_helper(CSRMatrix* A, aligned_vector<T>& vals)
         // Remove Duplicates
         col = A->idx2[orig_start];
         A->idx2[new_start] = col;
-        vals[new_start] = vals[orig_start];
+        A->copy_val(vals[orig_start], val_ptr(vals, new_start));
         prev_col = col;
         ctr = 1;
         for (int j = orig_start + 1; j < orig_end; j++)
@@ -873,7 +1000,7 @@ void remove_duplicates_helper(CSRMatrix* A, aligned_vector<T>& vals)
             col = A->idx2[j];
             if (col == prev_col)
             {
-                A->append_vals(&vals[ctr - 1 + new_start], &vals[j]);
+                A->append_vals(val_ptr(vals, ctr - 1 + new_start), vals[j]);
             }
             else
             {
@@ -883,7 +1010,7 @@ void remove_duplicates_helper(CSRMatrix* A, aligned_vector<T>& vals)
                 }
 
                 A->idx2[ctr + new_start] = col;
-                vals[ctr + new_start] = vals[j];
+                A->copy_val(vals[j], val_ptr(vals, ctr + new_start));
                 ctr++;
                 prev_col = col;
             }
@@ -902,7 +1029,7 @@ void remove_duplicates_helper(CSRMatrix* A, aligned_vector<T>& vals)
 }
 
 template <typename T>
-void remove_duplicates_helper(CSCMatrix* A, aligned_vector<T>& vals)
+void remove_duplicates_helper(CSCMatrix* A, T& vals)
 {
     int orig_start, orig_end;
     int new_start;
@@ -931,7 +1058,7 @@ void remove_duplicates_helper(CSCMatrix* A, aligned_vector<T>& vals)
         // Remove Duplicates
         row = A->idx2[orig_start];
         A->idx2[new_start] = row;
-        vals[new_start] = vals[orig_start];
+        A->copy_val(vals[orig_start], val_ptr(vals, new_start));
         prev_row = row;
         ctr = 1;
         for (int j = orig_start + 1; j < orig_end; j++)
@@ -939,7 +1066,7 @@ void remove_duplicates_helper(CSCMatrix* A, aligned_vector<T>& vals)
             row = A->idx2[j];
             if (row == prev_row)
             {
-                A->append_vals(&vals[ctr - 1 + new_start], &vals[j]);
+                A->append_vals(val_ptr(vals, ctr - 1 + new_start), vals[j]);
             }
             else
             {
@@ -949,7 +1076,7 @@ void remove_duplicates_helper(CSCMatrix* A, aligned_vector<T>& vals)
                 }
 
                 A->idx2[ctr + new_start] = row;
-                vals[ctr + new_start] = vals[j];
+                A->copy_val(vals[j], val_ptr(vals, ctr + new_start));
                 ctr++;
                 prev_row = row;
             }
@@ -991,6 +1118,13 @@ void BSCMatrix::remove_duplicates()
 {
     remove_duplicates_helper(this, block_vals);
 }
+void SolveMatrix::remove_duplicates()
+{
+    CSRMatrix* A = to_CSR();
+    A->remove_duplicates();
+    init_from_CSR(A);
+    delete A;
+}
 
 /**************************************************************
 *****   Matrix Convert
@@ -1016,10 +1150,7 @@ CSRMatrix* COOMatrix::to_CSR()
 }
 CSRMatrix* BCOOMatrix::to_CSR()
 {
-    BSRMatrix* A = new BSRMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BSRMatrix* A = new BSRMatrix(n_rows, n_cols, b_rows, b_cols);
     COO_to_CSR(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1032,10 +1163,7 @@ CSCMatrix* COOMatrix::to_CSC()
 }
 CSCMatrix* BCOOMatrix::to_CSC()
 {
-    BSCMatrix* A = new BSCMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BSCMatrix* A = new BSCMatrix(n_rows, n_cols, b_rows, b_cols);
     COO_to_CSC(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1048,10 +1176,7 @@ COOMatrix* CSRMatrix::to_COO()
 }
 COOMatrix* BSRMatrix::to_COO()
 {
-    BCOOMatrix* A = new BCOOMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BCOOMatrix* A = new BCOOMatrix(n_rows, n_cols, b_rows, b_cols);
     CSR_to_COO(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1073,10 +1198,7 @@ CSCMatrix* CSRMatrix::to_CSC()
 }
 CSCMatrix* BSRMatrix::to_CSC()
 {
-    BSCMatrix* A = new BSCMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BSCMatrix* A = new BSCMatrix(n_rows, n_cols, b_rows, b_cols);
     CSR_to_CSC(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1089,10 +1211,7 @@ COOMatrix* CSCMatrix::to_COO()
 }
 COOMatrix* BSCMatrix::to_COO()
 {
-    BCOOMatrix* A = new BCOOMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BCOOMatrix* A = new BCOOMatrix(n_rows, n_cols, b_rows, b_cols);
     CSC_to_COO(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1105,10 +1224,7 @@ CSRMatrix* CSCMatrix::to_CSR()
 }
 CSRMatrix* BSCMatrix::to_CSR()
 {
-    BSRMatrix* A = new BSRMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BSRMatrix* A = new BSRMatrix(n_rows, n_cols, b_rows, b_cols);
     CSC_to_CSR(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1121,6 +1237,150 @@ CSCMatrix* BSCMatrix::to_CSC()
     return this;
 }
 
+COOMatrix* SolveMatrix::to_COO()
+{
+    CSRMatrix* A_csr = to_CSR();
+    COOMatrix* A = A_csr->to_COO();
+    delete A_csr;
+    return A;
+}
+CSCMatrix* SolveMatrix::to_CSC()
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSCMatrix* A = A_csr->to_CSC();
+    delete A_csr;
+    return A;
+}
+
+CSRMatrix* SELLMatrix::to_CSR()
+{
+    int C = chunk_height;
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols, nnz);
+
+    A->idx1[0] = 0;
+    for (int slot = 0; slot < n_rows; slot++)
+    {
+        A->idx1[row_order[slot] + 1] = row_sizes[slot];
+    }
+    for (int i = 0; i < n_rows; i++)
+    {
+        A->idx1[i+1] += A->idx1[i];
+    }
+    A->idx2.resize(nnz);
+    A->vals.resize(nnz);
+
+    for (int slot = 0; slot < n_rows; slot++)
+    {
+        int row_pos = A->idx1[row_order[slot]];
+        int pos = idx1[slot / C] + (slot % C);
+        for (int k = 0; k < row_sizes[slot]; k++)
+        {
+            A->idx2[row_pos + k] = idx2[pos];
+            A->vals[row_pos + k] = vals[pos];
+            pos += C;
+        }
+    }
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+
+    return A;
+}
+
+CSRMatrix* FloatCSRMatrix::to_CSR()
+{
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols, nnz);
+    std::copy(idx1.begin(), idx1.end(), A->idx1.begin());
+    A->idx2.resize(nnz);
+    A->vals.resize(nnz);
+    for (int j = 0; j < nnz; j++)
+    {
+        A->idx2[j] = idx2[j];
+        A->vals[j] = float_vals[j];
+    }
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+
+    return A;
+}
+
+CSRMatrix* CompressedCSRMatrix::to_CSR()
+{
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols, nnz);
+    std::copy(idx1.begin(), idx1.end(), A->idx1.begin());
+    A->idx2.resize(nnz);
+    A->vals.resize(nnz);
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            A->idx2[j] = col(i, j);
+            A->vals[j] = vals[j];
+        }
+    }
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+
+    return A;
+}
+
+// Each row of the full matrix holds its entries below the diagonal 
+// (from earlier stored rows, in increasing column order) followed
+// by its stored entries
+CSRMatrix* SymCSRMatrix::to_CSR()
+{
+    int full_nnz = 2*nnz;
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            if (idx2[j] == i) full_nnz--;
+        }
+    }
+
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols, full_nnz);
+    A->idx2.resize(full_nnz);
+    A->vals.resize(full_nnz);
+    std::fill(A->idx1.begin(), A->idx1.end(), 0);
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            int col = idx2[j];
+            A->idx1[i+1]++;
+            if (col != i) A->idx1[col+1]++;
+        }
+    }
+    for (int i = 0; i < n_rows; i++)
+    {
+        A->idx1[i+1] += A->idx1[i];
+    }
+
+    aligned_vector<int> pos(A->idx1.begin(), A->idx1.end() - 1);
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            int col = idx2[j];
+            if (col == i) continue;
+            A->idx2[pos[col]] = i;
+            A->vals[pos[col]++] = vals[j];
+        }
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            A->idx2[pos[i]] = idx2[j];
+            A->vals[pos[i]++] = vals[j];
+        }
+    }
+    A->nnz = full_nnz;
+    A->sorted = sorted;
+    A->diag_first = false;
+
+    return A;
+}
+
 COOMatrix* COOMatrix::copy()
 {
     COOMatrix* A = new COOMatrix();
@@ -1129,10 +1389,7 @@ COOMatrix* COOMatrix::copy()
 }
 BCOOMatrix* BCOOMatrix::copy()
 {
-    BCOOMatrix* A = new BCOOMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BCOOMatrix* A = new BCOOMatrix(n_rows, n_cols, b_rows, b_cols);
     COO_to_COO(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1144,10 +1401,7 @@ CSRMatrix* CSRMatrix::copy()
 }
 BSRMatrix* BSRMatrix::copy()
 {
-    BSRMatrix* A = new BSRMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BSRMatrix* A = new BSRMatrix(n_rows, n_cols, b_rows, b_cols);
     CSR_to_CSR(this, A, block_vals, A->block_vals);
     return A;
 }
@@ -1159,12 +1413,325 @@ CSCMatrix* CSCMatrix::copy()
 }
 BSCMatrix* BSCMatrix::copy()
 {
-    BSCMatrix* A = new BSCMatrix();
-    A->b_rows = b_rows;
-    A->b_cols = b_cols;
-    A->b_size = b_size;
+    BSCMatrix* A = new BSCMatrix(n_rows, n_cols, b_rows, b_cols);
     CSC_to_CSC(this, A, block_vals, A->block_vals);
     return A;
 }
+SELLMatrix* SELLMatrix::copy()
+{
+    SELLMatrix* A = new SELLMatrix();
+    A->n_rows = n_rows;
+    A->n_cols = n_cols;
+    A->nnz = nnz;
+    A->chunk_height = chunk_height;
+    A->sort_window = sort_window;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+    A->idx1 = idx1;
+    A->idx2 = idx2;
+    A->vals = vals;
+    A->row_order = row_order;
+    A->row_sizes = row_sizes;
+    return A;
+}
+FloatCSRMatrix* FloatCSRMatrix::copy()
+{
+    FloatCSRMatrix* A = new FloatCSRMatrix();
+    A->n_rows = n_rows;
+    A->n_cols = n_cols;
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+    A->idx1 = idx1;
+    A->idx2 = idx2;
+    A->float_vals = float_vals;
+    return A;
+}
+CompressedCSRMatrix* CompressedCSRMatrix::copy()
+{
+    CompressedCSRMatrix* A = new CompressedCSRMatrix();
+    A->n_rows = n_rows;
+    A->n_cols = n_cols;
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+    A->idx1 = idx1;
+    A->idx2 = idx2;
+    A->vals = vals;
+    A->row_base = row_base;
+    A->col_offsets = col_offsets;
+    return A;
+}
+SymCSRMatrix* SymCSRMatrix::copy()
+{
+    SymCSRMatrix* A = new SymCSRMatrix();
+    A->n_rows = n_rows;
+    A->n_cols = n_cols;
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+    A->idx1 = idx1;
+    A->idx2 = idx2;
+    A->vals = vals;
+    return A;
+}
+
+/**************************************************************
+*****   SELLMatrix From CSR
+**************************************************************
+***** Forms SELL-C-sigma storage from a scalar CSRMatrix.  Rows 
+***** are sorted by decreasing length within each window of 
+***** sort_window rows, grouped into chunks of chunk_height rows, 
+***** and each chunk is padded to its longest row.  Padding 
+***** repeats the last column of the row with a zero value, so 
+***** padded loads of x stay within the row's cache lines.
+*****
+***** Parameters
+***** -------------
+***** A : const CSRMatrix*
+*****    Matrix to convert (b_size must be 1)
+**************************************************************/
+SELLMatrix::SELLMatrix(const CSRMatrix* A, int _chunk_height, int _sort_window)
+    : SolveMatrix(A->n_rows, A->n_cols)
+{
+    chunk_height = _chunk_height;
+    sort_window = _sort_window;
+    init_from_CSR(A);
+}
+
+void SELLMatrix::init_from_CSR(const CSRMatrix* A)
+{
+    int C = chunk_height;
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+    nnz = A->nnz;
+    sorted = A->sorted;
+    diag_first = A->diag_first;
+
+    // Sort rows by decreasing length within each window
+    row_order.resize(n_rows);
+    std::iota(row_order.begin(), row_order.end(), 0);
+    if (sort_window > 1)
+    {
+        for (int start = 0; start < n_rows; start += sort_window)
+        {
+            int end = std::min(start + sort_window, n_rows);
+            std::stable_sort(row_order.begin() + start, row_order.begin() + end,
+                    [&](const int i, const int j)
+                    {
+                        return (A->idx1[i+1] - A->idx1[i]) > (A->idx1[j+1] - A->idx1[j]);
+                    });
+        }
+    }
+
+    row_sizes.resize(n_rows);
+    for (int slot = 0; slot < n_rows; slot++)
+    {
+        int row = row_order[slot];
+        row_sizes[slot] = A->idx1[row+1] - A->idx1[row];
+    }
+
+    // Find offset of each chunk, with each chunk
+    // padded to its longest row
+    int n_chunks = num_chunks();
+    idx1.resize(n_chunks + 1);
+    idx1[0] = 0;
+    for (int c = 0; c < n_chunks; c++)
+    {
+        int first = c * C;
+        int last = std::min(first + C, n_rows);
+        int width = 0;
+        for (int slot = first; slot < last; slot++)
+        {
+            if (row_sizes[slot] > width) width = row_sizes[slot];
+        }
+        idx1[c+1] = idx1[c] + width * C;
+    }
+
+    idx2.resize(idx1[n_chunks]);
+    vals.resize(idx1[n_chunks]);
+    for (int c = 0; c < n_chunks; c++)
+    {
+        int width = (idx1[c+1] - idx1[c]) / C;
+        for (int r = 0; r < C; r++)
+        {
+            int slot = c * C + r;
+            int pos = idx1[c] + r;
+            int col = 0;
+            int k = 0;
+            if (slot < n_rows)
+            {
+                int row = row_order[slot];
+                int start = A->idx1[row];
+                for ( ; k < row_sizes[slot]; k++)
+                {
+                    col = A->idx2[start + k];
+                    idx2[pos] = col;
+                    vals[pos] = A->vals[start + k];
+                    pos += C;
+                }
+            }
+            for ( ; k < width; k++)
+            {
+                idx2[pos] = col;
+                vals[pos] = 0.0;
+                pos += C;
+            }
+        }
+    }
+}
+
+/**************************************************************
+*****   FloatCSRMatrix From CSR
+**************************************************************
+***** Copies the sparsity pattern of a scalar CSRMatrix and 
+***** rounds its values to single precision
+*****
+***** Parameters
+***** -------------
+***** A : const CSRMatrix*
+*****    Matrix to convert (b_size must be 1)
+**************************************************************/
+FloatCSRMatrix::FloatCSRMatrix(const CSRMatrix* A)
+    : SolveMatrix(A->n_rows, A->n_cols)
+{
+    init_from_CSR(A);
+}
+
+void FloatCSRMatrix::init_from_CSR(const CSRMatrix* A)
+{
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+    nnz = A->nnz;
+    sorted = A->sorted;
+    diag_first = A->diag_first;
+
+    idx1.resize(n_rows + 1);
+    std::copy(A->idx1.begin(), A->idx1.begin() + n_rows + 1, idx1.begin());
+    idx2.resize(nnz);
+    float_vals.resize(nnz);
+    for (int j = 0; j < nnz; j++)
+    {
+        idx2[j] = A->idx2[j];
+        float_vals[j] = (float) A->vals[j];
+    }
+}
+
+/**************************************************************
+*****   CompressedCSRMatrix From CSR
+**************************************************************
+***** Stores each row of a scalar CSRMatrix as a base column 
+***** and 16-bit offsets when its columns span at most 65536
+***** values, and as 32-bit columns otherwise
+*****
+***** Parameters
+***** -------------
+***** A : const CSRMatrix*
+*****    Matrix to convert (b_size must be 1)
+**************************************************************/
+CompressedCSRMatrix::CompressedCSRMatrix(const CSRMatrix* A)
+    : SolveMatrix(A->n_rows, A->n_cols)
+{
+    init_from_CSR(A);
+}
+
+void CompressedCSRMatrix::init_from_CSR(const CSRMatrix* A)
+{
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+    nnz = A->nnz;
+    sorted = A->sorted;
+    diag_first = A->diag_first;
+
+    idx1.resize(n_rows + 1);
+    std::copy(A->idx1.begin(), A->idx1.begin() + n_rows + 1, idx1.begin());
+    vals.resize(nnz);
+    std::copy(A->vals.begin(), A->vals.begin() + nnz, vals.begin());
+    row_base.resize(n_rows);
+    col_offsets.resize(nnz);
+    idx2.clear();
+
+    for (int i = 0; i < n_rows; i++)
+    {
+        int start = A->idx1[i];
+        int end = A->idx1[i+1];
+        int min_col = 0;
+        int max_col = 0;
+        if (start < end)
+        {
+            min_col = A->idx2[start];
+            max_col = min_col;
+        }
+        for (int j = start + 1; j < end; j++)
+        {
+            int col = A->idx2[j];
+            if (col < min_col) min_col = col;
+            if (col > max_col) max_col = col;
+        }
+
+        if (max_col - min_col <= UINT16_MAX)
+        {
+            row_base[i] = min_col;
+            for (int j = start; j < end; j++)
+            {
+                col_offsets[j] = (uint16_t) (A->idx2[j] - min_col);
+            }
+        }
+        else
+        {
+            row_base[i] = -1 - (int) idx2.size();
+            for (int j = start; j < end; j++)
+            {
+                col_offsets[j] = 0;
+                idx2.push_back(A->idx2[j]);
+            }
+        }
+    }
+}
 
+/**************************************************************
+*****   SymCSRMatrix From CSR
+**************************************************************
+***** Keeps the diagonal and upper triangle of each row of a 
+***** square, symmetric (scalar) CSRMatrix.  Symmetry is not 
+***** checked here; entries below the diagonal are dropped.
+*****
+***** Parameters
+***** -------------
+***** A : const CSRMatrix*
+*****    Symmetric matrix to convert (b_size must be 1)
+**************************************************************/
+SymCSRMatrix::SymCSRMatrix(const CSRMatrix* A)
+    : SolveMatrix(A->n_rows, A->n_cols)
+{
+    init_from_CSR(A);
+}
+
+void SymCSRMatrix::init_from_CSR(const CSRMatrix* A)
+{
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+    sorted = A->sorted;
+    diag_first = A->sorted || A->diag_first;
+
+    idx1.resize(n_rows + 1);
+    idx2.clear();
+    vals.clear();
+    idx2.reserve(A->nnz / 2 + n_rows);
+    vals.reserve(A->nnz / 2 + n_rows);
 
+    idx1[0] = 0;
+    for (int i = 0; i < n_rows; i++)
+    {
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            if (A->idx2[j] >= i)
+            {
+                idx2.push_back(A->idx2[j]);
+                vals.push_back(A->vals[j]);
+            }
+        }
+        idx1[i+1] = idx2.size();
+    }
+    nnz = idx2.size();
+}
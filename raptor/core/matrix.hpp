@@ -53,6 +53,12 @@ namespace raptor
   class COOMatrix;
   class CSRMatrix;
   class CSCMatrix;
+  class SolveMatrix;
+  class SELLMatrix;
+  class FloatCSRMatrix;
+  class CompressedCSRMatrix;
+  class SymCSRMatrix;
+  class SpGEMMPlan;
   class Matrix
   {
 
@@ -113,14 +119,14 @@ namespace raptor
         nnz = data.size();
         resize_data(nnz);
 
-        T* val_list = (T*) get_data();
+        double* val_list = (double*) get_data();
 
-        std::copy(_idx1.begin(), _idx1.end(), std::back_inserter(idx1));
-        std::copy(_idx2.begin(), _idx2.end(), std::back_inserter(idx2));
+        idx1.assign(_idx1.begin(), _idx1.end());
+        idx2.assign(_idx2.begin(), _idx2.end());
 
         for (int i = 0; i < nnz; i++)
         {
-            val_list[i] = copy_val(data[i]);
+            copy_val(data[i], &val_list[i*b_size]);
         }
     }
 
@@ -165,7 +171,7 @@ namespace raptor
     {
         printf("A[%d][%d] = %e\n", row, col, val);
     }
-    void val_print(int row, int col, double* val) const
+    void val_print(int row, int col, const double* val) const
     {
         for (int i = 0; i < b_rows; i++)
         {
@@ -176,18 +182,18 @@ namespace raptor
         }
     }
 
-    double copy_val(double val) const
+    // Methods for copying a single or block value
+    // into the storage at dest
+    void copy_val(double val, double* dest) const
     {
-        return val;
+        *dest = val;
     }
-    double* copy_val(double* val) const
+    void copy_val(const double* val, double* dest) const
     {
-        double* new_val = new double[b_size];
         for (int i = 0; i < b_size; i++)
         {
-            new_val[i] = val[i];
+            dest[i] = val[i];
         }
-        return new_val;
     }
 
     // Method for finding the absolute value of 
@@ -196,7 +202,7 @@ namespace raptor
     {
         return fabs(val);
     }
-    double abs_val(double* val) const
+    double abs_val(const double* val) const
     {
         double sum = 0;
         for (int i = 0; i < b_size; i++)
@@ -208,24 +214,23 @@ namespace raptor
 
     // Methods for appending two values
     // (either single or block values)
-    void append_vals(double* val, double* addl_val) const
+    void append_vals(double* val, double addl_val) const
     {
-        *val += *addl_val;
+        *val += addl_val;
     }
-    void append_vals(double** val, double** addl_val) const
+    void append_vals(double* val, const double* addl_val) const
     {
         for (int i = 0; i < b_size; i++)
         {
-            *val[i] += *addl_val[i];
+            val[i] += addl_val[i];
         }
-        delete[] *addl_val;
     }
     void mult_vals(double val, double addl_val, double* sum, 
             int n_rows, int n_cols, int n_inner) const
     {
         *sum += (val * addl_val);
     }
-    void mult_vals(double* val, double* addl_val, double** sum,
+    void mult_vals(const double* val, const double* addl_val, double* sum,
             int n_rows, int n_cols, int n_inner) const
     {
         for (int i = 0; i < n_rows; i++) // Go through b_rows of A
@@ -235,9 +240,9 @@ namespace raptor
                 double s = 0;
                 for (int k = 0; k < n_inner; k++) // Go through b_cols of A (== b_rows of B)
                 {
-                    s += val[i*n_inner + k] * addl_val[k*n_inner + j];
+                    s += val[i*n_inner + k] * addl_val[k*n_cols + j];
                 }
-                (*sum)[i*n_cols + j] += s;
+                sum[i*n_cols + j] += s;
             }
         }
     }
@@ -246,19 +251,19 @@ namespace raptor
     {
         *sum += (val * addl_val);
     }
-    void mult_T_vals(double* val, double* addl_val, double** sum,
+    void mult_T_vals(const double* val, const double* addl_val, double* sum,
             int n_rows, int n_cols, int n_inner) const
     {
-        for (int i = 0; i < n_rows; i++) // Go through b_rows of A
+        for (int i = 0; i < n_rows; i++) // Go through b_cols of A
         { 
             for (int j = 0; j < n_cols; j++) // Go through b_cols of B
             {
                 double s = 0;
-                for (int k = 0; k < n_inner; k++) // Go through b_cols of A (== b_rows of B)
+                for (int k = 0; k < n_inner; k++) // Go through b_rows of A (== b_rows of B)
                 {
-                    s += val[k*n_inner + i] * addl_val[k*n_inner + j];
+                    s += val[k*n_rows + i] * addl_val[k*n_cols + j];
                 }
-                (*sum)[i*n_cols + j] += s;
+                sum[i*n_cols + j] += s;
             }
         }
     }
@@ -321,7 +326,7 @@ namespace raptor
     void append_neg_T(int idx1, int idx2, double* b, const double* x, const double* val) const
     {
         int first_row = idx1*b_rows;
-        int first_col = idx1*b_cols;
+        int first_col = idx2*b_cols;
         for (int row = 0; row < b_rows; row++)
         {
             for (int col = 0; col < b_cols; col++)
@@ -489,7 +494,7 @@ namespace raptor
             resize_data(nnz_dense);
         }
 
-        T* val_list = (T*) get_data();
+        double* val_list = (double*) get_data();
 
         for (int i = 0; i < n_rows; i++)
         {
@@ -500,7 +505,7 @@ namespace raptor
                 {
                     idx1[nnz] = i;
                     idx2[nnz] = j;
-                    val_list[nnz] = copy_val(_data[pos]);
+                    copy_val(_data[pos], &val_list[nnz*b_size]);
                     nnz++;
                 }
             }
@@ -665,7 +670,7 @@ namespace raptor
             resize_data(nnz_dense);
         }
 
-        T* val_list = (T*) get_data();
+        double* val_list = (double*) get_data();
 
         idx1[0] = 0;
         for (int i = 0; i < n_rows; i++)
@@ -676,7 +681,7 @@ namespace raptor
                 if (abs_val(_data[pos]))
                 {
                     idx2[nnz] = j;
-                    val_list[nnz] = copy_val(_data[pos]);
+                    copy_val(_data[pos], &val_list[nnz*b_size]);
                     nnz++;
                 }
             }
@@ -699,9 +704,24 @@ namespace raptor
     void spmv_append_neg_T(const double* x, double* b) const;
     void spmv_residual(const double* x, const double* b, double* r) const; 
 
+    // SpMM with n_vecs vectors, interleaved row-major (value v of 
+    // row i at x[i*n_vecs + v]) as in ParMultiVector
+    void spmm(const double* x, double* b, int n_vecs) const;
+    void spmm_append(const double* x, double* b, int n_vecs) const;
+    void spmm_append_neg(const double* x, double* b, int n_vecs) const;
+    void spmm_append_T(const double* x, double* b, int n_vecs) const;
+    void spmm_residual(const double* x, const double* b, double* r, 
+            int n_vecs) const;
+
     CSRMatrix* spgemm(CSRMatrix* B, int* B_to_C = NULL);
     CSRMatrix* spgemm_T(CSCMatrix* A, int* C_map = NULL);
 
+    // Two phase SpGEMM C = this * B: the symbolic phase forms the 
+    // pattern of C, and the numeric phase (re)computes C's values 
+    // for matrices with the same patterns as when planned
+    SpGEMMPlan* spgemm_symbolic(CSRMatrix* B, int* B_to_C = NULL);
+    void spgemm_numeric(CSRMatrix* B, SpGEMMPlan* plan, CSRMatrix* C);
+
     CSRMatrix* add(CSRMatrix* A, bool remove_dup = true);
     void add_append(CSRMatrix* A, CSRMatrix* C, bool remove_dup = true);
     CSRMatrix* subtract(CSRMatrix* A);
@@ -832,7 +852,7 @@ namespace raptor
             resize_data(nnz_dense);
         }
 
-        T* val_list = (T*) get_data();
+        double* val_list = (double*) get_data();
 
         idx1[0] = 0;
         for (int i = 0; i < n_cols; i++)
@@ -843,7 +863,7 @@ namespace raptor
                 if (abs_val(_data[pos]) > zero_tol)
                 {
                     idx2[nnz] = j;
-                    val_list[nnz] = copy_val(_data[pos]);
+                    copy_val(_data[pos], &val_list[nnz*b_size]);
                     nnz++;
                 }
             }
@@ -924,6 +944,540 @@ namespace raptor
 
 
 
+/**************************************************************
+ *****   SolveMatrix Class (Inherits from Matrix Base Class)
+ **************************************************************
+ ***** Base of the read-only copies of a (scalar) CSRMatrix formed
+ ***** for solve phase products (SELL, float, compressed, and 
+ ***** symmetric storage).  Each implements its SpMVs, to_CSR, and
+ ***** init_from_CSR.  Reordering (sort, move_diag, and 
+ ***** remove_duplicates), conversions, and SpGEMMs go through a
+ ***** CSR copy, as they are only needed before the solve phase.
+ ***** Entries cannot be added to these layouts; form a CSRMatrix
+ ***** and convert it instead.
+ **************************************************************/
+  class SolveMatrix : public Matrix
+  {
+
+  public:
+
+    SolveMatrix(int _nrows, int _ncols) : Matrix(_nrows, _ncols)
+    {
+    }
+
+    SolveMatrix()
+    {
+    }
+
+    virtual ~SolveMatrix()
+    {
+
+    }
+
+    virtual void init_from_CSR(const CSRMatrix* A) = 0;
+
+    void sort();
+    void move_diag();
+    void remove_duplicates();
+
+    CSRMatrix* spgemm(CSRMatrix* B, int* B_to_C = NULL);
+    CSRMatrix* spgemm_T(CSCMatrix* A, int* C_map = NULL);
+
+    COOMatrix* to_COO();
+    CSCMatrix* to_CSC();
+
+    void add_value(int /*row*/, int /*col*/, double /*value*/) 
+    {
+        throw std::logic_error("Solve phase matrices do not support add_value; convert from CSR");
+    }
+    void add_value(int /*row*/, int /*col*/, double* /*value*/)
+    {
+        throw std::logic_error("Solve phase matrices do not support add_value; convert from CSR");
+    }
+
+    void* get_data()
+    {
+       return vals.data();
+    } 
+    int data_size() const
+    {
+        return vals.size();
+    }
+    void resize_data(int size)
+    {
+        vals.resize(size);
+    }
+    void reserve_size(int size)
+    {
+        idx2.reserve(size);
+        vals.reserve(size);
+    }
+
+    double get_val(const int j, const int /*k*/)
+    {
+        return vals[j];
+    }
+  };
+
+
+/**************************************************************
+ *****   SELLMatrix Class (Inherits from SolveMatrix)
+ **************************************************************
+ ***** This class stores a sparse matrix in sliced ELLPACK 
+ ***** (SELL-C-sigma) format.  Rows are grouped into chunks of 
+ ***** chunk_height (C) rows, and each chunk is padded to the 
+ ***** length of its longest row and stored column-wise, so 
+ ***** consecutive values belong to consecutive rows of the chunk 
+ ***** and SpMVs can fill a SIMD register per column of a chunk.  
+ ***** Before chunking, rows are sorted by length within windows 
+ ***** of sort_window (sigma) rows to limit padding.
+ *****
+ ***** A SELLMatrix is formed from a (scalar) CSRMatrix and is 
+ ***** intended for the solve phase, where the same matrix is 
+ ***** applied many times.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** idx1 : aligned_vector<int>
+ *****    Position in idx2 and vals of the first entry of each chunk
+ ***** idx2 : aligned_vector<int>
+ *****    Column of each entry, including padding
+ ***** vals : aligned_vector<double>
+ *****    Value of each entry (zero for padding)
+ ***** row_order : aligned_vector<int>
+ *****    Row of the matrix held in each chunk slot
+ ***** row_sizes : aligned_vector<int>
+ *****    Number of nonzeros (excluding padding) in each chunk slot
+ ***** chunk_height : int
+ *****    Number of rows per chunk (C)
+ ***** sort_window : int
+ *****    Number of rows sorted by length at a time (sigma)
+ ***** chunk_sums : aligned_vector<double>
+ *****    Row sums of one chunk, reused by scalar SpMVs
+ **************************************************************/
+  class SELLMatrix : public SolveMatrix
+  {
+
+  public:
+
+    SELLMatrix(int _nrows, int _ncols, int _chunk_height = 8, 
+            int _sort_window = 1) : SolveMatrix(_nrows, _ncols)
+    {
+        chunk_height = _chunk_height;
+        sort_window = _sort_window;
+        idx1.resize(num_chunks() + 1, 0);
+        row_sizes.resize(n_rows, 0);
+        row_order.resize(n_rows);
+        std::iota(row_order.begin(), row_order.end(), 0);
+    }
+
+    SELLMatrix(const CSRMatrix* A, int _chunk_height = 8, int _sort_window = 1);
+
+    SELLMatrix()
+    {
+        chunk_height = 8;
+        sort_window = 1;
+        idx1.resize(1, 0);
+    }
+
+    ~SELLMatrix()
+    {
+
+    }
+
+    void init_from_CSR(const CSRMatrix* A);
+
+    int num_chunks() const
+    {
+        return (n_rows + chunk_height - 1) / chunk_height;
+    }
+
+    SELLMatrix* transpose();
+    void print();
+
+    void spmv(const double* x, double* b) const;
+    void spmv_append(const double* x, double* b) const;
+    void spmv_append_T(const double* x, double* b) const;
+    void spmv_append_neg(const double* x, double* b) const;
+    void spmv_append_neg_T(const double* x, double* b) const;
+    void spmv_residual(const double* x, const double* b, double* r) const; 
+
+    CSRMatrix* to_CSR();
+    SELLMatrix* copy();
+
+    format_t format()
+    {
+        return SELL;
+    }
+
+    aligned_vector<int> row_order;
+    aligned_vector<int> row_sizes;
+    int chunk_height;
+    int sort_window;
+    mutable aligned_vector<double> chunk_sums;
+  };
+
+
+/**************************************************************
+ *****   FloatCSRMatrix Class (Inherits from SolveMatrix)
+ **************************************************************
+ ***** This class stores a sparse matrix in CSR format with values
+ ***** in single precision.  SpMVs read float values but multiply
+ ***** and accumulate in double, with double vectors, so each 
+ ***** nonzero streams 8 bytes rather than 12.  
+ *****
+ ***** A FloatCSRMatrix is formed from a (scalar) CSRMatrix once 
+ ***** setup is complete, for solve phase products, where the
+ ***** rounding (relative error near 6e-8 per value) lies below
+ ***** the accuracy of an AMG cycle.  Setup keeps the double
+ ***** matrix, since relaxation weights and coarse solves need it.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** idx1 : aligned_vector<int>
+ *****    Position in idx2 and float_vals of the first entry of 
+ *****    each row
+ ***** idx2 : aligned_vector<int>
+ *****    Column of each entry
+ ***** float_vals : aligned_vector<float>
+ *****    Value of each entry, rounded to single precision
+ **************************************************************/
+  class FloatCSRMatrix : public SolveMatrix
+  {
+
+  public:
+
+    FloatCSRMatrix(int _nrows, int _ncols) : SolveMatrix(_nrows, _ncols)
+    {
+        idx1.resize(n_rows + 1, 0);
+    }
+
+    FloatCSRMatrix(const CSRMatrix* A);
+
+    FloatCSRMatrix()
+    {
+        idx1.resize(1, 0);
+    }
+
+    ~FloatCSRMatrix()
+    {
+
+    }
+
+    void init_from_CSR(const CSRMatrix* A);
+
+    FloatCSRMatrix* transpose();
+    void print();
+
+    void spmv(const double* x, double* b) const;
+    void spmv_append(const double* x, double* b) const;
+    void spmv_append_T(const double* x, double* b) const;
+    void spmv_append_neg(const double* x, double* b) const;
+    void spmv_append_neg_T(const double* x, double* b) const;
+    void spmv_residual(const double* x, const double* b, double* r) const; 
+
+    CSRMatrix* to_CSR();
+    FloatCSRMatrix* copy();
+
+    format_t format()
+    {
+        return FloatCSR;
+    }
+
+    void* get_data()
+    {
+       return float_vals.data();
+    } 
+    int data_size() const
+    {
+        return float_vals.size();
+    }
+    void resize_data(int size)
+    {
+        float_vals.resize(size);
+    }
+    void reserve_size(int size)
+    {
+        idx2.reserve(size);
+        float_vals.reserve(size);
+    }
+
+    double get_val(const int j, const int /*k*/)
+    {
+        return float_vals[j];
+    }
+
+    aligned_vector<float> float_vals;
+  };
+
+
+/**************************************************************
+ *****   CompressedCSRMatrix Class (Inherits from SolveMatrix)
+ **************************************************************
+ ***** This class stores a sparse matrix in CSR format with 
+ ***** compressed column indices.  Each row holds a base column
+ ***** (its smallest column) and a 16-bit offset per nonzero, so
+ ***** banded or reordered rows stream 10 bytes per nonzero rather
+ ***** than 12.  Rows spanning more than 65536 columns fall back 
+ ***** to 32-bit columns, stored in idx2.
+ *****
+ ***** A CompressedCSRMatrix is formed from a (scalar) CSRMatrix,
+ ***** typically on_proc, for the solve phase.  Other operations 
+ ***** go through a CSR copy.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** idx1 : aligned_vector<int>
+ *****    Position in vals and col_offsets of the first entry of 
+ *****    each row
+ ***** row_base : aligned_vector<int>
+ *****    Base column of each 16-bit row, or -1 - (position in idx2
+ *****    of the row's first column) for 32-bit rows
+ ***** col_offsets : aligned_vector<uint16_t>
+ *****    Column of each entry of a 16-bit row, minus the row's base
+ ***** idx2 : aligned_vector<int>
+ *****    Columns of the 32-bit rows only
+ **************************************************************/
+  class CompressedCSRMatrix : public SolveMatrix
+  {
+
+  public:
+
+    CompressedCSRMatrix(int _nrows, int _ncols) : SolveMatrix(_nrows, _ncols)
+    {
+        idx1.resize(n_rows + 1, 0);
+        row_base.resize(n_rows, 0);
+    }
+
+    CompressedCSRMatrix(const CSRMatrix* A);
+
+    CompressedCSRMatrix()
+    {
+        idx1.resize(1, 0);
+    }
+
+    ~CompressedCSRMatrix()
+    {
+
+    }
+
+    void init_from_CSR(const CSRMatrix* A);
+
+    // Column of entry j, which lies in row
+    int col(const int row, const int j) const
+    {
+        int base = row_base[row];
+        if (base >= 0) return base + col_offsets[j];
+        return idx2[-base - 1 + j - idx1[row]];
+    }
+
+    // Sum of vals[j] * x[col(row, j)] over entries [start, end) of row
+    double row_sum(const int row, const int start, const double* x) const
+    {
+        int end = idx1[row+1];
+        int base = row_base[row];
+        double sum = 0.0;
+        if (base >= 0)
+        {
+            for (int j = start; j < end; j++)
+            {
+                sum += vals[j] * x[base + col_offsets[j]];
+            }
+        }
+        else
+        {
+            const int shift = -base - 1 - idx1[row];
+            for (int j = start; j < end; j++)
+            {
+                sum += vals[j] * x[idx2[shift + j]];
+            }
+        }
+        return sum;
+    }
+
+    // Number of rows stored with 32-bit columns
+    int num_wide_rows() const
+    {
+        int n_wide = 0;
+        for (int i = 0; i < n_rows; i++)
+        {
+            if (row_base[i] < 0) n_wide++;
+        }
+        return n_wide;
+    }
+
+    CompressedCSRMatrix* transpose();
+    void print();
+
+    void spmv(const double* x, double* b) const;
+    void spmv_append(const double* x, double* b) const;
+    void spmv_append_T(const double* x, double* b) const;
+    void spmv_append_neg(const double* x, double* b) const;
+    void spmv_append_neg_T(const double* x, double* b) const;
+    void spmv_residual(const double* x, const double* b, double* r) const; 
+
+    CSRMatrix* to_CSR();
+    CompressedCSRMatrix* copy();
+
+    format_t format()
+    {
+        return CompressedCSR;
+    }
+
+    void reserve_size(int size)
+    {
+        col_offsets.reserve(size);
+        vals.reserve(size);
+    }
+
+    aligned_vector<int> row_base;
+    aligned_vector<uint16_t> col_offsets;
+  };
+
+
+/**************************************************************
+ *****   SymCSRMatrix Class (Inherits from SolveMatrix)
+ **************************************************************
+ ***** This class stores a square symmetric sparse matrix as the
+ ***** diagonal and upper triangle of each row, in CSR format.
+ ***** SpMVs apply both halves in a single pass over the stored
+ ***** entries: entry (i, j) adds to row i with x[j] and, off the
+ ***** diagonal, to row j with x[i].  A^T * x is A * x, so
+ ***** transposed products use the same kernel.
+ *****
+ ***** A SymCSRMatrix is formed from a symmetric (scalar) CSRMatrix
+ ***** once setup is complete, for solve phase products; other
+ ***** operations go through to_CSR().  Threads own contiguous
+ ***** rows, and entries reaching rows of a later thread are
+ ***** summed in per-thread scratch kept with the matrix.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** idx1 : aligned_vector<int>
+ *****    Position in idx2 and vals of the first entry of each row
+ ***** idx2 : aligned_vector<int>
+ *****    Column of each entry, no less than its row
+ ***** vals : aligned_vector<double>
+ *****    Value of each entry
+ ***** scatter : std::vector<aligned_vector<double> >
+ *****    Per-thread sums for rows past the thread's own rows,
+ *****    zero between products
+ **************************************************************/
+  class SymCSRMatrix : public SolveMatrix
+  {
+
+  public:
+
+    SymCSRMatrix(int _nrows, int _ncols) : SolveMatrix(_nrows, _ncols)
+    {
+        idx1.resize(n_rows + 1, 0);
+    }
+
+    SymCSRMatrix(const CSRMatrix* A);
+
+    SymCSRMatrix()
+    {
+        idx1.resize(1, 0);
+    }
+
+    ~SymCSRMatrix()
+    {
+
+    }
+
+    void init_from_CSR(const CSRMatrix* A);
+
+    SymCSRMatrix* transpose();
+    void print();
+
+    void spmv(const double* x, double* b) const;
+    void spmv_append(const double* x, double* b) const;
+    void spmv_append_T(const double* x, double* b) const;
+    void spmv_append_neg(const double* x, double* b) const;
+    void spmv_append_neg_T(const double* x, double* b) const;
+    void spmv_residual(const double* x, const double* b, double* r) const; 
+
+    CSRMatrix* to_CSR();
+    SymCSRMatrix* copy();
+
+    format_t format()
+    {
+        return SymCSR;
+    }
+
+    mutable std::vector<aligned_vector<double> > scatter;
+  };
+
+
+
+/**************************************************************
+ *****   SpGEMMPlan Class
+ **************************************************************
+ ***** Holds the sparsity pattern of a sum of sparse products
+ ***** C = sum_t A_t * B_t, so that products with the same 
+ ***** patterns (e.g. A*P and P^T*AP recomputed every time step)
+ ***** skip the symbolic phase and only compute values.
+ *****
+ ***** The rows of each A_t are read from its idx1, idx2, and 
+ ***** vals, so a CSCMatrix A_t contributes A_t^T.  A term with 
+ ***** no A adds the rows of B directly.  Columns of B are mapped
+ ***** to columns of C through B_to_C, if given.  In the numeric
+ ***** phase, the position of each product in C is found by 
+ ***** scattering the (sorted) columns of the row of C.
+ *****
+ ***** The pattern is structural: products that cancel are kept 
+ ***** as explicit zeros, where spgemm drops them.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** n_rows : int
+ *****    Number of rows of C
+ ***** n_cols : int
+ *****    Number of columns of C
+ ***** idx1 : aligned_vector<int>
+ *****    Row pointer of C
+ ***** idx2 : aligned_vector<int>
+ *****    Column of each entry of C, sorted within each row
+ ***** col_map : aligned_vector<int>
+ *****    Copy of B_to_C for plans formed by 
+ *****    CSRMatrix::spgemm_symbolic
+ **************************************************************/
+  class SpGEMMPlan
+  {
+  public:
+    struct Term
+    {
+        const Matrix* A;
+        const Matrix* B;
+        const int* B_to_C;
+    };
+
+    SpGEMMPlan()
+    {
+        n_rows = 0;
+        n_cols = 0;
+        idx1.resize(1, 0);
+    }
+
+    void symbolic(int _n_rows, int _n_cols, const std::vector<Term>& terms);
+    void numeric(const std::vector<Term>& terms, double* vals) const;
+
+    int nnz() const
+    {
+        return idx1[n_rows];
+    }
+
+    int n_rows;
+    int n_cols;
+    aligned_vector<int> idx1;
+    aligned_vector<int> idx2;
+    aligned_vector<int> col_map;
+
+    // Per-thread position in vals of each column of C, kept between
+    // numeric calls
+    mutable std::vector<aligned_vector<int> > pos;
+  };
+
 // Forward Declaration of Blocked Classes 
 class BCOOMatrix;
 class BSRMatrix;
@@ -939,6 +1493,7 @@ class BSRMatrix : public CSRMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
     }
 
     BSRMatrix(int num_block_rows, int num_block_cols, 
@@ -948,6 +1503,7 @@ class BSRMatrix : public CSRMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
 
         init_from_dense(data);
     }
@@ -961,6 +1517,7 @@ class BSRMatrix : public CSRMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
 
         init_from_lists(rowptr, cols, data);
     }
@@ -975,9 +1532,6 @@ class BSRMatrix : public CSRMatrix
 
     ~BSRMatrix()
     {
-        for (aligned_vector<double*>::iterator it = block_vals.begin();
-                it != block_vals.end(); ++it)
-            delete[] *it;
     }
 
     BSRMatrix* transpose();
@@ -1010,7 +1564,7 @@ class BSRMatrix : public CSRMatrix
     void add_value(int row, int col, double* value) 
     {
         idx2.emplace_back(col);
-        block_vals.emplace_back(copy_val(value));
+        block_vals.emplace_back(value);
         nnz++;
     }
 
@@ -1037,7 +1591,7 @@ class BSRMatrix : public CSRMatrix
         return block_vals[j][k];
     }
 
-    aligned_vector<double*> block_vals;
+    BlockArray block_vals;
 };
 
 class BCOOMatrix : public COOMatrix
@@ -1050,6 +1604,7 @@ class BCOOMatrix : public COOMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
     }
 
     BCOOMatrix(int num_block_rows, int num_block_cols,
@@ -1059,6 +1614,7 @@ class BCOOMatrix : public COOMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
         
         init_from_dense(values); 
     }
@@ -1072,6 +1628,7 @@ class BCOOMatrix : public COOMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
 
         init_from_lists(rows, cols, data);
     }
@@ -1085,9 +1642,6 @@ class BCOOMatrix : public COOMatrix
 
     ~BCOOMatrix()
     {
-        for (aligned_vector<double*>::iterator it = block_vals.begin();
-                it != block_vals.end(); ++it)
-            delete[] *it;
     }
 
     BCOOMatrix* transpose();
@@ -1115,7 +1669,7 @@ class BCOOMatrix : public COOMatrix
     {
         idx1.emplace_back(row);
         idx2.emplace_back(col);
-        block_vals.emplace_back(copy_val(values));
+        block_vals.emplace_back(values);
         nnz++;
     }
 
@@ -1148,7 +1702,7 @@ class BCOOMatrix : public COOMatrix
         return block_vals[j][k];
     }
 
-    aligned_vector<double*> block_vals;
+    BlockArray block_vals;
 };
 
 // Blocks are still stored row-wise in BSC matrix...
@@ -1162,6 +1716,7 @@ class BSCMatrix : public CSCMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
     }
 
     BSCMatrix(int num_block_rows, int num_block_cols, 
@@ -1171,6 +1726,7 @@ class BSCMatrix : public CSCMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
 
         init_from_dense(data);
     }
@@ -1184,6 +1740,7 @@ class BSCMatrix : public CSCMatrix
         b_rows = block_row_size;
         b_cols = block_col_size;
         b_size = b_rows * b_cols;
+        block_vals.set_block_size(b_size);
 
         init_from_lists(colptr, rows, data);
     }
@@ -1198,9 +1755,6 @@ class BSCMatrix : public CSCMatrix
 
     ~BSCMatrix()
     {
-        for (aligned_vector<double*>::iterator it = block_vals.begin();
-                it != block_vals.end(); ++it)
-            delete[] *it;
     }
 
     BSCMatrix* transpose();
@@ -1233,7 +1787,7 @@ class BSCMatrix : public CSCMatrix
     void add_value(int row, int col, double* value)
     {
         idx2.emplace_back(row);
-        block_vals.emplace_back(copy_val(value));
+        block_vals.emplace_back(value);
         nnz++;
     }
 
@@ -1260,7 +1814,7 @@ class BSCMatrix : public CSCMatrix
         return block_vals[j][k];
     }
 
-    aligned_vector<double*> block_vals;
+    BlockArray block_vals;
 };
 
 
@@ -2,6 +2,10 @@
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 #include "par_matrix.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <assert.h>
+
 using namespace raptor;
 
 /**************************************************************
@@ -423,7 +427,8 @@ void ParCSRMatrix::copy_helper(ParCSRMatrix* A)
         delete off_proc;
     }
 
-    on_proc = A->on_proc->copy();
+    if (A->on_proc_sym) on_proc = A->on_proc_sym->to_CSR();
+    else on_proc = A->on_proc->copy();
     off_proc = A->off_proc->copy();
 
     ParMatrix::copy_helper(A);
@@ -514,140 +519,341 @@ void ParCSCMatrix::copy_helper(ParCOOMatrix* A)
     ParMatrix::copy_helper(A);
 }
 
-// Main transpose
-ParCSRMatrix* ParCSRMatrix::transpose()
+ParTransposePlan::~ParTransposePlan()
 {
-    int start, end;
-    int proc;
-    int col, col_start, col_end;
-    int ctr, size;
-    int col_count, count;
-    int col_size;
-    int idx, row;
-    MPI_Status recv_status;
-
-    Partition* part_T;
-    Matrix* on_proc_T;
-    Matrix* off_proc_T;
-    CSCMatrix* send_mat;
-    CSCMatrix* recv_mat;
-    ParCSRMatrix* T = NULL;
-
-    aligned_vector<PairData> send_buffer;
-    aligned_vector<PairData> recv_buffer;
-    aligned_vector<int> send_ptr(comm->recv_data->num_msgs+1);
+    delete comm;
+}
 
-    // Transpose partition
-    part_T = partition->transpose();
+/**************************************************************
+*****   Form Transpose Plan
+**************************************************************
+***** Forms the pattern of T = A^T, the communication package
+***** of T, and the exchange of A->off_proc values.  The global
+***** rows of each off_proc column of A are sent to the process 
+***** owning the column (the processes A->comm receives from), 
+***** and are received from the processes A->comm sends to, so
+***** the pattern is formed with point-to-point messages only.
+*****
+***** Parameters
+***** -------------
+***** A : ParCSRMatrix*
+*****    Matrix to be transposed
+***** plan : ParTransposePlan*
+*****    Plan to be formed
+**************************************************************/
+void form_transpose_plan(ParCSRMatrix* A, ParTransposePlan* plan)
+{
+    int start, end, col_start, col_end;
+    int proc, count, size;
+    int row, idx, ctr;
+    MPI_Status recv_status;
 
-    // Transpose local (on_proc) matrix
-    on_proc_T = on_proc->transpose();
+    ParComm* comm = A->comm;
+    Matrix* A_on = A->on_proc;
+    Matrix* A_off = A->off_proc;
+    int n_rows_T = A->on_proc_num_cols;
+    int n_send = comm->recv_data->num_msgs;
+    int n_recv = comm->send_data->num_msgs;
+
+    plan->comm = new ParComm(A->partition, comm->key, comm->mpi_comm);
+    ParComm* comm_T = plan->comm;
+
+    // Transpose on_proc, storing the entry of A held by each entry of T
+    int on_nnz = A_on->idx1[A->local_num_rows];
+    plan->on_idx1.assign(n_rows_T + 1, 0);
+    plan->on_idx2.resize(on_nnz);
+    plan->on_pos.resize(on_nnz);
+    for (int j = 0; j < on_nnz; j++)
+    {
+        plan->on_idx1[A_on->idx2[j] + 1]++;
+    }
+    for (int i = 0; i < n_rows_T; i++)
+    {
+        plan->on_idx1[i+1] += plan->on_idx1[i];
+    }
+    aligned_vector<int> row_pos(plan->on_idx1.begin(), plan->on_idx1.end() - 1);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        for (int j = A_on->idx1[i]; j < A_on->idx1[i+1]; j++)
+        {
+            idx = row_pos[A_on->idx2[j]]++;
+            plan->on_idx2[idx] = i;
+            plan->on_pos[idx] = j;
+        }
+    }
 
-    // Allocate vectors for sending off_proc matrix
-    send_mat = off_proc->to_CSC();
-    recv_mat = new CSCMatrix(local_num_rows, comm->send_data->size_msgs);
+    // Order entries of off_proc by column (rows remain ascending)
+    int off_nnz = A_off->idx1[A->local_num_rows];
+    aligned_vector<int> col_ptr(A->off_proc_num_cols + 1, 0);
+    aligned_vector<int> col_rows(off_nnz);
+    aligned_vector<int> col_pos(off_nnz);
+    for (int j = 0; j < off_nnz; j++)
+    {
+        col_ptr[A_off->idx2[j] + 1]++;
+    }
+    for (int i = 0; i < A->off_proc_num_cols; i++)
+    {
+        col_ptr[i+1] += col_ptr[i];
+    }
+    row_pos.assign(col_ptr.begin(), col_ptr.end() - 1);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        for (int j = A_off->idx1[i]; j < A_off->idx1[i+1]; j++)
+        {
+            idx = row_pos[A_off->idx2[j]]++;
+            col_rows[idx] = i;
+            col_pos[idx] = j;
+        }
+    }
 
-    // Add off_proc cols of matrix to send buffer
-    ctr = 0;
-    send_ptr[0] = 0;
-    for (int i = 0; i < comm->recv_data->num_msgs; i++)
+    // Send the size and global rows of each off_proc column to its
+    // owner.  Local rows with entries in a message are the values
+    // T will send to that process.
+    aligned_vector<int> send_buffer;
+    aligned_vector<int> msg_ptr(n_send + 1);
+    aligned_vector<int> row_mark(A->local_num_rows, -1);
+    aligned_vector<int> send_rows;
+    aligned_vector<MPI_Request> requests(n_send);
+    msg_ptr[0] = 0;
+    plan->send_ptr.emplace_back(0);
+    for (int i = 0; i < n_send; i++)
     {
+        proc = comm->recv_data->procs[i];
         start = comm->recv_data->indptr[i];
         end = comm->recv_data->indptr[i+1];
-        for (int j = start; j < end; j++)
+        send_rows.clear();
+        for (int col = start; col < end; col++)
         {
-            col = j;
-            col_start = send_mat->idx1[col];
-            col_end = send_mat->idx1[col+1];
-            send_buffer.emplace_back(PairData());
-            send_buffer[ctr++].index = col_end - col_start;
+            col_start = col_ptr[col];
+            col_end = col_ptr[col+1];
+            send_buffer.emplace_back(col_end - col_start);
             for (int k = col_start; k < col_end; k++)
             {
-                send_buffer.emplace_back(PairData());
-                send_buffer[ctr].index = local_row_map[send_mat->idx2[k]];
-                send_buffer[ctr++].val = send_mat->vals[k];
+                row = col_rows[k];
+                send_buffer.emplace_back(A->local_row_map[row]);
+                plan->send_pos.emplace_back(col_pos[k]);
+                if (row_mark[row] != i)
+                {
+                    row_mark[row] = i;
+                    send_rows.emplace_back(row);
+                }
             }
         }
-        send_ptr[i+1] = send_buffer.size();
+        msg_ptr[i+1] = send_buffer.size();
+
+        if (send_rows.size())
+        {
+            std::sort(send_rows.begin(), send_rows.end());
+            comm_T->send_data->add_msg(proc, send_rows.size(), send_rows.data());
+            plan->send_procs.emplace_back(proc);
+            plan->send_ptr.emplace_back(plan->send_pos.size());
+        }
     }
-    for (int i = 0; i < comm->recv_data->num_msgs; i++)
+    for (int i = 0; i < n_send; i++)
     {
-        proc = comm->recv_data->procs[i];
-        start = send_ptr[i];
-        end = send_ptr[i+1];
-        MPI_Isend(&(send_buffer[start]), end - start, MPI_DOUBLE_INT, proc,
-                comm->key, comm->mpi_comm, &(comm->recv_data->requests[i]));
-    }
-    col_count = 0;
-    recv_mat->idx1[0] = 0;
-    for (int i = 0; i < comm->send_data->num_msgs; i++)
-    {
-        proc = comm->send_data->procs[i];
-        start = comm->send_data->indptr[i];
-        end = comm->send_data->indptr[i+1];
-        size = end - start;
+        MPI_Isend(&(send_buffer[msg_ptr[i]]), msg_ptr[i+1] - msg_ptr[i], MPI_INT,
+                comm->recv_data->procs[i], comm->key, comm->mpi_comm, 
+                &(requests[i]));
+    }
+
+    // Receive in order of process, so the global columns of T, and 
+    // the entries of each row of T->off_proc, are ascending
+    aligned_vector<int> recv_order(n_recv);
+    std::iota(recv_order.begin(), recv_order.end(), 0);
+    std::sort(recv_order.begin(), recv_order.end(), [&](const int i, const int j)
+            {
+                return comm->send_data->procs[i] < comm->send_data->procs[j];
+            });
+
+    aligned_vector<int> recv_buffer;
+    aligned_vector<int> recv_rows;
+    aligned_vector<int> recv_cols;
+    plan->recv_ptr.emplace_back(0);
+    for (int i = 0; i < n_recv; i++)
+    {
+        int msg = recv_order[i];
+        proc = comm->send_data->procs[msg];
+        start = comm->send_data->indptr[msg];
+        end = comm->send_data->indptr[msg+1];
         MPI_Probe(proc, comm->key, comm->mpi_comm, &recv_status);
-        MPI_Get_count(&recv_status, MPI_DOUBLE_INT, &count);
-        if (count > recv_buffer.size())
+        MPI_Get_count(&recv_status, MPI_INT, &count);
+        if (count > (int) recv_buffer.size())
         {
             recv_buffer.resize(count);
         }
-        MPI_Recv(&(recv_buffer[0]), count, MPI_DOUBLE_INT, proc,
-                comm->key, comm->mpi_comm, &recv_status);
+        MPI_Recv(recv_buffer.data(), count, MPI_INT, proc, comm->key, 
+                comm->mpi_comm, &recv_status);
+
+        int first_slot = recv_rows.size();
         ctr = 0;
-        for (int j = 0; j < size; j++)
+        for (int j = start; j < end; j++)
         {
-            col_size = recv_buffer[ctr++].index;
-            recv_mat->idx1[col_count+1] = recv_mat->idx1[col_count] + col_size;
-            col_count++;
-            for (int k = 0; k < col_size; k++)
+            row = comm->send_data->indices[j];
+            size = recv_buffer[ctr++];
+            for (int k = 0; k < size; k++)
             {
-                recv_mat->idx2.emplace_back(recv_buffer[ctr].index);
-                recv_mat->vals.emplace_back(recv_buffer[ctr++].val);
+                recv_rows.emplace_back(row);
+                recv_cols.emplace_back(recv_buffer[ctr++]);
             }
         }
+        if ((int) recv_rows.size() == first_slot)
+        {
+            continue;
+        }
+
+        // Distinct global rows received form the columns of T
+        int first_col = plan->off_proc_column_map.size();
+        plan->off_proc_column_map.insert(plan->off_proc_column_map.end(),
+                recv_cols.begin() + first_slot, recv_cols.end());
+        std::sort(plan->off_proc_column_map.begin() + first_col, 
+                plan->off_proc_column_map.end());
+        plan->off_proc_column_map.erase(std::unique(
+                    plan->off_proc_column_map.begin() + first_col,
+                    plan->off_proc_column_map.end()), 
+                plan->off_proc_column_map.end());
+        for (int j = first_slot; j < (int) recv_rows.size(); j++)
+        {
+            recv_cols[j] = std::lower_bound(
+                    plan->off_proc_column_map.begin() + first_col,
+                    plan->off_proc_column_map.end(), recv_cols[j]) 
+                - plan->off_proc_column_map.begin();
+        }
+        comm_T->recv_data->add_msg(proc, 
+                plan->off_proc_column_map.size() - first_col);
+        plan->recv_procs.emplace_back(proc);
+        plan->recv_ptr.emplace_back(recv_rows.size());
+    }
+    comm_T->send_data->finalize();
+    comm_T->recv_data->finalize();
+
+    // Pattern of T->off_proc, with the recv position of each entry
+    int recv_size = recv_rows.size();
+    plan->off_idx1.assign(n_rows_T + 1, 0);
+    plan->off_idx2.resize(recv_size);
+    plan->off_pos.resize(recv_size);
+    for (int j = 0; j < recv_size; j++)
+    {
+        plan->off_idx1[recv_rows[j] + 1]++;
     }
-    recv_mat->nnz = recv_mat->idx2.size();
-    MPI_Waitall(comm->recv_data->num_msgs, comm->recv_data->requests.data(), MPI_STATUSES_IGNORE);
+    for (int i = 0; i < n_rows_T; i++)
+    {
+        plan->off_idx1[i+1] += plan->off_idx1[i];
+    }
+    row_pos.assign(plan->off_idx1.begin(), plan->off_idx1.end() - 1);
+    for (int j = 0; j < recv_size; j++)
+    {
+        idx = row_pos[recv_rows[j]]++;
+        plan->off_idx2[idx] = recv_cols[j];
+        plan->off_pos[idx] = j;
+    }
+
+    MPI_Waitall(n_send, requests.data(), MPI_STATUSES_IGNORE);
+
+    plan->formed = true;
+}
+
+// Main transpose
+ParCSRMatrix* ParCSRMatrix::transpose()
+{
+    ParTransposePlan plan;
+    return transpose(&plan);
+}
+
+/**************************************************************
+*****   ParCSRMatrix Transpose
+**************************************************************
+***** Returns T = A^T.  The pattern of T and its communication
+***** package are formed with plan on the first call, after 
+***** which the on_proc values are permuted locally while the 
+***** values of off_proc are exchanged in a single message to 
+***** each neighboring process.
+*****
+***** Parameters
+***** -------------
+***** plan : ParTransposePlan*
+*****    Plan formed by an earlier transpose of a matrix with the
+*****    same pattern, or an unformed plan
+**************************************************************/
+ParCSRMatrix* ParCSRMatrix::transpose(ParTransposePlan* plan)
+{
+    int start, end;
 
-    off_proc_T = new CSRMatrix(on_proc_num_cols, -1);
-    aligned_vector<int> off_T_sizes(on_proc_num_cols, 0);
-    for (int i = 0; i < comm->send_data->size_msgs; i++)
+    if (!plan->formed)
     {
-        row = comm->send_data->indices[i];
-        start = recv_mat->idx1[i];
-        end = recv_mat->idx1[i+1];
-        off_T_sizes[row] += (end - start);
+        form_transpose_plan(this, plan);
     }
-    off_proc_T->idx1[0] = 0;
-    for (int i = 0; i < off_proc_T->n_rows; i++)
+
+    ParComm* comm_T = plan->comm;
+    int n_send = plan->send_procs.size();
+    int n_recv = plan->recv_procs.size();
+    aligned_vector<double> send_buffer(plan->send_pos.size());
+    aligned_vector<double> recv_buffer(plan->recv_ptr[n_recv]);
+    aligned_vector<MPI_Request> requests(n_send + n_recv);
+
+    // Exchange values of off_proc
+    for (int i = 0; i < n_recv; i++)
     {
-        off_proc_T->idx1[i+1] = off_proc_T->idx1[i] + off_T_sizes[i];
-        off_T_sizes[i] = 0;
+        start = plan->recv_ptr[i];
+        end = plan->recv_ptr[i+1];
+        MPI_Irecv(&(recv_buffer[start]), end - start, MPI_DOUBLE, 
+                plan->recv_procs[i], comm_T->key, comm_T->mpi_comm, 
+                &(requests[i]));
     }
-    off_proc_T->nnz = off_proc_T->idx1[off_proc_T->n_rows];
-    off_proc_T->idx2.resize(off_proc_T->nnz);
-    off_proc_T->vals.resize(off_proc_T->nnz);
-    for (int i = 0; i < comm->send_data->size_msgs; i++)
+    for (int i = 0; i < n_send; i++)
     {
-        row = comm->send_data->indices[i];
-        start = recv_mat->idx1[i];
-        end = recv_mat->idx1[i+1];
+        start = plan->send_ptr[i];
+        end = plan->send_ptr[i+1];
         for (int j = start; j < end; j++)
         {
-            idx = off_proc_T->idx1[row] + off_T_sizes[row]++;
-            off_proc_T->idx2[idx] = recv_mat->idx2[j];
-            off_proc_T->vals[idx] = recv_mat->vals[j];
+            send_buffer[j] = off_proc->vals[plan->send_pos[j]];
         }
+        MPI_Isend(&(send_buffer[start]), end - start, MPI_DOUBLE,
+                plan->send_procs[i], comm_T->key, comm_T->mpi_comm,
+                &(requests[n_recv + i]));
+    }
+
+    // Form T, permuting on_proc values while messages are in flight
+    Partition* part_T = partition->transpose();
+    ParCSRMatrix* T = new ParCSRMatrix(part_T, global_num_cols, global_num_rows,
+            on_proc_num_cols, local_num_rows, plan->off_proc_column_map.size(),
+            0, false);
+    T->on_proc = new CSRMatrix(on_proc_num_cols, local_num_rows);
+    T->off_proc = new CSRMatrix(on_proc_num_cols, T->off_proc_num_cols);
+    Matrix* on_T = T->on_proc;
+    Matrix* off_T = T->off_proc;
+
+    on_T->idx1 = plan->on_idx1;
+    on_T->idx2 = plan->on_idx2;
+    on_T->vals.resize(plan->on_pos.size());
+    for (int j = 0; j < (int) plan->on_pos.size(); j++)
+    {
+        on_T->vals[j] = on_proc->vals[plan->on_pos[j]];
     }
+    on_T->nnz = on_T->idx2.size();
+    on_T->sorted = true;
+
+    T->on_proc_column_map = local_row_map;
+    T->local_row_map = on_proc_column_map;
+    T->off_proc_column_map = plan->off_proc_column_map;
+    T->comm = new ParComm(comm_T);
 
-    T = new ParCSRMatrix(part_T, on_proc_T, off_proc_T);
+    MPI_Waitall(n_send + n_recv, requests.data(), MPI_STATUSES_IGNORE);
 
-    delete send_mat;
-    delete recv_mat;
+    off_T->idx1 = plan->off_idx1;
+    off_T->idx2 = plan->off_idx2;
+    off_T->vals.resize(plan->off_pos.size());
+    for (int j = 0; j < (int) plan->off_pos.size(); j++)
+    {
+        off_T->vals[j] = recv_buffer[plan->off_pos[j]];
+    }
+    off_T->nnz = off_T->idx2.size();
+    off_T->sorted = true;
+
+    T->local_nnz = on_T->nnz + off_T->nnz;
 
     return T;
 }
+
 ParCOOMatrix* ParCOOMatrix::transpose()
 {
     ParCSRMatrix* A_csr = to_ParCSR();
@@ -759,8 +965,8 @@ ParBSRMatrix* ParCSRMatrix::to_ParBSR(const int block_row_size, const int block_
                 {
                     on_proc_pos[block_col] = A_on_proc->idx2.size();
                     A_on_proc->idx2.emplace_back(block_col);
-                    A_on_proc->block_vals.emplace_back(
-                            new double[A_on_proc->b_size]());
+                    A_on_proc->block_vals.resize(
+                            A_on_proc->idx2.size());
                 }
                 val = on_proc->vals[k];
                 pos = on_proc_pos[block_col];
@@ -780,8 +986,8 @@ ParBSRMatrix* ParCSRMatrix::to_ParBSR(const int block_row_size, const int block_
                 {
                     off_proc_pos[block_col] = A_off_proc->idx2.size();
                     A_off_proc->idx2.emplace_back(block_col);
-                    A_off_proc->block_vals.emplace_back(
-                            new double[A_off_proc->b_size]());
+                    A_off_proc->block_vals.resize(
+                            A_off_proc->idx2.size());
                 }
                 val = off_proc->vals[k];
                 pos = off_proc_pos[block_col];
@@ -801,6 +1007,61 @@ ParBSRMatrix* ParCSRMatrix::to_ParBSR(const int block_row_size, const int block_
     return A;
 }
 
+void ParMatrix::init_neighbor_comm(bool reorder)
+{
+    // Communicators shared with another matrix are left in place
+    if (comm == NULL || shared_comm)
+    {
+        return;
+    }
+
+    ParComm* neighbor_comm = new NeighborComm(comm, reorder);
+    delete comm;
+    comm = neighbor_comm;
+}
+
+bool ParMatrix::init_shared_tap_comm()
+{
+    if (shared_comm)
+    {
+        return false;
+    }
+
+    bool shared = tap_comm && tap_comm->init_shared_comm();
+    if (shared)
+    {
+        // tap_mat_comm may hold the original local_L_par_comm
+        if (tap_mat_comm && tap_mat_comm->shared_L)
+        {
+            tap_mat_comm->local_L_par_comm = tap_comm->local_L_par_comm;
+        }
+    }
+    if (tap_mat_comm)
+    {
+        tap_mat_comm->init_shared_comm();
+    }
+
+    return shared;
+}
+
+void ParMatrix::set_halo_precision(halo_t precision)
+{
+    // Communicators shared with another matrix are left in place
+    if (shared_comm)
+    {
+        return;
+    }
+
+    if (comm)
+    {
+        comm->set_halo_precision(precision);
+    }
+    if (tap_comm)
+    {
+        tap_comm->set_halo_precision(precision);
+    }
+}
+
 void ParMatrix::init_tap_communicators(MPI_Comm comm, data_t* comm_t)
 {
     /*********************************
@@ -922,3 +1183,230 @@ void ParMatrix::init_tap_communicators(MPI_Comm comm, data_t* comm_t)
     }
 }
 
+void ParCSRMatrix::init_sell(int chunk_height, int sort_window)
+{
+    clear_sell();
+    clear_symmetric();
+    if (on_proc->b_size > 1 || off_proc->b_size > 1) return;
+
+    on_proc_sell = new SELLMatrix((CSRMatrix*) on_proc, chunk_height, sort_window);
+    off_proc_sell = new SELLMatrix((CSRMatrix*) off_proc, chunk_height, sort_window);
+}
+
+void ParCSRMatrix::clear_sell()
+{
+    delete on_proc_sell;
+    delete off_proc_sell;
+    on_proc_sell = NULL;
+    off_proc_sell = NULL;
+}
+
+void ParCSRMatrix::init_float()
+{
+    clear_float();
+    clear_symmetric();
+    if (on_proc->b_size > 1 || off_proc->b_size > 1) return;
+
+    on_proc_float = new FloatCSRMatrix((CSRMatrix*) on_proc);
+    off_proc_float = new FloatCSRMatrix((CSRMatrix*) off_proc);
+}
+
+void ParCSRMatrix::clear_float()
+{
+    delete on_proc_float;
+    delete off_proc_float;
+    on_proc_float = NULL;
+    off_proc_float = NULL;
+}
+
+void ParCSRMatrix::init_compressed()
+{
+    clear_compressed();
+    clear_symmetric();
+    if (on_proc->b_size > 1) return;
+
+    on_proc->sort();
+    on_proc->move_diag();
+    on_proc_compressed = new CompressedCSRMatrix((CSRMatrix*) on_proc);
+}
+
+void ParCSRMatrix::clear_compressed()
+{
+    delete on_proc_compressed;
+    on_proc_compressed = NULL;
+}
+
+bool ParCSRMatrix::init_symmetric()
+{
+    clear_symmetric();
+    if (on_proc->b_size > 1 || on_proc->n_rows != on_proc->n_cols) return false;
+
+    SymCSRMatrix* A_sym = new SymCSRMatrix((CSRMatrix*) on_proc);
+
+    // Each entry below the diagonal must match its stored mirror, 
+    // to within roundoff of the Galerkin product forming it
+    const double sym_tol = 1e-12;
+    int n_lower = 0;
+    for (int i = 0; i < on_proc->n_rows; i++)
+    {
+        for (int j = on_proc->idx1[i]; j < on_proc->idx1[i+1]; j++)
+        {
+            int col = on_proc->idx2[j];
+            if (col >= i) continue;
+            n_lower++;
+
+            double val = on_proc->vals[j];
+            int k = A_sym->idx1[col];
+            int end = A_sym->idx1[col+1];
+            while (k < end && A_sym->idx2[k] != i) k++;
+            if (k == end || fabs(A_sym->vals[k] - val) > sym_tol * fabs(val) + zero_tol)
+            {
+                delete A_sym;
+                return false;
+            }
+        }
+    }
+    int n_diag = 0;
+    for (int i = 0; i < A_sym->n_rows; i++)
+    {
+        for (int j = A_sym->idx1[i]; j < A_sym->idx1[i+1]; j++)
+        {
+            if (A_sym->idx2[j] == i) n_diag++;
+        }
+    }
+    if (n_lower != A_sym->nnz - n_diag)
+    {
+        delete A_sym;
+        return false;
+    }
+
+    // The upper triangle replaces on_proc, which holds no entries
+    // until clear_symmetric() restores it
+    on_proc_sym = A_sym;
+    aligned_vector<int>().swap(on_proc->idx2);
+    aligned_vector<double>().swap(on_proc->vals);
+    std::fill(on_proc->idx1.begin(), on_proc->idx1.end(), 0);
+    on_proc->nnz = 0;
+    return true;
+}
+
+void ParCSRMatrix::clear_symmetric()
+{
+    if (on_proc_sym == NULL) return;
+
+    CSRMatrix* A_full = on_proc_sym->to_CSR();
+    on_proc->idx1.swap(A_full->idx1);
+    on_proc->idx2.swap(A_full->idx2);
+    on_proc->vals.swap(A_full->vals);
+    on_proc->nnz = A_full->nnz;
+    on_proc->sorted = false;
+    on_proc->diag_first = false;
+    on_proc->sort();
+    on_proc->move_diag();
+    delete A_full;
+
+    delete on_proc_sym;
+    on_proc_sym = NULL;
+}
+
+// Reorders the rows of a scalar CSRMatrix: row i becomes row perm[i]
+void permute_csr_rows(Matrix* A, const aligned_vector<int>& perm)
+{
+    aligned_vector<int> idx1(A->n_rows + 1);
+    aligned_vector<int> idx2(A->nnz);
+    aligned_vector<double> vals(A->nnz);
+
+    idx1[0] = 0;
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        int start = A->idx1[perm[i]];
+        int end = A->idx1[perm[i]+1];
+        int pos = idx1[i];
+        std::copy(A->idx2.begin() + start, A->idx2.begin() + end, 
+                idx2.begin() + pos);
+        std::copy(A->vals.begin() + start, A->vals.begin() + end, 
+                vals.begin() + pos);
+        idx1[i+1] = pos + (end - start);
+    }
+
+    A->idx1.swap(idx1);
+    A->idx2.swap(idx2);
+    A->vals.swap(vals);
+}
+
+void ParCSRMatrix::permute_local_rows(const aligned_vector<int>& perm)
+{
+    clear_sell();
+    clear_float();
+    clear_compressed();
+    clear_symmetric();
+
+    permute_csr_rows(on_proc, perm);
+    permute_csr_rows(off_proc, perm);
+
+    if ((int) local_row_map.size() == local_num_rows)
+    {
+        aligned_vector<int> row_map(local_num_rows);
+        for (int i = 0; i < local_num_rows; i++)
+        {
+            row_map[i] = local_row_map[perm[i]];
+        }
+        local_row_map.swap(row_map);
+    }
+}
+
+void ParCSRMatrix::permute_on_proc_cols(const aligned_vector<int>& perm)
+{
+    // Packages borrowed from another matrix (e.g. strength matrices)
+    // cannot be re-formed here
+    assert(!shared_comm);
+
+    clear_sell();
+    clear_float();
+    clear_compressed();
+    clear_symmetric();
+
+    aligned_vector<int> old_to_new(on_proc_num_cols);
+    aligned_vector<int> col_map(on_proc_num_cols);
+    for (int i = 0; i < on_proc_num_cols; i++)
+    {
+        old_to_new[perm[i]] = i;
+        col_map[i] = on_proc_column_map[perm[i]];
+    }
+    on_proc_column_map.swap(col_map);
+
+    for (int j = 0; j < on_proc->nnz; j++)
+    {
+        on_proc->idx2[j] = old_to_new[on_proc->idx2[j]];
+    }
+    bool diag_first = on_proc->diag_first;
+    on_proc->sorted = false;
+    on_proc->diag_first = false;
+    on_proc->sort();
+    if (diag_first) on_proc->move_diag();
+
+    // Send indices of communication packages are positions in the
+    // local vector, so packages are formed again with the new map
+    if (comm)
+    {
+        delete comm;
+        comm = new ParComm(partition, off_proc_column_map, on_proc_column_map);
+    }
+    if (tap_comm && tap_mat_comm)
+    {
+        delete tap_mat_comm;
+        delete tap_comm;
+        init_tap_communicators();
+    }
+    else if (tap_comm)
+    {
+        delete tap_comm;
+        tap_comm = new TAPComm(partition, off_proc_column_map, on_proc_column_map);
+    }
+    else if (tap_mat_comm)
+    {
+        delete tap_mat_comm;
+        tap_mat_comm = new TAPComm(partition, off_proc_column_map, 
+                on_proc_column_map, false);
+    }
+}
@@ -92,6 +92,13 @@ namespace raptor
         tap_comm = NULL;
         tap_mat_comm = NULL;
         shared_comm = false;
+
+        on_proc_sell = NULL;
+        off_proc_sell = NULL;
+        on_proc_float = NULL;
+        off_proc_float = NULL;
+        on_proc_compressed = NULL;
+        on_proc_sym = NULL;
     }
 
     ParMatrix(Partition* part, index_t glob_rows, index_t glob_cols, int local_rows, 
@@ -109,6 +116,13 @@ namespace raptor
         tap_comm = NULL;
         tap_mat_comm = NULL;
         shared_comm = false;
+
+        on_proc_sell = NULL;
+        off_proc_sell = NULL;
+        on_proc_float = NULL;
+        off_proc_float = NULL;
+        on_proc_compressed = NULL;
+        on_proc_sym = NULL;
     }
 
     ParMatrix(index_t glob_rows, index_t glob_cols)
@@ -124,6 +138,13 @@ namespace raptor
         tap_comm = NULL;
         tap_mat_comm = NULL;
         shared_comm = false;
+
+        on_proc_sell = NULL;
+        off_proc_sell = NULL;
+        on_proc_float = NULL;
+        off_proc_float = NULL;
+        on_proc_compressed = NULL;
+        on_proc_sym = NULL;
     }
 
     ParMatrix(index_t glob_rows, 
@@ -146,6 +167,13 @@ namespace raptor
         tap_comm = NULL;
         tap_mat_comm = NULL;
         shared_comm = false;
+
+        on_proc_sell = NULL;
+        off_proc_sell = NULL;
+        on_proc_float = NULL;
+        off_proc_float = NULL;
+        on_proc_compressed = NULL;
+        on_proc_sym = NULL;
     }
        
     ParMatrix()
@@ -161,6 +189,13 @@ namespace raptor
         tap_mat_comm = NULL;
         shared_comm = false;
 
+        on_proc_sell = NULL;
+        off_proc_sell = NULL;
+        on_proc_float = NULL;
+        off_proc_float = NULL;
+        on_proc_compressed = NULL;
+        on_proc_sym = NULL;
+
         on_proc = NULL;
         off_proc = NULL;
 
@@ -171,6 +206,12 @@ namespace raptor
     {
         delete off_proc;
         delete on_proc;
+        delete off_proc_sell;
+        delete on_proc_sell;
+        delete off_proc_float;
+        delete on_proc_float;
+        delete on_proc_compressed;
+        delete on_proc_sym;
 
         if (!shared_comm)
         {
@@ -260,6 +301,19 @@ namespace raptor
     ParMatrix* subtract(ParCSRMatrix* A);
 
     void init_tap_communicators(MPI_Comm comm = MPI_COMM_WORLD, data_t* comm_t = NULL);
+
+    // Replaces comm with a NeighborComm, exchanging the halos of mult
+    // and residual with neighborhood collectives (collective)
+    void init_neighbor_comm(bool reorder = false);
+
+    // Moves the intra-node steps of tap_comm and tap_mat_comm into 
+    // shared-memory windows, if each node shares memory (collective).
+    // Returns whether tap_comm was moved.
+    bool init_shared_tap_comm();
+
+    // Sends the double halo values of comm and tap_comm (not matrix
+    // communication) in the given precision
+    void set_halo_precision(halo_t precision);
     void update_tap_comm(ParMatrix* old, const aligned_vector<int>& old_to_new,
             double* comm_t = NULL)
     {
@@ -325,6 +379,37 @@ namespace raptor
     Matrix* on_proc; 
     Matrix* off_proc;
 
+    // Optional SELL-C-sigma or single precision copies of on_proc 
+    // and off_proc, used in place of them by solve phase SpMVs 
+    // (mult, mult_append, mult_T, residual, and jacobi) when formed
+    SELLMatrix* on_proc_sell;
+    SELLMatrix* off_proc_sell;
+    FloatCSRMatrix* on_proc_float;
+    FloatCSRMatrix* off_proc_float;
+
+    // Optional copy of on_proc with 16-bit column offsets, used by
+    // solve phase SpMVs and by Gauss-Seidel relaxation when formed
+    CompressedCSRMatrix* on_proc_compressed;
+
+    // Optional upper triangle of a symmetric on_proc, replacing it
+    // in solve phase SpMVs and SOR sweeps when formed
+    SymCSRMatrix* on_proc_sym;
+
+    Matrix* solve_on_proc()
+    {
+        if (on_proc_float) return on_proc_float;
+        if (on_proc_sell) return on_proc_sell;
+        if (on_proc_sym) return on_proc_sym;
+        if (on_proc_compressed) return on_proc_compressed;
+        return on_proc;
+    }
+    Matrix* solve_off_proc()
+    {
+        if (off_proc_float) return off_proc_float;
+        if (off_proc_sell) return off_proc_sell;
+        return off_proc;
+    }
+
     // Store information about columns of off_proc
     // It will be condensed to only store columns with 
     // nonzeros, and these must be mapped to 
@@ -471,6 +556,167 @@ namespace raptor
     }
   };
 
+  /**************************************************************
+   *****   ParSpGEMMPlan Class
+   **************************************************************
+   ***** Sparsity patterns of a parallel product C = A*B or 
+   ***** C = A^T*B, formed by the first ParCSRMatrix::mult or 
+   ***** mult_T called with the plan.  Later calls with matrices of
+   ***** the same patterns (e.g. when only values change between 
+   ***** time steps) skip the symbolic phase, computing values of
+   ***** C in the planned patterns.  The rows of B held by other 
+   ***** processes are still communicated in each call, but are 
+   ***** summed directly into the planned pattern.
+   *****
+   ***** Attributes
+   ***** -------------
+   ***** formed : bool
+   *****    Whether the patterns have been formed
+   ***** on_plan : SpGEMMPlan
+   *****    Pattern of C->on_proc
+   ***** off_plan : SpGEMMPlan
+   *****    Pattern of C->off_proc
+   ***** partial_plan : SpGEMMPlan
+   *****    Pattern of the products sent to other processes
+   *****    (mult_T only)
+   ***** off_proc_column_map : aligned_vector<int>
+   *****    Global columns of C->off_proc
+   ***** off_to_C : aligned_vector<int>
+   *****    Maps off_proc columns of B (the matrix being 
+   *****    multiplied) to off_proc columns of C
+   ***** partial_off_map : aligned_vector<int>
+   *****    Maps off_proc columns of B to columns of partial_plan
+   ***** partial_global_idx2 : aligned_vector<int>
+   *****    Global column of each entry of partial_plan
+   **************************************************************/
+  class ParSpGEMMPlan
+  {
+  public:
+    ParSpGEMMPlan()
+    {
+        formed = false;
+    }
+
+    bool formed;
+    SpGEMMPlan on_plan;
+    SpGEMMPlan off_plan;
+    SpGEMMPlan partial_plan;
+    aligned_vector<int> off_proc_column_map;
+    aligned_vector<int> off_to_C;
+    aligned_vector<int> partial_off_map;
+    aligned_vector<int> partial_global_idx2;
+  };
+
+  /**************************************************************
+   *****   ParAddPlan Class
+   **************************************************************
+   ***** Sparsity pattern of a parallel sum C = alpha*A + beta*B,
+   ***** formed by the first ParCSRMatrix::add called with the plan.
+   ***** Later sums of matrices with the same patterns skip the 
+   ***** merge of rows and column maps, scattering the values of 
+   ***** A and B directly into the planned pattern of C.
+   *****
+   ***** The pattern is structural: entries that cancel are kept
+   ***** as explicit zeros, where add without a plan drops them.
+   *****
+   ***** Attributes
+   ***** -------------
+   ***** formed : bool
+   *****    Whether the pattern has been formed
+   ***** on_idx1, on_idx2 : aligned_vector<int>
+   *****    Pattern of C->on_proc
+   ***** off_idx1, off_idx2 : aligned_vector<int>
+   *****    Pattern of C->off_proc
+   ***** off_proc_column_map : aligned_vector<int>
+   *****    Global columns of C->off_proc
+   ***** A_on_pos, A_off_pos : aligned_vector<int>
+   *****    Position in C of each entry of A->on_proc and A->off_proc
+   ***** B_on_pos, B_off_pos : aligned_vector<int>
+   *****    Position in C of each entry of B->on_proc and B->off_proc
+   **************************************************************/
+  class ParAddPlan
+  {
+  public:
+    ParAddPlan()
+    {
+        formed = false;
+    }
+
+    bool formed;
+    aligned_vector<int> on_idx1;
+    aligned_vector<int> on_idx2;
+    aligned_vector<int> off_idx1;
+    aligned_vector<int> off_idx2;
+    aligned_vector<int> off_proc_column_map;
+    aligned_vector<int> A_on_pos;
+    aligned_vector<int> A_off_pos;
+    aligned_vector<int> B_on_pos;
+    aligned_vector<int> B_off_pos;
+  };
+
+  /**************************************************************
+   *****   ParTransposePlan Class
+   **************************************************************
+   ***** Pattern and exchange of a parallel transpose T = A^T, 
+   ***** formed by the first ParCSRMatrix::transpose called with 
+   ***** the plan.  The processes exchanged with are those of A->comm
+   ***** with send and recv reversed, so no global communication is 
+   ***** needed to form the plan.  Later transposes of a matrix with
+   ***** the same pattern (and entry order) permute the local values
+   ***** and exchange only the values of A->off_proc.
+   *****
+   ***** Attributes
+   ***** -------------
+   ***** formed : bool
+   *****    Whether the plan has been formed
+   ***** on_idx1, on_idx2 : aligned_vector<int>
+   *****    Pattern of T->on_proc
+   ***** off_idx1, off_idx2 : aligned_vector<int>
+   *****    Pattern of T->off_proc
+   ***** on_pos : aligned_vector<int>
+   *****    Entry of A->on_proc holding each entry of T->on_proc
+   ***** off_pos : aligned_vector<int>
+   *****    Position in the recv buffer of each entry of T->off_proc
+   ***** off_proc_column_map : aligned_vector<int>
+   *****    Global columns of T->off_proc
+   ***** send_procs, send_ptr : aligned_vector<int>
+   *****    Processes to which values of A->off_proc are sent, and 
+   *****    the extent of each message in the send buffer
+   ***** send_pos : aligned_vector<int>
+   *****    Entry of A->off_proc held in each position of send buffer
+   ***** recv_procs, recv_ptr : aligned_vector<int>
+   *****    Processes from which values are received, and the extent
+   *****    of each message in the recv buffer
+   ***** comm : ParComm*
+   *****    Communication package of T (copied to each transpose)
+   **************************************************************/
+  class ParTransposePlan
+  {
+  public:
+    ParTransposePlan()
+    {
+        formed = false;
+        comm = NULL;
+    }
+
+    ~ParTransposePlan();
+
+    bool formed;
+    aligned_vector<int> on_idx1;
+    aligned_vector<int> on_idx2;
+    aligned_vector<int> off_idx1;
+    aligned_vector<int> off_idx2;
+    aligned_vector<int> on_pos;
+    aligned_vector<int> off_pos;
+    aligned_vector<int> off_proc_column_map;
+    aligned_vector<int> send_procs;
+    aligned_vector<int> send_ptr;
+    aligned_vector<int> send_pos;
+    aligned_vector<int> recv_procs;
+    aligned_vector<int> recv_ptr;
+    ParComm* comm;
+  };
+
   class ParCSRMatrix : public ParMatrix
   {
   public:
@@ -559,6 +805,105 @@ namespace raptor
 
     ParBSRMatrix* to_ParBSR(const int block_row_size, const int block_col_size);
 
+    /**************************************************************
+    *****   ParCSRMatrix Init SELL
+    **************************************************************
+    ***** Forms SELL-C-sigma copies of on_proc and off_proc for 
+    ***** the solve phase.  The CSR matrices are kept for setup
+    ***** and Gauss-Seidel relaxation, so this should be called 
+    ***** once the matrix is final.  Block matrices are skipped.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** chunk_height : int
+    *****    Rows per chunk (C), 8 or 4 use SIMD kernels
+    ***** sort_window : int
+    *****    Rows sorted by length at a time (sigma)
+    **************************************************************/
+    void init_sell(int chunk_height = 8, int sort_window = 1);
+    void clear_sell();
+
+    /**************************************************************
+    *****   ParCSRMatrix Init Float
+    **************************************************************
+    ***** Forms single precision copies of on_proc and off_proc for
+    ***** the solve phase, taking precedence over SELL copies.
+    ***** Setup computes in double, and the double matrices are
+    ***** kept for Gauss-Seidel relaxation and conversions, so this
+    ***** adds 8 bytes per nonzero (columns and float values)
+    ***** to the 12 of the double matrices, while SpMVs stream 8 
+    ***** rather than 12.  Block matrices are skipped.
+    **************************************************************/
+    void init_float();
+    void clear_float();
+
+    /**************************************************************
+    *****   ParCSRMatrix Init Compressed
+    **************************************************************
+    ***** Forms a copy of on_proc storing each row as a base column
+    ***** plus 16-bit offsets (rows spanning more than 65536 columns
+    ***** keep 32-bit columns), reducing index traffic of SpMVs and
+    ***** Gauss-Seidel sweeps.  Sorts on_proc and moves the diagonal
+    ***** first.  Float and SELL copies take precedence in SpMVs.
+    ***** Block matrices are skipped.
+    **************************************************************/
+    void init_compressed();
+    void clear_compressed();
+
+    /**************************************************************
+    *****   ParCSRMatrix Init Symmetric
+    **************************************************************
+    ***** Replaces on_proc with its diagonal and upper triangle,
+    ***** if on_proc is symmetric, so that solve phase SpMVs (mult,
+    ***** mult_T, residual, jacobi) and SOR sweeps read about half
+    ***** of its entries.  The diagonal block of a symmetric matrix
+    ***** is symmetric; off_proc is unchanged.  on_proc is left
+    ***** empty until clear_symmetric() restores it (sorted, with
+    ***** the diagonal first), which permutations and the other
+    ***** init_ methods do first; copies expand the upper triangle.
+    ***** Other operations need clear_symmetric() to be called.
+    ***** Float and SELL copies take precedence in SpMVs.  Block
+    ***** matrices are skipped.
+    *****
+    ***** Returns
+    ***** -------------
+    ***** bool : whether on_proc was symmetric and the copy formed
+    **************************************************************/
+    bool init_symmetric();
+    void clear_symmetric();
+
+    /**************************************************************
+    *****   ParCSRMatrix Permute Local Rows
+    **************************************************************
+    ***** Reorders the local rows of on_proc and off_proc, and 
+    ***** local_row_map.  Solve phase copies (SELL, float, etc.)
+    ***** are cleared.  Block matrices are not supported.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** perm : const aligned_vector<int>&
+    *****    perm[i] is the current local row moved to row i
+    **************************************************************/
+    void permute_local_rows(const aligned_vector<int>& perm);
+
+    /**************************************************************
+    *****   ParCSRMatrix Permute On Proc Cols
+    **************************************************************
+    ***** Reorders the columns of on_proc (and so the local values
+    ***** of vectors multiplied by this matrix), updating 
+    ***** on_proc_column_map and re-forming existing communication
+    ***** packages, whose send indices refer to local positions.
+    ***** Rows of on_proc are re-sorted, keeping the diagonal first
+    ***** if it was.  Solve phase copies are cleared.  Matrices
+    ***** sharing another matrix's packages are not supported.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** perm : const aligned_vector<int>&
+    *****    perm[i] is the current on_proc column moved to column i
+    **************************************************************/
+    void permute_on_proc_cols(const aligned_vector<int>& perm);
+
     void copy_helper(ParCSRMatrix* A);
     void copy_helper(ParCSCMatrix* A);
     void copy_helper(ParCOOMatrix* A);
@@ -576,15 +921,66 @@ namespace raptor
     void tap_mult(ParVector& x, ParVector& b, data_t* comm_t = NULL);
     void mult_T(ParVector& x, ParVector& b, bool tap = false, data_t* comm_t = NULL);
     void tap_mult_T(ParVector& x, ParVector& b, data_t* comm_t = NULL);
+
+    /**************************************************************
+    *****   ParCSRMatrix Multi-Vector Products
+    **************************************************************
+    ***** SpMM with all vectors of a ParMultiVector at once : the 
+    ***** matrix is read once per product, and x is exchanged in a
+    ***** single halo exchange carrying n_vecs values per column.
+    ***** Block matrices, and matrices with solve phase copies 
+    ***** (SELL, float, etc.) formed, apply the ParVector products
+    ***** to one vector at a time
+    **************************************************************/
+    using ParMatrix::mult_append;
+    using ParMatrix::residual;
+    void mult(ParMultiVector& x, ParMultiVector& b, bool tap = false, 
+            data_t* comm_t = NULL);
+    void mult_append(ParMultiVector& x, ParMultiVector& b, bool tap = false,
+            data_t* comm_t = NULL);
+    void residual(ParMultiVector& x, ParMultiVector& b, ParMultiVector& r,
+            bool tap = false, data_t* comm_t = NULL);
+    void mult_T(ParMultiVector& x, ParMultiVector& b, bool tap = false, 
+            data_t* comm_t = NULL);
+
     ParCSRMatrix* mult(ParCSRMatrix* B, bool tap = false, data_t* comm_t = NULL);
     ParCSRMatrix* tap_mult(ParCSRMatrix* B, data_t* comm_t = NULL);
     ParCSRMatrix* mult_T(ParCSCMatrix* A, bool tap = false, data_t* comm_t = NULL);
     ParCSRMatrix* mult_T(ParCSRMatrix* A, bool tap = false, data_t* comm_t = NULL);
     ParCSRMatrix* tap_mult_T(ParCSCMatrix* A, data_t* comm_t = NULL);
     ParCSRMatrix* tap_mult_T(ParCSRMatrix* A, data_t* comm_t = NULL);
+
+    // Products reusing (or forming) the patterns held in plan
+    ParCSRMatrix* mult(ParCSRMatrix* B, ParSpGEMMPlan* plan, bool tap = false,
+            data_t* comm_t = NULL);
+    ParCSRMatrix* mult_T(ParCSCMatrix* A, ParSpGEMMPlan* plan, bool tap = false,
+            data_t* comm_t = NULL);
+    ParCSRMatrix* mult_T(ParCSRMatrix* A, ParSpGEMMPlan* plan, bool tap = false,
+            data_t* comm_t = NULL);
+
+    // Galerkin product P^T * this * P, optionally returning the time
+    // spent forming rows of this*P in AP_t, and the part of comm_t
+    // spent receiving rows of P for this*P in AP_comm_t
+    ParCSRMatrix* rap(ParCSRMatrix* P, bool tap = false, data_t* comm_t = NULL,
+            data_t* AP_t = NULL, data_t* AP_comm_t = NULL);
+
+    // Memory-capped products, forming rows of this*B (or this*P) in 
+    // chunks whose intermediate rows take at most max_bytes (the 
+    // largest taken by rap_chunked is returned in peak_bytes)
+    ParCSRMatrix* mult_chunked(ParCSRMatrix* B, size_t max_bytes, 
+            bool tap = false, data_t* comm_t = NULL);
+    ParCSRMatrix* rap_chunked(ParCSRMatrix* P, size_t max_bytes, 
+            bool tap = false, data_t* comm_t = NULL, data_t* AP_t = NULL,
+            data_t* AP_comm_t = NULL, size_t* peak_bytes = NULL);
+
     ParCSRMatrix* add(ParCSRMatrix* A);
     ParCSRMatrix* subtract(ParCSRMatrix* B);
 
+    // Scaled sum alpha*this + beta*B, reusing (or forming) the 
+    // pattern held in plan when given.  Neither operand is reordered.
+    ParCSRMatrix* add(ParCSRMatrix* B, double alpha, double beta,
+            ParAddPlan* plan = NULL);
+
     void print_mult(ParCSRMatrix* B, const aligned_vector<int>& proc_distances, 
                 const aligned_vector<int>& worst_proc_distances);
     void print_mult_T(ParCSCMatrix* A, const aligned_vector<int>& proc_distances,
@@ -596,12 +992,19 @@ namespace raptor
     
     void mult_helper(ParCSRMatrix* B, ParCSRMatrix* C, CSRMatrix* recv,
             CSRMatrix* C_on_on, CSRMatrix* C_on_off);
+    void mult_combine(ParCSRMatrix* B, ParCSRMatrix* C, 
+            const aligned_vector<int>& recv_off_cols, CSRMatrix* C_on_on, 
+            CSRMatrix* C_on_off, CSRMatrix* C_off_on, CSRMatrix* C_off_off);
     CSRMatrix* mult_T_partial(ParCSCMatrix* A);
     CSRMatrix* mult_T_partial(CSCMatrix* A_off);
     void mult_T_combine(ParCSCMatrix* A, ParCSRMatrix* C, CSRMatrix* recv_mat,
             CSRMatrix* C_on_on, CSRMatrix* C_off_on);
     
     ParCSRMatrix* transpose();
+
+    // Transpose reusing (or forming) the pattern and exchange 
+    // held in plan
+    ParCSRMatrix* transpose(ParTransposePlan* plan);
   };
 
  class ParBSRMatrix : public ParCSRMatrix
@@ -121,3 +121,110 @@ data_t ParVector::inner_product(ParVector& x)
 }
 
 
+
+
+
+/**************************************************************
+*****   ParMultiVector Methods
+**************************************************************
+***** Local operations act on all n_vecs vectors at once, as
+***** their interleaved values form a single local Vector
+**************************************************************/
+void ParMultiVector::axpy(ParMultiVector& x, data_t alpha)
+{
+    if (local_n)
+    {
+        local.axpy(x.local, alpha);
+    }
+}
+
+void ParMultiVector::scale(data_t alpha)
+{
+    if (local_n)
+    {
+        local.scale(alpha);
+    }
+}
+
+void ParMultiVector::set_const_value(data_t alpha)
+{
+    if (local_n)
+    {
+        local.set_const_value(alpha);
+    }
+}
+
+void ParMultiVector::set_rand_values()
+{
+    if (local_n)
+    {
+        local.set_rand_values();
+    }
+}
+
+void ParMultiVector::norm(index_t p, data_t* norms)
+{
+    for (int v = 0; v < n_vecs; v++)
+    {
+        norms[v] = 0.0;
+    }
+
+    for (int i = 0; i < local_n; i++)
+    {
+        const double* row = &local.values[i * n_vecs];
+        for (int v = 0; v < n_vecs; v++)
+        {
+            if (fabs(row[v]) > zero_tol)
+                norms[v] += pow(row[v], p);
+        }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, norms, n_vecs, MPI_DATA_T, MPI_SUM, MPI_COMM_WORLD);
+    for (int v = 0; v < n_vecs; v++)
+    {
+        norms[v] = pow(norms[v], 1./p);
+    }
+}
+
+void ParMultiVector::inner_product(ParMultiVector& x, data_t* inner_prods)
+{
+    if (local_n != x.local_n || n_vecs != x.n_vecs)
+    {
+        printf("Error.  Cannot perform inner product.  Dimensions do not match.\n");
+        exit(-1);
+    }
+
+    for (int v = 0; v < n_vecs; v++)
+    {
+        inner_prods[v] = 0.0;
+    }
+
+    for (int i = 0; i < local_n; i++)
+    {
+        const double* row = &local.values[i * n_vecs];
+        const double* x_row = &x.local.values[i * n_vecs];
+        for (int v = 0; v < n_vecs; v++)
+        {
+            inner_prods[v] += row[v] * x_row[v];
+        }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, inner_prods, n_vecs, MPI_DATA_T, MPI_SUM, MPI_COMM_WORLD);
+}
+
+void ParMultiVector::get_vector(int v, ParVector& x)
+{
+    x.resize(global_n, local_n, first_local);
+    for (int i = 0; i < local_n; i++)
+    {
+        x.local.values[i] = local.values[i * n_vecs + v];
+    }
+}
+
+void ParMultiVector::set_vector(int v, ParVector& x)
+{
+    for (int i = 0; i < local_n; i++)
+    {
+        local.values[i * n_vecs + v] = x.local.values[i];
+    }
+}
@@ -182,5 +182,125 @@ namespace raptor
         int first_local;
     };
 
+    /**************************************************************
+     *****   ParMultiVector Class
+     **************************************************************
+     ***** This class constructs a block of n_vecs parallel vectors
+     ***** sharing one row distribution, such as multiple right-hand
+     ***** sides.  Local values are interleaved row-major, so value v
+     ***** of local row i is stored at local[i*n_vecs + v], and the
+     ***** values of a row are contiguous for SpMM kernels and halo
+     ***** exchanges (one message per neighbor, n_vecs values per 
+     ***** column)
+     *****
+     ***** Attributes
+     ***** -------------
+     ***** local : Vector
+     *****    Interleaved local values (local_n * n_vecs entries)
+     ***** global_n : index_t
+     *****    Number of rows in each global vector
+     ***** local_n : index_t
+     *****    Number of rows stored locally
+     ***** first_local : index_t
+     *****    Position of local rows inside each global vector
+     ***** n_vecs : int
+     *****    Number of vectors
+     **************************************************************/
+    class ParMultiVector
+    {
+    public:
+        /**************************************************************
+        *****   ParMultiVector Class Constructor
+        **************************************************************
+        ***** Sets the dimensions of the global vectors and initializes
+        ***** empty local values of the given size
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** glbl_n : index_t
+        *****    Number of rows in each global vector
+        ***** lcl_n : index_t
+        *****    Number of rows stored locally
+        ***** first_lcl : index_t
+        *****    Position of local rows inside global vectors
+        ***** num_vecs : int
+        *****    Number of vectors
+        **************************************************************/
+        ParMultiVector(index_t glbl_n, int lcl_n, index_t first_lcl, int num_vecs)
+        {
+            resize(glbl_n, lcl_n, first_lcl, num_vecs);
+        }
+
+        ParMultiVector(const ParMultiVector& x)
+        {
+            copy(x);
+        }
+
+        ParMultiVector()
+        {
+            local_n = 0;
+            n_vecs = 0;
+        }
+
+        void resize(index_t glbl_n, int lcl_n, index_t first_lcl, int num_vecs)
+        {
+            global_n = glbl_n;
+            local_n = lcl_n;
+            first_local = first_lcl;
+            n_vecs = num_vecs;
+            local.resize(local_n * n_vecs);
+        }
+
+        void copy(const ParMultiVector& x)
+        {
+            global_n = x.global_n;
+            local_n = x.local_n;
+            first_local = x.first_local;
+            n_vecs = x.n_vecs;
+            local.copy(x.local);
+        }
+
+        void set_const_value(data_t alpha);
+        void set_rand_values();
+        void axpy(ParMultiVector& y, data_t alpha);
+        void scale(data_t alpha);
+
+        /**************************************************************
+        *****   ParMultiVector Norm
+        **************************************************************
+        ***** Calculates the P norm of each global vector, with a 
+        ***** single reduction for all vectors
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** p : index_t
+        *****    Determines which p-norm to calculate
+        ***** norms : data_t*
+        *****    Returns the n_vecs norms
+        **************************************************************/
+        void norm(index_t p, data_t* norms);
+        void inner_product(ParMultiVector& x, data_t* inner_prods);
+
+        // Copy vector v to or from a ParVector
+        void get_vector(int v, ParVector& x);
+        void set_vector(int v, ParVector& x);
+
+        const data_t& operator()(const int row, const int v) const
+        {
+            return local.values[row * n_vecs + v];
+        }
+
+        data_t& operator()(const int row, const int v)
+        {
+            return local.values[row * n_vecs + v];
+        }
+
+        Vector local;
+        int global_n;
+        int local_n;
+        int first_local;
+        int n_vecs;
+    };
+
 }
 #endif
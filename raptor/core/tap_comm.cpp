@@ -495,39 +495,28 @@ void TAPComm::form_global_par_comm(aligned_vector<int>& orig_procs,
     global_recv->size_msgs = ctr;
     global_recv->finalize();
 
+    // Send recv sizes to corresponding local procs on appropriate nodes,
+    // finding the processes sending to rank with a nonblocking consensus
     if (comm_t) *comm_t -= MPI_Wtime(); 
-    aligned_vector<int> send_p(num_procs, 0);
+    ContigData node_size_msgs;
+    NonContigData node_size_recvs;
+    aligned_vector<int> node_size_buffer;
     for (int i = 0; i < global_recv->num_msgs; i++)
     {
         node = global_recv->procs[i];
         proc = topology->get_global_proc(node, local_rank);
-        send_p[proc] = 1;
+        node_size_msgs.add_msg(proc, 1);
+        node_size_buffer.emplace_back(node_sizes[node]);
     }
-    MPI_Allreduce(MPI_IN_PLACE, send_p.data(), num_procs, MPI_INT,
-            MPI_SUM, MPI_COMM_WORLD);
-    int recv_n = send_p[rank];
-    sendbuf.resize(recv_n);
-    sendbuf_sizes.resize(recv_n);
-    // Send recv sizes to corresponding local procs on appropriate nodes
-    ctr = 0;
-    for (int i = 0; i < global_recv->num_msgs; i++)
+    node_size_recvs.probe_nbx(&node_size_msgs, node_size_buffer.data(), 9876,
+            MPI_COMM_WORLD);
+    sendbuf.resize(node_size_recvs.num_msgs);
+    sendbuf_sizes.resize(node_size_recvs.num_msgs);
+    for (int i = 0; i < node_size_recvs.num_msgs; i++)
     {
-        node = global_recv->procs[i];
-        proc = topology->get_global_proc(node, local_rank);
-        MPI_Isend(&(node_sizes[node]), 1, MPI_INT, proc, 9876, MPI_COMM_WORLD,
-                &(global_recv->requests[i]));
+        sendbuf[i] = node_size_recvs.procs[i];
+        sendbuf_sizes[i] = node_size_recvs.indices[i];
     }
-    for (int i = 0; i < recv_n; i++)
-    {
-        MPI_Probe(MPI_ANY_SOURCE, 9876, MPI_COMM_WORLD, &recv_status);
-        proc = recv_status.MPI_SOURCE;
-        MPI_Recv(&recvbuf, 1, MPI_INT, proc, 9876, MPI_COMM_WORLD, 
-                &recv_status);
-        sendbuf[i] = proc;
-        sendbuf_sizes[i] = recvbuf;
-    }
-    MPI_Waitall(global_recv->num_msgs, global_recv->requests.data(),
-            MPI_STATUSES_IGNORE);
     if (comm_t) *comm_t += MPI_Wtime();
 
     // Gather all procs to which node must send 
@@ -1052,13 +1041,14 @@ void TAPComm::form_simple_R_par_comm(aligned_vector<int>& off_node_column_map,
     local_R_recv->finalize();
 
     // Communicate local_R recv_data so send_data can be formed
-    MPI_Allreduce(MPI_IN_PLACE, local_proc_sizes.data(), topology->PPN, MPI_INT,
-            MPI_SUM, topology->local_comm);
-
+    aligned_vector<int> recv_cols(local_R_recv->size_msgs);
+    for (int i = 0; i < local_R_recv->size_msgs; i++)
+    {
+        recv_cols[i] = off_node_column_map[local_R_recv->indices[i]];
+    }
     if (comm_t) *comm_t -= MPI_Wtime();
-    local_R_par_comm->recv_data->send(off_node_column_map.data(), 6543, topology->local_comm);
-    local_R_par_comm->send_data->probe(local_proc_sizes[local_rank], 6543, topology->local_comm);
-    local_R_par_comm->recv_data->waitall();
+    local_R_par_comm->send_data->probe_nbx(local_R_recv, recv_cols.data(), 6543,
+            topology->local_comm);
     if (comm_t) *comm_t += MPI_Wtime();
 }
 
@@ -1127,22 +1117,9 @@ void TAPComm::form_simple_global_comm(aligned_vector<int>& off_proc_col_to_proc,
     global_recv->finalize();
 
     // Communicate global recv_data so send_data can be formed (dynamic comm)
-    aligned_vector<int> recv_sizes(num_procs, 0);
-    for (int i = 0; i < global_recv->num_msgs; i++)
-        recv_sizes[global_recv->procs[i]] = global_recv->indptr[i+1] - global_recv->indptr[i];
-    MPI_Allreduce(MPI_IN_PLACE, recv_sizes.data(), num_procs, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-
     if (comm_t) *comm_t -= MPI_Wtime();
-    for (int i = 0; i < global_recv->num_msgs; i++)
-    {
-        proc = global_recv->procs[i];
-        start = global_recv->indptr[i];
-        end = global_recv->indptr[i+1];
-        MPI_Isend(&(global_recv->indices[start]), end - start, MPI_INT,
-                proc, 6789, MPI_COMM_WORLD, &(global_recv->requests[i]));
-    }
-    global_par_comm->send_data->probe(recv_sizes[rank], 6789, MPI_COMM_WORLD);
-    global_par_comm->recv_data->waitall();
+    global_par_comm->send_data->probe_nbx(global_recv, global_recv->indices.data(),
+            6789, MPI_COMM_WORLD);
     if (comm_t) *comm_t += MPI_Wtime();
 }
 
@@ -109,25 +109,54 @@ TEST(BlockMatrixTest, TestsInCore)
     ASSERT_EQ(A_bcoo->nnz, A_bsr->nnz);
     ASSERT_EQ(A_bsr->nnz, A_bsc->nnz);
 
-    double** bcoo_vals = (double**) A_bcoo->get_data();
-    double** bsr_vals = (double**) A_bsr->get_data();
+    double* bcoo_vals = (double*) A_bcoo->get_data();
+    double* bsr_vals = (double*) A_bsr->get_data();
     for (int i = 0; i < A_bcoo->nnz; i++)
     {
         for (int j = 0; j < A_bcoo->b_size; j++)
         {
-            ASSERT_NEAR(bcoo_vals[i][j], bsr_vals[i][j], 1e-10);
+            ASSERT_NEAR(bcoo_vals[i*A_bcoo->b_size + j], 
+                    bsr_vals[i*A_bsr->b_size + j], 1e-10);
         }
     }
 
+    // Block values are stored contiguously, 64-byte aligned
+    ASSERT_EQ(((size_t) bsr_vals) % 64, 0);
+
+    Matrix* A_bsr_T = A_bsr->transpose();
+    ASSERT_EQ(A_bsr_T->n_rows, A_bsr->n_cols);
+    ASSERT_EQ(A_bsr_T->b_rows, A_bsr->b_cols);
+    for (int i = 0; i < A_bsr->n_rows; i++)
+    {
+        for (int j = A_bsr->idx1[i]; j < A_bsr->idx1[i+1]; j++)
+        {
+            int col = A_bsr->idx2[j];
+            for (int k = 0; k < A_bsr->b_rows; k++)
+            {
+                for (int l = 0; l < A_bsr->b_cols; l++)
+                {
+                    ASSERT_NEAR(A_bsr->get_val(j, k*A_bsr->b_cols + l),
+                            A_bsr_T->get_val(A_bsr_T->idx1[col] + 
+                                std::distance(A_bsr_T->idx2.begin() + A_bsr_T->idx1[col],
+                                    std::find(A_bsr_T->idx2.begin() + A_bsr_T->idx1[col],
+                                        A_bsr_T->idx2.begin() + A_bsr_T->idx1[col+1], i)),
+                                l*A_bsr->b_rows + k), 1e-10);
+                }
+            }
+        }
+    }
+    delete A_bsr_T;
+
     Matrix* Atmp = A_bsc->to_CSR();
     Atmp->sort();
     Atmp->move_diag();
-    double** tmp_vals = (double**) Atmp->get_data();
+    double* tmp_vals = (double*) Atmp->get_data();
     for (int i = 0; i < A_bsr->nnz; i++)
     {
         for (int j = 0; j < A_bsr->b_size; j++)
         {
-            ASSERT_NEAR(bsr_vals[i][j], tmp_vals[i][j], 1e-10);
+            ASSERT_NEAR(bsr_vals[i*A_bsr->b_size + j], 
+                    tmp_vals[i*Atmp->b_size + j], 1e-10);
         }
     }
 
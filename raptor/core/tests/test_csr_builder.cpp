@@ -0,0 +1,80 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+#include "core/csr_builder.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+TEST(CSRBuilderTest, TestsInCore)
+{
+    // Rows filled out of order, with one entry of row 1 dropped
+    // as zero and row 2 counted but left empty
+    CSRMatrix* A = new CSRMatrix(4, 4);
+    CSRBuilder builder(A);
+    builder.count(0, 2);
+    builder.count(1, 3);
+    builder.count(2);
+    builder.count(3);
+    builder.allocate();
+    ASSERT_EQ(A->nnz, 7);
+    ASSERT_EQ(A->idx2.capacity(), 7);
+
+    builder.add(3, 3, 4.0);
+    builder.add(1, 0, 2.0);
+    builder.add(1, 2, 0.0);
+    builder.add(1, 3, 3.0);
+    builder.add(0, 0, 1.0);
+    int pos = builder.insert(0, 1);
+    A->vals[pos] += 5.0;
+    ASSERT_EQ(builder.row_end(1) - builder.row_start(1), 3);
+    builder.drop_zeros(1);
+    ASSERT_EQ(builder.row_end(1) - builder.row_start(1), 2);
+    builder.finalize();
+
+    int idx1[5] = {0, 2, 4, 4, 5};
+    int idx2[5] = {0, 1, 0, 3, 3};
+    double vals[5] = {1.0, 5.0, 2.0, 3.0, 4.0};
+    ASSERT_EQ(A->nnz, 5);
+    ASSERT_EQ(A->idx2.capacity(), 5);
+    ASSERT_EQ(A->vals.capacity(), 5);
+    for (int i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(A->idx1[i], idx1[i]);
+        ASSERT_EQ(A->idx2[i], idx2[i]);
+        ASSERT_DOUBLE_EQ(A->vals[i], vals[i]);
+    }
+    delete A;
+
+    // Block values are moved with their columns
+    BSRMatrix* B = new BSRMatrix(2, 2, 2, 2);
+    CSRBuilder block_builder(B, B->block_vals);
+    block_builder.count(0, 2);
+    block_builder.count(1, 2);
+    block_builder.allocate();
+    double block[4] = {1.0, 2.0, 3.0, 4.0};
+    block_builder.add(0, 1, block);
+    block_builder.add(1, 0, block);
+    block_builder.finalize();
+
+    ASSERT_EQ(B->nnz, 2);
+    ASSERT_EQ(B->idx1[1], 1);
+    ASSERT_EQ(B->idx1[2], 2);
+    ASSERT_EQ(B->idx2[1], 0);
+    ASSERT_EQ(B->block_vals.size(), 2);
+    for (int k = 0; k < 4; k++)
+    {
+        ASSERT_DOUBLE_EQ(B->block_vals[1][k], block[k]);
+    }
+    delete B;
+
+} // end of TEST(CSRBuilderTest, TestsInCore) //
@@ -0,0 +1,109 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/par_stencil.hpp"
+#include "gallery/diffusion.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+TEST(NeighborCommTest, TestsInCore)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    double eps = 0.001;
+    double theta = M_PI / 8.0;
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(eps, theta);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    delete[] stencil;
+
+    ParVector x(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b_p2p(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r_p2p(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        x[i] = sin(A->local_row_map[i]);
+        b[i] = cos(A->local_row_map[i]);
+    }
+
+    // Results with point-to-point ParComm
+    A->mult(x, b_p2p);
+    A->residual(x, b, r_p2p);
+
+    for (int reorder = 0; reorder < 2; reorder++)
+    {
+        ParCSRMatrix* A_n = A->copy();
+        A_n->init_neighbor_comm(reorder);
+        NeighborComm* n_comm = dynamic_cast<NeighborComm*>(A_n->comm);
+        ASSERT_TRUE(n_comm != NULL);
+
+        // Messages are addressed by rank, so ranks must be kept
+        int graph_rank;
+        MPI_Comm_rank(n_comm->neighbor_comm, &graph_rank);
+        ASSERT_EQ(graph_rank, rank);
+
+        // Global columns of off_proc gathered from their owners
+        aligned_vector<int> global_rows(A_n->local_num_rows);
+        for (int i = 0; i < A_n->local_num_rows; i++)
+        {
+            global_rows[i] = A_n->local_row_map[i];
+        }
+        aligned_vector<int>& recvbuf = A_n->comm->communicate(global_rows);
+        for (int i = 0; i < A_n->off_proc_num_cols; i++)
+        {
+            ASSERT_EQ(recvbuf[i], A_n->off_proc_column_map[i]);
+        }
+
+        // Two values per index
+        aligned_vector<int> block_rows(2*A_n->local_num_rows);
+        for (int i = 0; i < A_n->local_num_rows; i++)
+        {
+            block_rows[2*i] = A_n->local_row_map[i];
+            block_rows[2*i+1] = -A_n->local_row_map[i];
+        }
+        aligned_vector<int>& block_recvbuf = A_n->comm->communicate(block_rows, 2);
+        for (int i = 0; i < A_n->off_proc_num_cols; i++)
+        {
+            ASSERT_EQ(block_recvbuf[2*i], A_n->off_proc_column_map[i]);
+            ASSERT_EQ(block_recvbuf[2*i+1], -A_n->off_proc_column_map[i]);
+        }
+
+        // SpMV and residual, repeated to reuse the graph communicator
+        for (int test = 0; test < 2; test++)
+        {
+            A_n->mult(x, r);
+            for (int i = 0; i < A_n->local_num_rows; i++)
+            {
+                ASSERT_NEAR(r[i], b_p2p[i], 1e-12);
+            }
+            A_n->residual(x, b, r);
+            for (int i = 0; i < A_n->local_num_rows; i++)
+            {
+                ASSERT_NEAR(r[i], r_p2p[i], 1e-12);
+            }
+        }
+
+        delete A_n;
+    }
+
+    delete A;
+
+} // end of TEST(NeighborCommTest, TestsInCore) //
@@ -2,6 +2,7 @@
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 
 #include "gtest/gtest.h"
+#include <climits>
 
 #include "core/types.hpp"
 #include "core/matrix.hpp"
@@ -86,3 +87,215 @@ TEST(ParCommTest, TestsInCore)
     delete A_seq;
 
 } // end of TEST(ParCommTest, TestsInCore) //
+
+TEST(ParCommTest, TestsPersistentComm)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    double eps = 0.001;
+    double theta = M_PI / 8.0;
+    int grid[2] = {10, 10};
+    double* stencil = diffusion_stencil_2d(eps, theta);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+
+    int n_recv, total_recv;
+    aligned_vector<double> values;
+    aligned_vector<int> counts;
+
+    // Requests are reused across exchanges, and formed again when the
+    // values, block size, or (on some processes) the buffer change
+    for (int iter = 0; iter < 6; iter++)
+    {
+        int block_size = (iter < 4) ? 1 : 2;
+        if (iter == 2)
+        {
+            values.clear();
+            values.shrink_to_fit();
+        }
+        if (iter == 3 && rank % 2 == 0)
+        {
+            aligned_vector<double>().swap(A->comm->recv_data->buffer);
+        }
+
+        values.resize(A->local_num_rows * block_size);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            for (int j = 0; j < block_size; j++)
+            {
+                values[i*block_size + j] = A->local_row_map[i] * block_size + j + iter;
+            }
+        }
+        aligned_vector<double>& recvbuf = A->comm->communicate(values, block_size);
+        for (int i = 0; i < A->off_proc_num_cols; i++)
+        {
+            for (int j = 0; j < block_size; j++)
+            {
+                ASSERT_EQ(recvbuf[i*block_size + j], 
+                        A->off_proc_column_map[i] * block_size + j + iter);
+            }
+        }
+
+        // Each off_proc column contributes one to the owning row
+        aligned_vector<int> ones(A->off_proc_num_cols, 1);
+        counts.resize(A->local_num_rows);
+        std::fill(counts.begin(), counts.end(), 0);
+        A->comm->communicate_T(ones, counts);
+        n_recv = 0;
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            n_recv += counts[i];
+        }
+        MPI_Allreduce(&n_recv, &total_recv, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        int total_off_proc;
+        MPI_Allreduce(&(A->off_proc_num_cols), &total_off_proc, 1, MPI_INT, 
+                MPI_SUM, MPI_COMM_WORLD);
+        ASSERT_EQ(total_recv, total_off_proc);
+    }
+
+    delete[] stencil;
+    delete A;
+
+} // end of TEST(ParCommTest, TestsPersistentComm) //
+
+TEST(ParCommTest, TestsTypedComm)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    double eps = 0.001;
+    double theta = M_PI / 8.0;
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(eps, theta);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    NonContigData* send_data = A->comm->send_data;
+
+    aligned_vector<double> values;
+    aligned_vector<int> int_values(A->local_num_rows);
+
+    // All messages sent with datatypes, a mix (by size), and all packed
+    int min_bytes[3] = {0, 100, INT_MAX};
+    for (int test = 0; test < 3; test++)
+    {
+        send_data->typed_min_bytes = min_bytes[test];
+        for (int block_size = 1; block_size <= 2; block_size++)
+        {
+            values.resize(A->local_num_rows * block_size);
+            for (int i = 0; i < A->local_num_rows; i++)
+            {
+                for (int j = 0; j < block_size; j++)
+                {
+                    values[i*block_size + j] = A->local_row_map[i] * block_size + j + test;
+                }
+            }
+            aligned_vector<double>& recvbuf = A->comm->communicate(values, block_size);
+            for (int i = 0; i < A->off_proc_num_cols; i++)
+            {
+                for (int j = 0; j < block_size; j++)
+                {
+                    ASSERT_EQ(recvbuf[i*block_size + j], 
+                            A->off_proc_column_map[i] * block_size + j + test);
+                }
+            }
+        }
+
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            int_values[i] = A->local_row_map[i] - test;
+        }
+        aligned_vector<int>& int_recvbuf = A->comm->communicate(int_values);
+        for (int i = 0; i < A->off_proc_num_cols; i++)
+        {
+            ASSERT_EQ(int_recvbuf[i], A->off_proc_column_map[i] - test);
+        }
+    }
+
+    delete[] stencil;
+    delete A;
+
+} // end of TEST(ParCommTest, TestsTypedComm) //
+
+TEST(ParCommTest, TestsReducedComm)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    double eps = 0.001;
+    double theta = M_PI / 8.0;
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(eps, theta);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+
+    aligned_vector<double> values;
+    aligned_vector<double> off_values;
+    aligned_vector<double> result(A->local_num_rows);
+    aligned_vector<double> reduced_result(A->local_num_rows);
+
+    // Relative error of float, and of 16-bit values scaled to the
+    // largest magnitude in each message
+    halo_t precision[2] = {HaloFloat, HaloScaled16};
+    double tol[2] = {1e-7, 1e-4};
+    for (int test = 0; test < 2; test++)
+    {
+        for (int block_size = 1; block_size <= 2; block_size++)
+        {
+            values.resize(A->local_num_rows * block_size);
+            for (int i = 0; i < A->local_num_rows; i++)
+            {
+                for (int j = 0; j < block_size; j++)
+                {
+                    values[i*block_size + j] = sin(A->local_row_map[i] * block_size + j);
+                }
+            }
+
+            A->comm->set_halo_precision(precision[test]);
+            aligned_vector<double>& recvbuf = A->comm->communicate(values, block_size);
+            for (int i = 0; i < A->off_proc_num_cols; i++)
+            {
+                for (int j = 0; j < block_size; j++)
+                {
+                    ASSERT_NEAR(recvbuf[i*block_size + j], 
+                            sin(A->off_proc_column_map[i] * block_size + j), tol[test]);
+                }
+            }
+
+            // Transpose sums match those of double values
+            off_values.resize(A->off_proc_num_cols * block_size);
+            for (int i = 0; i < A->off_proc_num_cols * block_size; i++)
+            {
+                off_values[i] = cos(i + rank);
+            }
+            result.resize(A->local_num_rows * block_size);
+            reduced_result.resize(A->local_num_rows * block_size);
+            std::fill(result.begin(), result.end(), 0.0);
+            std::fill(reduced_result.begin(), reduced_result.end(), 0.0);
+            A->comm->communicate_T(off_values, reduced_result, block_size);
+            A->comm->set_halo_precision(HaloDouble);
+            A->comm->communicate_T(off_values, result, block_size);
+            for (int i = 0; i < A->local_num_rows * block_size; i++)
+            {
+                ASSERT_NEAR(reduced_result[i], result[i], 4 * tol[test]);
+            }
+        }
+    }
+
+    // Int values are always sent exactly
+    aligned_vector<int> int_values(A->local_num_rows);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        int_values[i] = A->local_row_map[i];
+    }
+    A->comm->set_halo_precision(HaloScaled16);
+    aligned_vector<int>& int_recvbuf = A->comm->communicate(int_values);
+    for (int i = 0; i < A->off_proc_num_cols; i++)
+    {
+        ASSERT_EQ(int_recvbuf[i], A->off_proc_column_map[i]);
+    }
+
+    delete[] stencil;
+    delete A;
+
+} // end of TEST(ParCommTest, TestsReducedComm) //
@@ -51,3 +51,47 @@ TEST(ParMatrixTest, TestsInCore)
 
 } // end of TEST(ParMatrixTest, TestsInCore) //
 
+TEST(ParMatrixTest, TestsTransposePlan)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    ParCSRMatrix* A = readParMatrix("../../../../test_data/aniso.pm");
+    ParCSRMatrix* AT_py = readParMatrix("../../../../test_data/aniso_T.pm");
+    ParTransposePlan plan;
+
+    // Transpose twice with plan, scaling values of A in between
+    for (int test = 0; test < 2; test++)
+    {
+        ParCSRMatrix* AT = A->transpose(&plan);
+
+        // Communication package of T gathers its off_proc columns
+        aligned_vector<int> sendbuf(AT->local_num_rows);
+        for (int i = 0; i < AT->local_num_rows; i++)
+        {
+            sendbuf[i] = AT->local_row_map[i];
+        }
+        aligned_vector<int>& recvbuf = AT->comm->communicate(sendbuf);
+        for (int i = 0; i < AT->off_proc_num_cols; i++)
+        {
+            ASSERT_EQ(recvbuf[i], AT->off_proc_column_map[i]);
+        }
+
+        compare(AT, AT_py);
+        delete AT;
+
+        for (aligned_vector<double>::iterator it = A->on_proc->vals.begin();
+                it != A->on_proc->vals.end(); ++it) *it *= 2.0;
+        for (aligned_vector<double>::iterator it = A->off_proc->vals.begin();
+                it != A->off_proc->vals.end(); ++it) *it *= 2.0;
+        for (aligned_vector<double>::iterator it = AT_py->on_proc->vals.begin();
+                it != AT_py->on_proc->vals.end(); ++it) *it *= 2.0;
+        for (aligned_vector<double>::iterator it = AT_py->off_proc->vals.begin();
+                it != AT_py->off_proc->vals.end(); ++it) *it *= 2.0;
+    }
+
+    delete A;
+    delete AT_py;
+
+} // end of TEST(ParMatrixTest, TestsTransposePlan) //
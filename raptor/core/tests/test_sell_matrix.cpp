@@ -0,0 +1,135 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+#include "gallery/matrix_IO.hpp"
+#include "util/linalg/spmv_simd.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+void compare_sell(CSRMatrix* A, int chunk_height, int sort_window)
+{
+    SELLMatrix* A_sell = new SELLMatrix(A, chunk_height, sort_window);
+    ASSERT_EQ(A_sell->format(), SELL);
+    ASSERT_EQ(A_sell->nnz, A->nnz);
+    ASSERT_EQ(A_sell->idx1[A_sell->num_chunks()] % chunk_height, 0);
+
+    // Conversion back to CSR recovers A
+    CSRMatrix* A_csr = A_sell->to_CSR();
+    ASSERT_EQ(A_csr->nnz, A->nnz);
+    for (int i = 0; i <= A->n_rows; i++)
+        ASSERT_EQ(A_csr->idx1[i], A->idx1[i]);
+    for (int i = 0; i < A->nnz; i++)
+    {
+        ASSERT_EQ(A_csr->idx2[i], A->idx2[i]);
+        ASSERT_EQ(A_csr->vals[i], A->vals[i]);
+    }
+    delete A_csr;
+
+    aligned_vector<double> x(A->n_cols);
+    aligned_vector<double> x_T(A->n_rows);
+    aligned_vector<double> y(A->n_rows);
+    aligned_vector<double> y_T(A->n_cols);
+    for (int i = 0; i < A->n_cols; i++)
+    {
+        x[i] = sin(0.2 * i);
+        y_T[i] = 0.5 * i;
+    }
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        x_T[i] = cos(0.1 * i);
+        y[i] = 1.0 - 0.01 * i;
+    }
+
+    aligned_vector<double> b(A->n_rows), b_sell(A->n_rows);
+    aligned_vector<double> r(A->n_rows), r_sell(A->n_rows);
+    aligned_vector<double> b_T(y_T), b_T_sell(y_T);
+
+    A->spmv(x.data(), b.data());
+    A_sell->spmv(x.data(), b_sell.data());
+    A->spmv_residual(x.data(), y.data(), r.data());
+    A_sell->spmv_residual(x.data(), y.data(), r_sell.data());
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        ASSERT_NEAR(b[i], b_sell[i], 1e-12);
+        ASSERT_NEAR(r[i], r_sell[i], 1e-12);
+    }
+
+    A->spmv_append(x.data(), r.data());
+    A_sell->spmv_append(x.data(), r_sell.data());
+    A->spmv_append_neg(x.data(), b.data());
+    A_sell->spmv_append_neg(x.data(), b_sell.data());
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        ASSERT_NEAR(r[i], r_sell[i], 1e-12);
+        ASSERT_NEAR(b[i], b_sell[i], 1e-12);
+    }
+
+    A->spmv_append_T(x_T.data(), b_T.data());
+    A_sell->spmv_append_T(x_T.data(), b_T_sell.data());
+    A->spmv_append_neg_T(y.data(), b_T.data());
+    A_sell->spmv_append_neg_T(y.data(), b_T_sell.data());
+    for (int i = 0; i < A->n_cols; i++)
+    {
+        ASSERT_NEAR(b_T[i], b_T_sell[i], 1e-12);
+    }
+
+    // Copy and transpose keep the SELL layout
+    SELLMatrix* A_copy = A_sell->copy();
+    SELLMatrix* AT_sell = A_sell->transpose();
+    CSRMatrix* AT = A->transpose();
+    A_copy->spmv(x.data(), b_sell.data());
+    A->spmv(x.data(), b.data());
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        ASSERT_NEAR(b[i], b_sell[i], 1e-12);
+    }
+    AT->spmv(x_T.data(), b_T.data());
+    AT_sell->spmv(x_T.data(), b_T_sell.data());
+    for (int i = 0; i < A->n_cols; i++)
+    {
+        ASSERT_NEAR(b_T[i], b_T_sell[i], 1e-12);
+    }
+
+    // Solve phase matrices are read-only
+    ASSERT_THROW(A_sell->add_value(0, 0, 1.0), std::logic_error);
+
+    delete AT;
+    delete AT_sell;
+    delete A_copy;
+    delete A_sell;
+}
+
+TEST(SELLMatrixTest, TestsInCore)
+{
+    const char* files[3] = {"../../../../test_data/laplacian27.pm",
+            "../../../../test_data/aniso.pm",
+            "../../../../test_data/random.pm"};
+
+    for (int f = 0; f < 3; f++)
+    {
+        CSRMatrix* A = readMatrix(files[f]);
+
+        // SIMD kernels (chunk heights 4 and 8) and runtime loops
+        compare_sell(A, 8, 1);
+        compare_sell(A, 8, 32);
+        compare_sell(A, 4, 16);
+        compare_sell(A, 3, 4);
+
+        simd_t isa = get_simd();
+        set_simd(NoSIMD);
+        compare_sell(A, 8, 32);
+        set_simd(isa);
+
+        delete A;
+    }
+} // end of TEST(SELLMatrixTest, TestsInCore) //
@@ -85,3 +85,84 @@ TEST(TAPCommTest, TestsInCore)
 
 
 } // end of TEST(TAPCommTest, TestsInCore) //
+
+TEST(TAPCommTest, TestsSharedComm)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    // Four processes per node, so that all steps of TAP communication
+    // are used
+    setenv("PPN", "4", 1);
+
+    double eps = 0.001;
+    double theta = M_PI / 8.0;
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(eps, theta);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    A->init_tap_communicators(MPI_COMM_WORLD);
+    ASSERT_TRUE(A->init_shared_tap_comm());
+    ASSERT_TRUE(dynamic_cast<SharedComm*>(A->tap_comm->local_R_par_comm) != NULL);
+    ASSERT_TRUE(dynamic_cast<SharedComm*>(A->tap_comm->local_L_par_comm) != NULL);
+    ASSERT_TRUE(dynamic_cast<SharedComm*>(A->tap_mat_comm->local_R_par_comm) != NULL);
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector tap_b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    aligned_vector<double> values(2 * A->local_num_rows);
+    aligned_vector<int> int_values(A->local_num_rows);
+
+    for (int iter = 0; iter < 3; iter++)
+    {
+        x.set_rand_values();
+        aligned_vector<double> par_recv = A->comm->communicate(x);
+        aligned_vector<double>& tap_recv = A->tap_comm->communicate(x);
+        for (int i = 0; i < A->off_proc_num_cols; i++)
+        {
+            ASSERT_NEAR(par_recv[i], tap_recv[i], zero_tol);
+        }
+
+        aligned_vector<double>& tap_simp_recv = A->tap_mat_comm->communicate(x);
+        for (int i = 0; i < A->off_proc_num_cols; i++)
+        {
+            ASSERT_NEAR(par_recv[i], tap_simp_recv[i], zero_tol);
+        }
+
+        // Block size 2 (window is reallocated on first use)
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            values[2*i] = A->local_row_map[i];
+            values[2*i+1] = iter - A->local_row_map[i];
+        }
+        aligned_vector<double>& tap_block_recv = A->tap_comm->communicate(values, 2);
+        for (int i = 0; i < A->off_proc_num_cols; i++)
+        {
+            ASSERT_NEAR(tap_block_recv[2*i], A->off_proc_column_map[i], zero_tol);
+            ASSERT_NEAR(tap_block_recv[2*i+1], iter - A->off_proc_column_map[i], zero_tol);
+        }
+
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            int_values[i] = A->local_row_map[i] + iter;
+        }
+        aligned_vector<int>& tap_int_recv = A->tap_comm->communicate(int_values);
+        for (int i = 0; i < A->off_proc_num_cols; i++)
+        {
+            ASSERT_EQ(tap_int_recv[i], A->off_proc_column_map[i] + iter);
+        }
+
+        A->mult(x, b);
+        A->tap_mult(x, tap_b);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(b[i], tap_b[i], 1e-10);
+        }
+    }
+
+    delete[] stencil;
+    delete A;
+
+    unsetenv("PPN");
+
+} // end of TEST(TAPCommTest, TestsSharedComm) //
@@ -0,0 +1,219 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+#include "core/vector.hpp"
+#include "gallery/matrix_IO.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+void set_threads(int n)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(n);
+#else
+    (void) n;
+#endif
+}
+
+void check_partition(const CSRMatrix* A, int n)
+{
+    aligned_vector<int> firsts(n, -1);
+    aligned_vector<int> lasts(n, -1);
+    int n_parts = 1;
+
+    set_threads(n);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        int first, last;
+        thread_rows(A->idx1.data(), A->n_rows, first, last);
+#ifdef _OPENMP
+        int t = omp_get_thread_num();
+#pragma omp single
+        n_parts = omp_get_num_threads();
+#else
+        int t = 0;
+#endif
+        firsts[t] = first;
+        lasts[t] = last;
+    }
+
+    // Contiguous ranges covering every row exactly once
+    ASSERT_EQ(firsts[0], 0);
+    ASSERT_EQ(lasts[n_parts-1], A->n_rows);
+    for (int t = 1; t < n_parts; t++)
+        ASSERT_EQ(firsts[t], lasts[t-1]);
+
+    // Each range holds about nnz / n_parts nonzeros
+    int max_row = 0;
+    for (int i = 0; i < A->n_rows; i++)
+        max_row = std::max(max_row, A->idx1[i+1] - A->idx1[i]);
+    for (int t = 0; t < n_parts; t++)
+    {
+        int part_nnz = A->idx1[lasts[t]] - A->idx1[firsts[t]];
+        ASSERT_LE(part_nnz, A->nnz / n_parts + max_row);
+    }
+}
+
+TEST(ThreadingTest, TestsInCore)
+{
+    const char* laplace_fn = "../../../../test_data/laplacian27.pm";
+    CSRMatrix* A = readMatrix(laplace_fn);
+    ASSERT_GE(A->nnz, omp_min_work);
+
+    check_partition(A, 1);
+    check_partition(A, 3);
+    check_partition(A, 4);
+
+    // Serial reference products
+    int n = A->n_rows;
+    aligned_vector<double> x(n), y(n);
+    aligned_vector<double> b_ref(n), r_ref(n);
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = sin(0.3 * i);
+        y[i] = 1.0 + 0.01 * i;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        double sum = 0.0;
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+            sum += A->vals[j] * x[A->idx2[j]];
+        b_ref[i] = sum;
+        r_ref[i] = y[i] - sum;
+    }
+
+    int thread_counts[3] = {1, 2, 4};
+    for (int t = 0; t < 3; t++)
+    {
+        set_threads(thread_counts[t]);
+
+        aligned_vector<double> b(n), r(n), b_app(y);
+        A->spmv(x.data(), b.data());
+        A->spmv_residual(x.data(), y.data(), r.data());
+        A->spmv_append(x.data(), b_app.data());
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(b[i], b_ref[i], 1e-12);
+            ASSERT_NEAR(r[i], r_ref[i], 1e-12);
+            ASSERT_NEAR(b_app[i], y[i] + b_ref[i], 1e-12);
+        }
+
+        // Vector kernels, large enough to be threaded
+        int len = 4 * omp_min_work + 7;
+        Vector v(len), w(len);
+        v.set_const_value(2.0);
+        for (int i = 0; i < len; i++)
+            w[i] = (i % 5) - 2.0;
+        v.axpy(w, 0.5);
+        v.scale(2.0);
+
+        double v_sum = 0.0, v_dot = 0.0;
+        for (int i = 0; i < len; i++)
+        {
+            double val = 2.0 * (2.0 + 0.5 * ((i % 5) - 2.0));
+            ASSERT_NEAR(v[i], val, 1e-14);
+            v_sum += val * val;
+            v_dot += val * ((i % 5) - 2.0);
+        }
+        ASSERT_NEAR(v.norm(2), sqrt(v_sum), 1e-8);
+        ASSERT_NEAR(v.inner_product(w), v_dot, 1e-8);
+
+        Vector v_copy(v);
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ(v_copy[i], v[i]);
+    }
+
+    delete A;
+
+} // end of TEST(ThreadingTest, TestsInCore) //
+
+// Row i of C, as a map from column to value
+void row_map(const CSRMatrix* C, int i, std::map<int, double>& row)
+{
+    row.clear();
+    for (int j = C->idx1[i]; j < C->idx1[i+1]; j++)
+        row[C->idx2[j]] += C->vals[j];
+}
+
+TEST(ThreadedSpGEMMTest, TestsInCore)
+{
+    const char* laplace_fn = "../../../../test_data/laplacian27.pm";
+    CSRMatrix* A = readMatrix(laplace_fn);
+    int n = A->n_rows;
+
+    // Reference A*A, and columns mapped into a wide column space
+    std::vector<std::map<int, double> > ref(n);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            int k = A->idx2[j];
+            for (int l = A->idx1[k]; l < A->idx1[k+1]; l++)
+                ref[i][A->idx2[l]] += A->vals[j] * A->vals[l];
+        }
+    }
+    aligned_vector<int> col_map(n);
+    for (int i = 0; i < n; i++)
+        col_map[i] = 1000 * i + 7;
+
+    CSCMatrix* A_csc = A->to_CSC();
+    int thread_counts[3] = {1, 2, 4};
+    for (int t = 0; t < 3; t++)
+    {
+        set_threads(thread_counts[t]);
+
+        CSRMatrix* C = A->mult(A);
+        CSRMatrix* C_map = A->mult(A, col_map.data());
+        CSRMatrix* C_T = A->mult_T(A_csc);
+        ASSERT_EQ(C->n_rows, n);
+        ASSERT_EQ(C->nnz, C->idx1[n]);
+        ASSERT_TRUE(C->sorted);
+
+        std::map<int, double> row;
+        for (int i = 0; i < n; i++)
+        {
+            // Sorted columns, matching the reference
+            for (int j = C->idx1[i] + 1; j < C->idx1[i+1]; j++)
+                ASSERT_LT(C->idx2[j-1], C->idx2[j]);
+
+            row_map(C, i, row);
+            ASSERT_EQ(row.size(), ref[i].size());
+            for (std::map<int, double>::iterator it = ref[i].begin();
+                    it != ref[i].end(); ++it)
+                ASSERT_NEAR(row[it->first], it->second, 1e-12);
+
+            row_map(C_map, i, row);
+            ASSERT_EQ(row.size(), ref[i].size());
+            for (std::map<int, double>::iterator it = ref[i].begin();
+                    it != ref[i].end(); ++it)
+                ASSERT_NEAR(row[col_map[it->first]], it->second, 1e-12);
+
+            // A is symmetric, so A^T*A = A*A
+            row_map(C_T, i, row);
+            ASSERT_EQ(row.size(), ref[i].size());
+            for (std::map<int, double>::iterator it = ref[i].begin();
+                    it != ref[i].end(); ++it)
+                ASSERT_NEAR(row[it->first], it->second, 1e-12);
+        }
+
+        delete C;
+        delete C_map;
+        delete C_T;
+    }
+
+    delete A_csc;
+    delete A;
+
+} // end of TEST(ThreadedSpGEMMTest, TestsInCore) //
@@ -0,0 +1,181 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_CORE_THREADING_HPP_
+#define RAPTOR_CORE_THREADING_HPP_
+
+#include <stddef.h>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**************************************************************
+ *****   Threading Helpers
+ **************************************************************
+ ***** Support for hybrid MPI+OpenMP runs (configure with
+ ***** -DWITH_OPENMP=ON).  Without OpenMP each helper reduces
+ ***** to the serial case: a single thread owning every row.
+ *****
+ ***** Loops over rows use static partitions so that a thread
+ ***** touches the same rows of a vector in every kernel.
+ ***** Vectors and built matrices are first touched with the
+ ***** partition their kernels use, so pages are placed near
+ ***** the thread that uses them.
+ **************************************************************/
+namespace raptor
+{
+    // Loops with less work than this (nonzeros or vector entries)
+    // are not worth the overhead of a parallel region
+    const int omp_min_work = 16384;
+
+    inline int num_threads()
+    {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    inline int thread_num()
+    {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    /**************************************************************
+     *****   Thread Rows
+     **************************************************************
+     ***** Returns the contiguous range [first, last) of rows owned
+     ***** by the calling thread, splitting rows so that each thread
+     ***** holds an (approximately) equal number of nonzeros.  Must
+     ***** be called by every thread of the enclosing parallel region
+     *****
+     ***** Parameters
+     ***** -------------
+     ***** idx1 : const int*
+     *****    Row pointer of a CSR matrix, with n_rows+1 entries
+     ***** n_rows : int
+     *****    Number of rows to split
+     ***** first : int&
+     *****    Returns the first row owned by this thread
+     ***** last : int&
+     *****    Returns one past the last row owned by this thread
+     **************************************************************/
+    inline void thread_rows(const int* idx1, int n_rows, int& first, int& last)
+    {
+#ifdef _OPENMP
+        int n_parts = omp_get_num_threads();
+        int part = omp_get_thread_num();
+        if (n_parts > 1)
+        {
+            long start = idx1[0];
+            long nnz = idx1[n_rows] - start;
+            first = part == 0 ? 0 : std::lower_bound(idx1, idx1 + n_rows,
+                    start + (nnz * part) / n_parts) - idx1;
+            last = part == n_parts - 1 ? n_rows : std::lower_bound(idx1,
+                    idx1 + n_rows, start + (nnz * (part + 1)) / n_parts) - idx1;
+            return;
+        }
+#else
+        (void) idx1;
+#endif
+        first = 0;
+        last = n_rows;
+    }
+
+    /**************************************************************
+     *****   First Touch
+     **************************************************************
+     ***** Writes one byte per page of a newly reserved (untouched)
+     ***** array, with the pages split among threads in the static
+     ***** schedule used by vector loops, so the OS maps each page to
+     ***** the memory of the thread that will use it
+     *****
+     ***** Parameters
+     ***** -------------
+     ***** ptr : void*
+     *****    Start of the array
+     ***** bytes : size_t
+     *****    Size of the array in bytes
+     **************************************************************/
+    inline void first_touch(void* ptr, size_t bytes)
+    {
+#ifdef _OPENMP
+        const size_t page = 4096;
+        if (bytes < omp_min_work * sizeof(double) || omp_get_max_threads() == 1
+                || omp_in_parallel())
+            return;
+
+        char* data = (char*) ptr;
+        long n_pages = (bytes + page - 1) / page;
+#pragma omp parallel for schedule(static)
+        for (long i = 0; i < n_pages; i++)
+        {
+            data[i * page] = 0;
+        }
+#else
+        (void) ptr;
+        (void) bytes;
+#endif
+    }
+
+    /**************************************************************
+     *****   First Touch Rows
+     **************************************************************
+     ***** Touches the pages of a newly reserved array of nonzeros
+     ***** (column indices or values of a CSR matrix), each thread
+     ***** touching the nonzeros of the rows given to it by 
+     ***** thread_rows, as in the SpMV and SpGEMM kernels
+     *****
+     ***** Parameters
+     ***** -------------
+     ***** idx1 : const int*
+     *****    Row pointer of the matrix, with n_rows+1 entries
+     ***** n_rows : int
+     *****    Number of rows of the matrix
+     ***** ptr : void*
+     *****    Start of the array, holding entry idx1[0] first
+     ***** entry_bytes : size_t
+     *****    Size of each entry in bytes
+     **************************************************************/
+    inline void first_touch_rows(const int* idx1, int n_rows, void* ptr,
+            size_t entry_bytes)
+    {
+#ifdef _OPENMP
+        const size_t page = 4096;
+        if (idx1[n_rows] - idx1[0] < omp_min_work || omp_get_max_threads() == 1
+                || omp_in_parallel())
+            return;
+
+        char* data = (char*) ptr;
+        size_t first_page = (page - (size_t) data % page) % page;
+#pragma omp parallel
+        {
+            int first, last;
+            thread_rows(idx1, n_rows, first, last);
+            size_t start = (size_t) (idx1[first] - idx1[0]) * entry_bytes;
+            size_t end = (size_t) (idx1[last] - idx1[0]) * entry_bytes;
+
+            // Pages starting within this thread's nonzeros
+            size_t b = first_page;
+            if (start > b) b += ((start - b + page - 1) / page) * page;
+            for (; b < end; b += page)
+            {
+                data[b] = 0;
+            }
+        }
+#else
+        (void) idx1;
+        (void) n_rows;
+        (void) ptr;
+        (void) entry_bytes;
+#endif
+    }
+}
+
+#endif
@@ -41,6 +41,8 @@ using namespace std;
 #include <mpi.h>
 #endif
 
+#include "core/threading.hpp"
+
 struct PairData 
 {
     double val;
@@ -158,13 +160,147 @@ namespace raptor
     using index_t = int;
     template <typename T>
     using aligned_vector = std::vector<T, AlignAllocator<T, 16>>;
+
+    /**************************************************************
+    *****   BlockArray
+    **************************************************************
+    ***** Contiguous storage for the dense blocks of a block matrix
+    ***** (BSR, BCOO, BSC).  Block i occupies the b_size values
+    ***** beginning at data() + i*b_size, and the underlying array
+    ***** is 64-byte aligned so that block kernels stream through
+    ***** values rather than chasing one pointer per block.
+    *****
+    ***** Indexing a BlockArray returns a pointer to the first
+    ***** value of the block, so code written for aligned_vector<T>
+    ***** can read blocks the same way it reads scalars.
+    **************************************************************/
+    class BlockArray
+    {
+      public:
+        BlockArray(int _b_size = 1)
+        {
+            b_size = _b_size;
+        }
+
+        void set_block_size(int _b_size)
+        {
+            int n = size();
+            b_size = _b_size;
+            values.resize((size_t) n * b_size, 0.0);
+        }
+
+        int block_size() const
+        {
+            return b_size;
+        }
+
+        int size() const
+        {
+            return values.size() / b_size;
+        }
+
+        void resize(int n)
+        {
+            values.resize((size_t) n * b_size, 0.0);
+        }
+
+        void reserve(int n)
+        {
+            values.reserve((size_t) n * b_size);
+        }
+
+        void clear()
+        {
+            values.clear();
+        }
+
+        void shrink_to_fit()
+        {
+            values.shrink_to_fit();
+        }
+
+        // Append a copy of the b_size values in block
+        void emplace_back(const double* block)
+        {
+            values.insert(values.end(), block, block + b_size);
+        }
+        void push_back(const double* block)
+        {
+            emplace_back(block);
+        }
+
+        double* operator[](int i)
+        {
+            return values.data() + (size_t) i * b_size;
+        }
+        const double* operator[](int i) const
+        {
+            return values.data() + (size_t) i * b_size;
+        }
+
+        double* data()
+        {
+            return values.data();
+        }
+        const double* data() const
+        {
+            return values.data();
+        }
+
+        void swap(int i, int j)
+        {
+            std::swap_ranges(values.begin() + (size_t) i * b_size,
+                    values.begin() + (size_t) (i + 1) * b_size,
+                    values.begin() + (size_t) j * b_size);
+        }
+
+        // Move block pos to position start, shifting blocks
+        // [start, pos) back by one
+        void move_to_front(int start, int pos)
+        {
+            std::rotate(values.begin() + (size_t) start * b_size,
+                    values.begin() + (size_t) pos * b_size,
+                    values.begin() + (size_t) (pos + 1) * b_size);
+        }
+
+        // Reorder blocks [start, start + n) so that block start + i
+        // holds the block previously at start + perm[i]
+        void permute(const int* perm, int start, int n)
+        {
+            std::vector<double, AlignAllocator<double, 64>> tmp((size_t) n * b_size);
+            for (int i = 0; i < n; i++)
+            {
+                const double* src = (*this)[start + perm[i]];
+                std::copy(src, src + b_size, tmp.begin() + (size_t) i * b_size);
+            }
+            std::copy(tmp.begin(), tmp.end(), values.begin() + (size_t) start * b_size);
+        }
+
+      private:
+        int b_size;
+        std::vector<double, AlignAllocator<double, 64>> values;
+    };
+
+    // Pointer to the value (or first value of the block) at
+    // position i of either scalar or block storage
+    inline double* val_ptr(aligned_vector<double>& vals, int i)
+    {
+        return &vals[i];
+    }
+    inline double* val_ptr(BlockArray& vals, int i)
+    {
+        return vals[i];
+    }
+
     enum strength_t {Classical, Symmetric};
-    enum format_t {COO, CSR, CSC, BCOO, BSR, BSC};
+    enum format_t {COO, CSR, CSC, BCOO, BSR, BSC, SELL, FloatCSR, CompressedCSR, SymCSR};
     enum coarsen_t {RS, CLJP, Falgout, PMIS, HMIS};
     enum interp_t {Direct, ModClassical, Extended};
     enum agg_t {MIS};
     enum prolong_t {JacobiProlongation};
     enum relax_t {Jacobi, SOR, SSOR};
+    enum reorder_t {NoReorder, RCM, PeripheralRCM};
+    enum halo_t {HaloDouble, HaloFloat, HaloScaled16};
 
     template<typename T, typename U> 
     U sum_func(const U& a, const T&b)
@@ -90,6 +90,75 @@ void vec_sort(aligned_vector<T>& vec1, aligned_vector<T>& vec2,
     }
 }
 
+// Block variants: sort indices, then gather blocks in a single
+// pass rather than swapping b_size values per exchange
+template <typename T>
+void vec_sort(aligned_vector<T>& vec1, BlockArray& vec2, int start = 0, int end = -1)
+{
+    vec1.shrink_to_fit();
+
+    int n = vec1.size();
+    if (end < 0) end = n;
+    int size = end - start;
 
+    aligned_vector<int> p(size);
+    std::iota(p.begin(), p.end(), 0);
+    std::sort(p.begin(), p.end(),
+            [&](const int i, const int j)
+            {
+                return vec1[i+start] < vec1[j+start];
+            });
+
+    aligned_vector<T> tmp(size);
+    for (int i = 0; i < size; i++)
+        tmp[i] = vec1[p[i] + start];
+    std::copy(tmp.begin(), tmp.end(), vec1.begin() + start);
+    vec2.permute(p.data(), start, size);
+}
+
+template <typename T>
+void vec_sort(aligned_vector<T>& vec1, aligned_vector<T>& vec2,
+        BlockArray& vec3, int start = 0, int end = -1)
+{
+    vec1.shrink_to_fit();
+    vec2.shrink_to_fit();
+
+    int n = vec1.size();
+    if (end < 0) end = n;
+    int size = end - start;
+
+    aligned_vector<int> p(size);
+    std::iota(p.begin(), p.end(), 0);
+    std::sort(p.begin(), p.end(),
+            [&](const int i, const int j)
+            {
+                int idx1 = i + start;
+                int idx2 = j + start;
+                if (vec1[idx1] == vec1[idx2])
+                    return vec2[idx1] < vec2[idx2];
+                else
+                    return vec1[idx1] < vec1[idx2];
+            });
+
+    aligned_vector<T> tmp(size);
+    for (int i = 0; i < size; i++)
+        tmp[i] = vec1[p[i] + start];
+    std::copy(tmp.begin(), tmp.end(), vec1.begin() + start);
+    for (int i = 0; i < size; i++)
+        tmp[i] = vec2[p[i] + start];
+    std::copy(tmp.begin(), tmp.end(), vec2.begin() + start);
+    vec3.permute(p.data(), start, size);
+}
+
+// Move the entry at pos to start, shifting [start, pos) back by one
+template <typename T>
+void vec_move_to_front(aligned_vector<T>& vec, int start, int pos)
+{
+    std::rotate(vec.begin() + start, vec.begin() + pos, vec.begin() + pos + 1);
+}
+inline void vec_move_to_front(BlockArray& vec, int start, int pos)
+{
+    vec.move_to_front(start, pos);
+}
 
 #endif
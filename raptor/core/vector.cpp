@@ -16,6 +16,9 @@ using namespace raptor;
 **************************************************************/
 void Vector::set_const_value(data_t alpha)
 {
+#ifdef _OPENMP
+#pragma omp parallel for if (num_values >= omp_min_work)
+#endif
     for (index_t i = 0; i < num_values; i++)
     {
         values[i] = alpha;
@@ -52,6 +55,9 @@ void Vector::set_rand_values()
 **************************************************************/
 void Vector::axpy(Vector& x, data_t alpha)
 {
+#ifdef _OPENMP
+#pragma omp parallel for if (num_values >= omp_min_work)
+#endif
     for (index_t i = 0; i < num_values; i++)
     {
         values[i] += x.values[i]*alpha;
@@ -71,9 +77,14 @@ void Vector::axpy(Vector& x, data_t alpha)
 **************************************************************/
 void Vector::copy(const Vector& y)
 {
-    num_values = y.num_values;
-    values.resize(num_values);
-    std::copy(y.values.begin(), y.values.end(), values.begin());
+    resize(y.num_values);
+#ifdef _OPENMP
+#pragma omp parallel for if (num_values >= omp_min_work)
+#endif
+    for (index_t i = 0; i < num_values; i++)
+    {
+        values[i] = y.values[i];
+    }
 }
 
 /**************************************************************
@@ -88,6 +99,9 @@ void Vector::copy(const Vector& y)
 **************************************************************/
 void Vector::scale(data_t alpha)
 {
+#ifdef _OPENMP
+#pragma omp parallel for if (num_values >= omp_min_work)
+#endif
     for (index_t i = 0; i < num_values; i++)
     {
         values[i] *= alpha;
@@ -107,10 +121,12 @@ void Vector::scale(data_t alpha)
 data_t Vector::norm(index_t p)
 {
     data_t result = 0.0;
-    double val;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:result) if (num_values >= omp_min_work)
+#endif
     for (index_t i = 0; i < num_values; i++)
     {
-        val = values[i];
+        double val = values[i];
         if (fabs(val) > zero_tol)
             result += pow(val, p);
     }
@@ -156,9 +172,12 @@ data_t Vector::inner_product(Vector& x)
 {
     data_t result = 0.0;
 
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:result) if (num_values >= omp_min_work)
+#endif
     for (int i = 0; i < num_values; i++)
     {
-        result += values[i] * x[i];
+        result += values[i] * x.values[i];
     }
 
     return result;
@@ -73,6 +73,16 @@ public:
 
     void resize(int len)
     {
+        // Grown storage is first touched in the split of the
+        // threaded vector loops before zeroing
+        if ((size_t) len > values.capacity())
+        {
+            aligned_vector<double> new_values;
+            new_values.reserve(len);
+            first_touch(new_values.data(), len * sizeof(double));
+            new_values.assign(values.begin(), values.end());
+            new_values.swap(values);
+        }
         values.resize(len);
         num_values = len;
     }
@@ -10,6 +10,7 @@
 
 #include "core/types.hpp"
 #include "core/par_matrix.hpp"
+#include "core/csr_builder.hpp"
 
 using namespace raptor;
 
@@ -61,21 +62,13 @@ ParCSRMatrix* par_stencil_grid(data_t* stencil, int* grid, int dim)
     n_v = A->partition->local_num_rows;
     int first_local_row = A->partition->first_local_row;
     int last_local_row = first_local_row + n_v - 1;
+    int first_local_col = A->partition->first_local_col;
+    int last_local_col = A->partition->last_local_col;
 
     A->on_proc->n_rows = n_v;
     A->on_proc->n_cols = n_v;
-    A->on_proc->nnz = 0;
-    A->on_proc->idx1.resize(n_v+1);
-    A->on_proc->idx2.reserve(n_v*stencil_len);
-    A->on_proc->vals.reserve(n_v*stencil_len);
-
     A->off_proc->n_rows = n_v;
     A->off_proc->n_cols = N_v;
-    A->off_proc->nnz = 0;
-    A->off_proc->idx1.resize(n_v+1);
-    A->off_proc->idx2.reserve(0.3*n_v*stencil_len);
-    A->off_proc->vals.reserve(0.3*n_v*stencil_len);
-
 
     diags.resize(N_s, 0);
     nonzero_stencil.resize(N_s);
@@ -208,27 +201,54 @@ ParCSRMatrix* par_stencil_grid(data_t* stencil, int* grid, int dim)
         }
     }
 
-    //Add diagonals to ParMatrix A
-    A->on_proc->idx1[0] = 0;
-    A->off_proc->idx1[0] = 0;
+    //Add diagonals to ParMatrix A, counting the entries of each 
+    //row before filling on_proc and off_proc
+    CSRBuilder on_proc(A->on_proc);
+    CSRBuilder off_proc(A->off_proc);
     for (index_t i = 0; i < n_v; i++)
     {
         for (index_t d = 0; d < N_s; d++)
         {
-            //add data[i] if nonzero 
             col = diags[d] + i + first_local_row;
             value = data[(N_s-d-1)*n_v+i];
             if (col >= 0 && col < N_v && fabs(value) > zero_tol)
             {
-                A->add_value(i, col, value);
+                if (col >= first_local_col && col <= last_local_col)
+                {
+                    on_proc.count(i);
+                }
+                else
+                {
+                    off_proc.count(i);
+                }
             }
         }
-        A->on_proc->idx1[i+1] = A->on_proc->idx2.size();
-        A->off_proc->idx1[i+1] = A->off_proc->idx2.size();
     }
+    on_proc.allocate();
+    off_proc.allocate();
 
-    A->on_proc->nnz = A->on_proc->idx2.size();
-    A->off_proc->nnz = A->off_proc->idx2.size();
+    for (index_t i = 0; i < n_v; i++)
+    {
+        for (index_t d = 0; d < N_s; d++)
+        {
+            //add data[i] if nonzero 
+            col = diags[d] + i + first_local_row;
+            value = data[(N_s-d-1)*n_v+i];
+            if (col >= 0 && col < N_v && fabs(value) > zero_tol)
+            {
+                if (col >= first_local_col && col <= last_local_col)
+                {
+                    on_proc.add(i, col - first_local_col, value);
+                }
+                else
+                {
+                    off_proc.add(i, col, value);
+                }
+            }
+        }
+    }
+    on_proc.finalize();
+    off_proc.finalize();
     
     A->finalize();
 
@@ -8,6 +8,7 @@
 #include "core/par_vector.hpp"
 #include "multilevel/par_level.hpp"
 #include "util/linalg/par_relax.hpp"
+#include "util/linalg/reorder.hpp"
 #include "ruge_stuben/par_interpolation.hpp"
 #include "ruge_stuben/par_cf_splitting.hpp"
 
@@ -56,6 +57,58 @@
  *****    Maximum global num rows allowed in coarsest matrix
  ***** max_levels : int (default -1)
  *****    Maximum number of levels in hierarchy, or no maximum if -1
+ ***** sell_solve : bool (default false)
+ *****    Store A and P of each level in SELL-C-sigma format for the
+ *****    SpMVs, residuals, and Jacobi sweeps of the solve phase
+ ***** sell_chunk_height : int (default 8)
+ *****    Rows per SELL chunk (C)
+ ***** sell_sort_window : int (default 32)
+ *****    Rows sorted by length at a time when forming SELL (sigma)
+ ***** float_coarse_level : int (default -1)
+ *****    First level whose A is stored in single precision for the
+ *****    solve phase, in which case P of every level is as well.
+ *****    Setup computes in double, and vectors and sums remain 
+ *****    double.  No levels are converted if -1.
+ ***** compressed_solve : bool (default false)
+ *****    Store the diagonal block of A on each level with 16-bit
+ *****    column offsets for solve phase SpMVs and relaxation
+ ***** symmetric_solve : bool (default false)
+ *****    Store only the upper triangle of the diagonal block of A
+ *****    on each level whose diagonal block is symmetric, for the
+ *****    SpMVs, residuals, and Jacobi sweeps of the solve phase
+ ***** local_reorder : reorder_t (default NoReorder)
+ *****    Reorders the local rows and columns of A and P on all but
+ *****    the coarsest level with reverse Cuthill-McKee (RCM or 
+ *****    PeripheralRCM), for locality of the vector values 
+ *****    gathered by SpMVs and relaxation.  solve and cycle 
+ *****    permute vectors in and out of this ordering.
+ ***** spgemm_max_bytes : size_t (default 0)
+ *****    If nonzero, coarse operators are formed with rap_chunked,
+ *****    bounding the intermediate rows of A*P held at once by 
+ *****    this many bytes per process
+ ***** neighbor_comm_level : int (default -1)
+ *****    First level whose A and P exchange halos in the solve
+ *****    phase with MPI-3 neighborhood collectives (NeighborComm)
+ *****    rather than point-to-point messages.  Not used if -1.
+ ***** neighbor_reorder : bool (default false)
+ *****    Allow MPI to reorder ranks of the neighborhood graphs
+ ***** shared_tap_comm : bool (default false)
+ *****    Exchange the intra-node steps of TAP communication through
+ *****    shared-memory windows (SharedComm) rather than messages,
+ *****    when the processes of each node share memory
+ ***** reduced_halo_level : int (default -1)
+ *****    First level whose A and P send the double halo values of 
+ *****    the solve phase (relaxation, residual, restriction, and
+ *****    interpolation) in halo_precision.  With TAPComm, only the
+ *****    inter-node messages are reduced.  Not used if -1.
+ ***** halo_precision : halo_t (default HaloFloat)
+ *****    HaloFloat (relative error about 6e-8) or HaloScaled16 
+ *****    (16-bit values with an exponent per message, error about
+ *****    3e-5 of the largest magnitude in a message).  Coarse levels
+ *****    only correct the finer levels, so with reduced_halo_level
+ *****    of 1 or more the residual history matches double to about
+ *****    these tolerances.  Reducing level 0 perturbs A x itself, so
+ *****    the relative residual stalls near the halo error.
  ***** 
  ***** Methods
  ***** -------
@@ -102,6 +155,19 @@ namespace raptor
                 n_solve_times = 0;
                 solve_tol = 1e-07;
                 max_iterations = 100;
+                sell_solve = false;
+                sell_chunk_height = 8;
+                sell_sort_window = 32;
+                float_coarse_level = -1;
+                compressed_solve = false;
+                symmetric_solve = false;
+                local_reorder = NoReorder;
+                spgemm_max_bytes = 0;
+                neighbor_comm_level = -1;
+                neighbor_reorder = false;
+                shared_tap_comm = false;
+                reduced_halo_level = -1;
+                halo_precision = HaloFloat;
             }
 
             virtual ~ParMultilevel()
@@ -204,6 +270,76 @@ namespace raptor
                     weights = NULL;
 		}
 
+                if (local_reorder != NoReorder)
+                {
+                    reorder_hierarchy();
+                }
+
+                // Form solve phase SELL copies of all but the coarsest
+                // level, which is solved directly
+                if (sell_solve)
+                {
+                    for (int i = 0; i < num_levels - 1; i++)
+                    {
+                        levels[i]->A->init_sell(sell_chunk_height, sell_sort_window);
+                        levels[i]->P->init_sell(sell_chunk_height, sell_sort_window);
+                    }
+                }
+
+                // Down-convert coarse A and all P to single precision
+                if (float_coarse_level >= 0)
+                {
+                    for (int i = 0; i < num_levels - 1; i++)
+                    {
+                        if (i >= float_coarse_level)
+                            levels[i]->A->init_float();
+                        levels[i]->P->init_float();
+                    }
+                }
+
+                if (compressed_solve)
+                {
+                    for (int i = 0; i < num_levels - 1; i++)
+                    {
+                        levels[i]->A->init_compressed();
+                    }
+                }
+
+                if (symmetric_solve)
+                {
+                    for (int i = 0; i < num_levels - 1; i++)
+                    {
+                        levels[i]->A->init_symmetric();
+                    }
+                }
+
+                if (neighbor_comm_level >= 0)
+                {
+                    for (int i = neighbor_comm_level; i < num_levels - 1; i++)
+                    {
+                        levels[i]->A->init_neighbor_comm(neighbor_reorder);
+                        levels[i]->P->init_neighbor_comm(neighbor_reorder);
+                    }
+                }
+
+                if (shared_tap_comm)
+                {
+                    for (int i = 0; i < num_levels - 1; i++)
+                    {
+                        levels[i]->A->init_shared_tap_comm();
+                        levels[i]->P->init_shared_tap_comm();
+                    }
+                }
+
+                if (reduced_halo_level >= 0)
+                {
+                    for (int i = reduced_halo_level; i < num_levels - 1; i++)
+                    {
+                        levels[i]->A->set_halo_precision(halo_precision);
+                        levels[i]->P->set_halo_precision(halo_precision);
+                    }
+                }
+
                 // Duplicate coarsest level across all processes that hold any
                 // rows of A_c
                 if (setup_times) setup_times[0][num_levels - 1] -= MPI_Wtime();
@@ -212,6 +348,34 @@ namespace raptor
             }
 
 
+            // Permutes the rows and columns of A, the rows of P, and the
+            // columns of the finer P on each level but the coarsest.
+            // local_perm holds the ordering of the finest level.  Block 
+            // hierarchies are not reordered.
+            void reorder_hierarchy()
+            {
+                aligned_vector<int> perm;
+
+                if (levels[0]->A->on_proc->b_size > 1) return;
+
+                for (int i = 0; i < num_levels - 1; i++)
+                {
+                    ParCSRMatrix* A = levels[i]->A;
+                    rcm_ordering((CSRMatrix*) A->on_proc, perm, local_reorder);
+                    A->permute_local_rows(perm);
+                    A->permute_on_proc_cols(perm);
+                    levels[i]->P->permute_local_rows(perm);
+                    if (i > 0)
+                    {
+                        levels[i-1]->P->permute_on_proc_cols(perm);
+                    }
+                    else
+                    {
+                        local_perm = perm;
+                    }
+                }
+            }
+
             void form_rand_weights(int local_n, int first_n)
             {
                 if (local_n == 0) return;
@@ -339,6 +503,15 @@ namespace raptor
 
             void cycle(ParVector& x, ParVector& b, int level = 0)
             {
+                // Cycle in the local ordering of the hierarchy
+                if (level == 0 && local_reorder != NoReorder && &x != &levels[0]->x)
+                {
+                    permute_in(x, b);
+                    cycle(levels[0]->x, levels[0]->b, 0);
+                    permute_out(x);
+                    return;
+                }
+
                 ParCSRMatrix* A = levels[level]->A;
                 ParCSRMatrix* P = levels[level]->P;
                 ParVector& tmp = levels[level]->tmp;
@@ -464,6 +637,15 @@ namespace raptor
 
             int solve(ParVector& sol, ParVector& rhs)
             {
+                // Solve in the local ordering of the hierarchy
+                if (local_reorder != NoReorder && &sol != &levels[0]->x)
+                {
+                    permute_in(sol, rhs);
+                    int iter = solve(levels[0]->x, levels[0]->b);
+                    permute_out(sol);
+                    return iter;
+                }
+
                 double b_norm = rhs.norm(2);
                 double r_norm;
                 int iter = 0;
@@ -531,6 +713,26 @@ namespace raptor
                 return iter;
             }
 
+            // Copy x and b into the finest level vectors, in the local
+            // ordering of the hierarchy
+            void permute_in(const ParVector& x, const ParVector& b)
+            {
+                for (int i = 0; i < (int) local_perm.size(); i++)
+                {
+                    levels[0]->x.local.values[i] = x.local.values[local_perm[i]];
+                    levels[0]->b.local.values[i] = b.local.values[local_perm[i]];
+                }
+            }
+
+            // Copy the finest level x back to x, in the original ordering
+            void permute_out(ParVector& x)
+            {
+                for (int i = 0; i < (int) local_perm.size(); i++)
+                {
+                    x.local.values[local_perm[i]] = levels[0]->x.local.values[i];
+                }
+            }
+
             void print_hierarchy()
             {
                 int rank;
@@ -649,6 +851,21 @@ namespace raptor
             bool store_residuals;
             bool track_times;
 
+            bool sell_solve;
+            int sell_chunk_height;
+            int sell_sort_window;
+            int float_coarse_level;
+            bool compressed_solve;
+            bool symmetric_solve;
+            reorder_t local_reorder;
+            size_t spgemm_max_bytes;
+            int neighbor_comm_level;
+            bool neighbor_reorder;
+            bool shared_tap_comm;
+            int reduced_halo_level;
+            halo_t halo_precision;
+            aligned_vector<int> local_perm;
+
             double* weights;
             aligned_vector<double> residuals;
 
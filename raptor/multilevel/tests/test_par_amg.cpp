@@ -125,3 +125,67 @@ TEST(ParAMGTest, TestsInMultilevel)
     delete A;
 
 } // end of TEST(ParAMGTest, TestsInMultilevel) //
+
+TEST(ParAMGTest, TestsReducedHalo)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int dim = 3;
+    int grid[3] = {10, 10, 10};
+    double strong_threshold = 0.25;
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, dim);
+    delete[] stencil;
+
+    ParMultilevel* ml;
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    // Halos of levels 1 and coarser in reduced precision, with and
+    // without TAP communication, against the residuals in double
+    halo_t precision[3] = {HaloDouble, HaloFloat, HaloScaled16};
+    double tol[3] = {0.0, 1e-6, 1e-3};
+    aligned_vector<double> double_res;
+    for (int tap = 0; tap < 2; tap++)
+    {
+        int double_iter = 0;
+        for (int test = 0; test < 3; test++)
+        {
+            ml = new ParRugeStubenSolver(strong_threshold, CLJP, ModClassical, 
+                    Classical, SOR);
+            if (tap) ml->tap_amg = 0;
+            if (test)
+            {
+                ml->reduced_halo_level = 1;
+                ml->halo_precision = precision[test];
+            }
+            ml->setup(A);
+
+            x.set_const_value(1.0);
+            A->mult(x, b);
+            x.set_const_value(0.0);
+            int iter = ml->solve(x, b);
+            aligned_vector<double>& res = ml->get_residuals();
+            if (test == 0)
+            {
+                double_iter = iter;
+                double_res.assign(res.begin(), res.begin() + iter);
+            }
+            else
+            {
+                ASSERT_EQ(iter, double_iter);
+                for (int i = 0; i < iter; i++)
+                {
+                    ASSERT_NEAR(res[i], double_res[i], tol[test] * double_res[i]);
+                }
+            }
+
+            delete ml;
+        }
+    }
+
+    delete A;
+
+} // end of TEST(ParAMGTest, TestsReducedHalo) //
@@ -2,9 +2,28 @@
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 
 #include "core/par_matrix.hpp"
+#include "core/csr_builder.hpp"
 
 using namespace raptor;
 
+// An entry is strong if it exceeds the threshold in the direction
+// opposite the sign of the diagonal
+bool is_strong(double val, double diag, double threshold)
+{
+    if (diag < 0.0) return val > threshold;
+    return val < threshold;
+}
+
+// An entry a_ij is symmetrically strong if it is strong in either 
+// row i or row j
+bool symmetric_strong(double val, bool neg_diag, double threshold,
+        bool neg_diag_col, double threshold_col)
+{
+    return (neg_diag && val > threshold) || (!neg_diag && val < threshold)
+        || (neg_diag_col && val > threshold_col)
+        || (!neg_diag_col && val < threshold_col);
+}
+
 ParCSRMatrix* classical_strength(ParCSRMatrix* A, double theta, bool tap_amg, int num_variables,
         int* variables, data_t* comm_t)
 {
@@ -25,7 +44,7 @@ ParCSRMatrix* classical_strength(ParCSRMatrix* A, double theta, bool tap_amg, in
     ParCSRMatrix* S = new ParCSRMatrix(A->partition, A->global_num_rows, A->global_num_cols,
             A->local_num_rows, A->on_proc_num_cols, A->off_proc_num_cols);
     
-    int* off_variables;
+    int* off_variables = NULL;
     if (num_variables > 1)
     {
         if (comm_t) *comm_t -= MPI_Wtime();
@@ -38,22 +57,18 @@ ParCSRMatrix* classical_strength(ParCSRMatrix* A, double theta, bool tap_amg, in
     // A and S will be sorted 
     A->sort();
     A->on_proc->move_diag();
-    
-    if (A->on_proc->nnz)
-    {
-        S->on_proc->idx2.resize(A->on_proc->nnz);
-        S->on_proc->vals.resize(A->on_proc->nnz);
-    }
-    if (A->off_proc->nnz)
+
+    // Find threshold of each row and count strong connections
+    aligned_vector<double> diags;
+    aligned_vector<double> thresholds;
+    if (A->local_num_rows)
     {
-        S->off_proc->idx2.resize(A->off_proc->nnz);
-        S->off_proc->vals.resize(A->off_proc->nnz);
+        diags.resize(A->local_num_rows);
+        thresholds.resize(A->local_num_rows);
     }
 
-    S->on_proc->idx1[0] = 0;
-    S->off_proc->idx1[0] = 0;
-    S->on_proc->nnz = 0;
-    S->off_proc->nnz = 0;
+    CSRBuilder S_on(S->on_proc);
+    CSRBuilder S_off(S->off_proc);
     for (int i = 0; i < A->local_num_rows; i++)
     {
         row_start_on = A->on_proc->idx1[i];
@@ -72,255 +87,108 @@ ParCSRMatrix* classical_strength(ParCSRMatrix* A, double theta, bool tap_amg, in
                 diag = 0.0;
             }
 
-            // Find value with max magnitude in row
-            if (num_variables == 1)
+            // Find value with max magnitude in row (with sign 
+            // opposite of diagonal)
+            if (diag < 0.0) row_scale = -RAND_MAX;
+            else row_scale = RAND_MAX;
+            for (int j = row_start_on; j < row_end_on; j++)
             {
-                if (diag < 0.0)
-                {
-                    row_scale = -RAND_MAX; 
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        val = A->on_proc->vals[j];
-                        if (val > row_scale)
-                        {
-                            row_scale = val;
-                        }
-                    }    
-                    for (int j = row_start_off; j < row_end_off; j++)
-                    {
-                        val = A->off_proc->vals[j];
-                        if (val > row_scale)
-                        {
-                            row_scale = val;
-                        }
-                    } 
-                }
-                else
+                col = A->on_proc->idx2[j];
+                if (num_variables == 1 || variables[i] == variables[col])
                 {
-                    row_scale = RAND_MAX;
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        val = A->on_proc->vals[j];
-                        if (val < row_scale)
-                        {
-                            row_scale = val;
-                        }
-                    }    
-                    for (int j = row_start_off; j < row_end_off; j++)
+                    val = A->on_proc->vals[j];
+                    if (is_strong(val, diag, row_scale))
                     {
-                        val = A->off_proc->vals[j];
-                        if (val < row_scale)
-                        {
-                            row_scale = val;
-                        }
-                    } 
+                        row_scale = val;
+                    }
                 }
-            }
-            else
+            }    
+            for (int j = row_start_off; j < row_end_off; j++)
             {
-                if (diag < 0.0)
-                {
-                    row_scale = -RAND_MAX; 
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        col = A->on_proc->idx2[j];
-                        if (variables[i] == variables[col])
-                        {
-                            val = A->on_proc->vals[j];
-                            if (val > row_scale)
-                            {
-                                row_scale = val;
-                            }
-                        }
-                    }    
-                    for (int j = row_start_off; j < row_end_off; j++)
-                    {
-                        col = A->off_proc->idx2[j];
-                        if (variables[i] == off_variables[col])
-                        {
-                            val = A->off_proc->vals[j];
-                            if (val > row_scale)
-                            {
-                                row_scale = val;
-                            }
-                        }
-                    } 
-                }
-                else
+                col = A->off_proc->idx2[j];
+                if (num_variables == 1 || variables[i] == off_variables[col])
                 {
-                    row_scale = RAND_MAX;
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        col = A->on_proc->idx2[j];
-                        if (variables[i] == variables[col])
-                        {
-                            val = A->on_proc->vals[j];
-                            if (val < row_scale)
-                            {
-                                row_scale = val;
-                            }
-                        }
-                    }    
-                    for (int j = row_start_off; j < row_end_off; j++)
+                    val = A->off_proc->vals[j];
+                    if (is_strong(val, diag, row_scale))
                     {
-                        col = A->off_proc->idx2[j];
-                        if (variables[i] == off_variables[col])
-                        {
-                            val = A->off_proc->vals[j];
-                            if (val < row_scale)
-                            {
-                                row_scale = val;
-                            }
-                        }
-                    } 
+                        row_scale = val;
+                    }
                 }
-            }
-
-
+            } 
 
             // Multiply row max magnitude by theta
             threshold = row_scale * theta;
+            diags[i] = diag;
+            thresholds[i] = threshold;
 
             // Always add diagonal
-            S->on_proc->idx2[S->on_proc->nnz] = i;
-            S->on_proc->vals[S->on_proc->nnz] = diag;
-            S->on_proc->nnz++;
-
-            // Add all off-diagonal entries to strength
-            // if magnitude greater than equal to 
-            // row_max * theta
-            if (num_variables == 1)
+            S_on.count(i);
+            for (int j = row_start_on; j < row_end_on; j++)
             {
-                if (diag < 0)
+                col = A->on_proc->idx2[j];
+                if ((num_variables == 1 || variables[i] == variables[col])
+                        && is_strong(A->on_proc->vals[j], diag, threshold))
                 {
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        val = A->on_proc->vals[j];
-                        if (val > threshold)
-                        {
-                            col = A->on_proc->idx2[j];
-                            S->on_proc->idx2[S->on_proc->nnz] = col;
-                            S->on_proc->vals[S->on_proc->nnz] = val;
-                            S->on_proc->nnz++;
-                        }
-                    }
-                    for (int j = row_start_off; j < row_end_off; j++)
-                    {
-                        val = A->off_proc->vals[j];
-                        if (val > threshold)
-                        {
-                            col = A->off_proc->idx2[j];
-                            S->off_proc->idx2[S->off_proc->nnz] = col;
-                            S->off_proc->vals[S->off_proc->nnz] = val;
-                            S->off_proc->nnz++;
-                        }
-                    }
+                    S_on.count(i);
                 }
-                else
+            }
+            for (int j = row_start_off; j < row_end_off; j++)
+            {
+                col = A->off_proc->idx2[j];
+                if ((num_variables == 1 || variables[i] == off_variables[col])
+                        && is_strong(A->off_proc->vals[j], diag, threshold))
                 {
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        val = A->on_proc->vals[j];
-                        if (val < threshold)
-                        {
-                            col = A->on_proc->idx2[j];
-                            S->on_proc->idx2[S->on_proc->nnz] = col;
-                            S->on_proc->vals[S->on_proc->nnz] = val;
-                            S->on_proc->nnz++;
-                        }
-                    }
-                    for (int j = row_start_off; j < row_end_off; j++)
-                    {
-                        val = A->off_proc->vals[j];
-                        if (val < threshold)
-                        {
-                            col = A->off_proc->idx2[j];
-                            S->off_proc->idx2[S->off_proc->nnz] = col;
-                            S->off_proc->vals[S->off_proc->nnz] = val;
-                            S->off_proc->nnz++;
-                        }
-                    }
+                    S_off.count(i);
                 }
             }
-            else
+        }
+    }
+    S_on.allocate();
+    S_off.allocate();
+
+    // Add all off-diagonal entries to strength
+    // if magnitude greater than equal to 
+    // row_max * theta
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        row_start_on = A->on_proc->idx1[i];
+        row_end_on = A->on_proc->idx1[i+1];
+        row_start_off = A->off_proc->idx1[i];
+        row_end_off = A->off_proc->idx1[i+1];
+        if (row_end_on - row_start_on || row_end_off - row_start_off)
+        {
+            if (A->on_proc->idx2[row_start_on] == i)
             {
-                if (diag < 0)
+                row_start_on++;
+            }
+            diag = diags[i];
+            threshold = thresholds[i];
+
+            S_on.add(i, i, diag);
+            for (int j = row_start_on; j < row_end_on; j++)
+            {
+                col = A->on_proc->idx2[j];
+                val = A->on_proc->vals[j];
+                if ((num_variables == 1 || variables[i] == variables[col])
+                        && is_strong(val, diag, threshold))
                 {
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        col = A->on_proc->idx2[j];
-                        if (variables[i] == variables[col])
-                        {
-                            val = A->on_proc->vals[j];
-                            if (val > threshold)
-                            {
-                                S->on_proc->idx2[S->on_proc->nnz] = col;
-                                S->on_proc->vals[S->on_proc->nnz] = val;
-                                S->on_proc->nnz++;
-                            }
-                        }
-                    }
-                    for (int j = row_start_off; j < row_end_off; j++)
-                    {
-                        col = A->off_proc->idx2[j];
-                        if (variables[i] == off_variables[col])
-                        {
-                            val = A->off_proc->vals[j];
-                            if (val > threshold)
-                            {
-                                S->off_proc->idx2[S->off_proc->nnz] = col;
-                                S->off_proc->vals[S->off_proc->nnz] = val;
-                                S->off_proc->nnz++;
-                            }
-                        }
-                    }
+                    S_on.add(i, col, val);
                 }
-                else
+            }
+            for (int j = row_start_off; j < row_end_off; j++)
+            {
+                col = A->off_proc->idx2[j];
+                val = A->off_proc->vals[j];
+                if ((num_variables == 1 || variables[i] == off_variables[col])
+                        && is_strong(val, diag, threshold))
                 {
-                    for (int j = row_start_on; j < row_end_on; j++)
-                    {
-                        col = A->on_proc->idx2[j];
-                        if (variables[i] == variables[col])
-                        {
-                            val = A->on_proc->vals[j];
-                            if (val < threshold)
-                            {
-                                S->on_proc->idx2[S->on_proc->nnz] = col;
-                                S->on_proc->vals[S->on_proc->nnz] = val;
-                                S->on_proc->nnz++;
-                            }
-                        }
-                    }
-                    for (int j = row_start_off; j < row_end_off; j++)
-                    {
-                        col = A->off_proc->idx2[j];
-                        if (variables[i] == off_variables[col])
-                        {
-                            val = A->off_proc->vals[j];
-                            if (val < threshold)
-                            {
-                                S->off_proc->idx2[S->off_proc->nnz] = col;
-                                S->off_proc->vals[S->off_proc->nnz] = val;
-                                S->off_proc->nnz++;
-                            }
-                        }
-                    }
+                    S_off.add(i, col, val);
                 }
             }
-
         }
-        S->on_proc->idx1[i+1] = S->on_proc->nnz;
-        S->off_proc->idx1[i+1] = S->off_proc->nnz;
     }
-    S->on_proc->idx2.resize(S->on_proc->nnz);
-    S->on_proc->idx2.shrink_to_fit();
-    S->off_proc->idx2.resize(S->off_proc->nnz);
-    S->off_proc->idx2.shrink_to_fit();
-
-    S->on_proc->vals.resize(S->on_proc->nnz);
-    S->on_proc->vals.shrink_to_fit();
-    S->off_proc->vals.resize(S->off_proc->nnz);
-    S->off_proc->vals.shrink_to_fit();
+    S_on.finalize();
+    S_off.finalize();
 
     S->local_nnz = S->on_proc->nnz + S->off_proc->nnz;
 
@@ -368,19 +236,6 @@ ParCSRMatrix* symmetric_strength(ParCSRMatrix* A, double theta, bool tap_amg, da
     A->sort();
     A->on_proc->move_diag();
 
-    if (A->on_proc->nnz)
-    {
-        S->on_proc->idx2.resize(A->on_proc->nnz);
-        S->on_proc->vals.resize(A->on_proc->nnz);
-        S->on_proc->nnz = 0;
-    }
-    if (A->off_proc->nnz)
-    {
-        S->off_proc->idx2.resize(A->off_proc->nnz);
-        S->off_proc->vals.resize(A->off_proc->nnz);
-        S->off_proc->nnz = 0;
-    }
-
     for (int i = 0; i < A->local_num_rows; i++)
     {
         row_start_on = A->on_proc->idx1[i];
@@ -453,8 +308,41 @@ ParCSRMatrix* symmetric_strength(ParCSRMatrix* A, double theta, bool tap_amg, da
     aligned_vector<int>& off_proc_neg_diags = comm->communicate(neg_diags);
     if (comm_t) *comm_t += MPI_Wtime();
     
-    S->on_proc->idx1[0] = 0;
-    S->off_proc->idx1[0] = 0;
+    // Count strong connections (diagonal always added), then fill S
+    CSRBuilder S_on(S->on_proc);
+    CSRBuilder S_off(S->off_proc);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        row_start_on = A->on_proc->idx1[i];
+        row_end_on = A->on_proc->idx1[i+1];
+        row_start_off = A->off_proc->idx1[i];
+        row_end_off = A->off_proc->idx1[i+1];
+        if (row_end_on - row_start_on || row_end_off - row_start_off)
+        {
+            S_on.count(i);
+            for (int j = row_start_on + 1; j < row_end_on; j++)
+            {
+                if (symmetric_strong(A->on_proc->vals[j], neg_diags[i], row_scales[i],
+                            neg_diags[A->on_proc->idx2[j]], 
+                            row_scales[A->on_proc->idx2[j]]))
+                {
+                    S_on.count(i);
+                }
+            }
+            for (int j = row_start_off; j < row_end_off; j++)
+            {
+                col = A->off_proc->idx2[j];
+                if (symmetric_strong(A->off_proc->vals[j], neg_diags[i], row_scales[i],
+                            off_proc_neg_diags[col], off_proc_row_scales[col]))
+                {
+                    S_off.count(i);
+                }
+            }
+        }
+    }
+    S_on.allocate();
+    S_off.allocate();
+
     for (int i = 0; i < A->local_num_rows; i++)
     {
         row_start_on = A->on_proc->idx1[i];
@@ -467,9 +355,7 @@ ParCSRMatrix* symmetric_strength(ParCSRMatrix* A, double theta, bool tap_amg, da
             threshold = row_scales[i];
 
             // Always add diagonal
-            S->on_proc->idx2[S->on_proc->nnz] = i;
-            S->on_proc->vals[S->on_proc->nnz] = A->on_proc->vals[row_start_on++];
-            S->on_proc->nnz++;
+            S_on.add(i, i, A->on_proc->vals[row_start_on++]);
 
             // Add all off-diagonal entries to strength
             // if magnitude greater than equal to 
@@ -478,41 +364,26 @@ ParCSRMatrix* symmetric_strength(ParCSRMatrix* A, double theta, bool tap_amg, da
             {
                 val = A->on_proc->vals[j];
                 col = A->on_proc->idx2[j];
-                if ((neg_diag && val > threshold) || (!neg_diag && val < threshold) 
-                        || (neg_diags[col] && val > row_scales[col])
-                        || (!neg_diags[col] && val < row_scales[col]))
+                if (symmetric_strong(val, neg_diag, threshold, 
+                            neg_diags[col], row_scales[col]))
                 {
-                    S->on_proc->idx2[S->on_proc->nnz] = col;
-                    S->on_proc->vals[S->on_proc->nnz] = val;
-                    S->on_proc->nnz++;
+                    S_on.add(i, col, val);
                 }
             }
             for (int j = row_start_off; j < row_end_off; j++)
             {
                 val = A->off_proc->vals[j];
                 col = A->off_proc->idx2[j];
-                if ((neg_diag && val > threshold) || (!neg_diag && val < threshold)
-                        || (off_proc_neg_diags[col] && val > off_proc_row_scales[col])
-                        || (!off_proc_neg_diags[col] && val < off_proc_row_scales[col]))
+                if (symmetric_strong(val, neg_diag, threshold,
+                            off_proc_neg_diags[col], off_proc_row_scales[col]))
                 {
-                    S->off_proc->idx2[S->off_proc->nnz] = col;
-                    S->off_proc->vals[S->off_proc->nnz] = val;
-                    S->off_proc->nnz++;
+                    S_off.add(i, col, val);
                 }
             }                    
         }
-        S->on_proc->idx1[i+1] = S->on_proc->nnz;
-        S->off_proc->idx1[i+1] = S->off_proc->nnz;
     }
-    S->on_proc->idx2.resize(S->on_proc->nnz);
-    S->on_proc->idx2.shrink_to_fit();
-    S->off_proc->idx2.resize(S->off_proc->nnz);
-    S->off_proc->idx2.shrink_to_fit();
-
-    S->on_proc->vals.resize(S->on_proc->nnz);
-    S->on_proc->vals.shrink_to_fit();
-    S->off_proc->vals.resize(S->off_proc->nnz);
-    S->off_proc->vals.shrink_to_fit();
+    S_on.finalize();
+    S_off.finalize();
 
     S->local_nnz = S->on_proc->nnz + S->off_proc->nnz;
 
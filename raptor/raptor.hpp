@@ -15,6 +15,7 @@
 // Matrix and vector classes
 #include "core/matrix.hpp"
 #include "core/vector.hpp"
+#include "core/csr_builder.hpp"
 #ifndef NO_MPI
     #include "core/par_matrix.hpp"
     #include "core/par_vector.hpp"
@@ -96,6 +97,9 @@
     #include "util/linalg/par_relax.hpp"
 #endif
 
+// Local reordering
+#include "util/linalg/reorder.hpp"
+
 // Repartitioning matrix methods
 #ifndef NO_MPI
 #include "util/linalg/repartition.hpp"
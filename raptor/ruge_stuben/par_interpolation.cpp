@@ -3,6 +3,7 @@
 #include "assert.h"
 #include "core/types.hpp"
 #include "core/par_matrix.hpp"
+#include "core/csr_builder.hpp"
 
 using namespace raptor;
 
@@ -426,51 +427,111 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
     }
 
 
-    // Find upperbound size of P->on_proc and P->off_proc
-    int nnz_on = 0;
-    int nnz_off = 0;
+    // Count the exact size of each row of P->on_proc and P->off_proc
+    // (strong coarse points at distance one and two), marking 
+    // columns already in row i with pos and off_proc_pos
+    CSRBuilder P_on(P->on_proc);
+    CSRBuilder P_off(P->off_proc);
     for (int i = 0; i < A->local_num_rows; i++)
     {
-        if (states[i] == Unselected)
+        if (states[i] != Unselected)
         {
-            nnz_on += (S->on_proc->idx1[i+1] - S->on_proc->idx1[i]);
-            nnz_off += (S->off_proc->idx1[i+1] - S->off_proc->idx1[i]);
+            if (states[i] == Selected)
+            {
+                P_on.count(i);
+            }
+            continue;
+        }
 
-            start = S->on_proc->idx1[i]+1;
-            end = S->on_proc->idx1[i+1];
-            for (int j = start; j < end; j++)
+        start = S->on_proc->idx1[i]+1;
+        end = S->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            col = S->on_proc->idx2[j];
+            if (states[col] == Selected)
             {
-                col = S->on_proc->idx2[j];
-                if (states[col] == Unselected)
+                if (pos[col] != i)
                 {
-                    nnz_on += (S->on_proc->idx1[col+1] - S->on_proc->idx1[col]);
-                    nnz_off += (S->off_proc->idx1[col+1] - S->off_proc->idx1[col]);
+                    pos[col] = i;
+                    P_on.count(i);
                 }
             }
-            start = S->off_proc->idx1[i];
-            end = S->off_proc->idx1[i+1];
-            for (int j = start; j < end; j++)
+            else if (states[col] == Unselected)
             {
-                col = S->off_proc->idx2[j];
-                if (off_proc_states[col] == Unselected)
+                start_k = S->on_proc->idx1[col]+1;
+                end_k = S->on_proc->idx1[col+1];
+                for (int k = start_k; k < end_k; k++)
                 {
-                    nnz_on += (S_recv_on_ptr[col+1] - S_recv_on_ptr[col]);
-                    nnz_off += (S_recv_off_ptr[col+1] - S_recv_off_ptr[col]);
+                    col_k = S->on_proc->idx2[k];
+                    if (states[col_k] == Selected && pos[col_k] != i)
+                    {
+                        pos[col_k] = i;
+                        P_on.count(i);
+                    }
+                }
+
+                start_k = S->off_proc->idx1[col];
+                end_k = S->off_proc->idx1[col+1];
+                for (int k = start_k; k < end_k; k++)
+                {
+                    col_k = S->off_proc->idx2[k];
+                    col_P = off_proc_A_to_P[col_k];
+                    if (off_proc_states[col_k] == Selected && off_proc_pos[col_P] != i)
+                    {
+                        off_proc_pos[col_P] = i;
+                        P_off.count(i);
+                    }
                 }
             }
         }
-        else
+
+        start = S->off_proc->idx1[i];
+        end = S->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
         {
-            nnz_on++;
+            col = S->off_proc->idx2[j];
+            if (off_proc_states[col] == Selected)
+            {
+                col_P = off_proc_A_to_P[col];
+                if (off_proc_pos[col_P] != i)
+                {
+                    off_proc_pos[col_P] = i;
+                    P_off.count(i);
+                }
+            }
+            else if (off_proc_states[col] == Unselected)
+            {
+                start_k = S_recv_on_ptr[col];
+                end_k = S_recv_on_ptr[col+1];
+                for (int k = start_k; k < end_k; k++)
+                {
+                    col_k = recv_mat->idx2[S_recv_on_idx[k]];
+                    if (pos[col_k] != i)
+                    {
+                        pos[col_k] = i;
+                        P_on.count(i);
+                    }
+                }
+
+                start_k = S_recv_off_ptr[col];
+                end_k = S_recv_off_ptr[col+1];
+                for (int k = start_k; k < end_k; k++)
+                {
+                    col_k = recv_mat->idx2[S_recv_off_idx[k]];
+                    if (off_proc_pos[col_k] != i)
+                    {
+                        off_proc_pos[col_k] = i;
+                        P_off.count(i);
+                    }
+                }
+            }
         }
     }
-    P->on_proc->idx2.resize(nnz_on);
-    P->on_proc->vals.resize(nnz_on);
-    P->off_proc->idx2.resize(nnz_off);
-    P->off_proc->vals.resize(nnz_off);
+    P_on.allocate();
+    P_off.allocate();
+    std::fill(pos.begin(), pos.end(), -1);
+    std::fill(off_proc_pos.begin(), off_proc_pos.end(), -1);
 
-    nnz_on = 0;
-    nnz_off = 0;
     for (int i = 0; i < A->local_num_rows; i++)
     {
         // If coarse row, add to P
@@ -478,18 +539,15 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
         {
             if (states[i] == Selected)
             {
-                P->on_proc->idx2[nnz_on] = on_proc_col_to_new[i];
-                P->on_proc->vals[nnz_on++] = 1;
+                P_on.add(i, on_proc_col_to_new[i], 1);
             }
-            P->on_proc->idx1[i+1] = nnz_on;
-            P->off_proc->idx1[i+1] = nnz_off;
             continue;
         }
 
         // Go through strong coarse points, 
         // add to row coarse and create sparsity of P (dist1)
-        row_start_on = nnz_on;
-        row_start_off = nnz_off;
+        row_start_on = P_on.row_start(i);
+        row_start_off = P_off.row_start(i);
 
         start = S->on_proc->idx1[i]+1;
         end = S->on_proc->idx1[i+1];
@@ -501,9 +559,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             {
                 if (pos[col] < row_start_on)
                 {
-                    pos[col] = nnz_on;
-                    P->on_proc->idx2[nnz_on] = on_proc_col_to_new[col];
-                    P->on_proc->vals[nnz_on++] = 0.0;
+                    pos[col] = P_on.insert(i, on_proc_col_to_new[col]);
                 }
             }
             else if (states[col] == Unselected)
@@ -515,9 +571,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                     col_k = S->on_proc->idx2[k];
                     if (states[col_k] == Selected && pos[col_k] < row_start_on)
                     {
-                        pos[col_k] = nnz_on;
-                        P->on_proc->idx2[nnz_on] = on_proc_col_to_new[col_k];
-                        P->on_proc->vals[nnz_on++] = 0.0;
+                        pos[col_k] = P_on.insert(i, on_proc_col_to_new[col_k]);
                     }
                 }
 
@@ -530,9 +584,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                     if (off_proc_states[col_k] == Selected && off_proc_pos[col_P] < row_start_off)
                     {
                         col_exists[col_P] = true;
-                        off_proc_pos[col_P] = nnz_off;
-                        P->off_proc->idx2[nnz_off] = col_P;
-                        P->off_proc->vals[nnz_off++] = 0.0;
+                        off_proc_pos[col_P] = P_off.insert(i, col_P);
                     }
                 }
             }
@@ -549,10 +601,8 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                 col_P = off_proc_A_to_P[col];
                 if (off_proc_pos[col_P] < row_start_off)
                 {
-                    off_proc_pos[col_P] = nnz_off;
+                    off_proc_pos[col_P] = P_off.insert(i, col_P);
                     col_exists[col_P] = true;
-                    P->off_proc->idx2[nnz_off] = col_P;
-                    P->off_proc->vals[nnz_off++] = 0.0;
                 }
             }
             else if (off_proc_states[col] == Unselected)
@@ -565,9 +615,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                     col_k = recv_mat->idx2[idx];
                     if (pos[col_k] < row_start_on)
                     {
-                        pos[col_k] = nnz_on;
-                        P->on_proc->idx2[nnz_on] = on_proc_col_to_new[col_k];
-                        P->on_proc->vals[nnz_on++] = 0.0;
+                        pos[col_k] = P_on.insert(i, on_proc_col_to_new[col_k]);
                     }
                 }
 
@@ -579,17 +627,15 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                     col_k = recv_mat->idx2[idx];
                     if (off_proc_pos[col_k] < row_start_off)
                     {
-                        off_proc_pos[col_k] = nnz_off;
-                        P->off_proc->idx2[nnz_off] = col_k;
-                        P->off_proc->vals[nnz_off++] = 0.0;
+                        off_proc_pos[col_k] = P_off.insert(i, col_k);
                         col_exists[col_k] = true;
                     }
                 }
             }
         }
-        pos[i] = nnz_on;
-        row_end_on = nnz_on;
-        row_end_off = nnz_off;
+        row_end_on = P_on.row_end(i);
+        row_end_off = P_off.row_end(i);
+        pos[i] = row_end_on;
 
 
         start = A->on_proc->idx1[i];
@@ -836,22 +882,9 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             }
         }
         pos[i] = -1;
-
-        P->on_proc->idx1[i+1] = row_end_on;
-        P->off_proc->idx1[i+1] = row_end_off;
     }
-    P->on_proc->nnz = nnz_on;
-    P->off_proc->nnz = nnz_off;
-
-    P->on_proc->idx2.resize(nnz_on);
-    P->on_proc->idx2.shrink_to_fit();
-    P->on_proc->vals.resize(nnz_on);
-    P->on_proc->vals.shrink_to_fit();
-
-    P->off_proc->idx2.resize(nnz_off);
-    P->off_proc->idx2.shrink_to_fit();
-    P->off_proc->vals.resize(nnz_off);
-    P->off_proc->vals.shrink_to_fit();
+    P_on.finalize();
+    P_off.finalize();
 
     P->local_nnz = P->on_proc->nnz + P->off_proc->nnz;
 
@@ -997,8 +1030,11 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
     recv_mat = communicate(A, states, off_proc_states, mat_comm);
     if (comm_mat_t) *comm_mat_t += MPI_Wtime();
 
-    CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1, recv_mat->nnz);
-    CSRMatrix* recv_off = new CSRMatrix(recv_mat->n_rows, -1, recv_mat->nnz);
+    // Split recv_mat into on_proc and off_proc columns
+    CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1);
+    CSRMatrix* recv_off = new CSRMatrix(recv_mat->n_rows, -1);
+    CSRBuilder recv_on_builder(recv_on);
+    CSRBuilder recv_off_builder(recv_off);
     for (int i = 0; i < recv_mat->n_rows; i++)
     {
         start = recv_mat->idx1[i];
@@ -1008,20 +1044,35 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
             col = recv_mat->idx2[j];
             if (col < A->partition->first_local_col || col > A->partition->last_local_col)
             {
-                recv_off->idx2.emplace_back(col);
-                recv_off->vals.emplace_back(recv_mat->vals[j]);
+                recv_off_builder.count(i);
             }
             else
             {
-                recv_on->idx2.emplace_back(col);
-                recv_on->vals.emplace_back(recv_mat->vals[j]);
+                recv_on_builder.count(i);
             }
         }
-        recv_on->idx1[i+1] = recv_on->idx2.size();
-        recv_off->idx1[i+1] = recv_off->idx2.size();
     }
-    recv_on->nnz = recv_on->idx2.size();
-    recv_off->nnz = recv_off->idx2.size();
+    recv_on_builder.allocate();
+    recv_off_builder.allocate();
+    for (int i = 0; i < recv_mat->n_rows; i++)
+    {
+        start = recv_mat->idx1[i];
+        end = recv_mat->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            col = recv_mat->idx2[j];
+            if (col < A->partition->first_local_col || col > A->partition->last_local_col)
+            {
+                recv_off_builder.add(i, col, recv_mat->vals[j]);
+            }
+            else
+            {
+                recv_on_builder.add(i, col, recv_mat->vals[j]);
+            }
+        }
+    }
+    recv_on_builder.finalize();
+    recv_off_builder.finalize();
 
     delete recv_mat;
 
@@ -1079,22 +1130,49 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
         off_proc_pos.resize(A->off_proc_num_cols, -1);
     }
 
-    P->on_proc->idx1[0] = 0;
-    P->off_proc->idx1[0] = 0;
+    // Count strong coarse connections of each row (pattern of P)
+    CSRBuilder P_on(P->on_proc);
+    CSRBuilder P_off(P->off_proc);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        if (states[i] == Selected)
+        {
+            P_on.count(i);
+            continue;
+        }
+        start = S->on_proc->idx1[i] + 1;
+        end = S->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            if (states[S->on_proc->idx2[j]] == Selected)
+            {
+                P_on.count(i);
+            }
+        }
+        start = S->off_proc->idx1[i];
+        end = S->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            if (off_proc_states[S->off_proc->idx2[j]] == Selected)
+            {
+                P_off.count(i);
+            }
+        }
+    }
+    P_on.allocate();
+    P_off.allocate();
+
     for (int i = 0; i < A->local_num_rows; i++)
     {
         // If coarse row, add to P
         if (states[i] == Selected)
         {
-            P->on_proc->idx2.emplace_back(on_proc_col_to_new[i]);
-            P->on_proc->vals.emplace_back(1);
-            P->on_proc->idx1[i+1] = P->on_proc->idx2.size();
-            P->off_proc->idx1[i+1] = P->off_proc->idx2.size();
+            P_on.add(i, on_proc_col_to_new[i], 1);
             continue;
         }
 
-        row_start_on = P->on_proc->idx1[i];
-        row_start_off = P->off_proc->idx1[i];
+        row_start_on = P_on.row_start(i);
+        row_start_off = P_off.row_start(i);
 
         // Add selected states to P
         start = S->on_proc->idx1[i] + 1;
@@ -1105,9 +1183,8 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
             if (states[col] == Selected)
             {
                 val = S->on_proc->vals[j];
-                pos[col] = P->on_proc->idx2.size();
-                P->on_proc->idx2.push_back(on_proc_col_to_new[col]);
-                P->on_proc->vals.push_back(val);
+                pos[col] = P_on.insert(i, on_proc_col_to_new[col]);
+                P->on_proc->vals[pos[col]] = val;
             }
         }
         start = S->off_proc->idx1[i];
@@ -1118,10 +1195,9 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
             if (off_proc_states[col] == Selected)
             {
                 val = S->off_proc->vals[j];
-                off_proc_pos[col] = P->off_proc->idx2.size();
+                off_proc_pos[col] = P_off.insert(i, col);
                 col_exists[col] = true;
-                P->off_proc->idx2.push_back(col);
-                P->off_proc->vals.push_back(val);
+                P->off_proc->vals[off_proc_pos[col]] = val;
             }
         }
 
@@ -1309,25 +1385,22 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
             }
         }
 
-        P->on_proc->idx1[i+1] = P->on_proc->idx2.size();
-        P->off_proc->idx1[i+1] = P->off_proc->idx2.size();
-
-        start = P->on_proc->idx1[i];
-        end = P->on_proc->idx1[i+1];
+        start = row_start_on;
+        end = P_on.row_end(i);
         for (int j = start; j < end; j++)
         {
             P->on_proc->vals[j] /= -weak_sum;
         }
-        start = P->off_proc->idx1[i];
-        end = P->off_proc->idx1[i+1];
+        start = row_start_off;
+        end = P_off.row_end(i);
         for (int j = start; j < end; j++)
         {
             P->off_proc->vals[j] /= -weak_sum;
 
         }
     }
-    P->on_proc->nnz = P->on_proc->idx2.size();
-    P->off_proc->nnz = P->off_proc->idx2.size();
+    P_on.finalize();
+    P_off.finalize();
     P->local_nnz = P->on_proc->nnz + P->off_proc->nnz;
 
     for (int i = 0; i < S->off_proc_num_cols; i++)
@@ -1471,12 +1544,44 @@ ParCSRMatrix* direct_interpolation(ParCSRMatrix* A,
     }
     P->local_row_map = S->get_local_row_map();
 
+    // Count coarse points strongly connected to each fine row 
+    // (and the single entry of each coarse row)
+    CSRBuilder P_on(P->on_proc);
+    CSRBuilder P_off(P->off_proc);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        if (states[i] == 1)
+        {
+            P_on.count(i);
+            continue;
+        }
+        start = S->on_proc->idx1[i];
+        end = S->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            if (states[S->on_proc->idx2[j]] == 1)
+            {
+                P_on.count(i);
+            }
+        }
+        start = S->off_proc->idx1[i];
+        end = S->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            if (off_proc_states[S->off_proc->idx2[j]] == 1)
+            {
+                P_off.count(i);
+            }
+        }
+    }
+    P_on.allocate();
+    P_off.allocate();
+
     for (int i = 0; i < A->local_num_rows; i++)
     {
         if (states[i] == 1)
         {
-            P->on_proc->idx2.emplace_back(on_proc_col_to_new[i]);
-            P->on_proc->vals.emplace_back(1);
+            P_on.add(i, on_proc_col_to_new[i], 1);
         }
         else
         {
@@ -1595,15 +1700,13 @@ ParCSRMatrix* direct_interpolation(ParCSRMatrix* A,
                 if (states[col] == 1)
                 {
                     val = sa_on[j];
-                    P->on_proc->idx2.emplace_back(on_proc_col_to_new[col]);
-                    
                     if (val < 0)
                     {
-                        P->on_proc->vals.emplace_back(neg_coeff * val);
+                        P_on.add(i, on_proc_col_to_new[col], neg_coeff * val);
                     }
                     else
                     {
-                        P->on_proc->vals.emplace_back(pos_coeff * val);
+                        P_on.add(i, on_proc_col_to_new[col], pos_coeff * val);
                     }
                 }
             }
@@ -1616,24 +1719,20 @@ ParCSRMatrix* direct_interpolation(ParCSRMatrix* A,
                 {
                     val = sa_off[j];
                     col_exists[col] = true;
-                    P->off_proc->idx2.emplace_back(col);
-
                     if (val < 0)
                     {
-                        P->off_proc->vals.emplace_back(neg_coeff * val);
+                        P_off.add(i, col, neg_coeff * val);
                     }
                     else
                     {
-                        P->off_proc->vals.emplace_back(pos_coeff * val);
+                        P_off.add(i, col, pos_coeff * val);
                     }
                 }
             }
         }
-        P->on_proc->idx1[i+1] = P->on_proc->idx2.size();
-        P->off_proc->idx1[i+1] = P->off_proc->idx2.size();
     }
-    P->on_proc->nnz = P->on_proc->idx2.size();
-    P->off_proc->nnz = P->off_proc->idx2.size();
+    P_on.finalize();
+    P_off.finalize();
     P->local_nnz = P->on_proc->nnz + P->off_proc->nnz;
     
     for (int i = 0; i < S->off_proc_num_cols; i++)
@@ -30,6 +30,8 @@ TEST(TestParRAP, TestsInRuge_Stuben)
     ParCSRMatrix* AP;
     ParCSCMatrix* P_csc;
     ParCSRMatrix* Ac_rap;
+    ParCSRMatrix* Ac_fused;
+    ParCSRMatrix* AP_chunked;
 
     const char* A0_fn = "../../../../test_data/rss_A0.pm";
     const char* A1_fn = "../../../../test_data/rss_A1.pm";
@@ -45,6 +47,18 @@ TEST(TestParRAP, TestsInRuge_Stuben)
     Ac = AP->mult_T(P_csc);
     Ac_rap = readParMatrix(A1_fn);
     compare(Ac, Ac_rap);
+    Ac_fused = A->rap(P);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
+    for (size_t max_bytes = 1; max_bytes <= 65536; max_bytes *= 256)
+    {
+        AP_chunked = A->mult_chunked(P, max_bytes);
+        compare(AP_chunked, AP);
+        delete AP_chunked;
+        Ac_fused = A->rap_chunked(P, max_bytes);
+        compare(Ac_fused, Ac_rap);
+        delete Ac_fused;
+    }
     delete Ac_rap;
     delete Ac;
     delete P_csc;
@@ -60,6 +74,18 @@ TEST(TestParRAP, TestsInRuge_Stuben)
     Ac = AP->mult_T(P_csc);
     Ac_rap = readParMatrix(A2_fn);
     compare(Ac, Ac_rap);
+    Ac_fused = A->rap(P);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
+    for (size_t max_bytes = 1; max_bytes <= 65536; max_bytes *= 256)
+    {
+        AP_chunked = A->mult_chunked(P, max_bytes);
+        compare(AP_chunked, AP);
+        delete AP_chunked;
+        Ac_fused = A->rap_chunked(P, max_bytes);
+        compare(Ac_fused, Ac_rap);
+        delete Ac_fused;
+    }
     delete Ac_rap;
     delete Ac;
     delete P_csc;
@@ -67,3 +93,38 @@ TEST(TestParRAP, TestsInRuge_Stuben)
     delete P;
     delete A;
 } // end of TEST(TestParRAP, TestsInRuge_Stuben) //
+
+TEST(TestParRAP, TestsChunkedMatchesRAP)
+{ 
+    ParCSRMatrix* A;
+    ParCSRMatrix* P;
+    ParCSRMatrix* Ac_rap;
+    ParCSRMatrix* Ac_chunked;
+
+    const char* A0_fn = "../../../../test_data/rss_A0.pm";
+    const char* P0_fn = "../../../../test_data/rss_P0.pm";
+
+    A = readParMatrix(A0_fn);
+    P = readParMatrix(P0_fn);
+    Ac_rap = A->rap(P);
+
+    // Each row of A*P holds at least as many entries as the row of A,
+    // so budgets below a fraction of the local nnz split the rows 
+    // into at least that many chunks, each kept within the budget
+    size_t local_bytes = A->local_nnz * (sizeof(int) + sizeof(double));
+    size_t peak_bytes;
+    for (int n_chunks = 3; n_chunks <= 12; n_chunks *= 2)
+    {
+        size_t max_bytes = local_bytes / n_chunks;
+        if (max_bytes == 0) max_bytes = 1;
+        Ac_chunked = A->rap_chunked(P, max_bytes, false, NULL, NULL, NULL,
+                &peak_bytes);
+        compare(Ac_chunked, Ac_rap);
+        ASSERT_LE(peak_bytes, max_bytes);
+        delete Ac_chunked;
+    }
+
+    delete Ac_rap;
+    delete P;
+    delete A;
+} // end of TEST(TestParRAP, TestsChunkedMatchesRAP) //
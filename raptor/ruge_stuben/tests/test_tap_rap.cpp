@@ -32,6 +32,7 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     ParCSRMatrix* AP;
     ParCSCMatrix* P_csc;
     ParCSRMatrix* Ac_rap;
+    ParCSRMatrix* Ac_fused;
 
     const char* A0_fn = "../../../../test_data/rss_A0.pm";
     const char* A1_fn = "../../../../test_data/rss_A1.pm";
@@ -49,6 +50,12 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     Ac = AP->tap_mult_T(P_csc);
     Ac_rap = readParMatrix(A1_fn);
     compare(Ac, Ac_rap);
+    Ac_fused = A->rap(P, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
+    Ac_fused = A->rap_chunked(P, 4096, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
     delete Ac_rap;
     delete Ac;
     delete AP;
@@ -60,6 +67,12 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     Ac = AP->tap_mult_T(P_csc);
     Ac_rap = readParMatrix(A1_fn);
     compare(Ac, Ac_rap);
+    Ac_fused = A->rap(P, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
+    Ac_fused = A->rap_chunked(P, 4096, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
     delete Ac_rap;
     delete Ac;
     delete AP;
@@ -78,6 +91,12 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     Ac = AP->tap_mult_T(P_csc);
     Ac_rap = readParMatrix(A2_fn);
     compare(Ac, Ac_rap);
+    Ac_fused = A->rap(P, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
+    Ac_fused = A->rap_chunked(P, 4096, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
     delete Ac_rap;
     delete Ac;
     delete AP;
@@ -89,6 +108,12 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     Ac = AP->tap_mult_T(P_csc);
     Ac_rap = readParMatrix(A2_fn);
     compare(Ac, Ac_rap);
+    Ac_fused = A->rap(P, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
+    Ac_fused = A->rap_chunked(P, 4096, true);
+    compare(Ac_fused, Ac_rap);
+    delete Ac_fused;
     delete Ac_rap;
     delete Ac;
     delete AP;
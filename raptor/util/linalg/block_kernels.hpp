@@ -0,0 +1,234 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_UTIL_LINALG_BLOCK_KERNELS_HPP
+#define RAPTOR_UTIL_LINALG_BLOCK_KERNELS_HPP
+
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+
+/**************************************************************
+ *****   Block Kernels
+ **************************************************************
+ ***** BSR SpMV and block-block multiply kernels with the block
+ ***** dimensions as template parameters, so the loops over each
+ ***** block are fully unrolled and vectorized by the compiler.
+ ***** Blocks are stored row-wise in contiguous BlockArray storage.
+ *****
+ ***** Square blocks of size 2, 3, 4, and 6 are dispatched to the
+ ***** fixed size kernels.  All other block sizes fall back to
+ ***** loops over b_rows and b_cols at runtime.
+ **************************************************************/
+namespace raptor
+{
+    // b += scale * A * x
+    template <int BR, int BC>
+    void bsr_append_fixed(const CSRMatrix* A, const BlockArray& vals,
+            const double* x, double* b, const double scale)
+    {
+        double sum[BR];
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            for (int r = 0; r < BR; r++)
+            {
+                sum[r] = 0.0;
+            }
+
+            int start = A->idx1[i];
+            int end = A->idx1[i+1];
+            for (int j = start; j < end; j++)
+            {
+                const double* block = vals[j];
+                const double* x_j = &x[A->idx2[j] * BC];
+                for (int r = 0; r < BR; r++)
+                {
+                    for (int c = 0; c < BC; c++)
+                    {
+                        sum[r] += block[r*BC + c] * x_j[c];
+                    }
+                }
+            }
+
+            double* b_i = &b[i * BR];
+            for (int r = 0; r < BR; r++)
+            {
+                b_i[r] += scale * sum[r];
+            }
+        }
+    }
+
+    // b += scale * A^T * x
+    template <int BR, int BC>
+    void bsr_append_T_fixed(const CSRMatrix* A, const BlockArray& vals,
+            const double* x, double* b, const double scale)
+    {
+        double x_i[BR];
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            for (int r = 0; r < BR; r++)
+            {
+                x_i[r] = scale * x[i*BR + r];
+            }
+
+            int start = A->idx1[i];
+            int end = A->idx1[i+1];
+            for (int j = start; j < end; j++)
+            {
+                const double* block = vals[j];
+                double* b_j = &b[A->idx2[j] * BC];
+                for (int r = 0; r < BR; r++)
+                {
+                    for (int c = 0; c < BC; c++)
+                    {
+                        b_j[c] += block[r*BC + c] * x_i[r];
+                    }
+                }
+            }
+        }
+    }
+
+    inline void bsr_append_var(const CSRMatrix* A, const BlockArray& vals,
+            const double* x, double* b, const double scale)
+    {
+        int b_rows = A->b_rows;
+        int b_cols = A->b_cols;
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            int start = A->idx1[i];
+            int end = A->idx1[i+1];
+            double* b_i = &b[i * b_rows];
+            for (int r = 0; r < b_rows; r++)
+            {
+                double sum = 0.0;
+                for (int j = start; j < end; j++)
+                {
+                    const double* block = vals[j];
+                    const double* x_j = &x[A->idx2[j] * b_cols];
+                    for (int c = 0; c < b_cols; c++)
+                    {
+                        sum += block[r*b_cols + c] * x_j[c];
+                    }
+                }
+                b_i[r] += scale * sum;
+            }
+        }
+    }
+
+    inline void bsr_append_T_var(const CSRMatrix* A, const BlockArray& vals,
+            const double* x, double* b, const double scale)
+    {
+        int b_rows = A->b_rows;
+        int b_cols = A->b_cols;
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            int start = A->idx1[i];
+            int end = A->idx1[i+1];
+            const double* x_i = &x[i * b_rows];
+            for (int j = start; j < end; j++)
+            {
+                const double* block = vals[j];
+                double* b_j = &b[A->idx2[j] * b_cols];
+                for (int r = 0; r < b_rows; r++)
+                {
+                    double x_val = scale * x_i[r];
+                    for (int c = 0; c < b_cols; c++)
+                    {
+                        b_j[c] += block[r*b_cols + c] * x_val;
+                    }
+                }
+            }
+        }
+    }
+
+    inline void bsr_append(const CSRMatrix* A, const BlockArray& vals,
+            const double* x, double* b, const double scale)
+    {
+        if (A->b_rows == A->b_cols)
+        {
+            switch (A->b_rows)
+            {
+                case 2: bsr_append_fixed<2, 2>(A, vals, x, b, scale); return;
+                case 3: bsr_append_fixed<3, 3>(A, vals, x, b, scale); return;
+                case 4: bsr_append_fixed<4, 4>(A, vals, x, b, scale); return;
+                case 6: bsr_append_fixed<6, 6>(A, vals, x, b, scale); return;
+            }
+        }
+        bsr_append_var(A, vals, x, b, scale);
+    }
+
+    inline void bsr_append_T(const CSRMatrix* A, const BlockArray& vals,
+            const double* x, double* b, const double scale)
+    {
+        if (A->b_rows == A->b_cols)
+        {
+            switch (A->b_rows)
+            {
+                case 2: bsr_append_T_fixed<2, 2>(A, vals, x, b, scale); return;
+                case 3: bsr_append_T_fixed<3, 3>(A, vals, x, b, scale); return;
+                case 4: bsr_append_T_fixed<4, 4>(A, vals, x, b, scale); return;
+                case 6: bsr_append_T_fixed<6, 6>(A, vals, x, b, scale); return;
+            }
+        }
+        bsr_append_T_var(A, vals, x, b, scale);
+    }
+
+    // Value products used by SpGEMM : sum += val * addl_val (mult)
+    // or sum += val^T * addl_val (mult_T).  ValMult handles scalars
+    // and blocks of any size through Matrix::mult_vals.
+    struct ValMult
+    {
+        template <typename T, typename U>
+        static void mult(const Matrix* A, const T& val, const U& addl_val,
+                double* sum, int n_rows, int n_cols, int n_inner)
+        {
+            A->mult_vals(val, addl_val, sum, n_rows, n_cols, n_inner);
+        }
+
+        template <typename T, typename U>
+        static void mult_T(const Matrix* A, const T& val, const U& addl_val,
+                double* sum, int n_rows, int n_cols, int n_inner)
+        {
+            A->mult_T_vals(val, addl_val, sum, n_rows, n_cols, n_inner);
+        }
+    };
+
+    // Fixed size N x N blocks
+    template <int N>
+    struct FixedBlockMult
+    {
+        static void mult(const Matrix* /*A*/, const double* val, 
+                const double* addl_val, double* sum, int /*n_rows*/, 
+                int /*n_cols*/, int /*n_inner*/)
+        {
+            for (int i = 0; i < N; i++)
+            {
+                for (int k = 0; k < N; k++)
+                {
+                    double a = val[i*N + k];
+                    for (int j = 0; j < N; j++)
+                    {
+                        sum[i*N + j] += a * addl_val[k*N + j];
+                    }
+                }
+            }
+        }
+
+        static void mult_T(const Matrix* /*A*/, const double* val, 
+                const double* addl_val, double* sum, int /*n_rows*/, 
+                int /*n_cols*/, int /*n_inner*/)
+        {
+            for (int k = 0; k < N; k++)
+            {
+                for (int i = 0; i < N; i++)
+                {
+                    double a = val[k*N + i];
+                    for (int j = 0; j < N; j++)
+                    {
+                        sum[i*N + j] += a * addl_val[k*N + j];
+                    }
+                }
+            }
+        }
+    };
+}
+
+#endif
@@ -1,15 +1,17 @@
 #include "core/matrix.hpp"
+#include "core/csr_builder.hpp"
+#include "util/linalg/block_kernels.hpp"
 
 using namespace raptor;
 aligned_vector<double>& form_new(const CSRMatrix* A, const CSRMatrix* B, 
-        CSRMatrix** C_ptr, aligned_vector<double>& A_vals)
+        CSRMatrix** C_ptr, aligned_vector<double>& /*A_vals*/)
 {
     CSRMatrix* C = new CSRMatrix(A->n_rows, B->n_cols);
     *C_ptr = C;
     return C->vals;
 }
-aligned_vector<double*>& form_new(const CSRMatrix* A, const CSRMatrix* B, 
-        CSRMatrix** C_ptr, aligned_vector<double*>& A_vals)
+BlockArray& form_new(const CSRMatrix* A, const CSRMatrix* B, 
+        CSRMatrix** C_ptr, BlockArray& /*A_vals*/)
 {
     BSRMatrix* C = new BSRMatrix(A->n_rows, B->n_cols, 
             A->b_rows, B->b_cols);
@@ -17,14 +19,14 @@ aligned_vector<double*>& form_new(const CSRMatrix* A, const CSRMatrix* B,
     return C->block_vals;
 }
 aligned_vector<double>& form_new(const CSCMatrix* A, const CSRMatrix* B,
-        CSRMatrix** C_ptr, aligned_vector<double>& A_vals)
+        CSRMatrix** C_ptr, aligned_vector<double>& /*A_vals*/)
 {
     CSRMatrix* C = new CSRMatrix(A->n_cols, B->n_cols);
     *C_ptr = C;
     return C->vals;
 }
-aligned_vector<double*>& form_new(const CSCMatrix* A, const CSRMatrix* B,
-        CSRMatrix** C_ptr, aligned_vector<double*>& A_vals)
+BlockArray& form_new(const CSCMatrix* A, const CSRMatrix* B,
+        CSRMatrix** C_ptr, BlockArray& /*A_vals*/)
 {
     BSRMatrix* C = new BSRMatrix(A->n_cols, B->n_cols,
             A->b_cols, B->b_cols);
@@ -36,52 +38,60 @@ void init_sums(aligned_vector<double>& sums, int size, int b_size)
 {
     sums.resize(size, 0);
 }
-void init_sums(aligned_vector<double*>& sums, int size, int b_size)
+void init_sums(BlockArray& sums, int size, int b_size)
 {
-    for (int i = 0; i < size; i++)
-    {
-        sums.emplace_back(new double[b_size]);
-        for (int j = 0; j < b_size; j++)
-            sums[i][j] = 0.0;
-    }
+    sums.set_block_size(b_size);
+    sums.resize(size);
 }
 
 void zero_sum(double* sum, int b_size)
 {
-    *sum = 0;
-}
-void zero_sum(double** sum, int b_size)
-{
-    (*sum) = new double[b_size];
     for (int i = 0; i < b_size; i++)
-        (*sum)[i] = 0;
+        sum[i] = 0;
 }
 
-void finalize_sums(aligned_vector<double>& sums)
+// Count the distinct columns of B reached from each row of A 
+// (rows of A given by idx1 and idx2), an upper bound on the 
+// nonzeros of each row of C = A*B
+void count_products(int n_rows, const int* A_idx1, const int* A_idx2,
+        const CSRMatrix* B, CSRBuilder& builder)
 {
-    return;
-}
-void finalize_sums(aligned_vector<double*>& sums)
-{
-    for (aligned_vector<double*>::iterator it = sums.begin();
-            it != sums.end(); ++it)
-        delete[] *it;
+    aligned_vector<int> marker(B->n_cols, -1);
+    for (int i = 0; i < n_rows; i++)
+    {
+        int count = 0;
+        for (int j = A_idx1[i]; j < A_idx1[i+1]; j++)
+        {
+            int col_A = A_idx2[j];
+            for (int k = B->idx1[col_A]; k < B->idx1[col_A+1]; k++)
+            {
+                int col_B = B->idx2[k];
+                if (marker[col_B] != i)
+                {
+                    marker[col_B] = i;
+                    count++;
+                }
+            }
+        }
+        builder.count(i, count);
+    }
 }
 
-template <typename T>
+template <typename T, typename Mult = ValMult>
 CSRMatrix* spgemm_helper(const CSRMatrix* A, const CSRMatrix* B, 
-        aligned_vector<T>& A_vals, aligned_vector<T>& B_vals,
+        T& A_vals, T& B_vals,
         int* B_to_C = NULL)
 {
     aligned_vector<int> next(B->n_cols, -1);
-    aligned_vector<T> sums;
-    init_sums(sums, B->n_cols, B->b_size);
+    T sums;
+    init_sums(sums, B->n_cols, A->b_rows * B->b_cols);
 
     CSRMatrix* C = NULL;
-    aligned_vector<T>& C_vals = form_new(A, B, &C, A_vals);
-    C->reserve_size(1.5*A->nnz);
+    T& C_vals = form_new(A, B, &C, A_vals);
+    CSRBuilder builder(C, C_vals);
+    count_products(A->n_rows, A->idx1.data(), A->idx2.data(), B, builder);
+    builder.allocate();
 
-    C->idx1[0] = 0;
     for (int i = 0; i < A->n_rows; i++)
     {
         int head = -2;
@@ -91,13 +101,13 @@ CSRMatrix* spgemm_helper(const CSRMatrix* A, const CSRMatrix* B,
         for (int j = row_start_A; j < row_end_A; j++)
         {
             int col_A = A->idx2[j];
-            T val_A = A_vals[j];
+            auto val_A = A_vals[j];
             int row_start_B = B->idx1[col_A];
             int row_end_B = B->idx1[col_A+1];
             for (int k = row_start_B; k < row_end_B; k++)
             {
                 int col_B = B->idx2[k];
-                A->mult_vals(val_A, B_vals[k], &sums[col_B],
+                Mult::mult(A, val_A, B_vals[k], val_ptr(sums, col_B),
                         A->b_rows, B->b_cols, A->b_cols);
                 if (next[col_B] == -1)
                 {
@@ -109,47 +119,44 @@ CSRMatrix* spgemm_helper(const CSRMatrix* A, const CSRMatrix* B,
         }
         for (int j = 0; j < length; j++)
         {
-            double val = A->abs_val(sums[head]);
+            double val = C->abs_val(sums[head]);
             if (val > zero_tol)
             {
                 if (B_to_C) 
                 {
-                    C->idx2.emplace_back(B_to_C[head]);
+                    builder.add(i, B_to_C[head], sums[head]);
                 }
                 else
                 {
-                    C->idx2.emplace_back(head);
+                    builder.add(i, head, sums[head]);
                 }
-                C_vals.emplace_back(sums[head]);
             }
             int tmp = head;
             head = next[head];
             next[tmp] = -1;
-            zero_sum(&sums[tmp], A->b_size);
+            zero_sum(val_ptr(sums, tmp), C->b_size);
         }
-        C->idx1[i+1] = C->idx2.size();
     }
-    C->nnz = C->idx2.size();
-
-    finalize_sums(sums);
+    builder.finalize();
 
     return C;
 }
 
-template <typename T>
+template <typename T, typename Mult = ValMult>
 CSRMatrix* spgemm_T_helper(const CSCMatrix* A, const CSRMatrix* B,
-        aligned_vector<T>& A_vals, aligned_vector<T>& B_vals,
+        T& A_vals, T& B_vals,
         int* C_map = NULL)
 {
     CSRMatrix* C;
-    aligned_vector<T>& C_vals = form_new(A, B, &C, A_vals);
-    C->reserve_size(1.5*B->nnz);
+    T& C_vals = form_new(A, B, &C, A_vals);
+    CSRBuilder builder(C, C_vals);
+    count_products(A->n_cols, A->idx1.data(), A->idx2.data(), B, builder);
+    builder.allocate();
 
     aligned_vector<int> next(B->n_cols, -1); 
-    aligned_vector<T> sums;
-    init_sums(sums, B->n_cols, A->b_size);
+    T sums;
+    init_sums(sums, B->n_cols, A->b_cols * B->b_cols);
 
-    C->idx1[0] = 0;
     for (int i = 0; i < A->n_cols; i++)
     {
         int head = -2;
@@ -159,13 +166,13 @@ CSRMatrix* spgemm_T_helper(const CSCMatrix* A, const CSRMatrix* B,
         for (int j = row_start_AT; j < row_end_AT; j++)
         {
             int col_AT = A->idx2[j];
-            T val_AT = A_vals[j];
+            auto val_AT = A_vals[j];
             int row_start = B->idx1[col_AT];
             int row_end = B->idx1[col_AT+1];
             for (int k = row_start; k < row_end; k++)
             {
                 int col = B->idx2[k];
-                A->mult_T_vals(val_AT, B_vals[k], &sums[col],
+                Mult::mult_T(A, val_AT, B_vals[k], val_ptr(sums, col),
                         A->b_cols, B->b_cols, A->b_rows);
                 if (next[col] == -1)
                 {
@@ -177,32 +184,234 @@ CSRMatrix* spgemm_T_helper(const CSCMatrix* A, const CSRMatrix* B,
         }
         for (int j = 0; j < length; j++)
         {
-            if (A->abs_val(sums[head]) > zero_tol)
+            if (C->abs_val(sums[head]) > zero_tol)
             {
                 if (C_map)
                 {
-                    C->idx2.emplace_back(C_map[head]);
+                    builder.add(i, C_map[head], sums[head]);
                 }
                 else
                 {
-                    C->idx2.emplace_back(head);
+                    builder.add(i, head, sums[head]);
                 }
-                C_vals.emplace_back(sums[head]);
             }
             int tmp = head;
             head = next[head];
             next[tmp] = -1;
-            zero_sum(&sums[tmp], A->b_size);
+            zero_sum(val_ptr(sums, tmp), C->b_size);
         }
-        C->idx1[i+1] = C->idx2.size();
     }
-    C->nnz = C->idx2.size();
+    builder.finalize();
 
-    finalize_sums(sums);
+    return C;
+}
 
+/**************************************************************
+*****   Hash SpGEMM
+**************************************************************
+***** Scalar SpGEMM C = A * B, with rows of A given by idx1, 
+***** idx2, and vals (the columns of a CSCMatrix give A^T).
+***** Rows are split among threads by their number of products,
+***** which also bounds the nonzeros of each row.  Each thread 
+***** accumulates its rows in an open addressing hash table sized
+***** by its largest row bound (not the number of columns of B, 
+***** which is the global size for off_proc matrices), writing 
+***** rows to a local buffer with columns sorted.  C is allocated
+***** once, from a prefix sum of the row sizes.
+*****
+***** Parameters
+***** -------------
+***** n_rows : int
+*****    Number of rows of C
+***** A_idx1, A_idx2, A_vals : const int*, const int*, const double*
+*****    Rows of A
+***** B : const CSRMatrix*
+*****    Matrix to multiply
+***** B_vals : const double*
+*****    Values of B
+***** B_to_C : const int*
+*****    Maps columns of B to columns of C (NULL for none)
+***** C : CSRMatrix*
+*****    Returns the product
+**************************************************************/
+void hash_spgemm(int n_rows, const int* A_idx1, const int* A_idx2, 
+        const double* A_vals, const CSRMatrix* B, const double* B_vals,
+        const int* B_to_C, CSRMatrix* C)
+{
+    // Bound on the nonzeros of each row of C
+    aligned_vector<int> row_bound(n_rows + 1);
+    row_bound[0] = 0;
+    for (int i = 0; i < n_rows; i++)
+    {
+        int bound = 0;
+        for (int j = A_idx1[i]; j < A_idx1[i+1]; j++)
+        {
+            bound += B->idx1[A_idx2[j]+1] - B->idx1[A_idx2[j]];
+        }
+        row_bound[i+1] = row_bound[i] + std::min(bound, B->n_cols);
+    }
+
+    C->idx1.resize(n_rows + 1);
+    C->idx1[0] = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel if (row_bound[n_rows] >= omp_min_work)
+#endif
+    {
+        int first, last;
+        thread_rows(row_bound.data(), n_rows, first, last);
+
+        int max_row = 0;
+        for (int i = first; i < last; i++)
+        {
+            max_row = std::max(max_row, row_bound[i+1] - row_bound[i]);
+        }
+        int size = 1;
+        while (size < 2 * max_row) size <<= 1;
+        uint32_t mask = size - 1;
+
+        aligned_vector<int> keys(size, -1);
+        aligned_vector<double> sums(size);
+        aligned_vector<uint32_t> used;
+        aligned_vector<int> local_idx2;
+        aligned_vector<double> local_vals;
+        used.reserve(max_row);
+        local_idx2.reserve(row_bound[last] - row_bound[first]);
+        local_vals.reserve(row_bound[last] - row_bound[first]);
+
+        for (int i = first; i < last; i++)
+        {
+            used.clear();
+            for (int j = A_idx1[i]; j < A_idx1[i+1]; j++)
+            {
+                int col_A = A_idx2[j];
+                double val_A = A_vals[j];
+                for (int k = B->idx1[col_A]; k < B->idx1[col_A+1]; k++)
+                {
+                    int col = B->idx2[k];
+                    uint32_t h = ((uint32_t) col * 2654435761u) & mask;
+                    while (keys[h] != col && keys[h] != -1)
+                    {
+                        h = (h + 1) & mask;
+                    }
+                    if (keys[h] == -1)
+                    {
+                        keys[h] = col;
+                        sums[h] = 0.0;
+                        used.emplace_back(h);
+                    }
+                    sums[h] += val_A * B_vals[k];
+                }
+            }
+
+            std::sort(used.begin(), used.end(), 
+                    [&](const uint32_t a, const uint32_t b)
+                    {
+                        return keys[a] < keys[b];
+                    });
+            int row_size = 0;
+            for (aligned_vector<uint32_t>::iterator it = used.begin(); 
+                    it != used.end(); ++it)
+            {
+                if (fabs(sums[*it]) > zero_tol)
+                {
+                    local_idx2.emplace_back(B_to_C ? B_to_C[keys[*it]] : keys[*it]);
+                    local_vals.emplace_back(sums[*it]);
+                    row_size++;
+                }
+                keys[*it] = -1;
+            }
+            C->idx1[i+1] = row_size;
+        }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            for (int i = 0; i < n_rows; i++)
+            {
+                C->idx1[i+1] += C->idx1[i];
+            }
+            C->nnz = C->idx1[n_rows];
+            C->idx2.resize(C->nnz);
+            C->vals.resize(C->nnz);
+        }
+
+        std::copy(local_idx2.begin(), local_idx2.end(), 
+                C->idx2.begin() + C->idx1[first]);
+        std::copy(local_vals.begin(), local_vals.end(), 
+                C->vals.begin() + C->idx1[first]);
+    }
+
+    C->sorted = (B_to_C == NULL);
+}
+
+// Scalar products use the threaded hash SpGEMM
+CSRMatrix* spgemm_helper(const CSRMatrix* A, const CSRMatrix* B, 
+        aligned_vector<double>& A_vals, aligned_vector<double>& B_vals,
+        int* B_to_C = NULL)
+{
+    CSRMatrix* C = new CSRMatrix(A->n_rows, B->n_cols);
+    hash_spgemm(A->n_rows, A->idx1.data(), A->idx2.data(), A_vals.data(),
+            B, B_vals.data(), B_to_C, C);
     return C;
 }
 
+CSRMatrix* spgemm_T_helper(const CSCMatrix* A, const CSRMatrix* B,
+        aligned_vector<double>& A_vals, aligned_vector<double>& B_vals,
+        int* C_map = NULL)
+{
+    CSRMatrix* C = new CSRMatrix(A->n_cols, B->n_cols);
+    hash_spgemm(A->n_cols, A->idx1.data(), A->idx2.data(), A_vals.data(),
+            B, B_vals.data(), C_map, C);
+    return C;
+}
+
+// Dispatch block products to fixed size kernels when A and B
+// share a square block size of 2, 3, 4, or 6
+CSRMatrix* block_spgemm_helper(const CSRMatrix* A, const CSRMatrix* B,
+        BlockArray& A_vals, BlockArray& B_vals, int* B_to_C = NULL)
+{
+    if (A->b_rows == A->b_cols && B->b_rows == B->b_cols 
+            && A->b_cols == B->b_rows)
+    {
+        switch (A->b_rows)
+        {
+            case 2: return spgemm_helper<BlockArray, FixedBlockMult<2> >(A, B, 
+                            A_vals, B_vals, B_to_C);
+            case 3: return spgemm_helper<BlockArray, FixedBlockMult<3> >(A, B, 
+                            A_vals, B_vals, B_to_C);
+            case 4: return spgemm_helper<BlockArray, FixedBlockMult<4> >(A, B, 
+                            A_vals, B_vals, B_to_C);
+            case 6: return spgemm_helper<BlockArray, FixedBlockMult<6> >(A, B, 
+                            A_vals, B_vals, B_to_C);
+        }
+    }
+    return spgemm_helper(A, B, A_vals, B_vals, B_to_C);
+}
+
+CSRMatrix* block_spgemm_T_helper(const CSCMatrix* A, const CSRMatrix* B,
+        BlockArray& A_vals, BlockArray& B_vals, int* C_map = NULL)
+{
+    if (A->b_rows == A->b_cols && B->b_rows == B->b_cols 
+            && A->b_rows == B->b_rows)
+    {
+        switch (A->b_rows)
+        {
+            case 2: return spgemm_T_helper<BlockArray, FixedBlockMult<2> >(A, B, 
+                            A_vals, B_vals, C_map);
+            case 3: return spgemm_T_helper<BlockArray, FixedBlockMult<3> >(A, B, 
+                            A_vals, B_vals, C_map);
+            case 4: return spgemm_T_helper<BlockArray, FixedBlockMult<4> >(A, B, 
+                            A_vals, B_vals, C_map);
+            case 6: return spgemm_T_helper<BlockArray, FixedBlockMult<6> >(A, B, 
+                            A_vals, B_vals, C_map);
+        }
+    }
+    return spgemm_T_helper(A, B, A_vals, B_vals, C_map);
+}
+
 
 CSRMatrix* Matrix::mult(CSRMatrix* B, int* B_to_C)
 {
@@ -249,7 +458,7 @@ CSRMatrix* CSRMatrix::spgemm(CSRMatrix* B, int* B_to_C)
 BSRMatrix* BSRMatrix::spgemm(CSRMatrix* B, int* B_to_C)
 {
     BSRMatrix* B_bsr = (BSRMatrix*) B;
-    return (BSRMatrix*) spgemm_helper(this, B_bsr, block_vals, 
+    return (BSRMatrix*) block_spgemm_helper(this, B_bsr, block_vals, 
             B_bsr->block_vals, B_to_C);
 }
 CSRMatrix* COOMatrix::spgemm(CSRMatrix* B, int* B_to_C)
@@ -264,7 +473,7 @@ BSRMatrix* BCOOMatrix::spgemm(CSRMatrix* B, int* B_to_C)
 {
     BSRMatrix* A_bsr = (BSRMatrix*) to_CSR();
     BSRMatrix* B_bsr = (BSRMatrix*) B;
-    BSRMatrix* C = (BSRMatrix*) spgemm_helper(A_bsr, B_bsr, 
+    BSRMatrix* C = (BSRMatrix*) block_spgemm_helper(A_bsr, B_bsr, 
             A_bsr->block_vals, B_bsr->block_vals, B_to_C);
     delete A_bsr;
     return C;
@@ -281,11 +490,19 @@ BSRMatrix* BSCMatrix::spgemm(CSRMatrix* B, int* B_to_C)
 {
     BSRMatrix* A_bsr = (BSRMatrix*) to_CSR();
     BSRMatrix* B_bsr = (BSRMatrix*) B;
-    BSRMatrix* C = (BSRMatrix*) spgemm_helper(A_bsr, B_bsr, 
+    BSRMatrix* C = (BSRMatrix*) block_spgemm_helper(A_bsr, B_bsr, 
             A_bsr->block_vals, B_bsr->block_vals, B_to_C);
     delete A_bsr;
     return C;
 }
+CSRMatrix* SolveMatrix::spgemm(CSRMatrix* B, int* B_to_C)
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSRMatrix* C = spgemm_helper(A_csr, B, A_csr->vals, B->vals,
+            B_to_C);
+    delete A_csr;
+    return C;
+}
 
 
 CSRMatrix* CSRMatrix::spgemm_T(CSCMatrix* A, int* C_map)
@@ -295,7 +512,7 @@ CSRMatrix* CSRMatrix::spgemm_T(CSCMatrix* A, int* C_map)
 BSRMatrix* BSRMatrix::spgemm_T(CSCMatrix* A, int* C_map)
 {
     BSCMatrix* A_bsc = (BSCMatrix*) A;
-    return (BSRMatrix*) spgemm_T_helper(A_bsc, this, 
+    return (BSRMatrix*) block_spgemm_T_helper(A_bsc, this, 
             A_bsc->block_vals, block_vals, C_map);
 }
 CSRMatrix* COOMatrix::spgemm_T(CSCMatrix* A, int* C_map)
@@ -310,7 +527,7 @@ BSRMatrix* BCOOMatrix::spgemm_T(CSCMatrix* A, int* C_map)
 {
     BSCMatrix* A_bsc = (BSCMatrix*) A;
     BSRMatrix* B_bsr = (BSRMatrix*) to_CSR();
-    BSRMatrix* C = (BSRMatrix*) spgemm_T_helper(A_bsc, B_bsr, 
+    BSRMatrix* C = (BSRMatrix*) block_spgemm_T_helper(A_bsc, B_bsr, 
             A_bsc->block_vals, B_bsr->block_vals, C_map);
     delete B_bsr;
     return C;
@@ -327,8 +544,173 @@ BSRMatrix* BSCMatrix::spgemm_T(CSCMatrix* A, int* C_map)
 {
     BSCMatrix* A_bsc = (BSCMatrix*) A;
     BSRMatrix* B_bsr = (BSRMatrix*) to_CSR();
-    BSRMatrix* C = (BSRMatrix*) spgemm_T_helper(A_bsc, B_bsr, 
+    BSRMatrix* C = (BSRMatrix*) block_spgemm_T_helper(A_bsc, B_bsr, 
             A_bsc->block_vals, B_bsr->block_vals, C_map);
     delete B_bsr;
     return C;
 }
+CSRMatrix* SolveMatrix::spgemm_T(CSCMatrix* A, int* C_map)
+{
+    CSRMatrix* B_csr = to_CSR();
+    CSRMatrix* C = spgemm_T_helper(A, B_csr, A->vals, 
+            B_csr->vals, C_map);
+    delete B_csr;
+    return C;
+}
+
+/**************************************************************
+*****   SpGEMMPlan Symbolic
+**************************************************************
+***** Forms the pattern of C = sum_t A_t * B_t, marking the 
+***** columns reached by each row of C
+*****
+***** Parameters
+***** -------------
+***** _n_rows : int
+*****    Number of rows of C (columns of A_t if A_t is CSC)
+***** _n_cols : int
+*****    Number of columns of C
+***** terms : const std::vector<Term>&
+*****    Products (or added matrices) summed to form C
+**************************************************************/
+void SpGEMMPlan::symbolic(int _n_rows, int _n_cols, const std::vector<Term>& terms)
+{
+    n_rows = _n_rows;
+    n_cols = _n_cols;
+    idx1.resize(n_rows + 1);
+    idx2.clear();
+
+    aligned_vector<int> marker(n_cols, -1);
+    idx1[0] = 0;
+    for (int i = 0; i < n_rows; i++)
+    {
+        int row_start_C = idx2.size();
+        for (std::vector<Term>::const_iterator t = terms.begin(); t != terms.end(); ++t)
+        {
+            const Matrix* A = t->A;
+            const Matrix* B = t->B;
+            int row_start_A = A ? A->idx1[i] : i;
+            int row_end_A = A ? A->idx1[i+1] : i + 1;
+            for (int j = row_start_A; j < row_end_A; j++)
+            {
+                int row_B = A ? A->idx2[j] : j;
+                for (int k = B->idx1[row_B]; k < B->idx1[row_B+1]; k++)
+                {
+                    int col = t->B_to_C ? t->B_to_C[B->idx2[k]] : B->idx2[k];
+                    if (marker[col] != i)
+                    {
+                        marker[col] = i;
+                        idx2.emplace_back(col);
+                    }
+                }
+            }
+        }
+        std::sort(idx2.begin() + row_start_C, idx2.end());
+        idx1[i+1] = idx2.size();
+    }
+}
+
+/**************************************************************
+*****   SpGEMMPlan Numeric
+**************************************************************
+***** Computes the values of C = sum_t A_t * B_t in the planned
+***** pattern.  The matrices must have the patterns of those 
+***** passed to symbolic.  Rows are split among threads, each
+***** using column positions stored in the plan, so a plan must
+***** not be applied by two callers at once.
+*****
+***** Parameters
+***** -------------
+***** terms : const std::vector<Term>&
+*****    Products (or added matrices) summed to form C
+***** vals : double*
+*****    Returns the nnz() values of C
+**************************************************************/
+void SpGEMMPlan::numeric(const std::vector<Term>& terms, double* vals) const
+{
+    if ((int) pos.size() < num_threads()) pos.resize(num_threads());
+
+#ifdef _OPENMP
+#pragma omp parallel if (nnz() >= omp_min_work)
+#endif
+    {
+        int first, last;
+        thread_rows(idx1.data(), n_rows, first, last);
+
+        // Position in vals of each column of the current row
+        aligned_vector<int>& row_pos = pos[thread_num()];
+        if ((int) row_pos.size() < n_cols) row_pos.resize(n_cols);
+        for (int i = first; i < last; i++)
+        {
+            for (int k = idx1[i]; k < idx1[i+1]; k++)
+            {
+                row_pos[idx2[k]] = k;
+                vals[k] = 0.0;
+            }
+
+            for (std::vector<Term>::const_iterator t = terms.begin(); t != terms.end(); ++t)
+            {
+                const Matrix* A = t->A;
+                const Matrix* B = t->B;
+                const int* B_to_C = t->B_to_C;
+                int row_start_A = A ? A->idx1[i] : i;
+                int row_end_A = A ? A->idx1[i+1] : i + 1;
+                for (int j = row_start_A; j < row_end_A; j++)
+                {
+                    double val_A = A ? A->vals[j] : 1.0;
+                    int row_B = A ? A->idx2[j] : j;
+                    for (int k = B->idx1[row_B]; k < B->idx1[row_B+1]; k++)
+                    {
+                        int col = B_to_C ? B_to_C[B->idx2[k]] : B->idx2[k];
+                        vals[row_pos[col]] += val_A * B->vals[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+SpGEMMPlan* CSRMatrix::spgemm_symbolic(CSRMatrix* B, int* B_to_C)
+{
+    SpGEMMPlan* plan = new SpGEMMPlan();
+    int n_cols = B->n_cols;
+    if (B_to_C)
+    {
+        plan->col_map.assign(B_to_C, B_to_C + B->n_cols);
+        n_cols = 0;
+        for (int i = 0; i < B->n_cols; i++)
+        {
+            if (B_to_C[i] >= n_cols) n_cols = B_to_C[i] + 1;
+        }
+    }
+
+    std::vector<SpGEMMPlan::Term> terms(1);
+    terms[0].A = this;
+    terms[0].B = B;
+    terms[0].B_to_C = B_to_C;
+    plan->symbolic(n_rows, n_cols, terms);
+
+    return plan;
+}
+
+// C keeps its pattern if formed by an earlier call with this plan
+void CSRMatrix::spgemm_numeric(CSRMatrix* B, SpGEMMPlan* plan, CSRMatrix* C)
+{
+    if (C->n_rows != plan->n_rows || C->nnz != plan->nnz())
+    {
+        C->n_rows = plan->n_rows;
+        C->n_cols = plan->n_cols;
+        C->nnz = plan->nnz();
+        C->idx1 = plan->idx1;
+        C->idx2 = plan->idx2;
+        C->vals.resize(C->nnz);
+        C->sorted = true;
+        C->diag_first = false;
+    }
+
+    std::vector<SpGEMMPlan::Term> terms(1);
+    terms[0].A = this;
+    terms[0].B = B;
+    terms[0].B_to_C = plan->col_map.size() ? plan->col_map.data() : NULL;
+    plan->numeric(terms, C->vals.data());
+}
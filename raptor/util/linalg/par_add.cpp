@@ -1,7 +1,9 @@
 // Copyright (c) 2015-2017, RAPtor Developer Team
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 #include "assert.h"
+#include <limits.h>
 #include "core/par_matrix.hpp"
+#include "core/csr_builder.hpp"
 
 using namespace raptor;
 
@@ -15,191 +17,196 @@ ParMatrix* ParMatrix::subtract(ParCSRMatrix* B)
     return NULL;
 }
 
-ParCSRMatrix* ParCSRMatrix::add(ParCSRMatrix* B)
+/**************************************************************
+*****   Merge Rows
+**************************************************************
+***** Merges row i of A and B, both sorted by column, into 
+***** alpha*A + beta*B.  Columns are mapped through A_map and 
+***** B_map (if not NULL), which must preserve their order.  If 
+***** diag_first, an entry in column i is the first of each row
+***** (as after move_diag) and is kept first in C.
+*****
+***** Without a builder, only counts the entries of the merged 
+***** row.  Otherwise inserts them into row i of C, recording the
+***** position in C of each entry of A and B (if A_pos and B_pos
+***** are not NULL).
+*****
+***** Returns
+***** -------------
+***** int : number of entries in the merged row
+**************************************************************/
+int merge_rows(int i, bool diag_first, const Matrix* A, const int* A_map,
+        const Matrix* B, const int* B_map, double alpha, double beta,
+        CSRBuilder* builder, Matrix* C, int* A_pos, int* B_pos)
 {
-    ParCSRMatrix* C = new ParCSRMatrix(partition, global_num_rows, global_num_cols, 
-            local_num_rows, on_proc_num_cols, 0);
-    int start, end;
-
-    aligned_vector<int> off_proc_to_new;
-    aligned_vector<int> B_off_proc_to_new;
-    if (off_proc_num_cols) off_proc_to_new.resize(off_proc_num_cols, 0);
-    if (B->off_proc_num_cols) B_off_proc_to_new.resize(B->off_proc_num_cols, 0);
-
-    int ctr = 0;
-    int ctr_B = 0;
-    int global_col = 0;
-    int global_col_B = 0;
-    while (ctr < off_proc_num_cols || ctr_B < B->off_proc_num_cols)
+    int a = A->idx1[i];
+    int a_end = A->idx1[i+1];
+    int b = B->idx1[i];
+    int b_end = B->idx1[i+1];
+    int n = 0;
+    int col_a, col_b, col, pos;
+    double val;
+
+    if (diag_first)
     {
-        if (ctr < off_proc_num_cols) global_col = off_proc_column_map[ctr];
-        else global_col = partition->global_num_cols;
-
-        if (ctr_B < B->off_proc_num_cols) global_col_B = B->off_proc_column_map[ctr_B];
-        else global_col_B = B->partition->global_num_cols;
-
-        if (global_col == global_col_B)
-        {
-            off_proc_to_new[ctr++] = C->off_proc_column_map.size();
-            B_off_proc_to_new[ctr_B++] = C->off_proc_column_map.size();
-            C->off_proc_column_map.emplace_back(global_col);
-        }
-        else if (global_col < global_col_B)
-        {
-            off_proc_to_new[ctr++] = C->off_proc_column_map.size();
-            C->off_proc_column_map.emplace_back(global_col);
-        }
-        else
+        bool diag_a = a < a_end && A->idx2[a] == i;
+        bool diag_b = b < b_end && B->idx2[b] == i;
+        if (diag_a || diag_b)
         {
-            B_off_proc_to_new[ctr_B++] = C->off_proc_column_map.size();
-            C->off_proc_column_map.emplace_back(global_col_B);
+            if (builder)
+            {
+                pos = builder->insert(i, i);
+                val = 0.0;
+                if (diag_a)
+                {
+                    val += alpha * A->vals[a];
+                    if (A_pos) A_pos[a] = pos;
+                }
+                if (diag_b)
+                {
+                    val += beta * B->vals[b];
+                    if (B_pos) B_pos[b] = pos;
+                }
+                C->vals[pos] = val;
+            }
+            if (diag_a) a++;
+            if (diag_b) b++;
+            n++;
         }
     }
-    C->off_proc_num_cols = C->off_proc_column_map.size();
 
-
-    C->on_proc->idx1[0] = 0;
-    C->off_proc->idx1[0] = 0;
-    int on_nnz = on_proc->nnz + B->on_proc->nnz;
-    int off_nnz = off_proc->nnz + B->off_proc->nnz;
-    C->on_proc->idx2.resize(on_nnz);
-    C->on_proc->vals.resize(on_nnz);
-    C->off_proc->idx2.resize(off_nnz);
-    C->off_proc->vals.resize(off_nnz);
-    on_nnz = 0;
-    off_nnz = 0;
-    for (int i = 0; i < local_num_rows; i++)
+    while (a < a_end || b < b_end)
     {
-        // Add on_proc column indices and values
-        start = on_proc->idx1[i];
-        end = on_proc->idx1[i+1];
-        std::copy(on_proc->idx2.begin() + start,
-                on_proc->idx2.begin() + end,
-                C->on_proc->idx2.begin() + on_nnz);
-        std::copy(on_proc->vals.begin() + start,
-                on_proc->vals.begin() + end,
-                C->on_proc->vals.begin() + on_nnz);
-        on_nnz += (end - start);
-
-        // Add on_proc columns and values from B
-        start = B->on_proc->idx1[i];
-        end = B->on_proc->idx1[i+1];
-        std::copy(B->on_proc->idx2.begin() + start,
-                B->on_proc->idx2.begin() + end,
-                C->on_proc->idx2.begin() + on_nnz);
-        std::copy(B->on_proc->vals.begin() + start,
-                B->on_proc->vals.begin() + end,
-                C->on_proc->vals.begin() + on_nnz);
-        on_nnz += (end - start);
-
-        // Update rowptr
-        C->on_proc->idx1[i+1] = on_nnz;
-
-
-        // Add off_proc columns and values
-        start = off_proc->idx1[i];
-        end = off_proc->idx1[i+1];
-        std::copy(off_proc->idx2.begin() + start,
-                off_proc->idx2.begin() + end,
-                C->off_proc->idx2.begin() + off_nnz);
-        std::copy(off_proc->vals.begin() + start,
-                off_proc->vals.begin() + end,
-                C->off_proc->vals.begin() + off_nnz);
-        for (aligned_vector<int>::iterator it = C->off_proc->idx2.begin() + off_nnz;
-                it != C->off_proc->idx2.begin() + off_nnz + (end - start); ++it)
-        {
-            *it = off_proc_to_new[*it];
-        }
-        off_nnz += (end - start);
-
-        // Add off_proc columns and values from B
-        start = B->off_proc->idx1[i];
-        end = B->off_proc->idx1[i+1];
-        std::copy(B->off_proc->idx2.begin() + start,
-                B->off_proc->idx2.begin() + end,
-                C->off_proc->idx2.begin() + off_nnz);
-        std::copy(B->off_proc->vals.begin() + start,
-                B->off_proc->vals.begin() + end,
-                C->off_proc->vals.begin() + off_nnz);
-        for (aligned_vector<int>::iterator it = C->off_proc->idx2.begin() + off_nnz;
-                it != C->off_proc->idx2.begin() + off_nnz + (end - start); ++it)
+        col_a = INT_MAX;
+        col_b = INT_MAX;
+        if (a < a_end) col_a = A_map ? A_map[A->idx2[a]] : A->idx2[a];
+        if (b < b_end) col_b = B_map ? B_map[B->idx2[b]] : B->idx2[b];
+        col = std::min(col_a, col_b);
+
+        if (builder)
         {
-            *it = off_proc_to_new[*it];
+            pos = builder->insert(i, col);
+            val = 0.0;
+            if (col_a == col)
+            {
+                val += alpha * A->vals[a];
+                if (A_pos) A_pos[a] = pos;
+            }
+            if (col_b == col)
+            {
+                val += beta * B->vals[b];
+                if (B_pos) B_pos[b] = pos;
+            }
+            C->vals[pos] = val;
         }
-        off_nnz += (end - start);
-
-        // Update rowptr
-        C->off_proc->idx1[i+1] = off_nnz; 
+        if (col_a == col) a++;
+        if (col_b == col) b++;
+        n++;
     }
-    C->on_proc->nnz = C->on_proc->idx2.size();
-    C->off_proc->nnz = C->off_proc->idx2.size();
 
-    C->on_proc_column_map.resize(on_proc_column_map.size());
-    std::copy(on_proc_column_map.begin(), on_proc_column_map.end(),
-            C->on_proc_column_map.begin());
-    C->local_row_map.resize(local_row_map.size());
-    std::copy(local_row_map.begin(), local_row_map.end(),
-            C->local_row_map.begin());
+    return n;
+}
 
-    C->on_proc->sort();
-    C->on_proc->remove_duplicates();
-    C->on_proc->move_diag();
+/**************************************************************
+*****   Merge Order
+**************************************************************
+***** Returns A if its rows are sorted by column (with the
+***** diagonal first, if diag_first), or otherwise a copy of A
+***** in that order, so the operands of add are left unchanged.
+***** A returned copy must be deleted by the caller.
+**************************************************************/
+Matrix* merge_order(Matrix* A, bool diag_first)
+{
+    if (A->sorted && (A->diag_first || !diag_first)) return A;
 
-    C->off_proc->sort();
-    C->off_proc->remove_duplicates();
+    Matrix* A_sorted = A->copy();
+    A_sorted->sort();
+    if (diag_first) A_sorted->move_diag();
+    return A_sorted;
+}
 
-    if (C->off_proc_num_cols)
-    {
-        aligned_vector<int> new_col(C->off_proc_num_cols, 0);
-        for (aligned_vector<int>::iterator it = C->off_proc->idx2.begin();
-                it != C->off_proc->idx2.end(); ++it)
-        {
-            new_col[*it] = 1;
-        }
-        ctr = 0;
-        for (int i = 0; i < C->off_proc_num_cols; i++)
-        {
-            if (new_col[i])
-                new_col[i] = ctr++;
-            else 
-                new_col[i] = -1;
-        }
-        C->off_proc_num_cols = ctr;
-        C->off_proc->n_cols = ctr;
-        C->off_proc_column_map.resize(ctr);
+/**************************************************************
+*****   Add Sorted
+**************************************************************
+***** Forms C = alpha*A + beta*B from the blocks A_on, A_off, 
+***** B_on, and B_off of A and B, with rows sorted by column and 
+***** the diagonal first in A_on and B_on.  The off_proc column 
+***** map of C is the sorted union of those of A and B, after 
+***** which rows of each block are merged (counting, then filling
+***** C exactly) with rows split among threads.  Without a plan, 
+***** entries that cancel are dropped.  With a plan, the pattern 
+***** of C and the positions of entries of A and B in C are saved,
+***** and reused in later calls to only scatter values.
+**************************************************************/
+ParCSRMatrix* add_sorted(ParCSRMatrix* A, ParCSRMatrix* B, Matrix* A_on, 
+        Matrix* A_off, Matrix* B_on, Matrix* B_off, double alpha, 
+        double beta, ParAddPlan* plan)
+{
+    int n_rows = A->local_num_rows;
 
-        for (aligned_vector<int>::iterator it = C->off_proc->idx2.begin();
-                it != C->off_proc->idx2.end(); ++it)
+    if (plan && plan->formed)
+    {
+        ParCSRMatrix* C = new ParCSRMatrix(A->partition, A->global_num_rows,
+                A->global_num_cols, n_rows, A->on_proc_num_cols, 
+                plan->off_proc_column_map.size());
+        C->on_proc->idx1 = plan->on_idx1;
+        C->on_proc->idx2 = plan->on_idx2;
+        C->on_proc->nnz = plan->on_idx2.size();
+        C->on_proc->vals.resize(C->on_proc->nnz, 0.0);
+        C->off_proc->idx1 = plan->off_idx1;
+        C->off_proc->idx2 = plan->off_idx2;
+        C->off_proc->nnz = plan->off_idx2.size();
+        C->off_proc->vals.resize(C->off_proc->nnz, 0.0);
+
+        // Entries of row i of A and B lie in row i of C, so threads
+        // owning distinct rows scatter to distinct positions
+#ifdef _OPENMP
+#pragma omp parallel if (A->local_nnz + B->local_nnz >= omp_min_work)
+#endif
         {
-            *it = new_col[*it];
+            int first, last;
+            thread_rows(A_on->idx1.data(), n_rows, first, last);
+            for (int i = first; i < last; i++)
+            {
+                for (int j = A_on->idx1[i]; j < A_on->idx1[i+1]; j++)
+                    C->on_proc->vals[plan->A_on_pos[j]] += alpha * A_on->vals[j];
+                for (int j = B_on->idx1[i]; j < B_on->idx1[i+1]; j++)
+                    C->on_proc->vals[plan->B_on_pos[j]] += beta * B_on->vals[j];
+                for (int j = A_off->idx1[i]; j < A_off->idx1[i+1]; j++)
+                    C->off_proc->vals[plan->A_off_pos[j]] += alpha * A_off->vals[j];
+                for (int j = B_off->idx1[i]; j < B_off->idx1[i+1]; j++)
+                    C->off_proc->vals[plan->B_off_pos[j]] += beta * B_off->vals[j];
+            }
         }
-    }
 
-    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
-
-    return C;
-}
+        C->on_proc->sorted = true;
+        C->on_proc->diag_first = true;
+        C->off_proc->sorted = true;
+        C->off_proc_column_map = plan->off_proc_column_map;
+        C->on_proc_column_map = A->get_on_proc_column_map();
+        C->local_row_map = A->get_local_row_map();
+        C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
 
+        return C;
+    }
 
-ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
-{
-    ParCSRMatrix* C = new ParCSRMatrix(partition, global_num_rows, global_num_cols, 
-            local_num_rows, on_proc_num_cols, 0);
-    int start, end;
+    ParCSRMatrix* C = new ParCSRMatrix(A->partition, A->global_num_rows, 
+            A->global_num_cols, n_rows, A->on_proc_num_cols, 0);
 
+    // Sorted union of off_proc column maps
     aligned_vector<int> off_proc_to_new;
     aligned_vector<int> B_off_proc_to_new;
-    if (off_proc_num_cols) off_proc_to_new.resize(off_proc_num_cols, 0);
+    if (A->off_proc_num_cols) off_proc_to_new.resize(A->off_proc_num_cols, 0);
     if (B->off_proc_num_cols) B_off_proc_to_new.resize(B->off_proc_num_cols, 0);
 
     int ctr = 0;
     int ctr_B = 0;
     int global_col = 0;
     int global_col_B = 0;
-    while (ctr < off_proc_num_cols || ctr_B < B->off_proc_num_cols)
+    while (ctr < A->off_proc_num_cols || ctr_B < B->off_proc_num_cols)
     {
-        if (ctr < off_proc_num_cols) global_col = off_proc_column_map[ctr];
-        else global_col = partition->global_num_cols;
+        if (ctr < A->off_proc_num_cols) global_col = A->off_proc_column_map[ctr];
+        else global_col = A->partition->global_num_cols;
 
         if (ctr_B < B->off_proc_num_cols) global_col_B = B->off_proc_column_map[ctr_B];
         else global_col_B = B->partition->global_num_cols;
@@ -223,59 +230,75 @@ ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
     }
     C->off_proc_num_cols = C->off_proc_column_map.size();
 
+    int* A_on_pos = NULL;
+    int* B_on_pos = NULL;
+    int* A_off_pos = NULL;
+    int* B_off_pos = NULL;
+    if (plan)
+    {
+        plan->A_on_pos.resize(A_on->nnz);
+        plan->B_on_pos.resize(B_on->nnz);
+        plan->A_off_pos.resize(A_off->nnz);
+        plan->B_off_pos.resize(B_off->nnz);
+        A_on_pos = plan->A_on_pos.data();
+        B_on_pos = plan->B_on_pos.data();
+        A_off_pos = plan->A_off_pos.data();
+        B_off_pos = plan->B_off_pos.data();
+    }
 
-    C->on_proc->idx1[0] = 0;
-    C->off_proc->idx1[0] = 0;
-    for (int i = 0; i < local_num_rows; i++)
+    const int* A_map = off_proc_to_new.data();
+    const int* B_map = B_off_proc_to_new.data();
+    CSRBuilder C_on(C->on_proc);
+    CSRBuilder C_off(C->off_proc);
+#ifdef _OPENMP
+#pragma omp parallel if (A->local_nnz + B->local_nnz >= omp_min_work)
+#endif
     {
-        start = on_proc->idx1[i];
-        end = on_proc->idx1[i+1];
-        for (int j = start; j < end; j++)
-        {
-            C->on_proc->idx2.emplace_back(on_proc->idx2[j]);
-            C->on_proc->vals.emplace_back(on_proc->vals[j]);
-        }
-        start = B->on_proc->idx1[i];
-        end = B->on_proc->idx1[i+1];
-        for (int j = start; j < end; j++)
+        int first, last;
+        thread_rows(A_on->idx1.data(), n_rows, first, last);
+
+        for (int i = first; i < last; i++)
         {
-            C->on_proc->idx2.emplace_back(B->on_proc->idx2[j]);
-            C->on_proc->vals.emplace_back(-B->on_proc->vals[j]);
+            C_on.count(i, merge_rows(i, true, A_on, NULL, B_on,
+                        NULL, alpha, beta, NULL, NULL, NULL, NULL));
+            C_off.count(i, merge_rows(i, false, A_off, A_map, B_off,
+                        B_map, alpha, beta, NULL, NULL, NULL, NULL));
         }
-        C->on_proc->idx1[i+1] = C->on_proc->idx2.size();
-
 
-        start = off_proc->idx1[i];
-        end = off_proc->idx1[i+1];
-        for (int j = start; j < end; j++)
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
         {
-            C->off_proc->idx2.emplace_back(off_proc_to_new[off_proc->idx2[j]]);
-            C->off_proc->vals.emplace_back(off_proc->vals[j]);
+            C_on.allocate();
+            C_off.allocate();
         }
-        start = B->off_proc->idx1[i];
-        end = B->off_proc->idx1[i+1];
-        for (int j = start; j < end; j++)
+
+        for (int i = first; i < last; i++)
         {
-            C->off_proc->idx2.emplace_back(B_off_proc_to_new[B->off_proc->idx2[j]]);
-            C->off_proc->vals.emplace_back(-B->off_proc->vals[j]);
+            merge_rows(i, true, A_on, NULL, B_on, NULL, alpha, beta,
+                    &C_on, C->on_proc, A_on_pos, B_on_pos);
+            merge_rows(i, false, A_off, A_map, B_off, B_map, alpha, beta,
+                    &C_off, C->off_proc, A_off_pos, B_off_pos);
+
+            // Remove entries that cancel (kept in planned patterns)
+            if (!plan)
+            {
+                C_on.drop_zeros(i);
+                C_off.drop_zeros(i);
+            }
         }
-        C->off_proc->idx1[i+1] = C->off_proc->idx2.size();
     }
-    C->on_proc->nnz = C->on_proc->idx2.size();
-    C->off_proc->nnz = C->off_proc->idx2.size();
-
-    C->on_proc_column_map.resize(on_proc_column_map.size());
-    std::copy(on_proc_column_map.begin(), on_proc_column_map.end(), C->on_proc_column_map.begin());
-    C->local_row_map.resize(local_row_map.size());
-    std::copy(local_row_map.begin(), local_row_map.end(), C->local_row_map.begin());
-
-    C->on_proc->sort();
-    C->on_proc->remove_duplicates();
-    C->on_proc->move_diag();
+    C_on.finalize();
+    C_off.finalize();
 
-    C->off_proc->sort();
-    C->off_proc->remove_duplicates();
+    C->on_proc->sorted = true;
+    C->on_proc->diag_first = true;
+    C->off_proc->sorted = true;
+    C->on_proc_column_map = A->get_on_proc_column_map();
+    C->local_row_map = A->get_local_row_map();
 
+    // Remove off_proc columns with no remaining entries
     if (C->off_proc_num_cols)
     {
         aligned_vector<int> new_col(C->off_proc_num_cols, 0);
@@ -288,7 +311,10 @@ ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
         for (int i = 0; i < C->off_proc_num_cols; i++)
         {
             if (new_col[i])
+            {
+                C->off_proc_column_map[ctr] = C->off_proc_column_map[i];
                 new_col[i] = ctr++;
+            }
             else 
                 new_col[i] = -1;
         }
@@ -305,5 +331,56 @@ ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
 
     C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
 
+    if (plan)
+    {
+        plan->on_idx1 = C->on_proc->idx1;
+        plan->on_idx2 = C->on_proc->idx2;
+        plan->off_idx1 = C->off_proc->idx1;
+        plan->off_idx2 = C->off_proc->idx2;
+        plan->off_proc_column_map = C->off_proc_column_map;
+        plan->formed = true;
+    }
+
+    return C;
+}
+
+/**************************************************************
+*****   Add Helper
+**************************************************************
+***** Forms C = alpha*A + beta*B, merging sorted copies of any
+***** blocks of A and B that are not already in merge order
+**************************************************************/
+ParCSRMatrix* add_helper(ParCSRMatrix* A, ParCSRMatrix* B, double alpha, 
+        double beta, ParAddPlan* plan)
+{
+    Matrix* A_on = merge_order(A->on_proc, true);
+    Matrix* A_off = merge_order(A->off_proc, false);
+    Matrix* B_on = merge_order(B->on_proc, true);
+    Matrix* B_off = merge_order(B->off_proc, false);
+
+    ParCSRMatrix* C = add_sorted(A, B, A_on, A_off, B_on, B_off, alpha, 
+            beta, plan);
+
+    if (A_on != A->on_proc) delete A_on;
+    if (A_off != A->off_proc) delete A_off;
+    if (B_on != B->on_proc) delete B_on;
+    if (B_off != B->off_proc) delete B_off;
+
     return C;
 }
+
+ParCSRMatrix* ParCSRMatrix::add(ParCSRMatrix* B, double alpha, double beta,
+        ParAddPlan* plan)
+{
+    return add_helper(this, B, alpha, beta, plan);
+}
+
+ParCSRMatrix* ParCSRMatrix::add(ParCSRMatrix* B)
+{
+    return add_helper(this, B, 1.0, 1.0, NULL);
+}
+
+ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
+{
+    return add_helper(this, B, 1.0, -1.0, NULL);
+}
@@ -1,9 +1,13 @@
 // Copyright (c) 2015-2017, RAPtor Developer Team
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 #include "core/par_matrix.hpp"
+#include <limits>
 
 using namespace raptor;
 
+// Budget for the chunks of A*P formed by rap
+const size_t default_rap_bytes = 64 * 1024 * 1024;
+
 ParCSRMatrix* init_mat(ParCSCMatrix* A)
 {
     return new ParCSRMatrix(A->partition);
@@ -70,6 +74,10 @@ ParCSRMatrix* init_matrix(T* A, U* B)
     return C;
 }
 
+void pipelined_off_mult(ParCSRMatrix* A, ParCSRMatrix* B, CSRMatrix** C_off_on,
+        CSRMatrix** C_off_off, aligned_vector<int>& recv_off_cols, 
+        data_t* mat_comm_t);
+
 ParCSRMatrix* ParCSRMatrix::mult(ParCSRMatrix* B, bool tap, data_t* mat_comm_t)
 {
     if (tap)
@@ -96,15 +104,34 @@ ParCSRMatrix* ParCSRMatrix::mult(ParCSRMatrix* B, bool tap, data_t* mat_comm_t)
     CSRMatrix* C_on_on = on_proc->mult((CSRMatrix*) B->on_proc);
     CSRMatrix* C_on_off = on_proc->mult((CSRMatrix*) B->off_proc);
 
-    if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
-    CSRMatrix* recv_mat = comm->complete_mat_comm();
-    if (mat_comm_t) *mat_comm_t += MPI_Wtime();
+    // Block matrices multiply all received rows at once
+    if (on_proc->b_size > 1 || B->on_proc->b_size > 1)
+    {
+        if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+        CSRMatrix* recv_mat = comm->complete_mat_comm();
+        if (mat_comm_t) *mat_comm_t += MPI_Wtime();
 
-    mult_helper(B, C, recv_mat, C_on_on, C_on_off);
+        mult_helper(B, C, recv_mat, C_on_on, C_on_off);
+
+        delete C_on_on;
+        delete C_on_off;
+        delete recv_mat;
+
+        return C;
+    }
+
+    // Multiply rows of B by A->off_proc as each message arrives
+    CSRMatrix* C_off_on;
+    CSRMatrix* C_off_off;
+    aligned_vector<int> recv_off_cols;
+    pipelined_off_mult(this, B, &C_off_on, &C_off_off, recv_off_cols, mat_comm_t);
+
+    mult_combine(B, C, recv_off_cols, C_on_on, C_on_off, C_off_on, C_off_off);
 
     delete C_on_on;
     delete C_on_off;
-    delete recv_mat;
+    delete C_off_on;
+    delete C_off_off;
 
     // Return matrix containing product
     return C;
@@ -133,6 +160,9 @@ ParCSRMatrix* ParCSRMatrix::tap_mult(ParCSRMatrix* B, data_t* mat_comm_t)
     CSRMatrix* C_on_on = on_proc->mult((CSRMatrix*) B->on_proc);
     CSRMatrix* C_on_off = on_proc->mult((CSRMatrix*) B->off_proc);
 
+    // Not pipelined as in mult: rows from off-node processes are
+    // redistributed within the node after the inter-node step, so no
+    // message holds the final rows of a single source
     if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
     CSRMatrix* recv_mat = tap_mat_comm->complete_mat_comm();
     if (mat_comm_t) *mat_comm_t += MPI_Wtime();
@@ -260,25 +290,9 @@ ParMatrix* ParMatrix::mult(ParCSRMatrix* B, bool tap, data_t* mat_comm_t)
 void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C, 
         CSRMatrix* recv_mat, CSRMatrix* C_on_on, CSRMatrix* C_on_off)
 {
-    // Set dimensions of C
-    C->global_num_rows = global_num_rows;
-    C->global_num_cols = B->global_num_cols;
-    C->local_num_rows = local_num_rows;
-
-    C->on_proc_column_map = B->get_on_proc_column_map();
-    C->local_row_map = get_local_row_map();
-    C->on_proc_num_cols = C->on_proc_column_map.size();
-    
-    // Initialize nnz as 0 (will increment this as nonzeros are added)
-    C->local_nnz = 0;
-
     // Declare Variables
     int row_start, row_end;
-    int row_start_B, row_end_B;
-    int row_start_recv, row_end_recv;
-    int global_col, col, col_B, col_C;
-    int tmp;
-    double val;
+    int global_col;
             
     // Split recv_mat into on and off proc portions
     CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1);
@@ -314,71 +328,289 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
     recv_off->nnz = recv_off->idx2.size();
     delete[] part_to_col;
 
-    // Calculate global_to_C and B_to_C column maps
-    std::map<int, int> global_to_C;
-    aligned_vector<int> B_to_C(B->off_proc_num_cols);
+    recv_on->n_cols = B->on_proc->n_cols;
+    recv_off->n_cols = B->global_num_cols;
 
-    std::copy(recv_off->idx2.begin(), recv_off->idx2.end(),
-            std::back_inserter(C->off_proc_column_map));
-    for (aligned_vector<int>::iterator it = B->off_proc_column_map.begin();
-            it != B->off_proc_column_map.end(); ++it)
+    // Multiply A->off_proc * B->recv_on -> C_off_on
+    CSRMatrix* C_off_on = off_proc->mult(recv_on);
+    delete recv_on;
+
+    // Multiply A->off_proc * B->recv_off -> C_off_off (global columns)
+    CSRMatrix* C_off_off = off_proc->mult(recv_off);
+
+    mult_combine(B, C, recv_off->idx2, C_on_on, C_on_off, C_off_on, C_off_off);
+
+    delete recv_off;
+    delete C_off_on;
+    delete C_off_off;
+}
+
+/**************************************************************
+*****   ParCSRMatrix Mult Combine
+**************************************************************
+***** Forms C = A*B from the products of A's on_proc and off_proc
+***** blocks.  C->off_proc columns are the off_proc columns of B
+***** and the (global) off_proc columns of the received rows.
+*****
+***** Parameters
+***** -------------
+***** B : ParCSRMatrix*
+*****    Matrix multiplied by this
+***** C : ParCSRMatrix*
+*****    Returns the product
+***** recv_off_cols : const aligned_vector<int>&
+*****    Global off_proc columns of the received rows of B
+***** C_on_on, C_on_off : CSRMatrix*
+*****    A->on_proc times B->on_proc and B->off_proc 
+***** C_off_on, C_off_off : CSRMatrix*
+*****    A->off_proc times the received rows, split into columns
+*****    local to B (C_off_on) and global columns (C_off_off)
+**************************************************************/
+void ParCSRMatrix::mult_combine(ParCSRMatrix* B, ParCSRMatrix* C, 
+        const aligned_vector<int>& recv_off_cols, CSRMatrix* C_on_on, 
+        CSRMatrix* C_on_off, CSRMatrix* C_off_on, CSRMatrix* C_off_off)
+{
+    // Set dimensions of C
+    C->global_num_rows = global_num_rows;
+    C->global_num_cols = B->global_num_cols;
+    C->local_num_rows = local_num_rows;
+
+    C->on_proc_column_map = B->get_on_proc_column_map();
+    C->local_row_map = get_local_row_map();
+    C->on_proc_num_cols = C->on_proc_column_map.size();
+
+    // Sorted global columns of C->off_proc
+    aligned_vector<int>& off_map = C->off_proc_column_map;
+    off_map.clear();
+    std::copy(recv_off_cols.begin(), recv_off_cols.end(), 
+            std::back_inserter(off_map));
+    std::copy(B->off_proc_column_map.begin(), B->off_proc_column_map.end(),
+            std::back_inserter(off_map));
+    std::sort(off_map.begin(), off_map.end());
+    off_map.erase(std::unique(off_map.begin(), off_map.end()), off_map.end());
+    C->off_proc_num_cols = off_map.size();
+
+    // Map columns of B->off_proc and global columns to C->off_proc
+    aligned_vector<int> B_to_C(B->off_proc_num_cols);
+    for (int i = 0; i < B->off_proc_num_cols; i++)
     {
-        C->off_proc_column_map.emplace_back(*it);
+        B_to_C[i] = std::lower_bound(off_map.begin(), off_map.end(),
+                B->off_proc_column_map[i]) - off_map.begin();
+    }
+    for (aligned_vector<int>::iterator it = C_on_off->idx2.begin();
+            it != C_on_off->idx2.end(); ++it)
+    {
+        *it = B_to_C[*it];
+    }
+    for (aligned_vector<int>::iterator it = C_off_off->idx2.begin();
+            it != C_off_off->idx2.end(); ++it)
+    {
+        *it = std::lower_bound(off_map.begin(), off_map.end(), *it) 
+            - off_map.begin();
     }
-    std::sort(C->off_proc_column_map.begin(), C->off_proc_column_map.end());
+    C_on_off->n_cols = C->off_proc_num_cols;
+    C_off_off->n_cols = C->off_proc_num_cols;
 
-    int prev_col = -1;
-    C->off_proc_num_cols = 0;
-    for (aligned_vector<int>::iterator it = C->off_proc_column_map.begin();
-            it != C->off_proc_column_map.end(); ++it)
+    // Create C->on_proc by adding C_on_on + C_off_on
+    C_on_on->add_append(C_off_on, (CSRMatrix*) C->on_proc);
+
+    // Create C->off_proc by adding C_on_off + C_off_off
+    C_on_off->add_append(C_off_off, (CSRMatrix*) C->off_proc);
+
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+}
+
+// Merges the products of a row, (column, value) pairs, appending 
+// nonzero sums to rows, cols, and vals
+void merge_products(int row, std::vector<std::pair<int, double> >& products,
+        aligned_vector<int>& rows, aligned_vector<int>& cols, 
+        aligned_vector<double>& vals)
+{
+    std::sort(products.begin(), products.end(), 
+            [](const std::pair<int, double>& a, const std::pair<int, double>& b)
+            {
+                return a.first < b.first;
+            });
+    for (int i = 0; i < (int) products.size(); )
     {
-        if (*it != prev_col)
+        int col = products[i].first;
+        double sum = 0.0;
+        for ( ; i < (int) products.size() && products[i].first == col; i++)
         {
-            global_to_C[*it] = C->off_proc_num_cols;
-            C->off_proc_column_map[C->off_proc_num_cols++] = *it;
-            prev_col = *it;
+            sum += products[i].second;
+        }
+        if (fabs(sum) > zero_tol)
+        {
+            rows.emplace_back(row);
+            cols.emplace_back(col);
+            vals.emplace_back(sum);
         }
     }
-    C->off_proc_column_map.resize(C->off_proc_num_cols);
+    products.clear();
+}
 
-    for (int i = 0; i < B->off_proc_num_cols; i++)
+// Forms a CSRMatrix from (row, col, val) entries, in row order
+CSRMatrix* entries_to_csr(int n_rows, int n_cols, const aligned_vector<int>& rows,
+        const aligned_vector<int>& cols, const aligned_vector<double>& vals)
+{
+    int nnz = rows.size();
+    CSRMatrix* C = new CSRMatrix(n_rows, n_cols);
+    std::fill(C->idx1.begin(), C->idx1.end(), 0);
+    for (int i = 0; i < nnz; i++)
     {
-        global_col = B->off_proc_column_map[i];
-        B_to_C[i] = global_to_C[global_col];
+        C->idx1[rows[i]+1]++;
     }
-    for (aligned_vector<int>::iterator it = recv_off->idx2.begin(); 
-            it != recv_off->idx2.end(); ++it)
+    for (int i = 0; i < n_rows; i++)
     {
-        *it = global_to_C[*it];
+        C->idx1[i+1] += C->idx1[i];
     }
+    C->idx2.resize(nnz);
+    C->vals.resize(nnz);
+    aligned_vector<int> pos(C->idx1.begin(), C->idx1.end() - 1);
+    for (int i = 0; i < nnz; i++)
+    {
+        int j = pos[rows[i]]++;
+        C->idx2[j] = cols[i];
+        C->vals[j] = vals[i];
+    }
+    C->nnz = nnz;
+    return C;
+}
 
-    for (aligned_vector<int>::iterator it = C_on_off->idx2.begin();
-            it != C_on_off->idx2.end(); ++it)
+/**************************************************************
+*****   Pipelined Off-Process Product
+**************************************************************
+***** Multiplies A->off_proc by the rows of B received from other
+***** processes, one message at a time in order of arrival, so 
+***** products with early messages overlap waiting on later ones.
+***** The nonzeros of A->off_proc are first bucketed by the 
+***** message holding their column.  Products for each row are 
+***** merged within each message, and across messages when C is
+***** combined.
+*****
+***** Parameters
+***** -------------
+***** A : ParCSRMatrix*
+*****    Matrix whose comm has started communicating rows of B
+***** B : ParCSRMatrix*
+*****    Matrix being multiplied
+***** C_off_on : CSRMatrix**
+*****    Returns products in columns local to B
+***** C_off_off : CSRMatrix**
+*****    Returns products in global off_proc columns 
+***** recv_off_cols : aligned_vector<int>&
+*****    Returns global off_proc columns of the received rows
+***** mat_comm_t : data_t*
+*****    Adds time spent waiting on messages, if not NULL
+**************************************************************/
+void pipelined_off_mult(ParCSRMatrix* A, ParCSRMatrix* B, CSRMatrix** C_off_on,
+        CSRMatrix** C_off_off, aligned_vector<int>& recv_off_cols,
+        data_t* mat_comm_t)
+{
+    ParComm* comm = A->comm;
+    CommData* recv_data = comm->recv_data;
+    CSRMatrix* A_off = (CSRMatrix*) A->off_proc;
+    int num_msgs = recv_data->num_msgs;
+
+    // Bucket nonzeros of A->off_proc by message, in row order
+    aligned_vector<int> col_msg(A->off_proc_num_cols);
+    for (int m = 0; m < num_msgs; m++)
     {
-        *it = B_to_C[*it];
+        for (int k = recv_data->indptr[m]; k < recv_data->indptr[m+1]; k++)
+        {
+            col_msg[k] = m;
+        }
+    }
+    aligned_vector<int> msg_ptr(num_msgs + 1, 0);
+    for (int j = 0; j < A_off->nnz; j++)
+    {
+        msg_ptr[col_msg[A_off->idx2[j]]+1]++;
+    }
+    for (int m = 0; m < num_msgs; m++)
+    {
+        msg_ptr[m+1] += msg_ptr[m];
+    }
+    aligned_vector<int> pos(msg_ptr.begin(), msg_ptr.end());
+    aligned_vector<int> msg_rows(A_off->nnz);
+    aligned_vector<int> msg_cols(A_off->nnz);
+    aligned_vector<double> msg_vals(A_off->nnz);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        for (int j = A_off->idx1[i]; j < A_off->idx1[i+1]; j++)
+        {
+            int col = A_off->idx2[j];
+            int idx = pos[col_msg[col]]++;
+            msg_rows[idx] = i;
+            msg_cols[idx] = col;
+            msg_vals[idx] = A_off->vals[j];
+        }
     }
-    C->off_proc_num_cols = C->off_proc_column_map.size();
-    recv_on->n_cols = B->on_proc->n_cols;
-    recv_off->n_cols = C->off_proc_num_cols;
-    C_on_off->n_cols = C->off_proc_num_cols;
 
-    // Multiply A->off_proc * B->recv_on -> C_off_on
-    CSRMatrix* C_off_on = off_proc->mult(recv_on);
-    delete recv_on;
+    int first_col = B->partition->first_local_col;
+    int last_col = B->partition->last_local_col;
+    int* part_to_col = B->map_partition_to_local();
+    aligned_vector<int> on_rows, on_cols, off_rows, off_cols;
+    aligned_vector<double> on_vals, off_vals;
+    std::vector<std::pair<int, double> > on_products, off_products;
+    CSRMatrix* msg_mat = new CSRMatrix(0, B->global_num_cols);
+    aligned_vector<int> pending(num_msgs);
+    std::iota(pending.begin(), pending.end(), 0);
+
+    for (int n = 0; n < num_msgs; n++)
+    {
+        if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+        int m = comm->recv_mat_msg(msg_mat, pending);
+        if (mat_comm_t) *mat_comm_t += MPI_Wtime();
 
-    // Multiply A->off_proc * B->recv_off -> C_off_off
-    CSRMatrix* C_off_off = off_proc->mult(recv_off);
-    delete recv_off;
+        // Convert on_proc columns of received rows to local columns
+        for (aligned_vector<int>::iterator it = msg_mat->idx2.begin();
+                it != msg_mat->idx2.end(); ++it)
+        {
+            if (*it < first_col || *it > last_col)
+            {
+                recv_off_cols.emplace_back(*it);
+            }
+            else
+            {
+                *it = -1 - part_to_col[*it - first_col];
+            }
+        }
 
-    // Create C->on_proc by adding C_on_on + C_off_on
-    C_on_on->add_append(C_off_on, (CSRMatrix*) C->on_proc);
-    delete C_off_on;
+        int first_row = recv_data->indptr[m];
+        for (int j = msg_ptr[m]; j < msg_ptr[m+1]; j++)
+        {
+            int row = msg_rows[j];
+            int row_B = msg_cols[j] - first_row;
+            double val = msg_vals[j];
+            for (int k = msg_mat->idx1[row_B]; k < msg_mat->idx1[row_B+1]; k++)
+            {
+                int col = msg_mat->idx2[k];
+                if (col < 0)
+                {
+                    on_products.emplace_back(-1 - col, val * msg_mat->vals[k]);
+                }
+                else
+                {
+                    off_products.emplace_back(col, val * msg_mat->vals[k]);
+                }
+            }
 
-    // Create C->off_proc by adding C_off_on + C_off_off
-    C_on_off->add_append(C_off_off, (CSRMatrix*) C->off_proc);
-    delete C_off_off;
+            // Merge products once all entries of the row are added
+            if (j + 1 == msg_ptr[m+1] || msg_rows[j+1] != row)
+            {
+                merge_products(row, on_products, on_rows, on_cols, on_vals);
+                merge_products(row, off_products, off_rows, off_cols, off_vals);
+            }
+        }
+    }
+    comm->finalize_mat_comm();
+    delete msg_mat;
+    delete[] part_to_col;
 
-    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+    *C_off_on = entries_to_csr(A->local_num_rows, B->on_proc_num_cols, on_rows, 
+            on_cols, on_vals);
+    *C_off_off = entries_to_csr(A->local_num_rows, B->global_num_cols, off_rows, 
+            off_cols, off_vals);
 }
 
 CSRMatrix* ParCSRMatrix::mult_T_partial(CSCMatrix* A_off)
@@ -585,3 +817,1197 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     delete recv_off;
 }
 
+
+/**************************************************************
+*****   Planned Products
+**************************************************************
+***** Helpers for products reusing a ParSpGEMMPlan.  Received 
+***** rows are split into on_proc (local columns) and off_proc 
+***** portions in every call, as the values arrive in a new
+***** buffer each time.  Off_proc columns are left global if
+***** off_map is empty, and otherwise are mapped to their 
+***** position in the (sorted) off_map.
+**************************************************************/
+void split_recv(const CSRMatrix* recv_mat, Partition* part, 
+        const int* part_to_col, const aligned_vector<int>& off_map,
+        CSRMatrix* recv_on, CSRMatrix* recv_off)
+{
+    int first_col = part->first_local_col;
+    int last_col = part->last_local_col;
+    recv_on->idx1[0] = 0;
+    recv_off->idx1[0] = 0;
+    for (int i = 0; i < recv_mat->n_rows; i++)
+    {
+        for (int j = recv_mat->idx1[i]; j < recv_mat->idx1[i+1]; j++)
+        {
+            int global_col = recv_mat->idx2[j];
+            if (global_col < first_col || global_col > last_col)
+            {
+                if (off_map.size())
+                {
+                    global_col = std::lower_bound(off_map.begin(), off_map.end(),
+                            global_col) - off_map.begin();
+                }
+                recv_off->idx2.emplace_back(global_col);
+                recv_off->vals.emplace_back(recv_mat->vals[j]);
+            }
+            else
+            {
+                recv_on->idx2.emplace_back(part_to_col[global_col - first_col]);
+                recv_on->vals.emplace_back(recv_mat->vals[j]);
+            }
+        }
+        recv_on->idx1[i+1] = recv_on->idx2.size();
+        recv_off->idx1[i+1] = recv_off->idx2.size();
+    }
+    recv_on->nnz = recv_on->idx2.size();
+    recv_off->nnz = recv_off->idx2.size();
+}
+
+// Copies the pattern of plan into C, and computes C's values
+void fill_planned(const SpGEMMPlan& plan, const std::vector<SpGEMMPlan::Term>& terms,
+        Matrix* C)
+{
+    C->n_rows = plan.n_rows;
+    C->n_cols = plan.n_cols;
+    C->nnz = plan.nnz();
+    C->idx1 = plan.idx1;
+    C->idx2 = plan.idx2;
+    C->vals.resize(C->nnz);
+    C->sorted = true;
+    C->diag_first = false;
+    plan.numeric(terms, C->vals.data());
+}
+
+// Sorted, unique global columns of recv_off and the columns in col_map 
+void form_off_proc_column_map(const CSRMatrix* recv_off, 
+        const aligned_vector<int>& col_map, aligned_vector<int>& off_proc_column_map)
+{
+    off_proc_column_map.clear();
+    std::copy(recv_off->idx2.begin(), recv_off->idx2.end(),
+            std::back_inserter(off_proc_column_map));
+    std::copy(col_map.begin(), col_map.end(), 
+            std::back_inserter(off_proc_column_map));
+    std::sort(off_proc_column_map.begin(), off_proc_column_map.end());
+    off_proc_column_map.erase(std::unique(off_proc_column_map.begin(),
+                off_proc_column_map.end()), off_proc_column_map.end());
+}
+
+ParCSRMatrix* ParCSRMatrix::mult(ParCSRMatrix* B, ParSpGEMMPlan* plan, bool tap, 
+        data_t* mat_comm_t)
+{
+    CommPkg* mat_comm;
+    if (tap)
+    {
+        if (tap_mat_comm == NULL)
+        {
+            tap_mat_comm = new TAPComm(partition, off_proc_column_map, 
+                    on_proc_column_map, false);
+        }
+        mat_comm = tap_mat_comm;
+    }
+    else
+    {
+        if (comm == NULL)
+        {
+            comm = new ParComm(partition, off_proc_column_map, on_proc_column_map);
+        }
+        mat_comm = comm;
+    }
+
+    // Initialize C (matrix to be returned)
+    ParCSRMatrix* C = init_matrix(this, B);
+    aligned_vector<char> send_buffer;
+
+    // Communicate rows of B
+    if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+    mat_comm->init_par_mat_comm(B, send_buffer);
+    CSRMatrix* recv_mat = mat_comm->complete_mat_comm();
+    if (mat_comm_t) *mat_comm_t += MPI_Wtime();
+
+    C->global_num_rows = global_num_rows;
+    C->global_num_cols = B->global_num_cols;
+    C->local_num_rows = local_num_rows;
+    C->on_proc_column_map = B->get_on_proc_column_map();
+    C->local_row_map = get_local_row_map();
+    C->on_proc_num_cols = C->on_proc_column_map.size();
+
+    // Split received rows, mapping off_proc columns to C
+    CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1);
+    CSRMatrix* recv_off = new CSRMatrix(recv_mat->n_rows, -1);
+    int* part_to_col = B->map_partition_to_local();
+    split_recv(recv_mat, B->partition, part_to_col, plan->off_proc_column_map,
+            recv_on, recv_off);
+    delete[] part_to_col;
+    delete recv_mat;
+
+    if (!plan->formed)
+    {
+        form_off_proc_column_map(recv_off, B->off_proc_column_map, 
+                plan->off_proc_column_map);
+        const aligned_vector<int>& off_map = plan->off_proc_column_map;
+        for (aligned_vector<int>::iterator it = recv_off->idx2.begin();
+                it != recv_off->idx2.end(); ++it)
+        {
+            *it = std::lower_bound(off_map.begin(), off_map.end(), *it) 
+                - off_map.begin();
+        }
+        plan->off_to_C.resize(B->off_proc_num_cols);
+        for (int i = 0; i < B->off_proc_num_cols; i++)
+        {
+            plan->off_to_C[i] = std::lower_bound(off_map.begin(), off_map.end(), 
+                    B->off_proc_column_map[i]) - off_map.begin();
+        }
+    }
+
+    // C->on_proc = A_on * B_on + A_off * recv_on
+    std::vector<SpGEMMPlan::Term> on_terms(2);
+    on_terms[0].A = on_proc;
+    on_terms[0].B = B->on_proc;
+    on_terms[0].B_to_C = NULL;
+    on_terms[1].A = off_proc;
+    on_terms[1].B = recv_on;
+    on_terms[1].B_to_C = NULL;
+
+    // C->off_proc = A_on * B_off + A_off * recv_off
+    std::vector<SpGEMMPlan::Term> off_terms(2);
+    off_terms[0].A = on_proc;
+    off_terms[0].B = B->off_proc;
+    off_terms[0].B_to_C = plan->off_to_C.data();
+    off_terms[1].A = off_proc;
+    off_terms[1].B = recv_off;
+    off_terms[1].B_to_C = NULL;
+
+    if (!plan->formed)
+    {
+        plan->on_plan.symbolic(local_num_rows, C->on_proc_num_cols, on_terms);
+        plan->off_plan.symbolic(local_num_rows, plan->off_proc_column_map.size(), 
+                off_terms);
+        plan->formed = true;
+    }
+
+    fill_planned(plan->on_plan, on_terms, C->on_proc);
+    fill_planned(plan->off_plan, off_terms, C->off_proc);
+    C->off_proc_column_map = plan->off_proc_column_map;
+    C->off_proc_num_cols = C->off_proc_column_map.size();
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+
+    delete recv_on;
+    delete recv_off;
+
+    return C;
+}
+
+ParCSRMatrix* ParCSRMatrix::mult_T(ParCSRMatrix* A, ParSpGEMMPlan* plan, bool tap, 
+        data_t* mat_comm_t)
+{
+    ParCSCMatrix* Acsc = A->to_ParCSC();
+    ParCSRMatrix* C = this->mult_T(Acsc, plan, tap, mat_comm_t);
+    delete Acsc;
+    return C;
+}
+
+ParCSRMatrix* ParCSRMatrix::mult_T(ParCSCMatrix* A, ParSpGEMMPlan* plan, bool tap, 
+        data_t* mat_comm_t)
+{
+    CommPkg* mat_comm;
+    if (tap)
+    {
+        if (A->tap_mat_comm == NULL)
+        {
+            A->tap_mat_comm = new TAPComm(A->partition, A->off_proc_column_map, 
+                    A->on_proc_column_map, false);
+        }
+        mat_comm = A->tap_mat_comm;
+    }
+    else
+    {
+        if (A->comm == NULL)
+        {
+            A->comm = new ParComm(A->partition, A->off_proc_column_map, 
+                    A->on_proc_column_map);
+        }
+        mat_comm = A->comm;
+    }
+
+    // Initialize C (matrix to be returned)
+    ParCSRMatrix* C = init_matrix(this, A);
+
+    // Products A_off^T * B, sent to the processes holding the rows 
+    // of A^T, with off_proc columns of B following on_proc columns
+    std::vector<SpGEMMPlan::Term> partial_terms(2);
+    partial_terms[0].A = A->off_proc;
+    partial_terms[0].B = on_proc;
+    partial_terms[0].B_to_C = NULL;
+    partial_terms[1].A = A->off_proc;
+    partial_terms[1].B = off_proc;
+    partial_terms[1].B_to_C = NULL;
+    if (!plan->formed)
+    {
+        plan->partial_off_map.resize(off_proc_num_cols);
+        for (int i = 0; i < off_proc_num_cols; i++)
+        {
+            plan->partial_off_map[i] = on_proc_num_cols + i;
+        }
+        partial_terms[1].B_to_C = plan->partial_off_map.data();
+        plan->partial_plan.symbolic(A->off_proc_num_cols, 
+                on_proc_num_cols + off_proc_num_cols, partial_terms);
+
+        plan->partial_global_idx2.resize(plan->partial_plan.nnz());
+        for (int i = 0; i < plan->partial_plan.nnz(); i++)
+        {
+            int col = plan->partial_plan.idx2[i];
+            plan->partial_global_idx2[i] = col < on_proc_num_cols ?
+                on_proc_column_map[col] : off_proc_column_map[col - on_proc_num_cols];
+        }
+    }
+    partial_terms[1].B_to_C = plan->partial_off_map.data();
+    aligned_vector<double> partial_vals(plan->partial_plan.nnz());
+    plan->partial_plan.numeric(partial_terms, partial_vals.data());
+
+    aligned_vector<char> send_buffer;
+    if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+    mat_comm->init_mat_comm_T(send_buffer, plan->partial_plan.idx1, 
+            plan->partial_global_idx2, partial_vals);
+    CSRMatrix* recv_mat = mat_comm->complete_mat_comm_T(A->on_proc_num_cols);
+    if (mat_comm_t) *mat_comm_t += MPI_Wtime();
+
+    C->global_num_rows = A->global_num_cols;
+    C->global_num_cols = global_num_cols;
+    C->local_num_rows = A->on_proc_num_cols;
+    C->on_proc_column_map = get_on_proc_column_map();
+    C->local_row_map = A->get_on_proc_column_map();
+    C->on_proc_num_cols = C->on_proc_column_map.size();
+
+    // Split received products, mapping off_proc columns to C
+    CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1);
+    CSRMatrix* recv_off = new CSRMatrix(recv_mat->n_rows, -1);
+    int* part_to_col = map_partition_to_local();
+    split_recv(recv_mat, partition, part_to_col, plan->off_proc_column_map,
+            recv_on, recv_off);
+    delete[] part_to_col;
+    delete recv_mat;
+
+    // C->on_proc = A_on^T * B_on + recv_on
+    std::vector<SpGEMMPlan::Term> on_terms(2);
+    on_terms[0].A = A->on_proc;
+    on_terms[0].B = on_proc;
+    on_terms[0].B_to_C = NULL;
+    on_terms[1].A = NULL;
+    on_terms[1].B = recv_on;
+    on_terms[1].B_to_C = NULL;
+
+    // C->off_proc = A_on^T * B_off + recv_off
+    std::vector<SpGEMMPlan::Term> off_terms(2);
+    off_terms[0].A = A->on_proc;
+    off_terms[0].B = off_proc;
+    off_terms[1].A = NULL;
+    off_terms[1].B = recv_off;
+    off_terms[1].B_to_C = NULL;
+
+    if (!plan->formed)
+    {
+        // Candidate columns, condensed below to those reached
+        aligned_vector<int> off_map;
+        form_off_proc_column_map(recv_off, off_proc_column_map, off_map);
+        for (aligned_vector<int>::iterator it = recv_off->idx2.begin();
+                it != recv_off->idx2.end(); ++it)
+        {
+            *it = std::lower_bound(off_map.begin(), off_map.end(), *it) 
+                - off_map.begin();
+        }
+        plan->off_to_C.resize(off_proc_num_cols);
+        for (int i = 0; i < off_proc_num_cols; i++)
+        {
+            plan->off_to_C[i] = std::lower_bound(off_map.begin(), off_map.end(), 
+                    off_proc_column_map[i]) - off_map.begin();
+        }
+        off_terms[0].B_to_C = plan->off_to_C.data();
+        plan->off_plan.symbolic(C->local_num_rows, off_map.size(), off_terms);
+
+        aligned_vector<int> col_orig_to_new(off_map.size(), -1);
+        for (aligned_vector<int>::iterator it = plan->off_plan.idx2.begin();
+                it != plan->off_plan.idx2.end(); ++it)
+        {
+            col_orig_to_new[*it] = 0;
+        }
+        int ctr = 0;
+        plan->off_proc_column_map.clear();
+        for (int i = 0; i < (int) off_map.size(); i++)
+        {
+            if (col_orig_to_new[i] == 0)
+            {
+                col_orig_to_new[i] = ctr++;
+                plan->off_proc_column_map.emplace_back(off_map[i]);
+            }
+        }
+        for (aligned_vector<int>::iterator it = plan->off_plan.idx2.begin();
+                it != plan->off_plan.idx2.end(); ++it)
+        {
+            *it = col_orig_to_new[*it];
+        }
+        for (aligned_vector<int>::iterator it = plan->off_to_C.begin();
+                it != plan->off_to_C.end(); ++it)
+        {
+            *it = col_orig_to_new[*it];
+        }
+        for (aligned_vector<int>::iterator it = recv_off->idx2.begin();
+                it != recv_off->idx2.end(); ++it)
+        {
+            *it = col_orig_to_new[*it];
+        }
+        plan->off_plan.n_cols = ctr;
+
+        plan->on_plan.symbolic(C->local_num_rows, C->on_proc_num_cols, on_terms);
+        plan->formed = true;
+    }
+    off_terms[0].B_to_C = plan->off_to_C.data();
+
+    fill_planned(plan->on_plan, on_terms, C->on_proc);
+    fill_planned(plan->off_plan, off_terms, C->off_proc);
+    C->off_proc_column_map = plan->off_proc_column_map;
+    C->off_proc_num_cols = C->off_proc_column_map.size();
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+
+    delete recv_on;
+    delete recv_off;
+
+    return C;
+}
+
+/**************************************************************
+*****   AP Row
+**************************************************************
+***** Adds scale * (row of A*P) to the accumulator, marking the 
+***** columns first reached with tag.  Columns of P (and of the
+***** received rows of P, held from recv_start[k] to recv_end[k]
+***** for off_proc column k of A) are given as positions in the 
+***** accumulator.
+**************************************************************/
+void ap_row(int row, double scale, int tag, const CSRMatrix* A_on, 
+        const CSRMatrix* A_off, const CSRMatrix* P_on, const int* P_on_acc, 
+        const CSRMatrix* P_off, const int* P_off_acc, const int* recv_start, 
+        const int* recv_end, const int* recv_acc, const double* recv_vals,
+        aligned_vector<double>& acc, aligned_vector<int>& marker, 
+        aligned_vector<int>& cols)
+{
+    for (int j = A_on->idx1[row]; j < A_on->idx1[row+1]; j++)
+    {
+        int k = A_on->idx2[j];
+        double val = scale * A_on->vals[j];
+        for (int l = P_on->idx1[k]; l < P_on->idx1[k+1]; l++)
+        {
+            int col = P_on_acc[P_on->idx2[l]];
+            if (marker[col] != tag)
+            {
+                marker[col] = tag;
+                acc[col] = 0.0;
+                cols.emplace_back(col);
+            }
+            acc[col] += val * P_on->vals[l];
+        }
+        for (int l = P_off->idx1[k]; l < P_off->idx1[k+1]; l++)
+        {
+            int col = P_off_acc[P_off->idx2[l]];
+            if (marker[col] != tag)
+            {
+                marker[col] = tag;
+                acc[col] = 0.0;
+                cols.emplace_back(col);
+            }
+            acc[col] += val * P_off->vals[l];
+        }
+    }
+    for (int j = A_off->idx1[row]; j < A_off->idx1[row+1]; j++)
+    {
+        int k = A_off->idx2[j];
+        double val = scale * A_off->vals[j];
+        for (int l = recv_start[k]; l < recv_end[k]; l++)
+        {
+            int col = recv_acc[l];
+            if (marker[col] != tag)
+            {
+                marker[col] = tag;
+                acc[col] = 0.0;
+                cols.emplace_back(col);
+            }
+            acc[col] += val * recv_vals[l];
+        }
+    }
+}
+
+// Matrix communication package of A, formed if needed
+CommPkg* mat_comm_pkg(ParCSRMatrix* A, bool tap)
+{
+    if (tap)
+    {
+        if (A->tap_mat_comm == NULL)
+        {
+            A->tap_mat_comm = new TAPComm(A->partition, A->off_proc_column_map, 
+                    A->on_proc_column_map, false);
+        }
+        return A->tap_mat_comm;
+    }
+
+    if (A->comm == NULL)
+    {
+        A->comm = new ParComm(A->partition, A->off_proc_column_map, 
+                A->on_proc_column_map);
+    }
+    return A->comm;
+}
+
+/**************************************************************
+*****   Form Accumulator Maps
+**************************************************************
+***** Accumulator positions of the columns of P : on_proc columns
+***** of P followed by all other (global, sorted) columns of P 
+***** reached by this process, held in off_map.  P_off_acc and
+***** recv_acc map P->off_proc columns and the columns of each 
+***** received nonzero to these positions.
+**************************************************************/
+void form_acc_maps(ParCSRMatrix* P, const CSRMatrix* recv_mat, 
+        const int* part_to_col, aligned_vector<int>& off_map, 
+        aligned_vector<int>& P_on_acc, aligned_vector<int>& P_off_acc,
+        aligned_vector<int>& recv_acc)
+{
+    int on_n = P->on_proc_num_cols;
+    int first_col = P->partition->first_local_col;
+    int last_col = P->partition->last_local_col;
+
+    off_map.clear();
+    std::copy(P->off_proc_column_map.begin(), P->off_proc_column_map.end(),
+            std::back_inserter(off_map));
+    for (aligned_vector<int>::const_iterator it = recv_mat->idx2.begin();
+            it != recv_mat->idx2.end(); ++it)
+    {
+        if (*it < first_col || *it > last_col)
+            off_map.emplace_back(*it);
+    }
+    std::sort(off_map.begin(), off_map.end());
+    off_map.erase(std::unique(off_map.begin(), off_map.end()), off_map.end());
+
+    P_on_acc.resize(on_n);
+    P_off_acc.resize(P->off_proc_num_cols);
+    recv_acc.resize(recv_mat->nnz);
+    for (int i = 0; i < on_n; i++)
+    {
+        P_on_acc[i] = i;
+    }
+    for (int i = 0; i < P->off_proc_num_cols; i++)
+    {
+        P_off_acc[i] = on_n + (std::lower_bound(off_map.begin(), off_map.end(),
+                    P->off_proc_column_map[i]) - off_map.begin());
+    }
+    for (int i = 0; i < recv_mat->nnz; i++)
+    {
+        int global_col = recv_mat->idx2[i];
+        if (global_col < first_col || global_col > last_col)
+        {
+            recv_acc[i] = on_n + (std::lower_bound(off_map.begin(), off_map.end(),
+                    global_col) - off_map.begin());
+        }
+        else
+        {
+            recv_acc[i] = part_to_col[global_col - first_col];
+        }
+    }
+}
+
+// Condenses the off_proc columns of Ac to those holding nonzeros, 
+// where off_used[i] is nonzero if column Ac_off_map[i] holds any
+void condense_used_cols(ParCSRMatrix* Ac, const aligned_vector<int>& Ac_off_map,
+        aligned_vector<int>& off_used)
+{
+    Ac->off_proc_column_map.clear();
+    for (int i = 0; i < (int) Ac_off_map.size(); i++)
+    {
+        if (off_used[i])
+        {
+            off_used[i] = Ac->off_proc_column_map.size();
+            Ac->off_proc_column_map.emplace_back(Ac_off_map[i]);
+        }
+    }
+    for (aligned_vector<int>::iterator it = Ac->off_proc->idx2.begin();
+            it != Ac->off_proc->idx2.end(); ++it)
+    {
+        *it = off_used[*it];
+    }
+    Ac->off_proc_num_cols = Ac->off_proc_column_map.size();
+    Ac->off_proc->n_cols = Ac->off_proc_num_cols;
+}
+
+/**************************************************************
+*****   ParCSRMatrix RAP
+**************************************************************
+***** Forms the Galerkin product Ac = P^T * A * P, with the rows
+***** of A*P held only in chunks of default_rap_bytes (see 
+***** rap_chunked).  Each row i of A*P is formed once and 
+***** P(i,:)^T * (row i of A*P) is added into the rows of Ac.
+*****
+***** Parameters
+***** -------------
+***** P : ParCSRMatrix*
+*****    Prolongation operator
+***** tap : bool (default false)
+*****    Whether to use topology-aware communication
+***** mat_comm_t : data_t* (default NULL)
+*****    Returns time spent communicating matrices
+***** AP_t : data_t* (default NULL)
+*****    Returns time spent forming rows of A*P
+***** AP_comm_t : data_t* (default NULL)
+*****    Returns the part of mat_comm_t spent receiving rows of P
+*****    for A*P (the remainder sends rows of Ac to their owners)
+**************************************************************/
+ParCSRMatrix* ParCSRMatrix::rap(ParCSRMatrix* P, bool tap, data_t* mat_comm_t,
+        data_t* AP_t, data_t* AP_comm_t)
+{
+    return rap_chunked(P, default_rap_bytes, tap, mat_comm_t, AP_t, AP_comm_t);
+}
+
+/**************************************************************
+*****   Chunk Rows
+**************************************************************
+***** Splits the local rows of A into consecutive chunks, each 
+***** of whose rows of A*P (bounded by the lengths of the rows of
+***** P they combine) take at most max_bytes.  If with_PT, each 
+***** row also counts its products with the row of P, as formed 
+***** for P^T*(A*P).  A chunk holds at least one row.
+**************************************************************/
+void chunk_rows(const CSRMatrix* A_on, const CSRMatrix* A_off, 
+        const CSRMatrix* P_on, const CSRMatrix* P_off, 
+        const aligned_vector<int>& recv_start, const aligned_vector<int>& recv_end,
+        size_t max_bytes, bool with_PT, aligned_vector<int>& chunk_ptr)
+{
+    size_t chunk_bytes = 0;
+    chunk_ptr.clear();
+    chunk_ptr.emplace_back(0);
+    for (int i = 0; i < A_on->n_rows; i++)
+    {
+        size_t row_nnz = 0;
+        for (int j = A_on->idx1[i]; j < A_on->idx1[i+1]; j++)
+        {
+            int k = A_on->idx2[j];
+            row_nnz += (P_on->idx1[k+1] - P_on->idx1[k]) 
+                + (P_off->idx1[k+1] - P_off->idx1[k]);
+        }
+        for (int j = A_off->idx1[i]; j < A_off->idx1[i+1]; j++)
+        {
+            int k = A_off->idx2[j];
+            row_nnz += recv_end[k] - recv_start[k];
+        }
+        if (with_PT)
+        {
+            row_nnz *= 1 + (P_on->idx1[i+1] - P_on->idx1[i]) 
+                + (P_off->idx1[i+1] - P_off->idx1[i]);
+        }
+
+        size_t row_bytes = row_nnz * (sizeof(int) + sizeof(double));
+        if (chunk_bytes && chunk_bytes + row_bytes > max_bytes)
+        {
+            chunk_ptr.emplace_back(i);
+            chunk_bytes = 0;
+        }
+        chunk_bytes += row_bytes;
+    }
+    if (chunk_ptr.back() < A_on->n_rows)
+    {
+        chunk_ptr.emplace_back(A_on->n_rows);
+    }
+}
+
+/**************************************************************
+*****   Release Received Rows
+**************************************************************
+***** Drops the received rows of P whose last use (last_chunk) 
+***** was in or before chunk, moving the remaining rows into new
+***** storage.  Storage is only reallocated once a quarter of it
+***** (or all of it) is no longer needed.
+**************************************************************/
+void release_recv_rows(const aligned_vector<int>& last_chunk, int chunk,
+        aligned_vector<int>& recv_start, aligned_vector<int>& recv_end, 
+        aligned_vector<int>& recv_acc, aligned_vector<double>& recv_vals)
+{
+    int n_rows = last_chunk.size();
+    int stored = recv_acc.size();
+    int live = 0;
+    for (int k = 0; k < n_rows; k++)
+    {
+        if (last_chunk[k] > chunk)
+            live += recv_end[k] - recv_start[k];
+    }
+    if (live == stored || (live && 4 * (stored - live) < stored))
+    {
+        return;
+    }
+
+    aligned_vector<int> live_acc(live);
+    aligned_vector<double> live_vals(live);
+    int pos = 0;
+    for (int k = 0; k < n_rows; k++)
+    {
+        int start = recv_start[k];
+        int end = recv_end[k];
+        recv_start[k] = pos;
+        if (last_chunk[k] > chunk)
+        {
+            std::copy(recv_acc.begin() + start, recv_acc.begin() + end,
+                    live_acc.begin() + pos);
+            std::copy(recv_vals.begin() + start, recv_vals.begin() + end,
+                    live_vals.begin() + pos);
+            pos += end - start;
+        }
+        recv_end[k] = pos;
+    }
+    recv_acc.swap(live_acc);
+    recv_vals.swap(live_vals);
+}
+
+// Chunk of the last row of A using each received row of P (-1 if none)
+void form_last_chunk(const CSRMatrix* A_off, const aligned_vector<int>& chunk_ptr,
+        int n_recv_rows, aligned_vector<int>& last_chunk)
+{
+    last_chunk.resize(n_recv_rows);
+    std::fill(last_chunk.begin(), last_chunk.end(), -1);
+    for (int t = 0; t < (int) chunk_ptr.size() - 1; t++)
+    {
+        for (int j = A_off->idx1[chunk_ptr[t]]; j < A_off->idx1[chunk_ptr[t+1]]; j++)
+        {
+            last_chunk[A_off->idx2[j]] = t;
+        }
+    }
+}
+
+/**************************************************************
+*****   ParCSRMatrix Mult Chunked
+**************************************************************
+***** Memory-capped C = A*B.  Rows of C are formed in chunks of 
+***** consecutive rows of A, each bounded by max_bytes, and 
+***** appended directly to C.  Received rows of B are released 
+***** once no remaining chunk needs them.  Falls back to mult if
+***** max_bytes is 0 or either matrix is a block matrix.
+*****
+***** Parameters
+***** -------------
+***** B : ParCSRMatrix*
+*****    Matrix multiplied by this
+***** max_bytes : size_t
+*****    Memory budget for the intermediate rows of each chunk
+***** tap : bool (default false)
+*****    Whether to use topology-aware communication
+***** mat_comm_t : data_t* (default NULL)
+*****    Returns time spent communicating matrices
+**************************************************************/
+ParCSRMatrix* ParCSRMatrix::mult_chunked(ParCSRMatrix* B, size_t max_bytes, 
+        bool tap, data_t* mat_comm_t)
+{
+    if (max_bytes == 0 || on_proc->b_size > 1 || B->on_proc->b_size > 1)
+    {
+        return mult(B, tap, mat_comm_t);
+    }
+
+    CommPkg* mat_comm = mat_comm_pkg(this, tap);
+    ParCSRMatrix* C = init_matrix(this, B);
+
+    CSRMatrix* A_on = (CSRMatrix*) on_proc;
+    CSRMatrix* A_off = (CSRMatrix*) off_proc;
+    CSRMatrix* B_on = (CSRMatrix*) B->on_proc;
+    CSRMatrix* B_off = (CSRMatrix*) B->off_proc;
+    int on_n = B->on_proc_num_cols;
+
+    // Rows of B for the off_proc columns of A
+    aligned_vector<char> send_buffer;
+    if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+    mat_comm->init_par_mat_comm(B, send_buffer);
+    CSRMatrix* recv_mat = mat_comm->complete_mat_comm();
+    if (mat_comm_t) *mat_comm_t += MPI_Wtime();
+
+    // Accumulator positions of the columns of B, keeping received 
+    // rows as positions and values only
+    int* part_to_col = B->map_partition_to_local();
+    aligned_vector<int> off_map;
+    aligned_vector<int> B_on_acc;
+    aligned_vector<int> B_off_acc;
+    aligned_vector<int> recv_acc;
+    form_acc_maps(B, recv_mat, part_to_col, off_map, B_on_acc, B_off_acc, 
+            recv_acc);
+    delete[] part_to_col;
+    int n_recv_rows = recv_mat->n_rows;
+    aligned_vector<int> recv_start(recv_mat->idx1.begin(), recv_mat->idx1.end() - 1);
+    aligned_vector<int> recv_end(recv_mat->idx1.begin() + 1, recv_mat->idx1.end());
+    aligned_vector<double> recv_vals;
+    recv_vals.swap(recv_mat->vals);
+    delete recv_mat;
+
+    aligned_vector<int> chunk_ptr;
+    aligned_vector<int> last_chunk;
+    chunk_rows(A_on, A_off, B_on, B_off, recv_start, recv_end, max_bytes, false, 
+            chunk_ptr);
+    form_last_chunk(A_off, chunk_ptr, n_recv_rows, last_chunk);
+
+    // Set dimensions of C
+    C->global_num_rows = global_num_rows;
+    C->global_num_cols = B->global_num_cols;
+    C->local_num_rows = local_num_rows;
+    C->on_proc_column_map = B->get_on_proc_column_map();
+    C->local_row_map = get_local_row_map();
+    C->on_proc_num_cols = C->on_proc_column_map.size();
+    C->off_proc_column_map = off_map;
+    C->off_proc_num_cols = off_map.size();
+
+    CSRMatrix* C_on = (CSRMatrix*) C->on_proc;
+    CSRMatrix* C_off = (CSRMatrix*) C->off_proc;
+    C_on->n_rows = local_num_rows;
+    C_on->n_cols = C->on_proc_num_cols;
+    C_on->idx1.resize(local_num_rows + 1);
+    C_on->idx2.clear();
+    C_on->vals.clear();
+    C_off->n_rows = local_num_rows;
+    C_off->n_cols = C->off_proc_num_cols;
+    C_off->idx1.resize(local_num_rows + 1);
+    C_off->idx2.clear();
+    C_off->vals.clear();
+    C_on->idx1[0] = 0;
+    C_off->idx1[0] = 0;
+
+    int n_acc = on_n + off_map.size();
+    aligned_vector<double> acc(n_acc);
+    aligned_vector<int> marker(n_acc, -1);
+    aligned_vector<int> cols;
+    for (int t = 0; t < (int) chunk_ptr.size() - 1; t++)
+    {
+        for (int i = chunk_ptr[t]; i < chunk_ptr[t+1]; i++)
+        {
+            cols.clear();
+            ap_row(i, 1.0, i, A_on, A_off, B_on, B_on_acc.data(), B_off, 
+                    B_off_acc.data(), recv_start.data(), recv_end.data(), 
+                    recv_acc.data(), recv_vals.data(), acc, marker, cols);
+            std::sort(cols.begin(), cols.end());
+            for (aligned_vector<int>::iterator it = cols.begin(); it != cols.end(); ++it)
+            {
+                if (fabs(acc[*it]) <= zero_tol) continue;
+                if (*it < on_n)
+                {
+                    C_on->idx2.emplace_back(*it);
+                    C_on->vals.emplace_back(acc[*it]);
+                }
+                else
+                {
+                    C_off->idx2.emplace_back(*it - on_n);
+                    C_off->vals.emplace_back(acc[*it]);
+                }
+            }
+            C_on->idx1[i+1] = C_on->idx2.size();
+            C_off->idx1[i+1] = C_off->idx2.size();
+        }
+        release_recv_rows(last_chunk, t, recv_start, recv_end, recv_acc, recv_vals);
+    }
+    C_on->nnz = C_on->idx2.size();
+    C_off->nnz = C_off->idx2.size();
+    C_on->sorted = true;
+    C_off->sorted = true;
+    C_on->diag_first = false;
+    C_off->diag_first = false;
+    C->local_nnz = C_on->nnz + C_off->nnz;
+
+    return C;
+}
+
+/**************************************************************
+*****   ParCSRMatrix RAP Chunked
+**************************************************************
+***** Memory-capped Galerkin product Ac = P^T * A * P.  Rows of 
+***** A*P are formed in chunks of consecutive rows of A, each 
+***** bounded by max_bytes, and their products with the matching
+***** rows of P are added into the rows of Ac before the next 
+***** chunk, so only one chunk of A*P exists at a time.  Received
+***** rows of P are released once no remaining chunk needs them.
+***** Rows of Ac owned by other processes (off_proc columns of 
+***** P) are then sent to their owners, which add them into their
+***** local rows.  If max_bytes is 0, all rows form one chunk.  
+***** Block matrices form A*P explicitly.
+*****
+***** Parameters
+***** -------------
+***** P : ParCSRMatrix*
+*****    Prolongation operator
+***** max_bytes : size_t
+*****    Memory budget for the intermediate rows of each chunk
+***** tap : bool (default false)
+*****    Whether to use topology-aware communication
+***** mat_comm_t : data_t* (default NULL)
+*****    Returns time spent communicating matrices
+***** AP_t : data_t* (default NULL)
+*****    Returns time spent forming rows of A*P
+***** AP_comm_t : data_t* (default NULL)
+*****    Returns the part of mat_comm_t spent receiving rows of P
+***** peak_bytes : size_t* (default NULL)
+*****    Returns the largest storage of any chunk (its rows of A*P
+*****    and the matching entries of P), which is within max_bytes 
+*****    unless a single row exceeds it (0 for block matrices)
+**************************************************************/
+ParCSRMatrix* ParCSRMatrix::rap_chunked(ParCSRMatrix* P, size_t max_bytes, 
+        bool tap, data_t* mat_comm_t, data_t* AP_t, data_t* AP_comm_t,
+        size_t* peak_bytes)
+{
+    // Block matrices form A*P explicitly
+    if (on_proc->b_size > 1 || P->on_proc->b_size > 1)
+    {
+        if (peak_bytes) *peak_bytes = 0;
+        data_t AP_comm = 0.0;
+        if (AP_t) *AP_t -= MPI_Wtime();
+        ParCSRMatrix* AP = mult(P, tap, &AP_comm);
+        if (AP_t) *AP_t += MPI_Wtime();
+        if (mat_comm_t) *mat_comm_t += AP_comm;
+        if (AP_comm_t) *AP_comm_t += AP_comm;
+        ParCSRMatrix* Ac = AP->mult_T(P, tap, mat_comm_t);
+        delete AP;
+        return Ac;
+    }
+    if (max_bytes == 0)
+    {
+        max_bytes = std::numeric_limits<size_t>::max();
+    }
+
+    CommPkg* A_comm = mat_comm_pkg(this, tap);
+    CommPkg* P_comm = mat_comm_pkg(P, tap);
+
+    // Initialize Ac with the partition P^T * (A*P) would have
+    ParCSRMatrix* AP = init_matrix(this, P);
+    ParCSRMatrix* Ac = init_matrix(AP, P);
+    delete AP;
+
+    CSRMatrix* A_on = (CSRMatrix*) on_proc;
+    CSRMatrix* A_off = (CSRMatrix*) off_proc;
+    CSRMatrix* P_on = (CSRMatrix*) P->on_proc;
+    CSRMatrix* P_off = (CSRMatrix*) P->off_proc;
+    int on_n = P->on_proc_num_cols;
+    int first_col = P->partition->first_local_col;
+    int last_col = P->partition->last_local_col;
+
+    // Rows of P for the off_proc columns of A
+    aligned_vector<char> send_buffer;
+    if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+    if (AP_comm_t) *AP_comm_t -= MPI_Wtime();
+    A_comm->init_par_mat_comm(P, send_buffer);
+    CSRMatrix* recv_mat = A_comm->complete_mat_comm();
+    if (AP_comm_t) *AP_comm_t += MPI_Wtime();
+    if (mat_comm_t) *mat_comm_t += MPI_Wtime();
+
+    // Accumulator positions of the columns of P, keeping received 
+    // rows as positions and values only
+    int* part_to_col = P->map_partition_to_local();
+    aligned_vector<int> off_map;
+    aligned_vector<int> P_on_acc;
+    aligned_vector<int> P_off_acc;
+    aligned_vector<int> recv_acc;
+    form_acc_maps(P, recv_mat, part_to_col, off_map, P_on_acc, P_off_acc, 
+            recv_acc);
+    int n_recv_rows = recv_mat->n_rows;
+    aligned_vector<int> recv_start(recv_mat->idx1.begin(), recv_mat->idx1.end() - 1);
+    aligned_vector<int> recv_end(recv_mat->idx1.begin() + 1, recv_mat->idx1.end());
+    aligned_vector<double> recv_vals;
+    recv_vals.swap(recv_mat->vals);
+    delete recv_mat;
+
+    aligned_vector<int> chunk_ptr;
+    aligned_vector<int> last_chunk;
+    chunk_rows(A_on, A_off, P_on, P_off, recv_start, recv_end, max_bytes, true, 
+            chunk_ptr);
+    form_last_chunk(A_off, chunk_ptr, n_recv_rows, last_chunk);
+
+    // Rows of Ac summed so far : local rows, followed by rows for 
+    // the off_proc columns of P, with accumulator columns.  Each 
+    // chunk is added into the rows it reaches before the next chunk
+    // is formed, so the sums hold at most one entry per nonzero of
+    // these rows, however many products the chunks form.
+    int n_acc = on_n + off_map.size();
+    int n_sum_rows = on_n + P->off_proc_num_cols;
+    std::vector<aligned_vector<int> > sum_cols(n_sum_rows);
+    std::vector<aligned_vector<double> > sum_vals(n_sum_rows);
+    CSRMatrix* AP_chunk = new CSRMatrix(0, n_acc);
+    aligned_vector<double> acc(n_acc);
+    aligned_vector<int> marker(n_acc, -1);
+    aligned_vector<int> cols;
+    aligned_vector<int> row_chunk(n_sum_rows, -1);
+    aligned_vector<int> row_pos(n_sum_rows);
+    aligned_vector<int> PT_sum_rows;
+    aligned_vector<int> PT_ptr;
+    aligned_vector<int> PT_rows;
+    aligned_vector<double> PT_vals;
+    if (peak_bytes) *peak_bytes = 0;
+    int tag = 0;
+    for (int t = 0; t < (int) chunk_ptr.size() - 1; t++)
+    {
+        int row_start = chunk_ptr[t];
+        int row_end = chunk_ptr[t+1];
+
+        // Rows of A*P in the chunk
+        if (AP_t) *AP_t -= MPI_Wtime();
+        AP_chunk->n_rows = row_end - row_start;
+        AP_chunk->idx1.resize(AP_chunk->n_rows + 1);
+        AP_chunk->idx2.clear();
+        AP_chunk->vals.clear();
+        AP_chunk->idx1[0] = 0;
+        for (int i = row_start; i < row_end; i++)
+        {
+            cols.clear();
+            ap_row(i, 1.0, tag++, A_on, A_off, P_on, P_on_acc.data(), P_off, 
+                    P_off_acc.data(), recv_start.data(), recv_end.data(), 
+                    recv_acc.data(), recv_vals.data(), acc, marker, cols);
+            for (aligned_vector<int>::iterator it = cols.begin(); it != cols.end(); ++it)
+            {
+                AP_chunk->idx2.emplace_back(*it);
+                AP_chunk->vals.emplace_back(acc[*it]);
+            }
+            AP_chunk->idx1[i - row_start + 1] = AP_chunk->idx2.size();
+        }
+        AP_chunk->nnz = AP_chunk->idx2.size();
+        if (AP_t) *AP_t += MPI_Wtime();
+        release_recv_rows(last_chunk, t, recv_start, recv_end, recv_acc, recv_vals);
+
+        // Rows of Ac reached by the rows of P in the chunk, and the 
+        // rows of P (within the chunk) reaching each
+        PT_sum_rows.clear();
+        PT_ptr.assign(1, 0);
+        for (int i = row_start; i < row_end; i++)
+        {
+            int n_on = P_on->idx1[i+1] - P_on->idx1[i];
+            int n_off = P_off->idx1[i+1] - P_off->idx1[i];
+            for (int j = 0; j < n_on + n_off; j++)
+            {
+                int r = j < n_on ? P_on->idx2[P_on->idx1[i] + j]
+                    : on_n + P_off->idx2[P_off->idx1[i] + j - n_on];
+                if (row_chunk[r] != t)
+                {
+                    row_chunk[r] = t;
+                    row_pos[r] = PT_sum_rows.size();
+                    PT_sum_rows.emplace_back(r);
+                    PT_ptr.emplace_back(0);
+                }
+                PT_ptr[row_pos[r] + 1]++;
+            }
+        }
+        int n_reached = PT_sum_rows.size();
+        for (int k = 0; k < n_reached; k++)
+        {
+            PT_ptr[k+1] += PT_ptr[k];
+        }
+        PT_rows.resize(PT_ptr[n_reached]);
+        PT_vals.resize(PT_ptr[n_reached]);
+        for (int i = row_start; i < row_end; i++)
+        {
+            for (int j = P_on->idx1[i]; j < P_on->idx1[i+1]; j++)
+            {
+                int pos = PT_ptr[row_pos[P_on->idx2[j]]]++;
+                PT_rows[pos] = i - row_start;
+                PT_vals[pos] = P_on->vals[j];
+            }
+            for (int j = P_off->idx1[i]; j < P_off->idx1[i+1]; j++)
+            {
+                int pos = PT_ptr[row_pos[on_n + P_off->idx2[j]]]++;
+                PT_rows[pos] = i - row_start;
+                PT_vals[pos] = P_off->vals[j];
+            }
+        }
+        for (int k = n_reached; k > 0; k--)
+        {
+            PT_ptr[k] = PT_ptr[k-1];
+        }
+        PT_ptr[0] = 0;
+
+        if (peak_bytes)
+        {
+            size_t chunk_bytes = (AP_chunk->nnz + PT_rows.size()) 
+                * (sizeof(int) + sizeof(double));
+            if (chunk_bytes > *peak_bytes) *peak_bytes = chunk_bytes;
+        }
+
+        // Add P(chunk,:)^T * AP_chunk into each row of Ac reached
+        for (int k = 0; k < n_reached; k++)
+        {
+            int r = PT_sum_rows[k];
+            aligned_vector<int>& r_cols = sum_cols[r];
+            aligned_vector<double>& r_vals = sum_vals[r];
+            int n_prev = r_cols.size();
+            for (int j = 0; j < n_prev; j++)
+            {
+                marker[r_cols[j]] = tag;
+                acc[r_cols[j]] = r_vals[j];
+            }
+
+            cols.clear();
+            for (int jj = PT_ptr[k]; jj < PT_ptr[k+1]; jj++)
+            {
+                int row = PT_rows[jj];
+                double val_P = PT_vals[jj];
+                for (int j = AP_chunk->idx1[row]; j < AP_chunk->idx1[row+1]; j++)
+                {
+                    int col = AP_chunk->idx2[j];
+                    if (marker[col] != tag)
+                    {
+                        marker[col] = tag;
+                        acc[col] = 0.0;
+                        cols.emplace_back(col);
+                    }
+                    acc[col] += val_P * AP_chunk->vals[j];
+                }
+            }
+            tag++;
+
+            for (int j = 0; j < n_prev; j++)
+            {
+                r_vals[j] = acc[r_cols[j]];
+            }
+            for (aligned_vector<int>::iterator it = cols.begin(); 
+                    it != cols.end(); ++it)
+            {
+                r_cols.emplace_back(*it);
+                r_vals.emplace_back(acc[*it]);
+            }
+        }
+    }
+    delete AP_chunk;
+
+    // Rows of Ac held by other processes, with global columns
+    aligned_vector<int> send_idx1(P->off_proc_num_cols + 1);
+    aligned_vector<int> send_idx2;
+    aligned_vector<double> send_vals;
+    send_idx1[0] = 0;
+    for (int c = 0; c < P->off_proc_num_cols; c++)
+    {
+        aligned_vector<int>& r_cols = sum_cols[on_n + c];
+        aligned_vector<double>& r_vals = sum_vals[on_n + c];
+        for (int j = 0; j < (int) r_cols.size(); j++)
+        {
+            int col = r_cols[j];
+            if (fabs(r_vals[j]) > zero_tol)
+            {
+                send_idx2.emplace_back(col < on_n ? P->on_proc_column_map[col]
+                        : off_map[col - on_n]);
+                send_vals.emplace_back(r_vals[j]);
+            }
+        }
+        send_idx1[c+1] = send_idx2.size();
+        aligned_vector<int>().swap(r_cols);
+        aligned_vector<double>().swap(r_vals);
+    }
+
+    if (mat_comm_t) *mat_comm_t -= MPI_Wtime();
+    P_comm->init_mat_comm_T(send_buffer, send_idx1, send_idx2, send_vals);
+    CSRMatrix* recv_T = P_comm->complete_mat_comm_T(on_n);
+    if (mat_comm_t) *mat_comm_t += MPI_Wtime();
+
+    // Off_proc columns of Ac : those of the sums and of received rows
+    aligned_vector<int> Ac_off_map(off_map);
+    for (aligned_vector<int>::iterator it = recv_T->idx2.begin();
+            it != recv_T->idx2.end(); ++it)
+    {
+        if (*it < first_col || *it > last_col)
+            Ac_off_map.emplace_back(*it);
+    }
+    std::sort(Ac_off_map.begin(), Ac_off_map.end());
+    Ac_off_map.erase(std::unique(Ac_off_map.begin(), Ac_off_map.end()), 
+            Ac_off_map.end());
+    aligned_vector<int> off_to_Ac(off_map.size());
+    for (int i = 0; i < (int) off_map.size(); i++)
+    {
+        off_to_Ac[i] = on_n + (std::lower_bound(Ac_off_map.begin(), 
+                    Ac_off_map.end(), off_map[i]) - Ac_off_map.begin());
+    }
+    for (aligned_vector<int>::iterator it = recv_T->idx2.begin();
+            it != recv_T->idx2.end(); ++it)
+    {
+        if (*it < first_col || *it > last_col)
+        {
+            *it = on_n + (std::lower_bound(Ac_off_map.begin(), Ac_off_map.end(),
+                        *it) - Ac_off_map.begin());
+        }
+        else
+        {
+            *it = part_to_col[*it - first_col];
+        }
+    }
+    delete[] part_to_col;
+    n_acc = on_n + Ac_off_map.size();
+    acc.resize(n_acc);
+    marker.resize(n_acc);
+    std::fill(marker.begin(), marker.end(), -1);
+
+    // Set dimensions of Ac
+    Ac->global_num_rows = P->global_num_cols;
+    Ac->global_num_cols = P->global_num_cols;
+    Ac->local_num_rows = on_n;
+    Ac->on_proc_column_map = P->get_on_proc_column_map();
+    Ac->local_row_map = P->get_on_proc_column_map();
+    Ac->on_proc_num_cols = on_n;
+
+    // Local rows of Ac : summed chunk products plus received rows
+    CSRMatrix* Ac_on = (CSRMatrix*) Ac->on_proc;
+    CSRMatrix* Ac_off = (CSRMatrix*) Ac->off_proc;
+    Ac_on->n_rows = on_n;
+    Ac_on->n_cols = on_n;
+    Ac_on->idx1.resize(on_n + 1);
+    Ac_on->idx2.clear();
+    Ac_on->vals.clear();
+    Ac_off->n_rows = on_n;
+    Ac_off->idx1.resize(on_n + 1);
+    Ac_off->idx2.clear();
+    Ac_off->vals.clear();
+    Ac_on->idx1[0] = 0;
+    Ac_off->idx1[0] = 0;
+    aligned_vector<int> off_used(Ac_off_map.size(), 0);
+    for (int c = 0; c < on_n; c++)
+    {
+        cols.clear();
+        for (int j = 0; j < (int) sum_cols[c].size(); j++)
+        {
+            int col = sum_cols[c][j];
+            if (col >= on_n) col = off_to_Ac[col - on_n];
+            marker[col] = c;
+            acc[col] = sum_vals[c][j];
+            cols.emplace_back(col);
+        }
+        aligned_vector<int>().swap(sum_cols[c]);
+        aligned_vector<double>().swap(sum_vals[c]);
+        for (int j = recv_T->idx1[c]; j < recv_T->idx1[c+1]; j++)
+        {
+            int col = recv_T->idx2[j];
+            if (marker[col] != c)
+            {
+                marker[col] = c;
+                acc[col] = 0.0;
+                cols.emplace_back(col);
+            }
+            acc[col] += recv_T->vals[j];
+        }
+
+        for (aligned_vector<int>::iterator it = cols.begin(); it != cols.end(); ++it)
+        {
+            if (fabs(acc[*it]) <= zero_tol) continue;
+            if (*it < on_n)
+            {
+                Ac_on->idx2.emplace_back(*it);
+                Ac_on->vals.emplace_back(acc[*it]);
+            }
+            else
+            {
+                off_used[*it - on_n] = 1;
+                Ac_off->idx2.emplace_back(*it - on_n);
+                Ac_off->vals.emplace_back(acc[*it]);
+            }
+        }
+        Ac_on->idx1[c+1] = Ac_on->idx2.size();
+        Ac_off->idx1[c+1] = Ac_off->idx2.size();
+    }
+    Ac_on->nnz = Ac_on->idx2.size();
+    Ac_off->nnz = Ac_off->idx2.size();
+
+    // Condense off_proc columns to those holding nonzeros
+    condense_used_cols(Ac, Ac_off_map, off_used);
+    Ac->local_nnz = Ac_on->nnz + Ac_off->nnz;
+
+    delete recv_T;
+
+    return Ac;
+}
@@ -35,6 +35,30 @@ void SOR_forward(ParCSRMatrix* A, ParVector& x, const ParVector& y,
     double diag;
     double row_sum;
 
+    // Diagonal block stored with 16-bit column offsets
+    CompressedCSRMatrix* A_on = A->on_proc_compressed;
+    if (A_on)
+    {
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            start_on = A_on->idx1[i];
+            if (start_on == A_on->idx1[i+1] || A_on->col(i, start_on) != i)
+                continue;
+            diag = A_on->vals[start_on];
+            row_sum = A_on->row_sum(i, start_on + 1, x.local.data());
+
+            end_off = A->off_proc->idx1[i+1];
+            for (int j = A->off_proc->idx1[i]; j < end_off; j++)
+            {
+                col = A->off_proc->idx2[j];
+                row_sum += A->off_proc->vals[j] * dist_x[col];
+            }
+
+            x[i] = (x[i] + omega * (y[i] - x[i] - row_sum)) / diag;
+        }
+        return;
+    }
+
     start_on = 0;
     start_off = 0;
     for (int i = 0; i < A->local_num_rows; i++)
@@ -74,6 +98,30 @@ void SOR_backward(ParCSRMatrix* A, ParVector& x, const ParVector& y,
     double diag;
     double row_sum;
 
+    // Diagonal block stored with 16-bit column offsets
+    CompressedCSRMatrix* A_on = A->on_proc_compressed;
+    if (A_on)
+    {
+        for (int i = A->local_num_rows - 1; i >= 0; i--)
+        {
+            start = A_on->idx1[i];
+            if (start == A_on->idx1[i+1] || A_on->col(i, start) != i)
+                continue;
+            diag = A_on->vals[start];
+            row_sum = A_on->row_sum(i, start + 1, x.local.data());
+
+            end = A->off_proc->idx1[i+1];
+            for (int j = A->off_proc->idx1[i]; j < end; j++)
+            {
+                col = A->off_proc->idx2[j];
+                row_sum += A->off_proc->vals[j] * dist_x[col];
+            }
+
+            x[i] = ((1.0 - omega)*x[i]) + (omega*((y[i] - row_sum) / diag));
+        }
+        return;
+    }
+
     for (int i = A->local_num_rows - 1; i >= 0; i--)
     {
         row_sum = 0;
@@ -103,6 +151,91 @@ void SOR_backward(ParCSRMatrix* A, ParVector& x, const ParVector& y,
     }
 }
 
+/**************************************************************
+ *****   SOR Sweeps Over a Symmetric Diagonal Block
+ **************************************************************
+ ***** SOR_forward and SOR_backward for matrices whose on_proc is
+ ***** replaced by its upper triangle.  Row i holds a_ij for j > i,
+ ***** and the terms a_ij * x[j] with j < i are summed in lower[i]
+ ***** by scattering each row of the triangle: after x[i] is 
+ ***** updated in forward sweeps, and before backward sweeps (which
+ ***** use the old x[j] for j < i).
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** lower : double*
+ *****    Local-length scratch array
+ **************************************************************/
+void SOR_forward_sym(ParCSRMatrix* A, ParVector& x, const ParVector& y, 
+        const aligned_vector<double>& dist_x, double omega, double* lower)
+{
+    SymCSRMatrix* A_on = A->on_proc_sym;
+    std::fill(lower, lower + A->local_num_rows, 0.0);
+
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        int start = A_on->idx1[i];
+        int end = A_on->idx1[i+1];
+        bool has_diag = start < end && A_on->idx2[start] == i;
+        if (has_diag)
+        {
+            double diag = A_on->vals[start];
+            double row_sum = lower[i];
+            for (int j = start + 1; j < end; j++)
+            {
+                row_sum += A_on->vals[j] * x[A_on->idx2[j]];
+            }
+            for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+            {
+                row_sum += A->off_proc->vals[j] * dist_x[A->off_proc->idx2[j]];
+            }
+            x[i] = (x[i] + omega * (y[i] - x[i] - row_sum)) / diag;
+            start++;
+        }
+
+        double x_val = x[i];
+        for (int j = start; j < end; j++)
+        {
+            lower[A_on->idx2[j]] += A_on->vals[j] * x_val;
+        }
+    }
+}
+
+void SOR_backward_sym(ParCSRMatrix* A, ParVector& x, const ParVector& y,
+        const aligned_vector<double>& dist_x, double omega, double* lower)
+{
+    SymCSRMatrix* A_on = A->on_proc_sym;
+    std::fill(lower, lower + A->local_num_rows, 0.0);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        double x_val = x[i];
+        for (int j = A_on->idx1[i]; j < A_on->idx1[i+1]; j++)
+        {
+            int col = A_on->idx2[j];
+            if (col != i) lower[col] += A_on->vals[j] * x_val;
+        }
+    }
+
+    for (int i = A->local_num_rows - 1; i >= 0; i--)
+    {
+        int start = A_on->idx1[i];
+        int end = A_on->idx1[i+1];
+        if (start == end || A_on->idx2[start] != i) continue;
+
+        double diag = A_on->vals[start];
+        double row_sum = lower[i];
+        for (int j = start + 1; j < end; j++)
+        {
+            row_sum += A_on->vals[j] * x[A_on->idx2[j]];
+        }
+        for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+        {
+            row_sum += A->off_proc->vals[j] * dist_x[A->off_proc->idx2[j]];
+        }
+        x[i] = ((1.0 - omega)*x[i]) + (omega*((y[i] - row_sum) / diag));
+    }
+}
+
 void jacobi_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
         int num_sweeps, double omega, CommPkg* comm, data_t* comm_t)
 {
@@ -119,6 +252,35 @@ void jacobi_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
         comm->communicate(x);
         if (comm_t) *comm_t += MPI_Wtime();
         aligned_vector<double>& dist_x = comm->get_buffer<double>();
+
+        // With solve phase (SELL or single precision) copies, form 
+        // the residual tmp = b - A*x and update x += omega * tmp / diag
+        if (A->solve_on_proc() != A->on_proc)
+        {
+            A->solve_on_proc()->spmv_residual(x.local.data(), b.local.data(), 
+                    tmp.local.data());
+            if (A->off_proc_num_cols)
+            {
+                A->solve_off_proc()->spmv_append_neg(dist_x.data(), tmp.local.data());
+            }
+            // The diagonal leads each row of on_proc (or of its upper
+            // triangle, when that replaces it)
+            Matrix* A_diag = A->on_proc_sym ? (Matrix*) A->on_proc_sym : A->on_proc;
+            for (int i = 0; i < A->local_num_rows; i++)
+            {
+                start = A_diag->idx1[i];
+                if (start < A_diag->idx1[i+1] && A_diag->idx2[start] == i)
+                {
+                    diag = A_diag->vals[start];
+                    if (fabs(diag) > zero_tol)
+                    {
+                        x[i] += omega * tmp[i] / diag;
+                    }
+                }
+            }
+            continue;
+        }
+
         for (int i = 0; i < A->local_num_rows; i++)
         {
             tmp[i] = x[i];
@@ -129,8 +291,13 @@ void jacobi_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
             diag = 0;
             row_sum = 0;
 
-            start = A->on_proc->idx1[i]+1;
+            start = A->on_proc->idx1[i];
             end = A->on_proc->idx1[i+1];
+            if (start < end && A->on_proc->idx2[start] == i)
+            {
+                diag = A->on_proc->vals[start];
+                start++;
+            }
             for (int j = start; j < end; j++)
             {
                 col = A->on_proc->idx2[j];
@@ -160,12 +327,18 @@ void sor_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
     A->off_proc->sort();
     A->on_proc->move_diag();
 
+    // Compressed copies hold every entry of on_proc
+    bool use_sym = A->on_proc_sym && !A->on_proc_compressed;
     for (int iter = 0; iter < num_sweeps; iter++)
     {
         if (comm_t) *comm_t -= MPI_Wtime();
         comm->communicate(x);
         if (comm_t) *comm_t += MPI_Wtime();
-        SOR_forward(A, x, b, comm->get_buffer<double>(), omega);
+        if (use_sym)
+            SOR_forward_sym(A, x, b, comm->get_buffer<double>(), omega,
+                    tmp.local.data());
+        else
+            SOR_forward(A, x, b, comm->get_buffer<double>(), omega);
     }
 }
 
@@ -177,13 +350,25 @@ void ssor_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
     A->off_proc->sort();
     A->on_proc->move_diag();
 
+    // Compressed copies hold every entry of on_proc
+    bool use_sym = A->on_proc_sym && !A->on_proc_compressed;
     for (int iter = 0; iter < num_sweeps; iter++)
     {
         if (comm_t) *comm_t -= MPI_Wtime();
         comm->communicate(x);
         if (comm_t) *comm_t += MPI_Wtime();
-        SOR_forward(A, x, b, comm->get_buffer<double>(), omega);
-        SOR_backward(A, x, b, comm->get_buffer<double>(), omega);
+        if (use_sym)
+        {
+            SOR_forward_sym(A, x, b, comm->get_buffer<double>(), omega,
+                    tmp.local.data());
+            SOR_backward_sym(A, x, b, comm->get_buffer<double>(), omega,
+                    tmp.local.data());
+        }
+        else
+        {
+            SOR_forward(A, x, b, comm->get_buffer<double>(), omega);
+            SOR_backward(A, x, b, comm->get_buffer<double>(), omega);
+        }
     }
 }
 
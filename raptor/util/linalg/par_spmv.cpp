@@ -46,7 +46,7 @@ void ParMatrix::mult(ParVector& x, ParVector& b, bool tap, data_t* comm_t)
     // setting b = A_diag*x_local
     if (local_num_rows)
     {
-        on_proc->mult(x.local, b.local);
+        solve_on_proc()->mult(x.local, b.local);
     }
 
     // Wait for Isends and Irecvs to complete
@@ -58,7 +58,7 @@ void ParMatrix::mult(ParVector& x, ParVector& b, bool tap, data_t* comm_t)
     // solution in b (b += A_offd * x_distant)
     if (off_proc_num_cols)
     {
-        off_proc->mult_append(x_tmp, b.local);
+        solve_off_proc()->mult_append(x_tmp, b.local);
     }
 }
 
@@ -80,7 +80,7 @@ void ParMatrix::tap_mult(ParVector& x, ParVector& b, data_t* comm_t)
     // setting b = A_diag*x_local
     if (local_num_rows)
     {
-        on_proc->mult(x.local, b.local);
+        solve_on_proc()->mult(x.local, b.local);
     }
 
     // Wait for Isends and Irecvs to complete
@@ -92,7 +92,7 @@ void ParMatrix::tap_mult(ParVector& x, ParVector& b, data_t* comm_t)
     // solution in b (b += A_offd * x_distant)
     if (off_proc_num_cols)
     {
-        off_proc->mult_append(x_tmp, b.local);
+        solve_off_proc()->mult_append(x_tmp, b.local);
     }
 }
 
@@ -120,7 +120,7 @@ void ParMatrix::mult_append(ParVector& x, ParVector& b, bool tap, data_t* comm_t
     // setting b = A_diag*x_local
     if (local_num_rows)
     {
-        on_proc->mult_append(x.local, b.local);
+        solve_on_proc()->mult_append(x.local, b.local);
     }
 
     // Wait for Isends and Irecvs to complete
@@ -132,7 +132,7 @@ void ParMatrix::mult_append(ParVector& x, ParVector& b, bool tap, data_t* comm_t
     // solution in b (b += A_offd * x_distant)
     if (off_proc_num_cols)
     {
-        off_proc->mult_append(x_tmp, b.local);
+        solve_off_proc()->mult_append(x_tmp, b.local);
     }
 }
 
@@ -154,7 +154,7 @@ void ParMatrix::tap_mult_append(ParVector& x, ParVector& b, data_t* comm_t)
     // setting b = A_diag*x_local
     if (local_num_rows)
     {
-        on_proc->mult_append(x.local, b.local);
+        solve_on_proc()->mult_append(x.local, b.local);
     }
 
     // Wait for Isends and Irecvs to complete
@@ -166,7 +166,7 @@ void ParMatrix::tap_mult_append(ParVector& x, ParVector& b, data_t* comm_t)
     // solution in b (b += A_offd * x_distant)
     if (off_proc_num_cols)
     {
-        off_proc->mult_append(x_tmp, b.local);
+        solve_off_proc()->mult_append(x_tmp, b.local);
     }
 }
 
@@ -190,7 +190,7 @@ void ParMatrix::mult_T(ParVector& x, ParVector& b, bool tap, data_t* comm_t)
     if (x_tmp.size() <= comm->recv_data->size_msgs * off_proc->b_cols)
         x_tmp.resize(comm->recv_data->size_msgs * off_proc->b_cols);
 
-    off_proc->mult_T(x.local, x_tmp);
+    solve_off_proc()->mult_T(x.local, x_tmp);
 
     if (comm_t) *comm_t -= MPI_Wtime();
     comm->init_comm_T(x_tmp, off_proc->b_cols);
@@ -198,7 +198,7 @@ void ParMatrix::mult_T(ParVector& x, ParVector& b, bool tap, data_t* comm_t)
 
     if (local_num_rows)
     {
-        on_proc->mult_T(x.local, b.local);
+        solve_on_proc()->mult_T(x.local, b.local);
     }
 
     if (comm_t) *comm_t -= MPI_Wtime();
@@ -220,7 +220,7 @@ void ParMatrix::tap_mult_T(ParVector& x, ParVector& b, data_t* comm_t)
     if (x_tmp.size() < tap_comm->recv_size * off_proc->b_cols)
         x_tmp.resize(tap_comm->recv_size * off_proc->b_cols);
 
-    off_proc->mult_T(x.local, x_tmp);
+    solve_off_proc()->mult_T(x.local, x_tmp);
 
     if (comm_t) *comm_t -= MPI_Wtime();
     tap_comm->init_comm_T(x_tmp, off_proc->b_cols);
@@ -228,7 +228,7 @@ void ParMatrix::tap_mult_T(ParVector& x, ParVector& b, data_t* comm_t)
 
     if (local_num_rows)
     {
-        on_proc->mult_T(x.local, b.local);
+        solve_on_proc()->mult_T(x.local, b.local);
     }
 
     if (comm_t) *comm_t -= MPI_Wtime();
@@ -257,14 +257,15 @@ void ParMatrix::residual(ParVector& x, ParVector& b, ParVector& r, bool tap,
     comm->init_comm(x, off_proc->b_cols);
     if (comm_t) *comm_t += MPI_Wtime();
 
-    std::copy(b.local.values.begin(), b.local.values.end(), 
-            r.local.values.begin());
-
     // Multiply the diagonal portion of the matrix,
-    // setting b = A_diag*x_local
+    // setting r = b - A_diag*x_local
     if (local_num_rows && on_proc_num_cols)
     {
-        on_proc->residual(x.local, b.local, r.local);
+        solve_on_proc()->residual(x.local, b.local, r.local);
+    }
+    else
+    {
+        r.local.copy(b.local);
     }
 
     // Wait for Isends and Irecvs to complete
@@ -276,7 +277,7 @@ void ParMatrix::residual(ParVector& x, ParVector& b, ParVector& r, bool tap,
     // solution in b (b += A_offd * x_distant)
     if (off_proc_num_cols)
     {
-        off_proc->mult_append_neg(x_tmp, r.local);
+        solve_off_proc()->mult_append_neg(x_tmp, r.local);
     }
 }
 
@@ -295,13 +296,15 @@ void ParMatrix::tap_residual(ParVector& x, ParVector& b, ParVector& r,
     tap_comm->init_comm(x, off_proc->b_cols);
     if (comm_t) *comm_t += MPI_Wtime();
 
-    std::copy(b.local.values.begin(), b.local.values.end(), r.local.values.begin());
-
     // Multiply the diagonal portion of the matrix,
-    // setting b = A_diag*x_local
+    // setting r = b - A_diag*x_local
     if (local_num_rows && on_proc_num_cols)
     {
-        on_proc->mult_append_neg(x.local, r.local);
+        solve_on_proc()->residual(x.local, b.local, r.local);
+    }
+    else
+    {
+        r.local.copy(b.local);
     }
 
     // Wait for Isends and Irecvs to complete
@@ -313,7 +316,7 @@ void ParMatrix::tap_residual(ParVector& x, ParVector& b, ParVector& r,
     // solution in b (b += A_offd * x_distant)
     if (off_proc_num_cols)
     {
-        off_proc->mult_append_neg(x_tmp, r.local);
+        solve_off_proc()->mult_append_neg(x_tmp, r.local);
     }
 }
 
@@ -390,3 +393,216 @@ void ParCSCMatrix::tap_mult_T(ParVector& x, ParVector& b,
     ParMatrix::tap_mult_T(x, b, comm_t);
 }
 
+
+// Returns the communication package for SpMVs, forming it on first use
+CommPkg* get_spmv_comm(ParMatrix* A, bool tap)
+{
+    if (tap)
+    {
+        if (A->tap_comm == NULL)
+        {
+            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
+                    A->on_proc_column_map);
+        }
+        return A->tap_comm;
+    }
+
+    if (A->comm == NULL)
+    {
+        A->comm = new ParComm(A->partition, A->off_proc_column_map, 
+                A->on_proc_column_map);
+    }
+    return A->comm;
+}
+
+// Whether SpMM kernels apply to A : block matrices, and matrices 
+// with solve phase copies (SELL, float, etc.) installed, form each
+// product one vector at a time through the ParVector products
+bool use_multi_vector(ParMatrix* A)
+{
+    if (A->on_proc->b_rows > 1 || A->on_proc->b_cols > 1)
+        return false;
+    return A->solve_on_proc() == A->on_proc 
+        && A->solve_off_proc() == A->off_proc;
+}
+
+/**************************************************************
+ *****   Parallel Matrix-Multi-Vector Multiplication
+ **************************************************************
+ ***** Performs parallel SpMM B = A*X on all vectors of X, with 
+ ***** one message per neighbor carrying n_vecs values per column
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** x : ParMultiVector&
+ *****    Parallel vectors to be multiplied
+ ***** b : ParMultiVector&
+ *****    Parallel vectors result is returned in
+ **************************************************************/
+void ParCSRMatrix::mult(ParMultiVector& x, ParMultiVector& b, bool tap,
+        data_t* comm_t)
+{
+    if (!use_multi_vector(this))
+    {
+        ParVector x_v, b_v;
+        for (int v = 0; v < x.n_vecs; v++)
+        {
+            x.get_vector(v, x_v);
+            b.get_vector(v, b_v);
+            mult(x_v, b_v, tap, comm_t);
+            b.set_vector(v, b_v);
+        }
+        return;
+    }
+    CommPkg* comm_pkg = get_spmv_comm(this, tap);
+    int n_vecs = x.n_vecs;
+    CSRMatrix* A_on = (CSRMatrix*) on_proc;
+    CSRMatrix* A_off = (CSRMatrix*) off_proc;
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm(x);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (local_num_rows)
+    {
+        A_on->spmm(x.local.data(), b.local.data(), n_vecs);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<double>& x_tmp = comm_pkg->complete_comm<double>(n_vecs);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (off_proc_num_cols)
+    {
+        A_off->spmm_append(x_tmp.data(), b.local.data(), n_vecs);
+    }
+}
+
+void ParCSRMatrix::mult_append(ParMultiVector& x, ParMultiVector& b, bool tap,
+        data_t* comm_t)
+{
+    if (!use_multi_vector(this))
+    {
+        ParVector x_v, b_v;
+        for (int v = 0; v < x.n_vecs; v++)
+        {
+            x.get_vector(v, x_v);
+            b.get_vector(v, b_v);
+            mult_append(x_v, b_v, tap, comm_t);
+            b.set_vector(v, b_v);
+        }
+        return;
+    }
+    CommPkg* comm_pkg = get_spmv_comm(this, tap);
+    int n_vecs = x.n_vecs;
+    CSRMatrix* A_on = (CSRMatrix*) on_proc;
+    CSRMatrix* A_off = (CSRMatrix*) off_proc;
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm(x);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (local_num_rows)
+    {
+        A_on->spmm_append(x.local.data(), b.local.data(), n_vecs);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<double>& x_tmp = comm_pkg->complete_comm<double>(n_vecs);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (off_proc_num_cols)
+    {
+        A_off->spmm_append(x_tmp.data(), b.local.data(), n_vecs);
+    }
+}
+
+void ParCSRMatrix::residual(ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& r, bool tap, data_t* comm_t)
+{
+    if (!use_multi_vector(this))
+    {
+        ParVector x_v, b_v, r_v;
+        for (int v = 0; v < x.n_vecs; v++)
+        {
+            x.get_vector(v, x_v);
+            b.get_vector(v, b_v);
+            r.get_vector(v, r_v);
+            residual(x_v, b_v, r_v, tap, comm_t);
+            r.set_vector(v, r_v);
+        }
+        return;
+    }
+    CommPkg* comm_pkg = get_spmv_comm(this, tap);
+    int n_vecs = x.n_vecs;
+    CSRMatrix* A_on = (CSRMatrix*) on_proc;
+    CSRMatrix* A_off = (CSRMatrix*) off_proc;
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm(x);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    // r = b - A_diag*X_local
+    if (local_num_rows && on_proc_num_cols)
+    {
+        A_on->spmm_residual(x.local.data(), b.local.data(), r.local.data(), 
+                n_vecs);
+    }
+    else
+    {
+        r.local.copy(b.local);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<double>& x_tmp = comm_pkg->complete_comm<double>(n_vecs);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (off_proc_num_cols)
+    {
+        A_off->spmm_append_neg(x_tmp.data(), r.local.data(), n_vecs);
+    }
+}
+
+void ParCSRMatrix::mult_T(ParMultiVector& x, ParMultiVector& b, bool tap,
+        data_t* comm_t)
+{
+    if (!use_multi_vector(this))
+    {
+        ParVector x_v, b_v;
+        for (int v = 0; v < x.n_vecs; v++)
+        {
+            x.get_vector(v, x_v);
+            b.get_vector(v, b_v);
+            mult_T(x_v, b_v, tap, comm_t);
+            b.set_vector(v, b_v);
+        }
+        return;
+    }
+    CommPkg* comm_pkg = get_spmv_comm(this, tap);
+    int n_vecs = x.n_vecs;
+    CSRMatrix* A_on = (CSRMatrix*) on_proc;
+    CSRMatrix* A_off = (CSRMatrix*) off_proc;
+
+    // Products with off_proc columns are sent to their owners,
+    // n_vecs values per column
+    aligned_vector<double>& x_tmp = comm_pkg->get_buffer<double>();
+    int size = off_proc_num_cols * n_vecs;
+    if ((int) x_tmp.size() < size)
+        x_tmp.resize(size);
+    std::fill(x_tmp.begin(), x_tmp.begin() + size, 0.0);
+    A_off->spmm_append_T(x.local.data(), x_tmp.data(), n_vecs);
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm_T(x_tmp, n_vecs);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    b.local.set_const_value(0.0);
+    if (local_num_rows)
+    {
+        A_on->spmm_append_T(x.local.data(), b.local.data(), n_vecs);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->complete_comm_T<double>(b.local.values, n_vecs);
+    if (comm_t) *comm_t += MPI_Wtime();
+}
@@ -0,0 +1,195 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "reorder.hpp"
+
+// Forms the pattern of A + A^T, without the diagonal
+void symmetric_adjacency(const CSRMatrix* A, aligned_vector<int>& adj_ptr,
+        aligned_vector<int>& adj)
+{
+    int n = A->n_rows;
+    adj_ptr.resize(n + 1);
+    std::fill(adj_ptr.begin(), adj_ptr.end(), 0);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            int col = A->idx2[j];
+            if (col == i) continue;
+            adj_ptr[i+1]++;
+            adj_ptr[col+1]++;
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        adj_ptr[i+1] += adj_ptr[i];
+    }
+
+    adj.resize(adj_ptr[n]);
+    aligned_vector<int> pos(adj_ptr.begin(), adj_ptr.end() - 1);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            int col = A->idx2[j];
+            if (col == i) continue;
+            adj[pos[i]++] = col;
+            adj[pos[col]++] = i;
+        }
+    }
+
+    // Remove duplicates (from entries stored in both triangles)
+    int ctr = 0;
+    int start = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int end = adj_ptr[i+1];
+        std::sort(adj.begin() + start, adj.begin() + end);
+        for (int j = start; j < end; j++)
+        {
+            if (j == start || adj[j] != adj[j-1])
+            {
+                adj[ctr++] = adj[j];
+            }
+        }
+        start = end;
+        adj_ptr[i+1] = ctr;
+    }
+    adj.resize(ctr);
+}
+
+// Breadth-first search from root over unnumbered vertices, returning
+// the number of levels and the vertices of the last level
+int bfs_last_level(int root, const aligned_vector<int>& adj_ptr, 
+        const aligned_vector<int>& adj, const aligned_vector<int>& numbered,
+        aligned_vector<int>& marker, int mark, aligned_vector<int>& queue,
+        aligned_vector<int>& last_level)
+{
+    int n_levels = 0;
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = root;
+    marker[root] = mark;
+    while (head < tail)
+    {
+        int level_end = tail;
+        last_level.assign(queue.begin() + head, queue.begin() + level_end);
+        n_levels++;
+        for (; head < level_end; head++)
+        {
+            int row = queue[head];
+            for (int j = adj_ptr[row]; j < adj_ptr[row+1]; j++)
+            {
+                int col = adj[j];
+                if (numbered[col] || marker[col] == mark) continue;
+                marker[col] = mark;
+                queue[tail++] = col;
+            }
+        }
+    }
+    return n_levels;
+}
+
+void rcm_ordering(const CSRMatrix* A, aligned_vector<int>& perm,
+        reorder_t reorder_type)
+{
+    int n = A->n_rows;
+    perm.resize(n);
+    if (n == 0) return;
+
+    aligned_vector<int> adj_ptr;
+    aligned_vector<int> adj;
+    symmetric_adjacency(A, adj_ptr, adj);
+
+    aligned_vector<int> degree(n);
+    for (int i = 0; i < n; i++)
+    {
+        degree[i] = adj_ptr[i+1] - adj_ptr[i];
+    }
+
+    // Candidate roots, by increasing degree
+    aligned_vector<int> by_degree(n);
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(), 
+            [&](const int i, const int j)
+            {
+                return degree[i] < degree[j];
+            });
+
+    aligned_vector<int> numbered(n, 0);
+    aligned_vector<int> marker(n, -1);
+    aligned_vector<int> queue(n);
+    aligned_vector<int> last_level;
+    aligned_vector<int> order;
+    order.reserve(n);
+    int mark = 0;
+
+    for (int k = 0; k < n; k++)
+    {
+        int root = by_degree[k];
+        if (numbered[root]) continue;
+
+        // Move root to a pseudo-peripheral vertex: the lowest degree
+        // vertex of the last level, while that increases the depth
+        if (reorder_type == PeripheralRCM)
+        {
+            int depth = bfs_last_level(root, adj_ptr, adj, numbered, marker,
+                    mark++, queue, last_level);
+            while (true)
+            {
+                int next = last_level[0];
+                for (int i = 1; i < (int) last_level.size(); i++)
+                {
+                    if (degree[last_level[i]] < degree[next])
+                        next = last_level[i];
+                }
+                int next_depth = bfs_last_level(next, adj_ptr, adj, numbered,
+                        marker, mark++, queue, last_level);
+                if (next_depth <= depth) break;
+                root = next;
+                depth = next_depth;
+            }
+        }
+
+        // Cuthill-McKee search of the component containing root
+        int head = order.size();
+        order.push_back(root);
+        numbered[root] = 1;
+        while (head < (int) order.size())
+        {
+            int row = order[head++];
+            int first = order.size();
+            for (int j = adj_ptr[row]; j < adj_ptr[row+1]; j++)
+            {
+                int col = adj[j];
+                if (numbered[col]) continue;
+                numbered[col] = 1;
+                order.push_back(col);
+            }
+            std::stable_sort(order.begin() + first, order.end(),
+                    [&](const int i, const int j)
+                    {
+                        return degree[i] < degree[j];
+                    });
+        }
+    }
+
+    // Reverse
+    for (int i = 0; i < n; i++)
+    {
+        perm[i] = order[n - 1 - i];
+    }
+}
+
+int bandwidth(const CSRMatrix* A)
+{
+    int bw = 0;
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            int dist = abs(A->idx2[j] - i);
+            if (dist > bw) bw = dist;
+        }
+    }
+    return bw;
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_UTIL_LINALG_REORDER_HPP
+#define RAPTOR_UTIL_LINALG_REORDER_HPP
+
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+
+using namespace raptor;
+
+/**************************************************************
+ *****   Reverse Cuthill-McKee Ordering
+ **************************************************************
+ ***** Finds a bandwidth-reducing ordering of the rows (and 
+ ***** columns) of a square matrix, so that the vector values
+ ***** gathered by nearby rows lie close together in memory.
+ ***** The pattern of A + A^T is used, so A need not be 
+ ***** symmetric.  Each connected component is ordered by a 
+ ***** breadth-first search visiting neighbors in order of 
+ ***** increasing degree, and the final ordering is reversed.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : const CSRMatrix*
+ *****    Square matrix to reorder
+ ***** perm : aligned_vector<int>&
+ *****    Returns the ordering: perm[i] is the original row
+ *****    placed at position i
+ ***** reorder_type : reorder_t (default RCM)
+ *****    RCM starts each component from a vertex of minimum 
+ *****    degree.  PeripheralRCM starts from a pseudo-peripheral
+ *****    vertex (George-Liu), which costs a few extra searches
+ *****    but usually gives a smaller bandwidth.
+ **************************************************************/
+void rcm_ordering(const CSRMatrix* A, aligned_vector<int>& perm,
+        reorder_t reorder_type = RCM);
+
+// Largest distance |i - j| over nonzeros (i, j) of A
+int bandwidth(const CSRMatrix* A);
+
+#endif
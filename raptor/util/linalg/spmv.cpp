@@ -2,12 +2,14 @@
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 
 #include "core/matrix.hpp"
+#include "util/linalg/block_kernels.hpp"
+#include "util/linalg/spmv_simd.hpp"
 
 using namespace raptor;
 
 // COOMatrix SpMV Methods (or BCOO)
 template <typename T>
-void COO_append(const COOMatrix* A, const aligned_vector<T>& vals,
+void COO_append(const COOMatrix* A, const T& vals,
         const double* x, double* b)
 {
     for (int i = 0; i < A->nnz; i++)
@@ -16,16 +18,16 @@ void COO_append(const COOMatrix* A, const aligned_vector<T>& vals,
     }
 }
 template <typename T>
-void COO_append_T(const COOMatrix* A, const aligned_vector<T>& vals,
+void COO_append_T(const COOMatrix* A, const T& vals,
         const double* x, double* b)
 {
     for (int i = 0; i < A->nnz; i++)
     {
-        A->append_T(A->idx2[i], A->idx1[i], b, x, vals[i]);
+        A->append_T(A->idx1[i], A->idx2[i], b, x, vals[i]);
     }
 }
 template <typename T>
-void COO_append_neg(const COOMatrix* A, const aligned_vector<T>& vals,
+void COO_append_neg(const COOMatrix* A, const T& vals,
         const double* x, double* b)
 {
     for (int i = 0; i < A->nnz; i++)
@@ -34,7 +36,7 @@ void COO_append_neg(const COOMatrix* A, const aligned_vector<T>& vals,
     }
 }
 template <typename T>
-void COO_append_neg_T(const COOMatrix* A, const aligned_vector<T>& vals,
+void COO_append_neg_T(const COOMatrix* A, const T& vals,
         const double* x, double* b)
 {
     for (int i = 0; i < A->nnz; i++)
@@ -49,61 +51,102 @@ void COO_append_neg_T(const COOMatrix* A, const aligned_vector<T>& vals,
 
 // CSRMatrix SpMV Methods (or BSR)
 // Optimized CSR and BSR standard SpMVs
-void CSR_spmv(const CSRMatrix* A, const double* x, double* b)
-{
-    int start, end;
-    double val;
-    for (int i = 0; i < A->n_rows; i++)
+// out = y + alpha*A*x (y may be NULL or alias out), with rows split
+// among threads in nnz-balanced static partitions.  Values may be
+// double or float (FloatCSRMatrix), always accumulated in double.
+template <typename V, typename K>
+void CSR_append_helper(const Matrix* A, const V* vals, K kernel,
+        const double* x, const double* y, const double alpha, double* out)
+{
+    int n_rows = A->n_rows;
+    if (n_rows == 0) return;
+
+#ifdef _OPENMP
+#pragma omp parallel if (A->idx1[n_rows] >= omp_min_work)
+#endif
     {
-        start = A->idx1[i];
-        end = A->idx1[i+1];
-        val = 0;
-        for (int j = start; j < end; j++)
+        int first, last;
+        thread_rows(A->idx1.data(), n_rows, first, last);
+
+        if (kernel)
         {
-            val += A->vals[j] * x[A->idx2[j]];
+            kernel(last - first, &A->idx1[first], A->idx2.data(), vals,
+                    x, y ? &y[first] : NULL, alpha, &out[first]);
+        }
+        else
+        {
+            int start, end;
+            double val;
+            for (int i = first; i < last; i++)
+            {
+                start = A->idx1[i];
+                end = A->idx1[i+1];
+                val = 0;
+                for (int j = start; j < end; j++)
+                {
+                    val += (double) vals[j] * x[A->idx2[j]];
+                }
+                if (y) out[i] = y[i] + alpha * val;
+                else out[i] = alpha * val;
+            }
         }
-        b[i] = val;
     }
 }
 
+void CSR_append(const CSRMatrix* A, const double* x, const double* y,
+        const double alpha, double* out)
+{
+    CSR_append_helper(A, A->vals.data(), csr_simd_kernel(), x, y, alpha, out);
+}
+
+void CSR_spmv(const CSRMatrix* A, const double* x, double* b)
+{
+    CSR_append(A, x, NULL, 1.0, b);
+}
+
 void CSR_residual(const CSRMatrix* A, const double* x, 
         const double* b, double* r)
+{
+    CSR_append(A, x, b, -1.0, r);
+}
+
+void CSR_append(const CSRMatrix* A, const double* x, double* b)
+{
+    CSR_append(A, x, b, 1.0, b);
+}
+
+template <typename T>
+void CSR_append_T(const CSRMatrix* A, const T& vals,
+        const double* x, double* b)
 {
     int start, end;
-    double val;
     for (int i = 0; i < A->n_rows; i++)
     {
         start = A->idx1[i];
         end = A->idx1[i+1];
-        val = b[i];
         for (int j = start; j < end; j++)
         {
-            val -= A->vals[j] * x[A->idx2[j]];
+            A->append_T(i, A->idx2[j], b, x, vals[j]);
         }
-        r[i] = val;
     }
 }
-
-
-void CSR_append(const CSRMatrix* A, const double* x, double* b)
+template <typename T>
+void CSR_append_neg(const CSRMatrix* A, const T& vals,
+        const double* x, double* b)
 {
     int start, end;
-    double val;
     for (int i = 0; i < A->n_rows; i++)
     {
         start = A->idx1[i];
         end = A->idx1[i+1];
-        val = 0;
         for (int j = start; j < end; j++)
         {
-            val += A->vals[j] * x[A->idx2[j]];
+            A->append_neg(i, A->idx2[j], b, x, vals[j]);
         }
-        b[i] += val;
     }
 }
-
 template <typename T>
-void BSR_append(const CSRMatrix* A, const aligned_vector<T>& vals,
+void CSR_append_neg_T(const CSRMatrix* A, const T& vals,
         const double* x, double* b)
 {
     int start, end;
@@ -113,90 +156,217 @@ void BSR_append(const CSRMatrix* A, const aligned_vector<T>& vals,
         end = A->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            A->append(i, A->idx2[j], b, x, vals[j]);
+            A->append_neg_T(i, A->idx2[j], b, x, vals[j]);
         }
     }
 }
 
-void BSR_spmv(const BSRMatrix* A, const double* x, double* b)
+
+// SELLMatrix SpMV Methods
+// out = y + alpha*A*x (y may be NULL or alias out)
+void SELL_append(const SELLMatrix* A, const double* x, const double* y,
+        const double alpha, double* out)
 {
-    int start, end, idx;
-    int first_row, first_col;
-    double val;
-    double* block_val;
-    for (int i = 0; i < A->n_rows; i++)
+    sell_simd_kernel_t kernel = sell_simd_kernel(A->chunk_height);
+    if (kernel)
     {
-        start = A->idx1[i];
-        end = A->idx1[i+1];
-        first_row = i*A->b_rows;
-        for (int row = 0; row < A->b_rows; row++)
+        kernel(A->n_rows, A->idx1.data(), A->row_order.data(), A->idx2.data(),
+                A->vals.data(), x, y, alpha, out);
+        return;
+    }
+
+    int C = A->chunk_height;
+    int n_chunks = A->num_chunks();
+    if ((int) A->chunk_sums.size() < C) A->chunk_sums.resize(C);
+    double* sums = A->chunk_sums.data();
+    for (int c = 0; c < n_chunks; c++)
+    {
+        for (int r = 0; r < C; r++)
         {
-            val = 0;
-            idx = row * A->b_cols;
-            for (int j = start; j < end; j++)
+            sums[r] = 0.0;
+        }
+
+        // Values in each column of the chunk are contiguous
+        for (int j = A->idx1[c]; j < A->idx1[c+1]; j += C)
+        {
+            for (int r = 0; r < C; r++)
             {
-                first_col = A->idx2[j]*A->b_cols;
-                block_val = A->block_vals[j];
-                for (int col = 0; col < A->b_cols; col++)
-                {
-                    val += (block_val[idx + col] * x[first_col + col]);
-                }
+                sums[r] += A->vals[j + r] * x[A->idx2[j + r]];
             }
-            b[first_row + row] = val;
+        }
+
+        int first = c * C;
+        int n = std::min(C, A->n_rows - first);
+        for (int r = 0; r < n; r++)
+        {
+            int row = A->row_order[first + r];
+            if (y) out[row] = y[row] + alpha * sums[r];
+            else out[row] = alpha * sums[r];
         }
     }
 }
-template <typename T>
-void CSR_append_T(const CSRMatrix* A, const aligned_vector<T>& vals,
-        const double* x, double* b)
+
+// b += alpha*A^T*x
+void SELL_append_T(const SELLMatrix* A, const double* x, 
+        const double alpha, double* b)
 {
-    int start, end;
-    for (int i = 0; i < A->n_rows; i++)
+    int C = A->chunk_height;
+    for (int slot = 0; slot < A->n_rows; slot++)
     {
-        start = A->idx1[i];
-        end = A->idx1[i+1];
-        for (int j = start; j < end; j++)
+        double x_val = alpha * x[A->row_order[slot]];
+        int pos = A->idx1[slot / C] + (slot % C);
+        for (int k = 0; k < A->row_sizes[slot]; k++)
         {
-            A->append_T(i, A->idx2[j], b, x, vals[j]);
+            b[A->idx2[pos]] += A->vals[pos] * x_val;
+            pos += C;
         }
     }
 }
-template <typename T>
-void CSR_append_neg(const CSRMatrix* A, const aligned_vector<T>& vals,
-        const double* x, double* b)
+
+
+
+// FloatCSRMatrix SpMV Methods
+void FloatCSR_append(const FloatCSRMatrix* A, const double* x, const double* y,
+        const double alpha, double* out)
+{
+    CSR_append_helper(A, A->float_vals.data(), csr_float_simd_kernel(), 
+            x, y, alpha, out);
+}
+
+// b += alpha*A^T*x
+void FloatCSR_append_T(const FloatCSRMatrix* A, const double* x, 
+        const double alpha, double* b)
 {
-    int start, end;
     for (int i = 0; i < A->n_rows; i++)
     {
-        start = A->idx1[i];
-        end = A->idx1[i+1];
-        for (int j = start; j < end; j++)
+        double x_val = alpha * x[i];
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
         {
-            A->append_neg(i, A->idx2[j], b, x, vals[j]);
+            b[A->idx2[j]] += (double) A->float_vals[j] * x_val;
         }
     }
 }
-template <typename T>
-void CSR_append_neg_T(const CSRMatrix* A, const aligned_vector<T>& vals,
-        const double* x, double* b)
+
+
+// CompressedCSRMatrix SpMV Methods
+// out = y + alpha*A*x (y may be NULL or alias out)
+void CompressedCSR_append(const CompressedCSRMatrix* A, const double* x, 
+        const double* y, const double alpha, double* out)
+{
+    int n_rows = A->n_rows;
+    if (n_rows == 0) return;
+
+#ifdef _OPENMP
+#pragma omp parallel if (A->idx1[n_rows] >= omp_min_work)
+#endif
+    {
+        int first, last;
+        thread_rows(A->idx1.data(), n_rows, first, last);
+        for (int i = first; i < last; i++)
+        {
+            double val = A->row_sum(i, A->idx1[i], x);
+            if (y) out[i] = y[i] + alpha * val;
+            else out[i] = alpha * val;
+        }
+    }
+}
+
+// b += alpha*A^T*x
+void CompressedCSR_append_T(const CompressedCSRMatrix* A, const double* x, 
+        const double alpha, double* b)
 {
-    int start, end;
     for (int i = 0; i < A->n_rows; i++)
     {
-        start = A->idx1[i];
-        end = A->idx1[i+1];
-        for (int j = start; j < end; j++)
+        double x_val = alpha * x[i];
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
         {
-            A->append_neg_T(i, A->idx2[j], b, x, vals[j]);
+            b[A->col(i, j)] += A->vals[j] * x_val;
         }
     }
 }
 
 
+// SymCSRMatrix SpMV Methods
+// out = y + alpha*A*x (y may be NULL or alias out), applying each
+// stored entry (i, j) to rows i and j.  Rows are split among threads
+// as in CSR_append_helper.  Entries (i, j) with j past the rows of
+// the thread are summed into its scratch array and added by the
+// thread owning row j after a barrier.
+void SymCSR_append(const SymCSRMatrix* A, const double* x, 
+        const double* y, const double alpha, double* out)
+{
+    int n_rows = A->n_rows;
+    if (n_rows == 0) return;
+
+    int n_threads = num_threads();
+    if ((int) A->scatter.size() < n_threads) A->scatter.resize(n_threads);
+    aligned_vector<int> ends(n_threads);
+    aligned_vector<int> reach(n_threads);
+
+#ifdef _OPENMP
+#pragma omp parallel if (A->idx1[n_rows] >= omp_min_work)
+#endif
+    {
+        int first, last;
+        thread_rows(A->idx1.data(), n_rows, first, last);
+        int t = thread_num();
+        aligned_vector<double>& buf = A->scatter[t];
+        if ((int) buf.size() < n_rows - last) buf.resize(n_rows - last, 0.0);
+
+        for (int i = first; i < last; i++)
+        {
+            out[i] = y ? y[i] : 0.0;
+        }
+
+        int max_col = last;
+        for (int i = first; i < last; i++)
+        {
+            double x_val = alpha * x[i];
+            double sum = 0.0;
+            for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+            {
+                int col = A->idx2[j];
+                double val = A->vals[j];
+                sum += val * x[col];
+                if (col == i) continue;
+                if (col < last) out[col] += val * x_val;
+                else
+                {
+                    buf[col - last] += val * x_val;
+                    if (col >= max_col) max_col = col + 1;
+                }
+            }
+            out[i] += alpha * sum;
+        }
+        ends[t] = last;
+        reach[t] = max_col;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        for (int s = 0; s < t; s++)
+        {
+            const aligned_vector<double>& buf_s = A->scatter[s];
+            int start = std::max(first, ends[s]);
+            int end = std::min(last, reach[s]);
+            for (int i = start; i < end; i++)
+            {
+                out[i] += buf_s[i - ends[s]];
+            }
+        }
+
+        // Scratch is left zeroed for the next product
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        std::fill(buf.begin(), buf.begin() + (max_col - last), 0.0);
+    }
+}
+
 
 // CSCMatrix SpMV Methods (or BSC)
 template <typename T>
-void CSC_append(const CSCMatrix* A, const aligned_vector<T>& vals,
+void CSC_append(const CSCMatrix* A, const T& vals,
         const double* x, double* b)
 {
     int start, end;
@@ -211,7 +381,7 @@ void CSC_append(const CSCMatrix* A, const aligned_vector<T>& vals,
     }
 }
 template <typename T>
-void CSC_append_T(const CSCMatrix* A, const aligned_vector<T>& vals,
+void CSC_append_T(const CSCMatrix* A, const T& vals,
         const double* x, double* b)
 {
     int start, end;
@@ -226,7 +396,7 @@ void CSC_append_T(const CSCMatrix* A, const aligned_vector<T>& vals,
     }
 }
 template <typename T>
-void CSC_append_neg(const CSCMatrix* A, const aligned_vector<T>& vals,
+void CSC_append_neg(const CSCMatrix* A, const T& vals,
         const double* x, double* b)
 {
     int start, end;
@@ -241,7 +411,7 @@ void CSC_append_neg(const CSCMatrix* A, const aligned_vector<T>& vals,
     }
 }
 template <typename T>
-void CSC_append_neg_T(const CSCMatrix* A, const aligned_vector<T>& vals,
+void CSC_append_neg_T(const CSCMatrix* A, const T& vals,
         const double* x, double* b)
 {
     int start, end;
@@ -340,31 +510,141 @@ void CSRMatrix::spmv_residual(const double* x, const double* b, double* r) const
 {
     CSR_residual(this, x, b, r);
 }
+
+// CSRMatrix SpMM Methods
+// Multiple vectors are interleaved row-major, so each nonzero is
+// read once and applied to the n_vecs contiguous values of its
+// column.  Vectors are processed K at a time, with K fixed for 
+// common block widths so the inner loops are unrolled.
+template <int K>
+void CSR_spmm_rows(const CSRMatrix* A, int first, int last, int n_vecs,
+        const double* x, const double* y, const double alpha, double* out)
+{
+    const int width = K ? K : 8;
+    double sums[K ? K : 8];
+    for (int i = first; i < last; i++)
+    {
+        int start = A->idx1[i];
+        int end = A->idx1[i+1];
+        for (int v0 = 0; v0 < n_vecs; v0 += width)
+        {
+            int n = K ? K : std::min(width, n_vecs - v0);
+            for (int v = 0; v < n; v++)
+            {
+                sums[v] = 0.0;
+            }
+            for (int j = start; j < end; j++)
+            {
+                double val = A->vals[j];
+                const double* x_j = &x[A->idx2[j] * n_vecs + v0];
+                for (int v = 0; v < n; v++)
+                {
+                    sums[v] += val * x_j[v];
+                }
+            }
+
+            int pos = i * n_vecs + v0;
+            for (int v = 0; v < n; v++)
+            {
+                if (y) out[pos + v] = y[pos + v] + alpha * sums[v];
+                else out[pos + v] = alpha * sums[v];
+            }
+        }
+    }
+}
+
+// out = y + alpha*A*X (y may be NULL or alias out)
+void CSR_spmm(const CSRMatrix* A, const double* x, const double* y, 
+        const double alpha, double* out, int n_vecs)
+{
+    int n_rows = A->n_rows;
+    if (n_rows == 0) return;
+
+#ifdef _OPENMP
+#pragma omp parallel if ((long) A->idx1[n_rows] * n_vecs >= omp_min_work)
+#endif
+    {
+        int first, last;
+        thread_rows(A->idx1.data(), n_rows, first, last);
+        switch (n_vecs)
+        {
+            case 1: CSR_spmm_rows<1>(A, first, last, n_vecs, x, y, alpha, out); break;
+            case 2: CSR_spmm_rows<2>(A, first, last, n_vecs, x, y, alpha, out); break;
+            case 4: CSR_spmm_rows<4>(A, first, last, n_vecs, x, y, alpha, out); break;
+            case 8: CSR_spmm_rows<8>(A, first, last, n_vecs, x, y, alpha, out); break;
+            case 16: CSR_spmm_rows<16>(A, first, last, n_vecs, x, y, alpha, out); break;
+            default: CSR_spmm_rows<0>(A, first, last, n_vecs, x, y, alpha, out);
+        }
+    }
+}
+
+// b += A^T*X
+void CSR_spmm_append_T(const CSRMatrix* A, const double* x, double* b, 
+        int n_vecs)
+{
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        const double* x_i = &x[i * n_vecs];
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            double val = A->vals[j];
+            double* b_j = &b[A->idx2[j] * n_vecs];
+            for (int v = 0; v < n_vecs; v++)
+            {
+                b_j[v] += val * x_i[v];
+            }
+        }
+    }
+}
+
+void CSRMatrix::spmm(const double* x, double* b, int n_vecs) const
+{
+    CSR_spmm(this, x, NULL, 1.0, b, n_vecs);
+}
+void CSRMatrix::spmm_append(const double* x, double* b, int n_vecs) const
+{
+    CSR_spmm(this, x, b, 1.0, b, n_vecs);
+}
+void CSRMatrix::spmm_append_neg(const double* x, double* b, int n_vecs) const
+{
+    CSR_spmm(this, x, b, -1.0, b, n_vecs);
+}
+void CSRMatrix::spmm_append_T(const double* x, double* b, int n_vecs) const
+{
+    CSR_spmm_append_T(this, x, b, n_vecs);
+}
+void CSRMatrix::spmm_residual(const double* x, const double* b, double* r,
+        int n_vecs) const
+{
+    CSR_spmm(this, x, b, -1.0, r, n_vecs);
+}
 void BSRMatrix::spmv(const double* x, double* b) const
 {
-    BSR_spmv(this, x, b);
+    for (int i = 0; i < n_rows * b_rows; i++)
+        b[i] = 0.0;
+    bsr_append(this, block_vals, x, b, 1.0);
 }
 void BSRMatrix::spmv_append(const double* x,double* b) const
 {
-    BSR_append(this, block_vals, x, b);
+    bsr_append(this, block_vals, x, b, 1.0);
 }
 void BSRMatrix::spmv_append_T(const double* x,double* b) const
 {
-    CSR_append_T(this, block_vals, x, b);
+    bsr_append_T(this, block_vals, x, b, 1.0);
 }
 void BSRMatrix::spmv_append_neg(const double* x,double* b) const
 {
-    CSR_append_neg(this, block_vals, x, b);
+    bsr_append(this, block_vals, x, b, -1.0);
 }
 void BSRMatrix::spmv_append_neg_T(const double* x,double* b) const
 {
-    CSR_append_neg_T(this, block_vals, x, b);
+    bsr_append_T(this, block_vals, x, b, -1.0);
 }
 void BSRMatrix::spmv_residual(const double* x, const double* b, double* r) const
 {
     for (int i = 0; i < n_rows * b_rows; i++)
         r[i] = b[i];
-    CSR_append_neg(this, block_vals, x, r);
+    bsr_append(this, block_vals, x, r, -1.0);
 }
 
 
@@ -427,4 +707,102 @@ void BSCMatrix::spmv_residual(const double* x, const double* b, double* r) const
 }
 
 
+void SELLMatrix::spmv(const double* x, double* b) const
+{
+    SELL_append(this, x, NULL, 1.0, b);
+}
+void SELLMatrix::spmv_append(const double* x, double* b) const
+{
+    SELL_append(this, x, b, 1.0, b);
+}
+void SELLMatrix::spmv_append_T(const double* x, double* b) const
+{
+    SELL_append_T(this, x, 1.0, b);
+}
+void SELLMatrix::spmv_append_neg(const double* x, double* b) const
+{
+    SELL_append(this, x, b, -1.0, b);
+}
+void SELLMatrix::spmv_append_neg_T(const double* x, double* b) const
+{
+    SELL_append_T(this, x, -1.0, b);
+}
+void SELLMatrix::spmv_residual(const double* x, const double* b, double* r) const
+{
+    SELL_append(this, x, b, -1.0, r);
+}
 
+void FloatCSRMatrix::spmv(const double* x, double* b) const
+{
+    FloatCSR_append(this, x, NULL, 1.0, b);
+}
+void FloatCSRMatrix::spmv_append(const double* x, double* b) const
+{
+    FloatCSR_append(this, x, b, 1.0, b);
+}
+void FloatCSRMatrix::spmv_append_T(const double* x, double* b) const
+{
+    FloatCSR_append_T(this, x, 1.0, b);
+}
+void FloatCSRMatrix::spmv_append_neg(const double* x, double* b) const
+{
+    FloatCSR_append(this, x, b, -1.0, b);
+}
+void FloatCSRMatrix::spmv_append_neg_T(const double* x, double* b) const
+{
+    FloatCSR_append_T(this, x, -1.0, b);
+}
+void FloatCSRMatrix::spmv_residual(const double* x, const double* b, double* r) const
+{
+    FloatCSR_append(this, x, b, -1.0, r);
+}
+
+void CompressedCSRMatrix::spmv(const double* x, double* b) const
+{
+    CompressedCSR_append(this, x, NULL, 1.0, b);
+}
+void CompressedCSRMatrix::spmv_append(const double* x, double* b) const
+{
+    CompressedCSR_append(this, x, b, 1.0, b);
+}
+void CompressedCSRMatrix::spmv_append_T(const double* x, double* b) const
+{
+    CompressedCSR_append_T(this, x, 1.0, b);
+}
+void CompressedCSRMatrix::spmv_append_neg(const double* x, double* b) const
+{
+    CompressedCSR_append(this, x, b, -1.0, b);
+}
+void CompressedCSRMatrix::spmv_append_neg_T(const double* x, double* b) const
+{
+    CompressedCSR_append_T(this, x, -1.0, b);
+}
+void CompressedCSRMatrix::spmv_residual(const double* x, const double* b, double* r) const
+{
+    CompressedCSR_append(this, x, b, -1.0, r);
+}
+
+void SymCSRMatrix::spmv(const double* x, double* b) const
+{
+    SymCSR_append(this, x, NULL, 1.0, b);
+}
+void SymCSRMatrix::spmv_append(const double* x, double* b) const
+{
+    SymCSR_append(this, x, b, 1.0, b);
+}
+void SymCSRMatrix::spmv_append_T(const double* x, double* b) const
+{
+    SymCSR_append(this, x, b, 1.0, b);
+}
+void SymCSRMatrix::spmv_append_neg(const double* x, double* b) const
+{
+    SymCSR_append(this, x, b, -1.0, b);
+}
+void SymCSRMatrix::spmv_append_neg_T(const double* x, double* b) const
+{
+    SymCSR_append(this, x, b, -1.0, b);
+}
+void SymCSRMatrix::spmv_residual(const double* x, const double* b, double* r) const
+{
+    SymCSR_append(this, x, b, -1.0, r);
+}
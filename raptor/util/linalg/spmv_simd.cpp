@@ -0,0 +1,367 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "util/linalg/spmv_simd.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define RAPTOR_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace raptor;
+
+#ifdef RAPTOR_SIMD_X86
+// Gathers of x merge into a zeroed source under a full mask: the
+// unmasked intrinsics start from an undefined register, which GCC
+// reports as maybe-uninitialized
+__attribute__((target("avx2,fma")))
+static inline __m256d gather_x(const double* x, __m128i cols)
+{
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), x, cols,
+            _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d gather_x(const double* x, __m256i cols)
+{
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), (__mmask8) 0xFF,
+            cols, x, 8);
+}
+
+// Zero-masked forms of the float widening and of the 256-bit extracts,
+// for the same reason
+__attribute__((target("avx512f")))
+static inline __m512d widen_vals(__m256 vals)
+{
+    return _mm512_maskz_cvtps_pd((__mmask8) 0xFF, vals);
+}
+
+__attribute__((target("avx512f")))
+static inline double sum_lanes(__m512d acc)
+{
+    __m256d acc4 = _mm256_add_pd(
+            _mm512_maskz_extractf64x4_pd((__mmask8) 0xF, acc, 0),
+            _mm512_maskz_extractf64x4_pd((__mmask8) 0xF, acc, 1));
+    __m128d acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc4),
+            _mm256_extractf128_pd(acc4, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(acc2, _mm_unpackhi_pd(acc2, acc2)));
+}
+
+__attribute__((target("avx2,fma")))
+void csr_avx2(int n_rows, const int* idx1, const int* idx2, 
+        const double* vals, const double* x, const double* y,
+        double alpha, double* out)
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        int start = idx1[i];
+        int end = idx1[i+1];
+        int j = start;
+
+        __m256d acc = _mm256_setzero_pd();
+        for (; j + 4 <= end; j += 4)
+        {
+            __m128i cols = _mm_loadu_si128((const __m128i*) &idx2[j]);
+            __m256d x_j = gather_x(x, cols);
+            acc = _mm256_fmadd_pd(_mm256_loadu_pd(&vals[j]), x_j, acc);
+        }
+        __m128d acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc), 
+                _mm256_extractf128_pd(acc, 1));
+        double val = _mm_cvtsd_f64(_mm_add_sd(acc2, _mm_unpackhi_pd(acc2, acc2)));
+
+        for (; j < end; j++)
+        {
+            val += vals[j] * x[idx2[j]];
+        }
+
+        if (y) out[i] = y[i] + alpha * val;
+        else out[i] = alpha * val;
+    }
+}
+
+__attribute__((target("avx512f")))
+void csr_avx512(int n_rows, const int* idx1, const int* idx2, 
+        const double* vals, const double* x, const double* y,
+        double alpha, double* out)
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        int start = idx1[i];
+        int end = idx1[i+1];
+        int j = start;
+
+        __m512d acc = _mm512_setzero_pd();
+        for (; j + 8 <= end; j += 8)
+        {
+            __m256i cols = _mm256_loadu_si256((const __m256i*) &idx2[j]);
+            __m512d x_j = gather_x(x, cols);
+            acc = _mm512_fmadd_pd(_mm512_loadu_pd(&vals[j]), x_j, acc);
+        }
+        if (j < end)
+        {
+            // Masked tail, so short rows (e.g. 7-point stencils)
+            // still take a single vector iteration
+            __mmask8 mask = (__mmask8) ((1 << (end - j)) - 1);
+            __m256i cols = _mm512_maskz_extracti64x4_epi64(
+                    (__mmask8) 0xF, _mm512_maskz_loadu_epi32(
+                        (__mmask16) mask, &idx2[j]), 0);
+            __m512d x_j = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 
+                    mask, cols, x, 8);
+            acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, &vals[j]), 
+                    x_j, acc);
+        }
+        double val = sum_lanes(acc);
+
+        if (y) out[i] = y[i] + alpha * val;
+        else out[i] = alpha * val;
+    }
+}
+
+// Single precision values, converted to double before the FMA
+// so products and sums stay in double precision
+__attribute__((target("avx2,fma")))
+void csr_float_avx2(int n_rows, const int* idx1, const int* idx2, 
+        const float* vals, const double* x, const double* y,
+        double alpha, double* out)
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        int start = idx1[i];
+        int end = idx1[i+1];
+        int j = start;
+
+        __m256d acc = _mm256_setzero_pd();
+        for (; j + 4 <= end; j += 4)
+        {
+            __m128i cols = _mm_loadu_si128((const __m128i*) &idx2[j]);
+            __m256d x_j = gather_x(x, cols);
+            __m256d a_j = _mm256_cvtps_pd(_mm_loadu_ps(&vals[j]));
+            acc = _mm256_fmadd_pd(a_j, x_j, acc);
+        }
+        __m128d acc2 = _mm_add_pd(_mm256_castpd256_pd128(acc), 
+                _mm256_extractf128_pd(acc, 1));
+        double val = _mm_cvtsd_f64(_mm_add_sd(acc2, _mm_unpackhi_pd(acc2, acc2)));
+
+        for (; j < end; j++)
+        {
+            val += (double) vals[j] * x[idx2[j]];
+        }
+
+        if (y) out[i] = y[i] + alpha * val;
+        else out[i] = alpha * val;
+    }
+}
+
+__attribute__((target("avx512f")))
+void csr_float_avx512(int n_rows, const int* idx1, const int* idx2, 
+        const float* vals, const double* x, const double* y,
+        double alpha, double* out)
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        int start = idx1[i];
+        int end = idx1[i+1];
+        int j = start;
+
+        __m512d acc = _mm512_setzero_pd();
+        for (; j + 8 <= end; j += 8)
+        {
+            __m256i cols = _mm256_loadu_si256((const __m256i*) &idx2[j]);
+            __m512d x_j = gather_x(x, cols);
+            __m512d a_j = widen_vals(_mm256_loadu_ps(&vals[j]));
+            acc = _mm512_fmadd_pd(a_j, x_j, acc);
+        }
+        if (j < end)
+        {
+            __mmask8 mask = (__mmask8) ((1 << (end - j)) - 1);
+            __m256i cols = _mm512_maskz_extracti64x4_epi64(
+                    (__mmask8) 0xF, _mm512_maskz_loadu_epi32(
+                        (__mmask16) mask, &idx2[j]), 0);
+            __m512d x_j = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 
+                    mask, cols, x, 8);
+            __m256 a_f = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(
+                    (__mmask8) 0xF, _mm512_castps_pd(_mm512_maskz_loadu_ps(
+                        (__mmask16) mask, &vals[j])), 0));
+            acc = _mm512_fmadd_pd(widen_vals(a_f), x_j, acc);
+        }
+        double val = sum_lanes(acc);
+
+        if (y) out[i] = y[i] + alpha * val;
+        else out[i] = alpha * val;
+    }
+}
+
+// Write the sums of one chunk to the rows held in its slots
+inline void sell_store(int first, int n, const int* row_order, 
+        const double* sums, const double* y, double alpha, double* out)
+{
+    for (int r = 0; r < n; r++)
+    {
+        int row = row_order[first + r];
+        if (y) out[row] = y[row] + alpha * sums[r];
+        else out[row] = alpha * sums[r];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void sell4_avx2(int n_rows, const int* idx1, const int* row_order,
+        const int* idx2, const double* vals, const double* x, 
+        const double* y, double alpha, double* out)
+{
+    double sums[4];
+    int n_chunks = (n_rows + 3) / 4;
+    for (int c = 0; c < n_chunks; c++)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        for (int j = idx1[c]; j < idx1[c+1]; j += 4)
+        {
+            __m128i cols = _mm_loadu_si128((const __m128i*) &idx2[j]);
+            __m256d x_j = gather_x(x, cols);
+            acc = _mm256_fmadd_pd(_mm256_loadu_pd(&vals[j]), x_j, acc);
+        }
+        _mm256_storeu_pd(sums, acc);
+        sell_store(c*4, std::min(4, n_rows - c*4), row_order, sums, y, alpha, out);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void sell8_avx2(int n_rows, const int* idx1, const int* row_order,
+        const int* idx2, const double* vals, const double* x, 
+        const double* y, double alpha, double* out)
+{
+    double sums[8];
+    int n_chunks = (n_rows + 7) / 8;
+    for (int c = 0; c < n_chunks; c++)
+    {
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        for (int j = idx1[c]; j < idx1[c+1]; j += 8)
+        {
+            __m128i cols0 = _mm_loadu_si128((const __m128i*) &idx2[j]);
+            __m128i cols1 = _mm_loadu_si128((const __m128i*) &idx2[j+4]);
+            __m256d x0 = gather_x(x, cols0);
+            __m256d x1 = gather_x(x, cols1);
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(&vals[j]), x0, acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(&vals[j+4]), x1, acc1);
+        }
+        _mm256_storeu_pd(sums, acc0);
+        _mm256_storeu_pd(sums + 4, acc1);
+        sell_store(c*8, std::min(8, n_rows - c*8), row_order, sums, y, alpha, out);
+    }
+}
+
+__attribute__((target("avx512f")))
+void sell8_avx512(int n_rows, const int* idx1, const int* row_order,
+        const int* idx2, const double* vals, const double* x, 
+        const double* y, double alpha, double* out)
+{
+    double sums[8];
+    int n_chunks = (n_rows + 7) / 8;
+    for (int c = 0; c < n_chunks; c++)
+    {
+        __m512d acc = _mm512_setzero_pd();
+        for (int j = idx1[c]; j < idx1[c+1]; j += 8)
+        {
+            __m256i cols = _mm256_loadu_si256((const __m256i*) &idx2[j]);
+            __m512d x_j = gather_x(x, cols);
+            acc = _mm512_fmadd_pd(_mm512_loadu_pd(&vals[j]), x_j, acc);
+        }
+        _mm512_storeu_pd(sums, acc);
+        sell_store(c*8, std::min(8, n_rows - c*8), row_order, sums, y, alpha, out);
+    }
+}
+#endif
+
+simd_t raptor::detect_simd()
+{
+#ifdef RAPTOR_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return AVX2;
+#endif
+    return NoSIMD;
+}
+
+bool raptor::simd_supported(simd_t isa)
+{
+    static const simd_t max_isa = detect_simd();
+    return isa <= max_isa;
+}
+
+const char* raptor::simd_name(simd_t isa)
+{
+    switch (isa)
+    {
+        case AVX2: return "AVX2";
+        case AVX512: return "AVX-512";
+        default: return "Scalar";
+    }
+}
+
+simd_t& selected_simd()
+{
+    static simd_t isa = detect_simd();
+    return isa;
+}
+
+simd_t raptor::get_simd()
+{
+    return selected_simd();
+}
+
+void raptor::set_simd(simd_t isa)
+{
+    if (simd_supported(isa))
+        selected_simd() = isa;
+}
+
+csr_simd_kernel_t raptor::csr_simd_kernel()
+{
+#ifdef RAPTOR_SIMD_X86
+    switch (selected_simd())
+    {
+        case AVX512: return csr_avx512;
+        case AVX2: return csr_avx2;
+        default: return NULL;
+    }
+#else
+    return NULL;
+#endif
+}
+
+csr_float_simd_kernel_t raptor::csr_float_simd_kernel()
+{
+#ifdef RAPTOR_SIMD_X86
+    switch (selected_simd())
+    {
+        case AVX512: return csr_float_avx512;
+        case AVX2: return csr_float_avx2;
+        default: return NULL;
+    }
+#else
+    return NULL;
+#endif
+}
+
+sell_simd_kernel_t raptor::sell_simd_kernel(int chunk_height)
+{
+#ifdef RAPTOR_SIMD_X86
+    switch (selected_simd())
+    {
+        case AVX512:
+            if (chunk_height == 8) return sell8_avx512;
+            if (chunk_height == 4) return sell4_avx2;
+            return NULL;
+        case AVX2:
+            if (chunk_height == 8) return sell8_avx2;
+            if (chunk_height == 4) return sell4_avx2;
+            return NULL;
+        default: 
+            return NULL;
+    }
+#else
+    return NULL;
+#endif
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_UTIL_LINALG_SPMV_SIMD_HPP
+#define RAPTOR_UTIL_LINALG_SPMV_SIMD_HPP
+
+#include "core/types.hpp"
+
+/**************************************************************
+ *****   SIMD CSR Kernels
+ **************************************************************
+ ***** Gather-based AVX2 and AVX-512 kernels for scalar CSR
+ ***** and SELL SpMV.  The instruction set is detected once from CPUID
+ ***** on first use, and CSR_spmv, CSR_residual, and CSR_append
+ ***** fall back to their scalar loops when neither is available
+ ***** (or when RAPtor is built for a non-x86 target).
+ *****
+ ***** Each kernel computes, for every row i,
+ *****     out[i] = y[i] + alpha * (A*x)[i]
+ ***** where y may be NULL (treated as zero) or alias out.
+ **************************************************************/
+namespace raptor
+{
+    enum simd_t {NoSIMD, AVX2, AVX512};
+
+    typedef void (*csr_simd_kernel_t)(int n_rows, const int* idx1,
+            const int* idx2, const double* vals, const double* x,
+            const double* y, double alpha, double* out);
+
+    // CSR kernels with single precision values (accumulating in 
+    // double), used by FloatCSRMatrix
+    typedef void (*csr_float_simd_kernel_t)(int n_rows, const int* idx1,
+            const int* idx2, const float* vals, const double* x,
+            const double* y, double alpha, double* out);
+
+    // SELL-C-sigma kernels additionally take the row held in each
+    // chunk slot (idx1 holds chunk offsets)
+    typedef void (*sell_simd_kernel_t)(int n_rows, const int* idx1,
+            const int* row_order, const int* idx2, const double* vals, 
+            const double* x, const double* y, double alpha, double* out);
+
+    // Widest instruction set supported by this CPU
+    simd_t detect_simd();
+    bool simd_supported(simd_t isa);
+    const char* simd_name(simd_t isa);
+
+    // Instruction set used by CSR SpMV kernels.  set_simd may be
+    // used to force a narrower path (e.g. for benchmarking), and
+    // is ignored if the CPU does not support the requested set.
+    simd_t get_simd();
+    void set_simd(simd_t isa);
+
+    // Kernel for the selected instruction set, or NULL for scalar
+    csr_simd_kernel_t csr_simd_kernel();
+
+    csr_float_simd_kernel_t csr_float_simd_kernel();
+
+    // SELL kernel for the selected instruction set and chunk height
+    // (4 or 8 rows per chunk), or NULL for scalar
+    sell_simd_kernel_t sell_simd_kernel(int chunk_height);
+}
+
+#endif
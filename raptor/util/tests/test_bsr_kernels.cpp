@@ -0,0 +1,145 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+// Block tridiagonal matrix with distinct values in each block
+BSRMatrix* form_block_tridiag(int n, int b_rows, int b_cols,
+        aligned_vector<double>& dense)
+{
+    int b_size = b_rows * b_cols;
+    int n_rows = n * b_rows;
+    int n_cols = n * b_cols;
+    aligned_vector<int> rowptr(n+1);
+    aligned_vector<int> cols;
+    aligned_vector<double*> data;
+
+    dense.resize(n_rows * n_cols);
+    std::fill(dense.begin(), dense.end(), 0.0);
+
+    rowptr[0] = 0;
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = std::max(i-1, 0); j < std::min(i+2, n); j++)
+        {
+            double* block = new double[b_size];
+            for (int r = 0; r < b_rows; r++)
+            {
+                for (int c = 0; c < b_cols; c++)
+                {
+                    double val = 1.0 / (1 + i + 2*j + 3*r + 5*c);
+                    if (i == j && r == c) val += 4.0;
+                    block[r*b_cols + c] = val;
+                    dense[(i*b_rows + r)*n_cols + j*b_cols + c] = val;
+                }
+            }
+            cols.push_back(j);
+            data.push_back(block);
+        }
+        rowptr[i+1] = cols.size();
+    }
+
+    BSRMatrix* A = new BSRMatrix(n, n, b_rows, b_cols, rowptr, cols, data);
+    for (int i = 0; i < (int) data.size(); i++)
+        delete[] data[i];
+    return A;
+}
+
+void test_block_size(int b_rows, int b_cols)
+{
+    int n = 9;
+    aligned_vector<double> dense;
+    BSRMatrix* A = form_block_tridiag(n, b_rows, b_cols, dense);
+    int n_rows = n * b_rows;
+    int n_cols = n * b_cols;
+
+    aligned_vector<double> x(n_cols);
+    aligned_vector<double> y(n_rows);
+    aligned_vector<double> b(n_rows);
+    aligned_vector<double> r(n_rows);
+    aligned_vector<double> x_T(n_cols);
+    for (int i = 0; i < n_cols; i++)
+        x[i] = 0.5 * i - 3.0;
+    for (int i = 0; i < n_rows; i++)
+        y[i] = 1.0 - 0.25 * i;
+
+    // b <- A*x, r <- y - A*x
+    A->spmv(x.data(), b.data());
+    A->spmv_residual(x.data(), y.data(), r.data());
+    for (int i = 0; i < n_rows; i++)
+    {
+        double sum = 0.0;
+        for (int j = 0; j < n_cols; j++)
+            sum += dense[i*n_cols + j] * x[j];
+        ASSERT_NEAR(b[i], sum, 1e-10);
+        ASSERT_NEAR(r[i], y[i] - sum, 1e-10);
+    }
+
+    // x_T <- A^T*y
+    std::fill(x_T.begin(), x_T.end(), 0.0);
+    A->spmv_append_T(y.data(), x_T.data());
+    for (int j = 0; j < n_cols; j++)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < n_rows; i++)
+            sum += dense[i*n_cols + j] * y[i];
+        ASSERT_NEAR(x_T[j], sum, 1e-10);
+    }
+
+    // C <- A*A for square blocks
+    if (b_rows == b_cols)
+    {
+        CSRMatrix* C = A->mult(A);
+        aligned_vector<double> C_dense(n_rows * n_cols, 0.0);
+        for (int i = 0; i < C->n_rows; i++)
+        {
+            for (int j = C->idx1[i]; j < C->idx1[i+1]; j++)
+            {
+                double* block = ((BSRMatrix*) C)->block_vals[j];
+                int col = C->idx2[j];
+                for (int k = 0; k < b_rows; k++)
+                    for (int l = 0; l < b_cols; l++)
+                        C_dense[(i*b_rows + k)*n_cols + col*b_cols + l] = 
+                            block[k*b_cols + l];
+            }
+        }
+        for (int i = 0; i < n_rows; i++)
+        {
+            for (int j = 0; j < n_cols; j++)
+            {
+                double sum = 0.0;
+                for (int k = 0; k < n_cols; k++)
+                    sum += dense[i*n_cols + k] * dense[k*n_cols + j];
+                ASSERT_NEAR(C_dense[i*n_cols + j], sum, 1e-10);
+            }
+        }
+        delete C;
+    }
+
+    delete A;
+}
+
+TEST(BSRKernelsTest, TestsInUtil)
+{
+    // Fixed size kernels
+    test_block_size(2, 2);
+    test_block_size(3, 3);
+    test_block_size(4, 4);
+    test_block_size(6, 6);
+
+    // Runtime fallback
+    test_block_size(1, 1);
+    test_block_size(5, 5);
+    test_block_size(2, 3);
+} // end of TEST(BSRKernelsTest, TestsInUtil) //
@@ -47,9 +47,45 @@ TEST(ParMatrixAddTest, TestsInUtil)
     AS_rap = A->subtract(S);
 
     compare(AS, AS_rap);
+    delete AS_rap;
+
+    // Scaled sum 2A - 2S
+    AS_rap = A->add(S, 2.0, -2.0);
+    for (aligned_vector<double>::iterator it = AS->on_proc->vals.begin();
+            it != AS->on_proc->vals.end(); ++it)
+        *it *= 2.0;
+    for (aligned_vector<double>::iterator it = AS->off_proc->vals.begin();
+            it != AS->off_proc->vals.end(); ++it)
+        *it *= 2.0;
+    compare(AS, AS_rap);
+    delete AS_rap;
+    delete AS;
 
+    // Planned sums (formed, then reused) match A + S
+    AS = readParMatrix(AS0_fn);
+    ParAddPlan plan;
+    for (int i = 0; i < 2; i++)
+    {
+        AS_rap = A->add(S, 1.0, 1.0, &plan);
+        ASSERT_TRUE(plan.formed);
+        compare(AS, AS_rap);
+        delete AS_rap;
+    }
+    delete AS;
+
+    // Planned sums with new values in the same pattern match a new add
+    ParCSRMatrix* S2 = S->copy();
+    for (int j = 0; j < S2->on_proc->nnz; j++)
+        S2->on_proc->vals[j] *= (j % 3) + 2;
+    for (int j = 0; j < S2->off_proc->nnz; j++)
+        S2->off_proc->vals[j] *= (j % 3) + 2;
+    AS = A->add(S2, 1.0, 1.0);
+    AS_rap = A->add(S2, 1.0, 1.0, &plan);
+    compare(AS, AS_rap);
     delete AS_rap;
     delete AS;
+    delete S2;
+
     delete S;
     delete A;
 
@@ -0,0 +1,113 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/diffusion.hpp"
+#include "gallery/par_stencil.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Each product of a ParMultiVector must match the same product 
+// applied to its vectors one at a time
+void compare_multi_vector(ParCSRMatrix* A, int n_vecs, bool tap)
+{
+    ParMultiVector X(A->global_num_cols, A->on_proc_num_cols, 
+            A->partition->first_local_col, n_vecs);
+    ParMultiVector Y(A->global_num_rows, A->local_num_rows,
+            A->partition->first_local_row, n_vecs);
+    ParMultiVector B(Y), R(Y), B_app(Y), B_T(X);
+    ParVector x, y, b, r, b_T;
+
+    for (int i = 0; i < A->on_proc_num_cols; i++)
+        for (int v = 0; v < n_vecs; v++)
+            X(i, v) = sin(0.1 * (A->partition->first_local_col + i) + v);
+    for (int i = 0; i < A->local_num_rows; i++)
+        for (int v = 0; v < n_vecs; v++)
+            Y(i, v) = cos(0.2 * (A->partition->first_local_row + i) * (v + 1));
+    B_app.copy(Y);
+
+    A->mult(X, B, tap);
+    A->residual(X, Y, R, tap);
+    A->mult_append(X, B_app, tap);
+    A->mult_T(Y, B_T, tap);
+
+    double norms[32], dots[32];
+    B.norm(2, norms);
+    B.inner_product(Y, dots);
+
+    for (int v = 0; v < n_vecs; v++)
+    {
+        X.get_vector(v, x);
+        Y.get_vector(v, y);
+        b.resize(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+        r.resize(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+        b_T.resize(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+
+        A->mult(x, b, tap);
+        A->residual(x, y, r, tap);
+        A->mult_T(y, b_T, tap);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(B(i, v), b[i], 1e-12);
+            ASSERT_NEAR(R(i, v), r[i], 1e-12);
+            ASSERT_NEAR(B_app(i, v), y[i] + b[i], 1e-12);
+        }
+        for (int i = 0; i < A->on_proc_num_cols; i++)
+        {
+            ASSERT_NEAR(B_T(i, v), b_T[i], 1e-12);
+        }
+
+        ASSERT_NEAR(norms[v], b.norm(2), 1e-10);
+        ASSERT_NEAR(dots[v], b.inner_product(y), 1e-10);
+
+        // Round trip through set_vector
+        b.scale(2.0);
+        B.set_vector(v, b);
+        for (int i = 0; i < A->local_num_rows; i++)
+            ASSERT_EQ(B(i, v), b[i]);
+    }
+}
+
+TEST(ParMultiVectorTest, TestsInUtil)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    int sizes[5] = {1, 3, 4, 8, 11};
+    for (int s = 0; s < 5; s++)
+    {
+        compare_multi_vector(A, sizes[s], false);
+        compare_multi_vector(A, sizes[s], true);
+    }
+    delete A;
+
+    int grid_2d[2] = {25, 25};
+    stencil = diffusion_stencil_2d(0.001, M_PI/8.0);
+    A = par_stencil_grid(stencil, grid_2d, 2);
+    delete[] stencil;
+    compare_multi_vector(A, 16, false);
+    compare_multi_vector(A, 16, true);
+
+    // Solve phase copies are applied to one vector at a time
+    A->init_sell();
+    compare_multi_vector(A, 3, false);
+    A->clear_sell();
+    A->init_float();
+    compare_multi_vector(A, 3, true);
+    A->clear_float();
+    delete A;
+
+} // end of TEST(ParMultiVectorTest, TestsInUtil) //
@@ -0,0 +1,187 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/stencil.hpp"
+#include "gallery/par_stencil.hpp"
+#include "util/linalg/reorder.hpp"
+#include "krylov/par_cg.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Returns B = A(perm, perm)
+CSRMatrix* permute_matrix(CSRMatrix* A, aligned_vector<int>& perm)
+{
+    aligned_vector<int> old_to_new(A->n_rows);
+    for (int i = 0; i < A->n_rows; i++)
+        old_to_new[perm[i]] = i;
+
+    CSRMatrix* B = new CSRMatrix(A->n_rows, A->n_cols, A->nnz);
+    B->idx1[0] = 0;
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        for (int j = A->idx1[perm[i]]; j < A->idx1[perm[i]+1]; j++)
+        {
+            B->idx2.emplace_back(old_to_new[A->idx2[j]]);
+            B->vals.emplace_back(A->vals[j]);
+        }
+        B->idx1[i+1] = B->idx2.size();
+    }
+    B->nnz = B->idx2.size();
+    return B;
+}
+
+void check_permutation(aligned_vector<int>& perm, int n)
+{
+    ASSERT_EQ((int) perm.size(), n);
+    aligned_vector<int> found(n, 0);
+    for (int i = 0; i < n; i++)
+    {
+        ASSERT_GE(perm[i], 0);
+        ASSERT_LT(perm[i], n);
+        ASSERT_EQ(found[perm[i]], 0);
+        found[perm[i]] = 1;
+    }
+}
+
+TEST(ParReorderTest, TestsInUtil)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // RCM recovers a narrow band from a randomly ordered grid
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    CSRMatrix* A_seq = stencil_grid(stencil, grid, 3);
+    int n = A_seq->n_rows;
+    aligned_vector<int> scramble(n);
+    std::iota(scramble.begin(), scramble.end(), 0);
+    srand(2448422);
+    for (int i = n - 1; i > 0; i--)
+        std::swap(scramble[i], scramble[rand() % (i + 1)]);
+    CSRMatrix* A_scram = permute_matrix(A_seq, scramble);
+    int scram_bw = bandwidth(A_scram);
+    ASSERT_GT(scram_bw, n / 2);
+
+    aligned_vector<int> perm;
+    rcm_ordering(A_scram, perm);
+    check_permutation(perm, n);
+    CSRMatrix* A_rcm = permute_matrix(A_scram, perm);
+    ASSERT_LT(bandwidth(A_rcm), scram_bw / 3);
+    delete A_rcm;
+
+    rcm_ordering(A_scram, perm, PeripheralRCM);
+    check_permutation(perm, n);
+    A_rcm = permute_matrix(A_scram, perm);
+    ASSERT_LT(bandwidth(A_rcm), scram_bw / 3);
+    delete A_rcm;
+    delete A_scram;
+    delete A_seq;
+
+    // Permuting local rows and columns of a ParCSRMatrix permutes 
+    // the local values of its products
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+    ParCSRMatrix* A_perm = A->copy();
+
+    ParVector x(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector x_perm(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b_perm(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    for (int i = 0; i < A->on_proc_num_cols; i++)
+    {
+        x[i] = sin(0.1 * (A->partition->first_local_col + i));
+    }
+    A->mult(x, b);
+    A_perm->mult(x, b_perm);
+
+    rcm_ordering((CSRMatrix*) A_perm->on_proc, perm);
+    A_perm->permute_local_rows(perm);
+    A_perm->permute_on_proc_cols(perm);
+    ASSERT_TRUE(A_perm->on_proc->sorted);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_EQ(A_perm->local_row_map[i], A->local_row_map[perm[i]]);
+        ASSERT_EQ(A_perm->on_proc_column_map[i], A->on_proc_column_map[perm[i]]);
+        x_perm[i] = x[perm[i]];
+    }
+    A_perm->mult(x_perm, b_perm);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_NEAR(b_perm[i], b[perm[i]], 1e-12);
+    }
+    delete A_perm;
+
+    // Reordered hierarchies converge identically with Jacobi, returning
+    // solutions in the original ordering
+    ParVector sol(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector sol_perm(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector rhs(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        rhs[i] = 1.0 + cos(0.2 * (A->partition->first_local_row + i));
+    }
+
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, RS, Direct, Classical, Jacobi);
+    ml->relax_weight = 0.8;
+    ml->setup(A);
+    sol.set_const_value(0.0);
+    int iter = ml->solve(sol, rhs);
+    aligned_vector<double> res = ml->get_residuals();
+
+    aligned_vector<double> pcg_res;
+    sol_perm.set_const_value(0.0);
+    PCG(A, ml, sol_perm, rhs, pcg_res, 1e-8, 20);
+    aligned_vector<double> pcg_sol(sol_perm.local.values);
+    delete ml;
+
+    reorder_t types[2] = {RCM, PeripheralRCM};
+    for (int t = 0; t < 2; t++)
+    {
+        ml = new ParRugeStubenSolver(0.25, RS, Direct, Classical, Jacobi);
+        ml->relax_weight = 0.8;
+        ml->local_reorder = types[t];
+        ml->setup(A);
+        check_permutation(ml->local_perm, A->local_num_rows);
+
+        sol_perm.set_const_value(0.0);
+        int iter_perm = ml->solve(sol_perm, rhs);
+        aligned_vector<double>& res_perm = ml->get_residuals();
+        ASSERT_EQ(iter, iter_perm);
+        for (int i = 0; i < iter; i++)
+        {
+            ASSERT_NEAR(res[i], res_perm[i], 1e-10 * (1.0 + res[i]));
+        }
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(sol[i], sol_perm[i], 1e-8);
+        }
+
+        // Preconditioning calls cycle directly, with vectors in the 
+        // original ordering
+        aligned_vector<double> pcg_res_perm;
+        sol_perm.set_const_value(0.0);
+        PCG(A, ml, sol_perm, rhs, pcg_res_perm, 1e-8, 20);
+        ASSERT_EQ(pcg_res.size(), pcg_res_perm.size());
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(pcg_sol[i], sol_perm[i], 1e-8);
+        }
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParReorderTest, TestsInUtil) //
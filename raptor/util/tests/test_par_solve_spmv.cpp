@@ -0,0 +1,427 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/par_stencil.hpp"
+#include "util/linalg/par_relax.hpp"
+#include "krylov/par_cg.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Solve phase storage of a ParCSRMatrix, formed once setup is done
+enum solve_format_t { SELLSolve, FloatSolve, CompressedSolve, SymSolve };
+
+void init_solve(ParCSRMatrix* A, solve_format_t format)
+{
+    switch (format)
+    {
+        case SELLSolve: A->init_sell(8, 32); break;
+        case FloatSolve: A->init_float(); break;
+        case CompressedSolve: A->init_compressed(); break;
+        case SymSolve: ASSERT_TRUE(A->init_symmetric()); break;
+    }
+}
+
+void clear_solve(ParCSRMatrix* A, solve_format_t format)
+{
+    switch (format)
+    {
+        case SELLSolve: A->clear_sell(); break;
+        case FloatSolve: A->clear_float(); break;
+        case CompressedSolve: A->clear_compressed(); break;
+        case SymSolve: A->clear_symmetric(); break;
+    }
+}
+
+Matrix* solve_copy(ParCSRMatrix* A, solve_format_t format)
+{
+    switch (format)
+    {
+        case SELLSolve: return A->on_proc_sell;
+        case FloatSolve: return A->on_proc_float;
+        case CompressedSolve: return A->on_proc_compressed;
+        case SymSolve: return A->on_proc_sym;
+    }
+    return NULL;
+}
+
+void use_solve(ParMultilevel* ml, solve_format_t format)
+{
+    switch (format)
+    {
+        case SELLSolve: ml->sell_solve = true; break;
+        case FloatSolve: ml->float_coarse_level = 0; break;
+        case CompressedSolve: ml->compressed_solve = true; break;
+        case SymSolve: ml->symmetric_solve = true; break;
+    }
+}
+
+void relax(int method, ParCSRMatrix* A, ParVector& x, ParVector& b,
+        ParVector& tmp)
+{
+    if (method == 0) jacobi(A, x, b, tmp, 2, 0.8);
+    else if (method == 1) sor(A, x, b, tmp, 2, 1.0);
+    else ssor(A, x, b, tmp, 2, 1.0);
+}
+
+class ParSolveSpMVTest : public ::testing::TestWithParam<solve_format_t> {};
+
+// Every solve phase copy gives the products, relaxation sweeps, and
+// AMG convergence of the CSR matrix it is formed from
+TEST_P(ParSolveSpMVTest, TestsInUtil)
+{
+    solve_format_t format = GetParam();
+
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector x_solve(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b_T(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b_T_solve(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector y(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector y_solve(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r_solve(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector tmp(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    for (int i = 0; i < A->on_proc_num_cols; i++)
+    {
+        x[i] = sin(0.1 * (A->partition->first_local_col + i));
+    }
+    b.set_const_value(1.0);
+
+    A->mult(x, y);
+    A->mult_T(b, b_T);
+    A->residual(x, b, r);
+
+    // Values of the stencil are exact in single precision, so every
+    // format matches to double precision accumulation
+    init_solve(A, format);
+    ASSERT_TRUE(solve_copy(A, format) != NULL);
+    ASSERT_TRUE(A->solve_on_proc() == solve_copy(A, format));
+    A->mult(x, y_solve);
+    A->mult_T(b, b_T_solve);
+    A->residual(x, b, r_solve);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_NEAR(y[i], y_solve[i], 1e-12);
+        ASSERT_NEAR(r[i], r_solve[i], 1e-12);
+    }
+    for (int i = 0; i < A->on_proc_num_cols; i++)
+    {
+        ASSERT_NEAR(b_T[i], b_T_solve[i], 1e-12);
+    }
+    A->mult_append(x, y_solve);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_NEAR(2.0 * y[i], y_solve[i], 1e-12);
+    }
+    clear_solve(A, format);
+    ASSERT_TRUE(A->solve_on_proc() == A->on_proc);
+
+    // Jacobi, SOR, and SSOR sweeps match those over CSR
+    for (int method = 0; method < 3; method++)
+    {
+        x.set_const_value(0.0);
+        x_solve.set_const_value(0.0);
+        init_solve(A, format);
+        relax(method, A, x_solve, b, tmp);
+        clear_solve(A, format);
+        relax(method, A, x, b, tmp);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(x[i], x_solve[i], 1e-12);
+        }
+    }
+
+    // AMG with the copy on every level but the coarsest converges as
+    // with CSR (single precision, to within the rounding of A and P)
+    ParVector sol(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector rhs(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    rhs.set_const_value(1.0);
+
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, RS, Direct, Classical, SOR);
+    ml->setup(A);
+    sol.set_const_value(0.0);
+    int iter = ml->solve(sol, rhs);
+    aligned_vector<double> res = ml->get_residuals();
+    delete ml;
+
+    ml = new ParRugeStubenSolver(0.25, RS, Direct, Classical, SOR);
+    use_solve(ml, format);
+    ml->setup(A);
+    ASSERT_TRUE(solve_copy(ml->levels[0]->A, format) != NULL);
+    sol.set_const_value(0.0);
+    int iter_solve = ml->solve(sol, rhs);
+    aligned_vector<double>& res_solve = ml->get_residuals();
+    double tol = format == FloatSolve ? 1e-4 : 1e-10;
+    ASSERT_LE(abs(iter - iter_solve), format == FloatSolve ? 1 : 0);
+    for (int i = 0; i < std::min(iter, iter_solve); i++)
+    {
+        ASSERT_NEAR(res[i], res_solve[i], tol * (1.0 + res[i]));
+    }
+    delete ml;
+
+    delete A;
+} // end of TEST_P(ParSolveSpMVTest, TestsInUtil) //
+
+INSTANTIATE_TEST_CASE_P(SolveFormats, ParSolveSpMVTest,
+        ::testing::Values(SELLSolve, FloatSolve, CompressedSolve, SymSolve));
+
+// Values not exact in single precision are each rounded by at most
+// 2^-24 of their magnitude, bounding the error of every row
+TEST(ParFloatSpMVTest, TestsRounding)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    CSRMatrix* A_on = (CSRMatrix*) A->on_proc;
+    for (int j = 0; j < A_on->nnz; j++)
+    {
+        A_on->vals[j] *= 1.0 + 0.1 * sin(0.7 * j) + 1e-9;
+    }
+    FloatCSRMatrix* A_float = new FloatCSRMatrix(A_on);
+    ASSERT_EQ(A_float->format(), FloatCSR);
+
+    aligned_vector<double> x(A_on->n_cols), b(A_on->n_rows), b_float(A_on->n_rows);
+    for (int i = 0; i < A_on->n_cols; i++)
+    {
+        x[i] = cos(0.3 * i);
+    }
+    A_on->spmv(x.data(), b.data());
+    A_float->spmv(x.data(), b_float.data());
+
+    const double eps_float = 1.0 / (1 << 24);
+    int n_rounded = 0;
+    for (int i = 0; i < A_on->n_rows; i++)
+    {
+        double bound = 1e-14;
+        for (int j = A_on->idx1[i]; j < A_on->idx1[i+1]; j++)
+        {
+            bound += eps_float * fabs(A_on->vals[j] * x[A_on->idx2[j]]);
+            if ((double) (float) A_on->vals[j] != A_on->vals[j]) n_rounded++;
+        }
+        ASSERT_LE(fabs(b[i] - b_float[i]), bound);
+    }
+    if (A_on->nnz)
+    {
+        ASSERT_GT(n_rounded, 0);
+    }
+
+    // Converting back gives the rounded values in the same pattern
+    CSRMatrix* A_csr = A_float->to_CSR();
+    ASSERT_EQ(A_csr->nnz, A_on->nnz);
+    for (int j = 0; j < A_on->nnz; j++)
+    {
+        ASSERT_EQ(A_csr->idx2[j], A_on->idx2[j]);
+        ASSERT_EQ(A_csr->vals[j], (double) (float) A_on->vals[j]);
+    }
+
+    delete A_csr;
+    delete A_float;
+    delete A;
+} // end of TEST(ParFloatSpMVTest, TestsRounding) //
+
+void compare_spmv(CSRMatrix* A, CompressedCSRMatrix* A_comp)
+{
+    aligned_vector<double> x(A->n_cols), y(A->n_rows);
+    aligned_vector<double> b(A->n_rows), b_comp(A->n_rows);
+    aligned_vector<double> b_T(A->n_cols, 0.0), b_T_comp(A->n_cols, 0.0);
+    for (int i = 0; i < A->n_cols; i++)
+        x[i] = sin(0.2 * i);
+    for (int i = 0; i < A->n_rows; i++)
+        y[i] = 1.0 - 0.01 * i;
+
+    A->spmv(x.data(), b.data());
+    A_comp->spmv(x.data(), b_comp.data());
+    for (int i = 0; i < A->n_rows; i++)
+        ASSERT_NEAR(b[i], b_comp[i], 1e-12);
+
+    A->spmv_residual(x.data(), y.data(), b.data());
+    A_comp->spmv_residual(x.data(), y.data(), b_comp.data());
+    for (int i = 0; i < A->n_rows; i++)
+        ASSERT_NEAR(b[i], b_comp[i], 1e-12);
+
+    A->spmv_append_T(y.data(), b_T.data());
+    A_comp->spmv_append_T(y.data(), b_T_comp.data());
+    for (int i = 0; i < A->n_cols; i++)
+        ASSERT_NEAR(b_T[i], b_T_comp[i], 1e-12);
+
+    CSRMatrix* A_csr = A_comp->to_CSR();
+    ASSERT_EQ(A_csr->nnz, A->nnz);
+    for (int j = 0; j < A->nnz; j++)
+    {
+        ASSERT_EQ(A_csr->idx2[j], A->idx2[j]);
+        ASSERT_EQ(A_csr->vals[j], A->vals[j]);
+    }
+    delete A_csr;
+}
+
+// Rows spanning more than 65536 columns fall back to 32-bit column
+// indices among rows of 16-bit offsets, with every value distinct
+TEST(ParCompressedSpMVTest, TestsWideRows)
+{
+    int n_cols = 70000;
+    aligned_vector<int> rowptr = {0, 2, 5, 6};
+    aligned_vector<int> cols = {3, 65538, 0, 5, 69999, 40000};
+    aligned_vector<double> data = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+    CSRMatrix* A_wide = new CSRMatrix(3, n_cols, rowptr, cols, data);
+    CompressedCSRMatrix* A_wide_comp = new CompressedCSRMatrix(A_wide);
+    ASSERT_EQ(A_wide_comp->format(), CompressedCSR);
+    ASSERT_EQ(A_wide_comp->num_wide_rows(), 1);
+    ASSERT_EQ(A_wide_comp->idx2.size(), 3);
+    compare_spmv(A_wide, A_wide_comp);
+    delete A_wide_comp;
+    delete A_wide;
+
+    // Every third row is wide, and entries of narrow rows span up to
+    // the full 16-bit range from the row's base column
+    int n_rows = 300;
+    rowptr.assign(1, 0);
+    cols.clear();
+    data.clear();
+    for (int i = 0; i < n_rows; i++)
+    {
+        int base = (i * 211) % 1000;
+        int span = (i % 3 == 0) ? n_cols - 1 - base : 65535;
+        for (int k = 0; k < 8; k++)
+        {
+            cols.push_back(base + (int) (((long) span * k) / 7));
+            data.push_back(1.0 / (1.0 + cols.size()) + 1e-3 * i);
+        }
+        rowptr.push_back(cols.size());
+    }
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols, rowptr, cols, data);
+    CompressedCSRMatrix* A_comp = new CompressedCSRMatrix(A);
+    ASSERT_EQ(A_comp->num_wide_rows(), n_rows / 3);
+    compare_spmv(A, A_comp);
+    delete A_comp;
+    delete A;
+} // end of TEST(ParCompressedSpMVTest, TestsWideRows) //
+
+// Removes entry j of a scalar CSR matrix
+void remove_entry(Matrix* A, int j)
+{
+    A->idx2.erase(A->idx2.begin() + j);
+    A->vals.erase(A->vals.begin() + j);
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        if (A->idx1[i+1] > j) A->idx1[i+1]--;
+    }
+    A->nnz--;
+}
+
+// The upper triangle replaces on_proc only if on_proc is symmetric
+// in both pattern and values; otherwise on_proc is left unchanged
+TEST(ParSymSpMVTest, TestsInitSymmetric)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+    A->on_proc->sort();
+
+    // Upper triangle expands back to the (sorted) diagonal block
+    CSRMatrix* A_on = (CSRMatrix*) A->on_proc->copy();
+    SymCSRMatrix* A_sym = new SymCSRMatrix(A_on);
+    ASSERT_EQ(A_sym->format(), SymCSR);
+    ASSERT_LT(A_sym->nnz, A_on->nnz / 2 + A_on->n_rows + 1);
+    CSRMatrix* A_csr = A_sym->to_CSR();
+    ASSERT_EQ(A_csr->nnz, A_on->nnz);
+    for (int j = 0; j < A_on->nnz; j++)
+    {
+        ASSERT_EQ(A_csr->idx2[j], A_on->idx2[j]);
+        ASSERT_EQ(A_csr->vals[j], A_on->vals[j]);
+    }
+    delete A_csr;
+    delete A_sym;
+
+    // on_proc holds no entries until the copy is cleared, and copies
+    // of A expand the upper triangle
+    ASSERT_TRUE(A->init_symmetric());
+    ASSERT_EQ(A->on_proc->nnz, 0);
+    ParCSRMatrix* A_copy = A->copy();
+    ASSERT_EQ(A_copy->on_proc->nnz, A_on->nnz);
+    delete A_copy;
+    A->clear_symmetric();
+    ASSERT_EQ(A->on_proc->nnz, A_on->nnz);
+
+    // CG converges as with the full diagonal block
+    ParVector x(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector x_sym(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    b.set_const_value(1.0);
+    aligned_vector<double> res, res_sym;
+    x.set_const_value(0.0);
+    CG(A, x, b, res, 1e-8, 100);
+    A->init_symmetric();
+    x_sym.set_const_value(0.0);
+    CG(A, x_sym, b, res_sym, 1e-8, 100);
+    A->clear_symmetric();
+    ASSERT_EQ(res.size(), res_sym.size());
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_NEAR(x[i], x_sym[i], 1e-8);
+    }
+
+    // Mirror entries of different values, of a missing lower entry,
+    // and of a missing upper entry
+    Matrix* on_proc = A->on_proc;
+    int row = 1;
+    int lower = -1;
+    for (; row < on_proc->n_rows && lower < 0; row++)
+    {
+        for (int j = on_proc->idx1[row]; j < on_proc->idx1[row+1]; j++)
+        {
+            if (on_proc->idx2[j] == row - 1) lower = j;
+        }
+    }
+    row--;
+    if (lower >= 0)
+    {
+        on_proc->vals[lower] += 1.0;
+        ASSERT_FALSE(A->init_symmetric());
+        ASSERT_TRUE(A->on_proc_sym == NULL);
+        ASSERT_EQ(on_proc->nnz, A_on->nnz);
+        on_proc->vals[lower] -= 1.0;
+        ASSERT_TRUE(A->init_symmetric());
+        A->clear_symmetric();
+
+        remove_entry(on_proc, lower);
+        ASSERT_FALSE(A->init_symmetric());
+        ASSERT_TRUE(A->on_proc_sym == NULL);
+        ASSERT_EQ(on_proc->nnz, A_on->nnz - 1);
+
+        delete A->on_proc;
+        A->on_proc = A_on->copy();
+        on_proc = A->on_proc;
+        int upper = on_proc->idx1[row-1];
+        while (on_proc->idx2[upper] != row) upper++;
+        remove_entry(on_proc, upper);
+        ASSERT_FALSE(A->init_symmetric());
+        ASSERT_TRUE(A->on_proc_sym == NULL);
+        ASSERT_EQ(on_proc->nnz, A_on->nnz - 1);
+    }
+
+    delete A_on;
+    delete A;
+} // end of TEST(ParSymSpMVTest, TestsInitSymmetric) //
@@ -0,0 +1,163 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/par_stencil.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Local rows of C, with global column indices
+void global_rows(ParCSRMatrix* C, std::vector<std::map<int, double> >& rows)
+{
+    rows.clear();
+    rows.resize(C->local_num_rows);
+    for (int i = 0; i < C->local_num_rows; i++)
+    {
+        for (int j = C->on_proc->idx1[i]; j < C->on_proc->idx1[i+1]; j++)
+            rows[i][C->on_proc_column_map[C->on_proc->idx2[j]]] += C->on_proc->vals[j];
+        for (int j = C->off_proc->idx1[i]; j < C->off_proc->idx1[i+1]; j++)
+            rows[i][C->off_proc_column_map[C->off_proc->idx2[j]]] += C->off_proc->vals[j];
+    }
+}
+
+// Planned patterns may hold explicit zeros dropped by mult
+void compare(ParCSRMatrix* C, ParCSRMatrix* C_plan)
+{
+    ASSERT_EQ(C->global_num_rows, C_plan->global_num_rows);
+    ASSERT_EQ(C->global_num_cols, C_plan->global_num_cols);
+    ASSERT_EQ(C->local_num_rows, C_plan->local_num_rows);
+    ASSERT_EQ(C->on_proc_num_cols, C_plan->on_proc_num_cols);
+
+    std::vector<std::map<int, double> > rows, rows_plan;
+    global_rows(C, rows);
+    global_rows(C_plan, rows_plan);
+    for (int i = 0; i < C->local_num_rows; i++)
+    {
+        ASSERT_EQ(C->local_row_map[i], C_plan->local_row_map[i]);
+        ASSERT_GE(rows_plan[i].size(), rows[i].size());
+        for (std::map<int, double>::iterator it = rows_plan[i].begin();
+                it != rows_plan[i].end(); ++it)
+        {
+            double val = rows[i].count(it->first) ? rows[i][it->first] : 0.0;
+            ASSERT_NEAR(it->second, val, 1e-12);
+        }
+    }
+}
+
+void scale_values(Matrix* A, double shift)
+{
+    for (int j = 0; j < A->nnz; j++)
+        A->vals[j] *= 1.0 + 0.1 * sin(shift + j);
+}
+
+TEST(ParSpGEMMPlanTest, TestsInUtil)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    // Serial symbolic and numeric phases match spgemm
+    CSRMatrix* A_on = (CSRMatrix*) A->on_proc;
+    CSRMatrix* AA = A_on->mult(A_on);
+    SpGEMMPlan* plan = A_on->spgemm_symbolic(A_on);
+    CSRMatrix* AA_plan = new CSRMatrix(0, 0);
+    A_on->spgemm_numeric(A_on, plan, AA_plan);
+    ASSERT_EQ(AA_plan->n_rows, AA->n_rows);
+    ASSERT_EQ(AA_plan->n_cols, AA->n_cols);
+    AA->sort();
+    for (int i = 0; i < AA->n_rows; i++)
+    {
+        int k = AA_plan->idx1[i];
+        for (int j = AA->idx1[i]; j < AA->idx1[i+1]; j++)
+        {
+            while (AA_plan->idx2[k] != AA->idx2[j])
+                ASSERT_NEAR(AA_plan->vals[k++], 0.0, 1e-12);
+            ASSERT_NEAR(AA_plan->vals[k++], AA->vals[j], 1e-12);
+        }
+    }
+    delete AA;
+    delete AA_plan;
+    delete plan;
+
+    // Galerkin products formed with plans match mult and mult_T, 
+    // before and after the values of A and P change
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, RS, Direct, Classical, Jacobi);
+    ml->max_levels = 2;
+    ml->setup(A);
+    ParCSRMatrix* P = ml->levels[0]->P;
+
+    ParSpGEMMPlan AP_plan, PTAP_plan, tap_plan;
+    for (int step = 0; step < 2; step++)
+    {
+        if (step)
+        {
+            scale_values(A->on_proc, 0.5);
+            scale_values(A->off_proc, 1.5);
+            scale_values(P->on_proc, 2.5);
+            scale_values(P->off_proc, 3.5);
+        }
+
+        ParCSRMatrix* AP = A->mult(P);
+        ParCSRMatrix* AP_planned = A->mult(P, &AP_plan);
+        compare(AP, AP_planned);
+        ParCSRMatrix* AP_tap = A->mult(P, &tap_plan, true);
+        compare(AP, AP_tap);
+        ASSERT_TRUE(AP_plan.formed);
+
+        ParCSRMatrix* PTAP = AP->mult_T(P);
+        ParCSRMatrix* PTAP_planned = AP_planned->mult_T(P, &PTAP_plan);
+        compare(PTAP, PTAP_planned);
+
+        delete AP;
+        delete AP_planned;
+        delete AP_tap;
+        delete PTAP;
+        delete PTAP_planned;
+    }
+
+    delete ml;
+    delete A;
+
+} // end of TEST(ParSpGEMMPlanTest, TestsInUtil) //
+
+TEST(ParSpGEMMPlanTest, TestsPipelinedMult)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    // mult multiplies the rows of each message as it arrives, while
+    // TAP mult multiplies all received rows at once
+    ParCSRMatrix* AA = A->mult(A);
+    ParCSRMatrix* AA_tap = A->mult(A, true);
+    compare(AA, AA_tap);
+    compare(AA_tap, AA);
+
+    // A*A has a wider halo, so rows arrive in more messages
+    ParCSRMatrix* AAA = AA->mult(A);
+    ParCSRMatrix* AAA_tap = AA->mult(A, true);
+    compare(AAA, AAA_tap);
+    compare(AAA_tap, AAA);
+
+    delete AAA;
+    delete AAA_tap;
+    delete AA;
+    delete AA_tap;
+    delete A;
+
+} // end of TEST(ParSpGEMMPlanTest, TestsPipelinedMult) //
@@ -0,0 +1,73 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+#include "gallery/matrix_IO.hpp"
+#include "util/linalg/spmv_simd.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+void compare_simd(const char* filename)
+{
+    CSRMatrix* A = readMatrix(filename);
+    int n_rows = A->n_rows;
+
+    aligned_vector<double> x(A->n_cols);
+    aligned_vector<double> y(n_rows);
+    for (int i = 0; i < A->n_cols; i++)
+        x[i] = sin(0.1 * i) + 1.0;
+    for (int i = 0; i < n_rows; i++)
+        y[i] = cos(0.3 * i);
+
+    // Reference values from the scalar kernels
+    aligned_vector<double> b_ref(n_rows);
+    aligned_vector<double> r_ref(n_rows);
+    aligned_vector<double> app_ref(y);
+    set_simd(NoSIMD);
+    A->spmv(x.data(), b_ref.data());
+    A->spmv_residual(x.data(), y.data(), r_ref.data());
+    A->spmv_append(x.data(), app_ref.data());
+
+    aligned_vector<double> b(n_rows);
+    aligned_vector<double> r(n_rows);
+    aligned_vector<double> app(n_rows);
+    for (int isa = AVX2; isa <= AVX512; isa++)
+    {
+        if (!simd_supported((simd_t) isa)) continue;
+        set_simd((simd_t) isa);
+        ASSERT_EQ(get_simd(), isa);
+
+        app = y;
+        A->spmv(x.data(), b.data());
+        A->spmv_residual(x.data(), y.data(), r.data());
+        A->spmv_append(x.data(), app.data());
+
+        // Only summation order differs from the scalar kernels
+        for (int i = 0; i < n_rows; i++)
+        {
+            double tol = 1e-12 * (1.0 + fabs(b_ref[i]) + fabs(y[i]));
+            ASSERT_NEAR(b[i], b_ref[i], tol);
+            ASSERT_NEAR(r[i], r_ref[i], tol);
+            ASSERT_NEAR(app[i], app_ref[i], tol);
+        }
+    }
+
+    set_simd(detect_simd());
+    delete A;
+}
+
+TEST(SIMDSpMVTest, TestsInUtil)
+{
+    compare_simd("../../../../test_data/laplacian27.pm");
+    compare_simd("../../../../test_data/aniso.pm");
+    compare_simd("../../../../test_data/random.pm");
+    compare_simd("../../../../test_data/rss_A0.pm");
+} // end of TEST(SIMDSpMVTest, TestsInUtil) //